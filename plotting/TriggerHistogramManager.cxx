@@ -209,6 +209,10 @@ void TriggerHistogramManager::LoadHistograms(){
  *       Axis 3                    Centrality
  *       Axis 4     Data level (Reconstructed / Generator level)
  *       Axis 5                Trigger selection
+ *
+ * In the turn-on-only mode, the jet histograms have the axes [jet pT][centrality][data level][trigger selection].
+ * If they were booked, the phi and eta distributions are in histograms named inclusiveJetPhi and inclusiveJetEta
+ * with phi or eta as the first axis and the same other axes.
  */
 void TriggerHistogramManager::LoadJetHistograms(){
   
@@ -224,6 +228,16 @@ void TriggerHistogramManager::LoadJetHistograms(){
   
   int nAxes = 3;           // Number of constraining axes for this iteration
   
+  // Find the axes from the layout of the jet histograms in the file
+  bool turnOnOnly = false;
+  bool hasEtaPhiHistograms = false;
+  THnSparseD *jetHistogram = (THnSparseD*) fInputFile->Get(fJetHistogramName[0]);
+  if(jetHistogram != nullptr) turnOnOnly = (jetHistogram->GetNdimensions() == 4);
+  if(turnOnOnly) hasEtaPhiHistograms = (fInputFile->Get(Form("%sEta",fJetHistogramName[0])) != nullptr);
+  const int centralityAxis = turnOnOnly ? 1 : 3;
+  const int dataLevelAxis = turnOnOnly ? 2 : 4;
+  const int triggerAxis = turnOnOnly ? 3 : 5;
+  
   
   for(int iCentralityBin = fFirstLoadedCentralityBin; iCentralityBin <= fLastLoadedCentralityBin; iCentralityBin++){
     
@@ -232,17 +246,17 @@ void TriggerHistogramManager::LoadJetHistograms(){
     higherCentralityBin = fCentralityBinIndices[iCentralityBin+1]+duplicateRemoverCentrality;
     
     
-    axisIndices[0] = 3; lowLimits[0] = lowerCentralityBin; highLimits[0] = higherCentralityBin;  // Centrality
+    axisIndices[0] = centralityAxis; lowLimits[0] = lowerCentralityBin; highLimits[0] = higherCentralityBin;  // Centrality
     
     for(int iDataLevel = 0; iDataLevel < TriggerHistograms::knDataLevels; iDataLevel++){
       
       // Select the correct data level
-      axisIndices[1] = 4; lowLimits[1] = iDataLevel+1; highLimits[1] = iDataLevel+1;
+      axisIndices[1] = dataLevelAxis; lowLimits[1] = iDataLevel+1; highLimits[1] = iDataLevel+1;
       
       for(int iTrigger = 0; iTrigger <= TriggerHistograms::knTriggerTypes; iTrigger++){
         
         // Apply trigger selection on top of the base trigger
-        axisIndices[2] = 5; lowLimits[2] = iTrigger+1; highLimits[2] = iTrigger+1;
+        axisIndices[2] = triggerAxis; lowLimits[2] = iTrigger+1; highLimits[2] = iTrigger+1;
         
         for(int iJetType = 0; iJetType < knJetTypes; iJetType++){
           
@@ -252,6 +266,14 @@ void TriggerHistogramManager::LoadJetHistograms(){
           
           if(!fLoadJets) continue;  // Only load the remaining jet histograms if selected
           
+          // In the turn-on-only mode, there are only the separate phi and eta histograms if requested
+          if(turnOnOnly){
+            if(!hasEtaPhiHistograms) continue;
+            fhJetPhi[iJetType][iCentralityBin][iDataLevel][iTrigger] = FindHistogram(fInputFile,Form("%sPhi",fJetHistogramName[iJetType]),0,nAxes,axisIndices,lowLimits,highLimits);
+            fhJetEta[iJetType][iCentralityBin][iDataLevel][iTrigger] = FindHistogram(fInputFile,Form("%sEta",fJetHistogramName[iJetType]),0,nAxes,axisIndices,lowLimits,highLimits);
+            continue;
+          }
+          
           fhJetPhi[iJetType][iCentralityBin][iDataLevel][iTrigger] = FindHistogram(fInputFile,fJetHistogramName[iJetType],1,nAxes,axisIndices,lowLimits,highLimits);
           fhJetEta[iJetType][iCentralityBin][iDataLevel][iTrigger] = FindHistogram(fInputFile,fJetHistogramName[iJetType],2,nAxes,axisIndices,lowLimits,highLimits);
           if(fLoad2DHistograms) fhJetEtaPhi[iJetType][iCentralityBin][iDataLevel][iTrigger] = FindHistogram2D(fInputFile,fJetHistogramName[iJetType],1,2,nAxes,axisIndices,lowLimits,highLimits);
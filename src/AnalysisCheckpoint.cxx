@@ -0,0 +1,252 @@
+// Implementation for AnalysisCheckpoint
+
+// C++ includes
+#include <iostream>
+#include <cstring>
+#include <assert.h>
+
+// Root includes
+#include <TFile.h>
+#include <TTree.h>
+#include <TMath.h>
+
+// Own includes
+#include "AnalysisCheckpoint.h"
+
+using namespace std;
+
+// Name of the tree listing the completed units in the checkpoint file
+const char *AnalysisCheckpoint::kUnitTreeName = "checkpointUnits";
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   TString fileName = Name of the checkpoint file
+ *   const std::vector<TString> &inputFileNames = Input file list of the analysis
+ *   Int_t nWorkers = Number of workers analyzing the files
+ *   Int_t fileInterval = Write a checkpoint after this many completed input files. 0 = Not used.
+ *   Double_t minuteInterval = Write a checkpoint after this many minutes. 0 = Not used.
+ */
+AnalysisCheckpoint::AnalysisCheckpoint(TString fileName, const std::vector<TString> &inputFileNames, Int_t nWorkers, Int_t fileInterval, Double_t minuteInterval) :
+  fFileName(fileName),
+  fInputFileNames(inputFileNames),
+  fFileInterval(fileInterval),
+  fTimeInterval(minuteInterval*60),
+  fStartTime(chrono::steady_clock::now()),
+  fWorkerMutex(nWorkers),
+  fWorkerUnits(nWorkers),
+  fFileEntries(inputFileNames.size(), -1),
+  fCompletedEntries(inputFileNames.size(), 0),
+  fPreviousUnits(inputFileNames.size()),
+  fnCompletedFiles(0),
+  fnCompletedFilesAtWrite(0),
+  fPreviousWriteTime(0)
+{
+  // Custom constructor
+}
+
+/*
+ * Destructor
+ */
+AnalysisCheckpoint::~AnalysisCheckpoint(){
+  // destructor
+}
+
+/*
+ * Lock held by a worker while it processes a unit and when its histograms are added to a checkpoint
+ */
+std::mutex& AnalysisCheckpoint::GetWorkerMutex(Int_t iWorker){
+  return fWorkerMutex.at(iWorker);
+}
+
+/*
+ * Record a unit as completed by a worker. The worker must hold its lock, so that the unit is included in a checkpoint
+ * together with the histograms filled from it.
+ *
+ *  Arguments:
+ *   Int_t iWorker = Index of the worker that processed the unit
+ *   const AnalysisTask &unit = Range of entries in a file that is completed
+ *   Long64_t nFileEntries = Number of entries in the file
+ */
+void AnalysisCheckpoint::AddCompletedUnit(Int_t iWorker, const AnalysisTask &unit, Long64_t nFileEntries){
+  fWorkerUnits.at(iWorker).push_back(unit);
+
+  lock_guard<mutex> fileLock(fFileMutex);
+  fFileEntries.at(unit.fFileIndex) = nFileEntries;
+  
+  // The units from the previous runs can extend past the end of the file, so they are counted once the size is known
+  for(const AnalysisTask &previousUnit : fPreviousUnits.at(unit.fFileIndex)){
+    fCompletedEntries.at(unit.fFileIndex) += TMath::Max(0LL, TMath::Min(previousUnit.fLastEntry, nFileEntries) - previousUnit.fFirstEntry);
+  }
+  fPreviousUnits.at(unit.fFileIndex).clear();
+  
+  fCompletedEntries.at(unit.fFileIndex) += unit.fLastEntry - unit.fFirstEntry;
+  if(fCompletedEntries.at(unit.fFileIndex) == nFileEntries) fnCompletedFiles++;
+}
+
+/*
+ * Set the units completed in the previous runs. They are already in the earlier checkpoint files, so they are only
+ * used to find out when a file is complete. A unit reaching past the end of the file covers the rest of the file.
+ *
+ *  Arguments:
+ *   const std::vector<AnalysisTask> &units = Units completed in the previous runs
+ *   const std::vector<Long64_t> &fileEntries = Number of entries in each input file. Negative if not known.
+ */
+void AnalysisCheckpoint::SetPreviousUnits(const std::vector<AnalysisTask> &units, const std::vector<Long64_t> &fileEntries){
+  lock_guard<mutex> fileLock(fFileMutex);
+  fFileEntries = fileEntries;
+  for(const AnalysisTask &unit : units){
+    fPreviousUnits.at(unit.fFileIndex).push_back(unit);
+  }
+}
+
+/*
+ * Units completed by a worker. The worker lock must be held while the units are read.
+ */
+const std::vector<AnalysisTask>& AnalysisCheckpoint::GetWorkerUnits(Int_t iWorker) const{
+  return fWorkerUnits.at(iWorker);
+}
+
+/*
+ * Time in seconds since the checkpointing started
+ */
+Double_t AnalysisCheckpoint::GetElapsedTime() const{
+  return chrono::duration<Double_t>(chrono::steady_clock::now() - fStartTime).count();
+}
+
+/*
+ * Check if enough files are completed or enough time has passed since the previous checkpoint
+ */
+Bool_t AnalysisCheckpoint::IsDue() const{
+  if(fFileInterval > 0 && fnCompletedFiles - fnCompletedFilesAtWrite >= fFileInterval) return true;
+  if(fTimeInterval > 0 && GetElapsedTime() - fPreviousWriteTime >= fTimeInterval) return true;
+  return false;
+}
+
+/*
+ * Start writing a checkpoint. Only one worker writes at a time, and the others continue processing.
+ *
+ *   return: True if the calling worker should write the checkpoint, false otherwise
+ */
+Bool_t AnalysisCheckpoint::TryBeginWrite(){
+  if(!fWriteMutex.try_lock()) return false;
+
+  // Another worker might have written the checkpoint just before the lock was taken
+  if(!IsDue()){
+    fWriteMutex.unlock();
+    return false;
+  }
+
+  fnCompletedFilesAtWrite = fnCompletedFiles.load();
+  fPreviousWriteTime = GetElapsedTime();
+  return true;
+}
+
+/*
+ * Finish writing a checkpoint
+ */
+void AnalysisCheckpoint::FinishWrite(){
+  fWriteMutex.unlock();
+}
+
+// Getter for the checkpoint file name
+TString AnalysisCheckpoint::GetFileName() const{
+  return fFileName;
+}
+
+/*
+ * Write the completed units as a tree to the current directory. Each entry has the file index and name, the range
+ * of entries and the number of entries in the file.
+ *
+ *  Arguments:
+ *   const std::vector<AnalysisTask> &units = Completed units written to the tree
+ */
+void AnalysisCheckpoint::WriteUnits(const std::vector<AnalysisTask> &units) const{
+
+  Int_t fileIndex;
+  char fileName[1024];
+  Long64_t firstEntry;
+  Long64_t lastEntry;
+  Long64_t fileEntries;
+
+  TTree *unitTree = new TTree(kUnitTreeName, "Units of input entries included in the checkpoint");
+  unitTree->Branch("file", &fileIndex, "file/I");
+  unitTree->Branch("fileName", fileName, "fileName/C");
+  unitTree->Branch("firstEntry", &firstEntry, "firstEntry/L");
+  unitTree->Branch("lastEntry", &lastEntry, "lastEntry/L");
+  unitTree->Branch("fileEntries", &fileEntries, "fileEntries/L");
+
+  for(const AnalysisTask &unit : units){
+    fileIndex = unit.fFileIndex;
+    strncpy(fileName, fInputFileNames.at(fileIndex).Data(), sizeof(fileName)-1);
+    fileName[sizeof(fileName)-1] = '\0';
+    firstEntry = unit.fFirstEntry;
+    lastEntry = unit.fLastEntry;
+    fileEntries = fFileEntries.at(fileIndex);
+    unitTree->Fill();
+  }
+
+  unitTree->Write();
+  delete unitTree;
+}
+
+/*
+ * Read the completed units from a checkpoint file and add them to the given list. The input files must be the same
+ * as in the run that wrote the checkpoint.
+ *
+ *  Arguments:
+ *   TString fileName = Name of the checkpoint file
+ *   const std::vector<TString> &inputFileNames = Input file list of the analysis
+ *   std::vector<AnalysisTask> &units = The completed units are added here
+ *   std::vector<Long64_t> &fileEntries = Number of entries in each input file is set here for the files in the checkpoint
+ *
+ *   return: True if the checkpoint could be read, false otherwise
+ */
+Bool_t AnalysisCheckpoint::ReadUnits(TString fileName, const std::vector<TString> &inputFileNames, std::vector<AnalysisTask> &units, std::vector<Long64_t> &fileEntries){
+
+  TFile *checkpointFile = TFile::Open(fileName);
+  if(!checkpointFile || checkpointFile->IsZombie()){
+    delete checkpointFile;
+    return false;
+  }
+
+  TTree *unitTree = (TTree*) checkpointFile->Get(kUnitTreeName);
+  if(!unitTree){
+    checkpointFile->Close();
+    delete checkpointFile;
+    return false;
+  }
+
+  Int_t fileIndex;
+  char unitFileName[1024];
+  Long64_t firstEntry;
+  Long64_t lastEntry;
+  Long64_t nFileEntries;
+  unitTree->SetBranchAddress("file", &fileIndex);
+  unitTree->SetBranchAddress("fileName", unitFileName);
+  unitTree->SetBranchAddress("firstEntry", &firstEntry);
+  unitTree->SetBranchAddress("lastEntry", &lastEntry);
+  unitTree->SetBranchAddress("fileEntries", &nFileEntries);
+
+  AnalysisTask unit;
+  const Long64_t nUnits = unitTree->GetEntries();
+  for(Long64_t iUnit = 0; iUnit < nUnits; iUnit++){
+    unitTree->GetEntry(iUnit);
+
+    if(fileIndex < 0 || fileIndex >= (Int_t)inputFileNames.size() || inputFileNames.at(fileIndex) != unitFileName){
+      cout << "Error! The checkpoint " << fileName.Data() << " was written for a different file list. File " << unitFileName << " does not match." << endl;
+      assert(0);
+    }
+
+    unit.fFileIndex = fileIndex;
+    unit.fFirstEntry = firstEntry;
+    unit.fLastEntry = lastEntry;
+    units.push_back(unit);
+    fileEntries.at(fileIndex) = nFileEntries;
+  }
+
+  checkpointFile->Close();
+  delete checkpointFile;
+  return true;
+}
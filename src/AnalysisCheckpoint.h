@@ -0,0 +1,79 @@
+// Bookkeeping of the analyzed units for writing checkpoints and resuming interrupted jobs
+
+#ifndef ANALYSISCHECKPOINT_H
+#define ANALYSISCHECKPOINT_H
+
+// C++ includes
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+// Root includes
+#include <TString.h>
+
+// Own includes
+#include "WorkStealingScheduler.h"
+
+/*
+ * AnalysisCheckpoint class
+ *
+ * Keeps track of the units of work, ranges of entries in the input files, that are completed by each worker. A
+ * checkpoint holds the merged histograms of all the workers together with the list of the completed units. For the
+ * two to match, a worker holds its own lock while processing a unit and recording it as completed. The worker
+ * writing the checkpoint takes the locks of the other workers one at a time, so each worker is paused only while its
+ * histograms are added to the checkpoint.
+ *
+ * The checkpoint is written to a temporary file that is renamed to the checkpoint file name when complete, so an
+ * interrupted write never leaves a broken checkpoint behind.
+ */
+class AnalysisCheckpoint{
+
+public:
+
+  static const char *kUnitTreeName;   // Name of the tree listing the completed units in the checkpoint file
+
+  // Constructors and destructor
+  AnalysisCheckpoint(TString fileName, const std::vector<TString> &inputFileNames, Int_t nWorkers, Int_t fileInterval, Double_t minuteInterval); // Custom constructor
+  ~AnalysisCheckpoint();                                     // Destructor
+
+  // Methods
+  std::mutex& GetWorkerMutex(Int_t iWorker);                 // Lock held by a worker while it processes a unit
+  void AddCompletedUnit(Int_t iWorker, const AnalysisTask &unit, Long64_t nFileEntries); // Record a completed unit. Needs the worker lock.
+  void SetPreviousUnits(const std::vector<AnalysisTask> &units, const std::vector<Long64_t> &fileEntries); // Units completed in the previous runs
+  const std::vector<AnalysisTask>& GetWorkerUnits(Int_t iWorker) const; // Units completed by a worker. Needs the worker lock.
+  Bool_t IsDue() const;                                      // Check if it is time to write a checkpoint
+  Bool_t TryBeginWrite();                                    // Start writing if it is due and no other worker is writing
+  void FinishWrite();                                        // Finish writing and start counting for the next checkpoint
+  TString GetFileName() const;                               // Getter for the checkpoint file name
+  void WriteUnits(const std::vector<AnalysisTask> &units) const; // Write the completed units as a tree to the current directory
+  static Bool_t ReadUnits(TString fileName, const std::vector<TString> &inputFileNames, std::vector<AnalysisTask> &units, std::vector<Long64_t> &fileEntries); // Read the completed units from a checkpoint file
+
+private:
+
+  // Private methods
+  Double_t GetElapsedTime() const;                           // Time in seconds since the checkpointing started
+
+  // Private data members
+  TString fFileName;                                 // Name of the checkpoint file
+  std::vector<TString> fInputFileNames;              // Names of the input files, written for checking when resuming
+  Int_t fFileInterval;                               // Number of completed input files between checkpoints. 0 = Not used.
+  Double_t fTimeInterval;                            // Time in seconds between checkpoints. 0 = Not used.
+  std::chrono::steady_clock::time_point fStartTime;  // Time when the checkpointing started
+
+  std::vector<std::mutex> fWorkerMutex;              // Lock for the histograms and the completed units of each worker
+  std::vector<std::vector<AnalysisTask>> fWorkerUnits; // Units completed by each worker
+
+  std::mutex fFileMutex;                             // Lock for the entry counts below
+  std::vector<Long64_t> fFileEntries;                // Number of entries in each input file. Negative if not known.
+  std::vector<Long64_t> fCompletedEntries;           // Number of completed entries in each input file
+  std::vector<std::vector<AnalysisTask>> fPreviousUnits; // Units from the previous runs not yet counted in the completed entries
+
+  std::mutex fWriteMutex;                            // Lock held while a checkpoint is written
+  std::atomic<Int_t> fnCompletedFiles;               // Number of completely analyzed input files
+  std::atomic<Int_t> fnCompletedFilesAtWrite;        // Number of completed input files when the previous checkpoint was written
+  std::atomic<Double_t> fPreviousWriteTime;          // Elapsed time when the previous checkpoint was written
+
+};
+
+#endif
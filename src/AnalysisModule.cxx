@@ -0,0 +1,94 @@
+// Implementation for AnalysisModule
+
+// C++ includes
+#include <iostream>
+#include <assert.h>
+
+// Own includes
+#include "AnalysisModule.h"
+#include "DijetModule.h"
+
+using namespace std;
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   TString name = Name of the module
+ *   ConfigurationCard *card = Configuration card for the analysis
+ */
+AnalysisModule::AnalysisModule(TString name, ConfigurationCard *card) :
+  fName(name),
+  fCard(card)
+{
+  // Custom constructor
+}
+
+/*
+ * Destructor
+ */
+AnalysisModule::~AnalysisModule(){
+  // destructor
+}
+
+/*
+ * Called when a worker opens a new file. Nothing is done by default.
+ *
+ *  Arguments:
+ *   Int_t iFile = Index of the file in the file list
+ *   TString fileName = Name of the file
+ */
+void AnalysisModule::BeginFile(Int_t iFile, TString fileName){
+  // Nothing to do by default
+}
+
+/*
+ * Called when a worker has no more tasks. Nothing is done by default.
+ */
+void AnalysisModule::End(){
+  // Nothing to do by default
+}
+
+// Getter for the name of the module
+TString AnalysisModule::GetName() const{
+  return fName;
+}
+
+/*
+ * Registered module creators. The built-in modules are registered when the registry is first used.
+ */
+std::map<TString, AnalysisModule::ModuleCreator>& AnalysisModule::GetRegistry(){
+  static std::map<TString, ModuleCreator> registry = {
+    {"dijet", DijetModule::Create}
+  };
+  return registry;
+}
+
+/*
+ * Register a module creator with a name, so that the module can be given in the card
+ *
+ *  Arguments:
+ *   TString name = Name of the module in the card
+ *   ModuleCreator creator = Function creating the module from the card
+ */
+void AnalysisModule::Register(TString name, ModuleCreator creator){
+  GetRegistry()[name] = creator;
+}
+
+/*
+ * Create a module registered with the given name
+ *
+ *  Arguments:
+ *   TString name = Name of the module in the card
+ *   ConfigurationCard *card = Configuration card for the analysis
+ *
+ *   return: New module. The caller owns it.
+ */
+AnalysisModule* AnalysisModule::Create(TString name, ConfigurationCard *card){
+  std::map<TString, ModuleCreator> &registry = GetRegistry();
+  if(registry.find(name) == registry.end()){
+    cout << "Error! No analysis module with the name " << name.Data() << " is registered" << endl;
+    assert(0);
+  }
+  return registry[name](card);
+}
@@ -0,0 +1,82 @@
+// Interface for additional analyses run in the same pass over the forest as the trigger analysis
+
+#ifndef ANALYSISMODULE_H
+#define ANALYSISMODULE_H
+
+// C++ includes
+#include <map>
+
+// Root includes
+#include <TString.h>
+
+// Own includes
+#include "ConfigurationCard.h"
+#include "ForestReader.h"
+
+/*
+ * Read-only view of an event passing the nominal event selection. The forest reader has all the trees of the event
+ * read, and the event weights, trigger selection and nominal jet selection are the ones used by the trigger analysis.
+ */
+struct EventView{
+  const ForestReader *fReader;     // Reader with the event content
+  Int_t fFileIndex;                // Index of the current file in the file list
+  Long64_t fEntry;                 // Entry of the event in the current file
+  Double_t fVz;                    // Vertex z-position
+  Double_t fCentrality;            // Event centrality
+  Int_t fHiBin;                    // CMS hiBin (centrality * 2)
+  Double_t fPtHat;                 // pT hat for MC events
+  Double_t fEventWeight;           // Product of the vz, centrality and pT hat weights
+  UInt_t fTriggerMask;             // Bit i is set if trigger i fired. Bit TriggerHistograms::knTriggerTypes is always set.
+  const Double_t *fTriggerWeight;  // Event weight multiplied by the trigger prescale for each set bit
+  const ULong64_t *fJetPassMask;   // Bit i is set if jet i passes the nominal jet cuts
+  Int_t fLeadingJetIndex;          // Index of the leading jet passing the nominal jet cuts. -1 if none.
+};
+
+/*
+ * AnalysisModule class
+ *
+ * Base class for analyses that share the event reading and selection of the trigger analysis. The modules to run are
+ * given in the card by name, and each worker creates its own instances with their own histograms. The histograms
+ * should be created in the constructor. The workers call BeginFile when they open a file, ProcessEvent for each event
+ * passing the nominal event selection and End when all their tasks are done. The modules of the workers are then
+ * merged into the modules of the first worker, and Write is called with the directory of the module as the current
+ * directory.
+ *
+ * New modules are added to the list of built-in modules in AnalysisModule.cxx, or registered with Register before the
+ * analyzer is created.
+ */
+class AnalysisModule{
+
+public:
+
+  // Function creating a module from the card
+  typedef AnalysisModule* (*ModuleCreator)(ConfigurationCard *card);
+
+  // Constructors and destructor
+  AnalysisModule(TString name, ConfigurationCard *card); // Custom constructor
+  virtual ~AnalysisModule();                             // Destructor
+
+  // Methods implemented by the modules
+  virtual void BeginFile(Int_t iFile, TString fileName);       // Called when a worker opens a new file
+  virtual void ProcessEvent(const EventView &event) = 0;       // Analyze an event passing the nominal event selection
+  virtual void End();                                          // Called when a worker has no more tasks
+  virtual void Merge(const AnalysisModule *other) = 0;         // Add the histograms from the same module of another worker
+  virtual void Write() const = 0;                              // Write the histograms to the current directory
+
+  // Methods
+  TString GetName() const;                                      // Getter for the name of the module
+  static AnalysisModule* Create(TString name, ConfigurationCard *card); // Create a module registered with the given name
+  static void Register(TString name, ModuleCreator creator);   // Register a module creator with a name
+
+protected:
+
+  TString fName;                // Name of the module. The histograms are written to a directory with this name.
+  ConfigurationCard *fCard;     // Configuration card for the analysis
+
+private:
+
+  static std::map<TString, ModuleCreator>& GetRegistry(); // Registered module creators with the built-in modules
+
+};
+
+#endif
@@ -0,0 +1,272 @@
+// Implementation for BootstrapHistogram
+
+// C++ includes
+#include <iostream>
+#include <assert.h>
+#include <algorithm>
+
+// Root includes
+#include <TMath.h>
+
+// Own includes
+#include "BootstrapHistogram.h"
+
+using namespace std;
+
+/*
+ * Default constructor
+ */
+BootstrapHistogram::BootstrapHistogram() :
+  fName(""),
+  fnReplicas(0),
+  fnPtBins(0),
+  fMinPt(0),
+  fMaxPt(0),
+  fCentralityBinEdges(),
+  fSumWeights()
+{
+  // Default constructor
+}
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   TString name = Name for the written histogram
+ *   Int_t nReplicas = Number of bootstrap replicas
+ *   Int_t nPtBins = Number of bins in the jet pT axis
+ *   Double_t minPt = Lower edge of the jet pT axis
+ *   Double_t maxPt = Upper edge of the jet pT axis
+ *   Int_t nCentralityBins = Number of bins in the centrality axis
+ *   const Double_t *centralityBinEdges = Array of nCentralityBins+1 bin edges for the centrality axis
+ */
+BootstrapHistogram::BootstrapHistogram(TString name, Int_t nReplicas, Int_t nPtBins, Double_t minPt, Double_t maxPt, Int_t nCentralityBins, const Double_t *centralityBinEdges) :
+  fName(name),
+  fnReplicas(nReplicas),
+  fnPtBins(nPtBins),
+  fMinPt(minPt),
+  fMaxPt(maxPt),
+  fCentralityBinEdges(centralityBinEdges, centralityBinEdges+nCentralityBins+1),
+  fSumWeights()
+{
+  // Custom constructor
+  if(fnReplicas < 1 || fnReplicas > kMaxReplicas){
+    cout << "Error! Number of bootstrap replicas must be between 1 and " << kMaxReplicas << endl;
+    assert(0);
+  }
+
+  // Underflow and overflow bins are included for jet pT and centrality
+  fSumWeights.assign((Long64_t)(fnPtBins+2) * (nCentralityBins+2) * TriggerHistograms::knDataLevels * knTriggerBins * fnReplicas, 0);
+}
+
+/*
+ * Copy constructor
+ */
+BootstrapHistogram::BootstrapHistogram(const BootstrapHistogram& in) :
+  fName(in.fName),
+  fnReplicas(in.fnReplicas),
+  fnPtBins(in.fnPtBins),
+  fMinPt(in.fMinPt),
+  fMaxPt(in.fMaxPt),
+  fCentralityBinEdges(in.fCentralityBinEdges),
+  fSumWeights(in.fSumWeights)
+{
+  // Copy constructor
+}
+
+/*
+ * Destructor
+ */
+BootstrapHistogram::~BootstrapHistogram(){
+  // destructor
+}
+
+/*
+ * Equal sign operator
+ */
+BootstrapHistogram& BootstrapHistogram::operator=(const BootstrapHistogram& in){
+  // Equal sign operator
+
+  if (&in==this) return *this;
+
+  fName = in.fName;
+  fnReplicas = in.fnReplicas;
+  fnPtBins = in.fnPtBins;
+  fMinPt = in.fMinPt;
+  fMaxPt = in.fMaxPt;
+  fCentralityBinEdges = in.fCentralityBinEdges;
+  fSumWeights = in.fSumWeights;
+
+  return *this;
+}
+
+/*
+ * Mix the bits of a 64-bit counter. This is the output function of the SplitMix64 generator, which gives
+ * statistically independent values for consecutive counters.
+ *
+ *  Arguments:
+ *   ULong64_t state = Counter value
+ *
+ *   return: Mixed 64-bit value
+ */
+ULong64_t BootstrapHistogram::SplitMix64(ULong64_t state){
+  state += 0x9E3779B97F4A7C15ULL;
+  state = (state ^ (state >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  state = (state ^ (state >> 27)) * 0x94D049BB133111EBULL;
+  return state ^ (state >> 31);
+}
+
+/*
+ * Generate the Poisson(1) weights for all replicas of an event. The event key is built from the run, luminosity
+ * block and event numbers, and the replica index is used as a counter on top of that. Uniform random numbers
+ * are converted to Poisson(1) numbers with the inverse of the cumulative distribution.
+ *
+ *  Arguments:
+ *   UInt_t runNumber = Run number of the event
+ *   UInt_t lumiBlock = Luminosity block number of the event
+ *   ULong64_t eventNumber = Event number of the event
+ *   Int_t nReplicas = Number of replicas
+ *   UChar_t *poissonWeights = Array of nReplicas weights filled here
+ */
+void BootstrapHistogram::GeneratePoissonWeights(UInt_t runNumber, UInt_t lumiBlock, ULong64_t eventNumber, Int_t nReplicas, UChar_t *poissonWeights){
+
+  // Cumulative distribution for Poisson(1). Beyond the last value the probability is below the resolution of the random numbers.
+  static const Int_t nPoissonValues = 20;
+  static Double_t poissonCumulative[nPoissonValues];
+  static const Bool_t isInitialized = [](){
+    Double_t probability = TMath::Exp(-1);
+    Double_t cumulative = 0;
+    for(Int_t k = 0; k < nPoissonValues; k++){
+      cumulative += probability;
+      poissonCumulative[k] = cumulative;
+      probability /= (k+1);
+    }
+    return true;
+  }();
+  (void) isInitialized;
+
+  // Unique key for the event
+  const ULong64_t eventKey = SplitMix64(SplitMix64(SplitMix64(runNumber) ^ lumiBlock) ^ eventNumber);
+
+  Double_t uniform;
+  Int_t poissonValue;
+  for(Int_t iReplica = 0; iReplica < nReplicas; iReplica++){
+
+    // Take the 53 highest bits to get a uniform number in [0,1)
+    uniform = (SplitMix64(eventKey + (ULong64_t)iReplica * 0x9E3779B97F4A7C15ULL) >> 11) * (1.0 / 9007199254740992.0);
+
+    poissonValue = 0;
+    while(poissonValue < nPoissonValues-1 && uniform >= poissonCumulative[poissonValue]) poissonValue++;
+    poissonWeights[iReplica] = poissonValue;
+  }
+
+}
+
+/*
+ * Find the jet pT bin. Bin 0 is underflow and bin fnPtBins+1 overflow.
+ */
+Int_t BootstrapHistogram::FindPtBin(Double_t jetPt) const{
+  if(!(jetPt >= fMinPt)) return 0;
+  if(jetPt >= fMaxPt) return fnPtBins+1;
+  Int_t bin = 1 + (Int_t)((jetPt - fMinPt) / (fMaxPt - fMinPt) * fnPtBins);
+  return (bin > fnPtBins) ? fnPtBins : bin;
+}
+
+/*
+ * Find the centrality bin. Bin 0 is underflow and the bin after the last edge overflow.
+ */
+Int_t BootstrapHistogram::FindCentralityBin(Double_t centrality) const{
+  return std::upper_bound(fCentralityBinEdges.begin(), fCentralityBinEdges.end(), centrality) - fCentralityBinEdges.begin();
+}
+
+/*
+ * Fill the replicas for all the trigger bits set in the mask
+ *
+ *  Arguments:
+ *   Double_t jetPt = Jet pT
+ *   Double_t centrality = Event centrality
+ *   Int_t dataLevel = Reconstructed or generator level
+ *   UInt_t triggerMask = Bit i is set if trigger bin i is filled
+ *   const Double_t *triggerWeight = Weight for each trigger bin. Only used for the set bits.
+ *   Double_t jetWeight = Weight for the jet multiplying all the trigger weights
+ *   const UChar_t *poissonWeights = Poisson weights of the event for each replica
+ */
+void BootstrapHistogram::Fill(Double_t jetPt, Double_t centrality, Int_t dataLevel, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight, const UChar_t *poissonWeights){
+
+  const Int_t nCentralityBins = fCentralityBinEdges.size() + 1;
+  const Long64_t firstIndex = ((Long64_t)(FindPtBin(jetPt) * nCentralityBins + FindCentralityBin(centrality)) * TriggerHistograms::knDataLevels + dataLevel) * knTriggerBins;
+
+  Int_t iTrigger;
+  Double_t weight;
+  Double_t *replicaSums;
+  while(triggerMask){
+    iTrigger = __builtin_ctz(triggerMask);
+    triggerMask &= triggerMask - 1;
+    weight = triggerWeight[iTrigger]*jetWeight;
+    replicaSums = &fSumWeights[(firstIndex + iTrigger) * fnReplicas];
+    for(Int_t iReplica = 0; iReplica < fnReplicas; iReplica++){
+      replicaSums[iReplica] += weight*poissonWeights[iReplica];
+    }
+  }
+
+}
+
+/*
+ * Add the replicas from another histogram with the same binning
+ */
+void BootstrapHistogram::Add(const BootstrapHistogram *other){
+  for(ULong64_t iBin = 0; iBin < fSumWeights.size(); iBin++){
+    fSumWeights[iBin] += other->fSumWeights[iBin];
+  }
+}
+
+/*
+ * Convert the replicas to a THnD with axes [jet pT][centrality][reco/gen][trigger][replica] and write it to the current directory
+ */
+void BootstrapHistogram::Write() const{
+
+  const Int_t nCentralityBins = fCentralityBinEdges.size() - 1;
+  const Int_t nAxes = 5;
+  Int_t nBins[nAxes] = {fnPtBins, nCentralityBins, TriggerHistograms::knDataLevels, knTriggerBins, fnReplicas};
+  Double_t lowBinBorder[nAxes] = {fMinPt, fCentralityBinEdges.front(), -0.5, -0.5, -0.5};
+  Double_t highBinBorder[nAxes] = {fMaxPt, fCentralityBinEdges.back(), TriggerHistograms::knDataLevels-0.5, knTriggerBins-0.5, fnReplicas-0.5};
+
+  THnD *replicaHistogram = new THnD(fName, fName, nAxes, nBins, lowBinBorder, highBinBorder);
+  replicaHistogram->SetBinEdges(1, fCentralityBinEdges.data());
+
+  // Copy the nonzero sums to the histogram
+  Int_t binIndex[nAxes];
+  Long64_t iSum = 0;
+  for(Int_t iPt = 0; iPt < fnPtBins+2; iPt++){
+    binIndex[0] = iPt;
+    for(Int_t iCentrality = 0; iCentrality < nCentralityBins+2; iCentrality++){
+      binIndex[1] = iCentrality;
+      for(Int_t iLevel = 0; iLevel < TriggerHistograms::knDataLevels; iLevel++){
+        binIndex[2] = iLevel+1;
+        for(Int_t iTrigger = 0; iTrigger < knTriggerBins; iTrigger++){
+          binIndex[3] = iTrigger+1;
+          for(Int_t iReplica = 0; iReplica < fnReplicas; iReplica++){
+            binIndex[4] = iReplica+1;
+            if(fSumWeights[iSum] != 0) replicaHistogram->SetBinContent(binIndex, fSumWeights[iSum]);
+            iSum++;
+          }
+        }
+      }
+    }
+  }
+
+  replicaHistogram->Write();
+  delete replicaHistogram;
+}
+
+// Getter for the number of replicas
+Int_t BootstrapHistogram::GetNReplicas() const{
+  return fnReplicas;
+}
+
+/*
+ * Memory used by the sums in bytes
+ */
+Long64_t BootstrapHistogram::GetMemorySize() const{
+  return fSumWeights.size() * sizeof(Double_t);
+}
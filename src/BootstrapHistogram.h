@@ -0,0 +1,67 @@
+// Histogram holding Poisson bootstrap replicas of the jet pT spectra for statistical uncertainties
+
+#ifndef BOOTSTRAPHISTOGRAM_H
+#define BOOTSTRAPHISTOGRAM_H
+
+// C++ includes
+#include <vector>
+
+// Root includes
+#include <TString.h>
+#include <THn.h>
+
+// Own includes
+#include "TriggerHistograms.h"
+
+/*
+ * BootstrapHistogram class
+ *
+ * Each event is given an independent Poisson(1) weight for every replica. The weights come from a counter-based
+ * random number generator seeded with the run, luminosity block and event numbers, so the same event always gets
+ * the same weights regardless of job splitting, and replicas from different jobs can simply be added together.
+ *
+ * The sums of weights are stored in one contiguous array with the replica index running fastest. A fill then
+ * updates one block of consecutive values, and the storage for 100 replicas with the default binning stays below ten megabytes. When
+ * written, the replicas are converted into a THnD with axes [jet pT][centrality][reco/gen][trigger][replica].
+ */
+class BootstrapHistogram{
+
+public:
+
+  static const Int_t kMaxReplicas = 1000;   // Maximum number of replicas
+  static const Int_t knTriggerBins = TriggerHistograms::knTriggerTypes+1; // Number of trigger bins. Last bin is for all events.
+
+  // Constructors and destructor
+  BootstrapHistogram(); // Default constructor
+  BootstrapHistogram(TString name, Int_t nReplicas, Int_t nPtBins, Double_t minPt, Double_t maxPt, Int_t nCentralityBins, const Double_t *centralityBinEdges); // Custom constructor
+  BootstrapHistogram(const BootstrapHistogram& in); // Copy constructor
+  ~BootstrapHistogram(); // Destructor
+  BootstrapHistogram& operator=(const BootstrapHistogram& in); // Equal sign operator
+
+  // Methods
+  static void GeneratePoissonWeights(UInt_t runNumber, UInt_t lumiBlock, ULong64_t eventNumber, Int_t nReplicas, UChar_t *poissonWeights); // Poisson(1) weights for an event
+  void Fill(Double_t jetPt, Double_t centrality, Int_t dataLevel, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight, const UChar_t *poissonWeights); // Fill the replicas for all the set trigger bits
+  void Add(const BootstrapHistogram *other); // Add the replicas from another histogram
+  void Write() const;                        // Convert the replicas to THnD and write it to the current directory
+  Int_t GetNReplicas() const;                // Getter for the number of replicas
+  Long64_t GetMemorySize() const;            // Memory used by the sums in bytes
+
+private:
+
+  // Private methods
+  static ULong64_t SplitMix64(ULong64_t state); // Mix the bits of the counter for the random number generator
+  Int_t FindPtBin(Double_t jetPt) const;            // Find the pT bin including underflow and overflow
+  Int_t FindCentralityBin(Double_t centrality) const; // Find the centrality bin including underflow and overflow
+
+  // Private data members
+  TString fName;                            // Name for the written histogram
+  Int_t fnReplicas;                         // Number of bootstrap replicas
+  Int_t fnPtBins;                           // Number of jet pT bins
+  Double_t fMinPt;                          // Lower edge of the jet pT axis
+  Double_t fMaxPt;                          // Upper edge of the jet pT axis
+  std::vector<Double_t> fCentralityBinEdges; // Bin edges for the centrality axis
+  std::vector<Double_t> fSumWeights;        // Sum of weights. Index: [pT][centrality][reco/gen][trigger][replica]
+
+};
+
+#endif
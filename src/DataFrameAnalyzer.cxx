@@ -0,0 +1,608 @@
+// Implementation for DataFrameAnalyzer
+
+// C++ includes
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <assert.h>
+
+// Root includes
+#include <TROOT.h>
+#include <TFile.h>
+#include <TChain.h>
+#include <TMath.h>
+
+// Own includes
+#include "DataFrameAnalyzer.h"
+#include "BootstrapHistogram.h"
+#include "EfficiencyAccumulator.h"
+#include "RunAccumulator.h"
+
+using namespace std;
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   std::vector<TString> fileNameVector = Files analyzed in the event loop
+ *   ConfigurationCard *newCard = Configuration card for the analysis
+ */
+DataFrameAnalyzer::DataFrameAnalyzer(std::vector<TString> fileNameVector, ConfigurationCard *newCard) :
+  fFileNames(fileNameVector),
+  fCard(newCard),
+  fHistograms(0),
+  fSlotHistograms(),
+  fSlotJetMatchers(),
+  fPtHatStitchingEdges(),
+  fPtHatStitchingWeights()
+{
+  // Custom constructor
+  fHistograms = new TriggerHistograms(fCard);
+  fHistograms->CreateHistograms();
+
+  // Configure the analyzer from input card
+  ReadConfigurationFromCard();
+
+  // Weights for Monte Carlo. Polynomial weight functions by default, histograms from a file if requested in the card.
+  fWeightProvider = WeightProvider(fDataType);
+  if(fCard->Get("WeightSource") == WeightProvider::kHistogram) fWeightProvider.LoadHistogramWeights(fCard->GetStr("WeightFile"));
+}
+
+/*
+ * Destructor
+ */
+DataFrameAnalyzer::~DataFrameAnalyzer(){
+  // destructor
+  delete fHistograms;
+  for(TriggerHistograms *histograms : fSlotHistograms) delete histograms;
+}
+
+/*
+ * Read the configuration from the input card. The same keys are used as in TriggerAnalyzer.
+ */
+void DataFrameAnalyzer::ReadConfigurationFromCard(){
+
+  //****************************************
+  //     Analyzed data type and trigger
+  //****************************************
+  fDataType = fCard->Get("DataType");
+  fIsMonteCarlo = (fDataType == ForestReader::kPpMC || fDataType == ForestReader::kPbPbMC);
+  fBaseTrigger = fCard->Get("BaseTrigger");   // Only the first base trigger is analyzed
+  if(fBaseTrigger < 0 || fBaseTrigger >= TriggerHistograms::knTriggerTypes){
+    cout << "Error! Unknown base trigger index " << fBaseTrigger << endl;
+    assert(0);
+  }
+
+  //****************************************
+  //         Event selection cuts
+  //****************************************
+  fVzCut = fCard->Get("ZVertexCut");          // Event cut vor the z-position of the primary vertex
+  fMinimumPtHat = fCard->Get("LowPtHatCut");  // Minimum accepted pT hat value
+  fMaximumPtHat = fCard->Get("HighPtHatCut"); // Maximum accepted pT hat value
+
+  //****************************************
+  //          Jet selection cuts
+  //****************************************
+  fJetType = fCard->Get("JetType");              // Select the type of analyzed jets (Calo, CSPF, PuPF, FlowPF)
+  fJetAxis = fCard->Get("JetAxis");              // Select between escheme and WTA axes
+  fCutBadPhiRegion = (fCard->Get("CutBadPhi") == 1);   // Flag for cutting the phi region with bad tracking efficiency from the analysis
+  fJetSelection = JetSelectionKernel(fCard->Get("JetEtaCut"), fCard->Get("MinJetPtCut"), fCard->Get("MaxJetPtCut"), fCard->Get("MinMaxTrackPtFraction"), fCard->Get("MaxMaxTrackPtFraction"));
+  fJetMatchingRadius = fIsMonteCarlo ? fCard->Get("JetMatchingRadius") : 0; // Matching radius for reconstructed and generator level jets in MC
+
+  //************************************************
+  //     Parallel processing and bootstrap
+  //************************************************
+  fNumberOfThreads = fCard->Get("NumberOfThreads");  // Number of threads in the implicit multithreading
+  if(fNumberOfThreads < 1) fNumberOfThreads = 1;
+  fnBootstrapReplicas = fCard->Get("NumberOfBootstrapReplicas"); // Number of Poisson bootstrap replicas for the jet pT spectra
+  if(fnBootstrapReplicas < 0) fnBootstrapReplicas = 0;
+
+  fDebugLevel = fCard->Get("DebugLevel");
+}
+
+/*
+ * Warn about the options of the card that only the hand-written event loop analyzes
+ */
+void DataFrameAnalyzer::PrintUnsupportedOptions() const{
+  if(fCard->Get("NumberOfCutVariations") > 0) cout << "Warning! Cut variations are not analyzed with the RDataFrame engine." << endl;
+  if(fCard->GetN("BaseTrigger") > 1) cout << "Warning! Only the first base trigger is analyzed with the RDataFrame engine." << endl;
+  if(fCard->Get("TriggerObjectMatchingRadius") > 0) cout << "Warning! Jets are not matched to HLT objects with the RDataFrame engine." << endl;
+  if(fCard->Get("NumberOfAnalysisModules") > 0) cout << "Warning! Analysis modules are not run with the RDataFrame engine." << endl;
+  if(fCard->Get("HistogramMemoryMB") > 0) cout << "Warning! The histogram memory budget is not used with the RDataFrame engine." << endl;
+}
+
+/*
+ * Build the computation graph and run the event loop
+ *
+ * The graph follows the hand-written loop: the pT hat cut, the event filters, the base trigger and the vz cut are
+ * Filter nodes, each filling its stage of the event counter in the histograms of the processing slot. The weights,
+ * the trigger prescales, the bootstrap weights and the masks of the jets passing the cuts are Define nodes. The
+ * histograms are filled by the only action in the graph, so all the nodes are evaluated in one event loop.
+ */
+void DataFrameAnalyzer::RunAnalysis(){
+
+  PrintUnsupportedOptions();
+  if(fFileNames.empty()){
+    cout << "Error! No input files given for the RDataFrame engine" << endl;
+    assert(0);
+  }
+
+  // Report the accuracy of the tabulated Monte Carlo weights
+  if(fDebugLevel > 0) fWeightProvider.PrintTableErrors();
+
+  // The implicit multithreading processes the TTree clusters of the chain in parallel. If the caller has already
+  // enabled it, its thread pool is used and left enabled in the end.
+  const Bool_t enableImplicitMT = fNumberOfThreads > 1 && !ROOT::IsImplicitMTEnabled();
+  if(enableImplicitMT) ROOT::EnableImplicitMT(fNumberOfThreads);
+
+  //************************************************
+  //       Chain the forest trees as friends
+  //************************************************
+
+  TChain heavyIonChain("hiEvtAnalyzer/HiTree");
+  TChain hltChain("hltanalysis/HltTree");
+  TChain skimChain("skimanalysis/HltTree");
+  TChain jetChain(ForestReader::GetJetTreeName(fDataType, fJetType));
+  for(const TString &fileName : fFileNames){
+    heavyIonChain.Add(fileName);
+    hltChain.Add(fileName);
+    skimChain.Add(fileName);
+    jetChain.Add(fileName);
+  }
+  heavyIonChain.AddFriend(&hltChain, "hlt");
+  heavyIonChain.AddFriend(&skimChain, "skim");
+  heavyIonChain.AddFriend(&jetChain, "jet");
+
+  // The HF coincidence filter has a different name in MiniAOD forests, which have the HiForestInfo tree
+  Bool_t isMiniAOD = false;
+  TFile *firstFile = TFile::Open(fFileNames.at(0));
+  if(firstFile && !firstFile->IsZombie()) isMiniAOD = (firstFile->Get("HiForestInfo/HiForest") != NULL);
+  if(firstFile){
+    firstFile->Close();
+    delete firstFile;
+  }
+
+  ROOT::RDataFrame dataFrame(heavyIonChain);
+  const UInt_t nSlots = dataFrame.GetNSlots();
+
+  // Each slot fills histograms of its own. They have the same names, so they are not attached to the current directory.
+  const Bool_t addDirectoryStatus = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+  for(UInt_t iSlot = 0; iSlot < nSlots; iSlot++){
+    fSlotHistograms.push_back(new TriggerHistograms(fCard));
+    fSlotHistograms.back()->CreateHistograms();
+    fSlotJetMatchers.push_back((fJetMatchingRadius > 0) ? JetMatcher(fJetMatchingRadius) : JetMatcher());
+  }
+  TH1::AddDirectory(addDirectoryStatus);
+
+  // All the entries are counted for the throughput
+  ROOT::RDF::RResultPtr<ULong64_t> nEvents = dataFrame.Count();
+
+  //************************************************
+  //      Event information and pT hat cut
+  //************************************************
+
+  const Bool_t isPp = (fDataType == ForestReader::kPp || fDataType == ForestReader::kPpMC);
+  ROOT::RDF::RNode eventNode = dataFrame;
+
+  // There is no pT hat or event weight for real data
+  if(fIsMonteCarlo){
+    eventNode = eventNode.Define("ptHatValue", [](Float_t ptHat){ return (Double_t)ptHat; }, {"pthat"});
+    eventNode = eventNode.Define("forestWeight", [](Float_t weight){ return (Double_t)weight; }, {"weight"});
+  } else {
+    eventNode = eventNode.Define("ptHatValue", [](){ return 0.0; });
+    eventNode = eventNode.Define("forestWeight", [](){ return 1.0; });
+  }
+
+  // The pT hat cut is applied before the weights, since they are not defined above the upper limit
+  eventNode = eventNode.Filter([this](Double_t ptHat){ return ptHat >= fMinimumPtHat && ptHat < fMaximumPtHat; }, {"ptHatValue"}, "pT hat");
+
+  // Weights for the event. Negative hiBin is handled by the same function as in the hand-written loop.
+  eventNode = eventNode.Define("centrality", [](Int_t hiBin){ return hiBin/2.0; }, {"hiBin"});
+  eventNode = eventNode.Define("vzWeight", [this](Float_t vz){ return fIsMonteCarlo ? fWeightProvider.GetVzWeight(vz) : 1.0; }, {"vz"});
+  eventNode = eventNode.Define("centralityWeight", [this](Int_t hiBin){ return (fDataType == ForestReader::kPbPbMC) ? fWeightProvider.GetCentralityWeight(ForestReader::GetValidHiBin(hiBin)) : 1.0; }, {"hiBin"});
+  eventNode = eventNode.Define("ptHatWeight", [this](Double_t ptHat, Double_t forestWeight){ return GetPtHatWeight(ptHat, forestWeight); }, {"ptHatValue", "forestWeight"});
+  eventNode = eventNode.Define("eventWeight", [](Double_t vzWeight, Double_t centralityWeight, Double_t ptHatWeight){ return vzWeight*centralityWeight*ptHatWeight; }, {"vzWeight", "centralityWeight", "ptHatWeight"});
+
+  //************************************************
+  //              Event filters
+  //************************************************
+
+  // The filters not used for the collision system always pass
+  if(isPp){
+    eventNode = eventNode.Define("eventFilterStage", [this](Int_t primaryVertex, Int_t beamScraping){ return GetEventFilterStage(primaryVertex, 1, 1, beamScraping); }, {"skim.pPAprimaryVertexFilter", "skim.pBeamScrapingFilter"});
+  } else {
+    eventNode = eventNode.Define("eventFilterStage", [this](Int_t primaryVertex, Int_t hfCoincidence, Int_t clusterCompatibility){ return GetEventFilterStage(primaryVertex, hfCoincidence, clusterCompatibility, 1); }, {"skim.pprimaryVertexFilter", isMiniAOD ? "skim.pphfCoincFilter2Th4" : "skim.phfCoincFilter2Th4", "skim.pclusterCompatibilityFilter"});
+  }
+
+  // Fill the event counter for all the passed event filters
+  eventNode = eventNode.Filter([this](UInt_t slot, Int_t eventFilterStage){
+    TriggerHistograms *histograms = fSlotHistograms[slot];
+    for(Int_t iStage = TriggerHistograms::kAll; iStage <= eventFilterStage; iStage++){
+      histograms->FillHistogram(histograms->fhEvents,iStage);
+    }
+    return eventFilterStage == TriggerHistograms::kBeamScraping;
+  }, {"rdfslot_", "eventFilterStage"}, "Event filters");
+
+  // Prescale of each trigger that fired, and -1 for the triggers that did not fire
+  TString triggerBranchName;
+  TString prescaleColumns = "";
+  for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+    triggerBranchName = "hlt." + ForestReader::GetTriggerBranchName(fDataType, iTrigger);
+    if(isPp){
+      // Only integer prescales for AOD
+      eventNode = eventNode.Define(Form("triggerPrescale%d", iTrigger), [](Int_t filterBit, Int_t numerator){ return filterBit ? (Double_t)numerator : -1.0; }, {triggerBranchName.Data(), (triggerBranchName + "_Prescl").Data()});
+    } else {
+      eventNode = eventNode.Define(Form("triggerPrescale%d", iTrigger), [](Int_t filterBit, Int_t numerator, Int_t denominator){ return filterBit ? (numerator*1.0)/denominator : -1.0; }, {triggerBranchName.Data(), (triggerBranchName + "_PrescaleNumerator").Data(), (triggerBranchName + "_PrescaleDenominator").Data()});
+    }
+    prescaleColumns += Form("%striggerPrescale%d", (iTrigger > 0) ? ", " : "", iTrigger);
+  }
+  eventNode = eventNode.Define("triggerPrescales", Form("ROOT::RVec<double>{%s}", prescaleColumns.Data()));
+
+  // Jet trigger requirement for the base trigger
+  eventNode = eventNode.Filter([this](UInt_t slot, const ROOT::RVec<Double_t> &triggerPrescales){
+    if(triggerPrescales[fBaseTrigger] < 0) return false;
+    fSlotHistograms[slot]->FillHistogram(fSlotHistograms[slot]->fhEvents,TriggerHistograms::kCaloJet);
+    return true;
+  }, {"rdfslot_", "triggerPrescales"}, "Base trigger");
+
+  // Cut for vertex z-position
+  eventNode = eventNode.Filter([this](UInt_t slot, Float_t vz){
+    if(TMath::Abs(vz) > fVzCut) return false;
+    fSlotHistograms[slot]->FillHistogram(fSlotHistograms[slot]->fhEvents,TriggerHistograms::kVzCut);
+    return true;
+  }, {"rdfslot_", "vz"}, "Vertex z");
+
+  //************************************************
+  //    Jet masks for the events passing the cuts
+  //************************************************
+
+  // Branches for the selected jet axis
+  const char *jetAxisName[2] = {"jt", "WTA"};
+  const char *genJetAxisName[2] = {"", "WTA"};
+  const std::string jetPhiColumn = Form("jet.%sphi", jetAxisName[fJetAxis]);
+  const std::string jetEtaColumn = Form("jet.%seta", jetAxisName[fJetAxis]);
+
+  eventNode = eventNode.Define("selectedJets", [this](const ROOT::RVec<Float_t> &jetPt, const ROOT::RVec<Float_t> &jetPhi, const ROOT::RVec<Float_t> &jetEta, const ROOT::RVec<Float_t> &jetRawPt, const ROOT::RVec<Float_t> &jetMaxTrackPt){
+    SelectedJets jets;
+    const Int_t nJets = TMath::Min((Int_t)jetPt.size(), JetSelectionKernel::kMaxJets);
+    if(fCutBadPhiRegion){
+      jets.fLeadingJetIndex = fJetSelection.SelectJets<true,true>(nJets, jetPt.data(), jetPhi.data(), jetEta.data(), jetRawPt.data(), jetMaxTrackPt.data(), jets.fPassMask);
+    } else {
+      jets.fLeadingJetIndex = fJetSelection.SelectJets<false,true>(nJets, jetPt.data(), jetPhi.data(), jetEta.data(), jetRawPt.data(), jetMaxTrackPt.data(), jets.fPassMask);
+    }
+    return jets;
+  }, {"jet.jtpt", jetPhiColumn, jetEtaColumn, "jet.rawpt", "jet.trackMax"});
+
+  // Only eta and pT cuts are applied for generator level jets. Real data has no generator level jets.
+  if(fIsMonteCarlo){
+    eventNode = eventNode.Alias("genJetPt", "jet.genpt");
+    eventNode = eventNode.Alias("genJetPhi", Form("jet.%sgenphi", genJetAxisName[fJetAxis]));
+    eventNode = eventNode.Alias("genJetEta", Form("jet.%sgeneta", genJetAxisName[fJetAxis]));
+  } else {
+    eventNode = eventNode.Define("genJetPt", [](){ return ROOT::RVec<Float_t>(); });
+    eventNode = eventNode.Define("genJetPhi", [](){ return ROOT::RVec<Float_t>(); });
+    eventNode = eventNode.Define("genJetEta", [](){ return ROOT::RVec<Float_t>(); });
+  }
+  eventNode = eventNode.Define("selectedGenJets", [this](const ROOT::RVec<Float_t> &jetPt, const ROOT::RVec<Float_t> &jetPhi, const ROOT::RVec<Float_t> &jetEta){
+    SelectedJets jets;
+    const Int_t nJets = TMath::Min((Int_t)jetPt.size(), JetSelectionKernel::kMaxJets);
+    jets.fLeadingJetIndex = fJetSelection.SelectJets<false,false>(nJets, jetPt.data(), jetPhi.data(), jetEta.data(), NULL, NULL, jets.fPassMask);
+    return jets;
+  }, {"genJetPt", "genJetPhi", "genJetEta"});
+
+  // The bootstrap weights depend only on the event identity. The event identifiers are only read if the bootstrap
+  // weights or the run-resolved spectra need them.
+  if(fnBootstrapReplicas > 0 || fHistograms->fLeadingJetPerRun != NULL){
+    eventNode = eventNode.Alias("runNumber", "run");
+    eventNode = eventNode.Define("bootstrapWeights", [this](UInt_t runNumber, UInt_t lumiBlock, ULong64_t eventNumber){
+      ROOT::RVec<UChar_t> poissonWeights(fnBootstrapReplicas);
+      if(fnBootstrapReplicas > 0) BootstrapHistogram::GeneratePoissonWeights(runNumber, lumiBlock, eventNumber, fnBootstrapReplicas, poissonWeights.data());
+      return poissonWeights;
+    }, {"run", "lumi", "evt"});
+  } else {
+    eventNode = eventNode.Define("runNumber", [](){ return (UInt_t)0; });
+    eventNode = eventNode.Define("bootstrapWeights", [](){ return ROOT::RVec<UChar_t>(); });
+  }
+
+  //************************************************
+  //     Fill the histograms in one event loop
+  //************************************************
+
+  ROOT::RDF::RResultPtr<ROOT::RDF::RCutFlowReport> cutFlowReport = eventNode.Report();
+
+  const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+  eventNode.ForeachSlot([this](UInt_t slot, Float_t vz, Double_t centrality, Double_t ptHat, Double_t vzWeight, Double_t centralityWeight, Double_t ptHatWeight, Double_t eventWeight, const ROOT::RVec<Double_t> &triggerPrescales, const SelectedJets &jets, const ROOT::RVec<Float_t> &jetPt, const ROOT::RVec<Float_t> &jetPhi, const ROOT::RVec<Float_t> &jetEta, const SelectedJets &genJets, const ROOT::RVec<Float_t> &genJetPt, const ROOT::RVec<Float_t> &genJetPhi, const ROOT::RVec<Float_t> &genJetEta, UInt_t runNumber, const ROOT::RVec<UChar_t> &bootstrapWeights){
+    FillEvent(slot, vz, centrality, ptHat, vzWeight, centralityWeight, ptHatWeight, eventWeight, triggerPrescales, jets, jetPt, jetPhi, jetEta, genJets, genJetPt, genJetPhi, genJetEta, runNumber, bootstrapWeights);
+  }, {"vz", "centrality", "ptHatValue", "vzWeight", "centralityWeight", "ptHatWeight", "eventWeight", "triggerPrescales", "selectedJets", "jet.jtpt", jetPhiColumn, jetEtaColumn, "selectedGenJets", "genJetPt", "genJetPhi", "genJetEta", "runNumber", "bootstrapWeights"});
+  const Double_t loopTime = chrono::duration<Double_t>(chrono::steady_clock::now() - startTime).count();
+
+  //************************************************
+  //    Merge the slot histograms and clean up
+  //************************************************
+
+  for(TriggerHistograms *histograms : fSlotHistograms){
+    fHistograms->Merge(histograms);
+    delete histograms;
+  }
+  fSlotHistograms.clear();
+  fSlotJetMatchers.clear();
+
+  if(enableImplicitMT) ROOT::DisableImplicitMT();
+
+  // Throughput as a reference for the hand-written event loop
+  if(fDebugLevel > 0){
+    cout << Form("RDataFrame engine: %llu events in %.1f s, %.1f events/s with %u slots", *nEvents, loopTime, (loopTime > 0) ? *nEvents / loopTime : 0, nSlots) << endl;
+  }
+  if(fDebugLevel > 1) cutFlowReport->Print();
+
+}
+
+/*
+ * Fill the histograms of a processing slot for an event passing the event cuts. The same histograms are filled as in
+ * TriggerAnalyzer::EventLoop and TriggerAnalyzer::FillJetHistograms for the nominal cuts.
+ *
+ *  Arguments:
+ *   UInt_t slot = Processing slot of the data frame
+ *   Double_t vz = Vertex z-position
+ *   Double_t centrality = Centrality of the event
+ *   Double_t ptHat = pT hat of the event. 0 for real data.
+ *   Double_t vzWeight = Weight for vz in MC
+ *   Double_t centralityWeight = Weight for centrality in MC
+ *   Double_t ptHatWeight = Weight for pT hat in MC
+ *   Double_t eventWeight = Combined weight of the event
+ *   const ROOT::RVec<Double_t> &triggerPrescales = Prescale for each trigger that fired, -1 for the others
+ *   const SelectedJets &jets = Reconstructed jets passing the jet cuts
+ *   const ROOT::RVec<Float_t> &jetPt = Reconstructed jet pT
+ *   const ROOT::RVec<Float_t> &jetPhi = Reconstructed jet phi
+ *   const ROOT::RVec<Float_t> &jetEta = Reconstructed jet eta
+ *   const SelectedJets &genJets = Generator level jets passing the jet cuts
+ *   const ROOT::RVec<Float_t> &genJetPt = Generator level jet pT. Empty for real data.
+ *   const ROOT::RVec<Float_t> &genJetPhi = Generator level jet phi. Empty for real data.
+ *   const ROOT::RVec<Float_t> &genJetEta = Generator level jet eta. Empty for real data.
+ *   UInt_t runNumber = Run number of the event
+ *   const ROOT::RVec<UChar_t> &bootstrapWeights = Poisson weights of the event for each bootstrap replica
+ */
+void DataFrameAnalyzer::FillEvent(UInt_t slot, Double_t vz, Double_t centrality, Double_t ptHat, Double_t vzWeight, Double_t centralityWeight, Double_t ptHatWeight, Double_t eventWeight, const ROOT::RVec<Double_t> &triggerPrescales, const SelectedJets &jets, const ROOT::RVec<Float_t> &jetPt, const ROOT::RVec<Float_t> &jetPhi, const ROOT::RVec<Float_t> &jetEta, const SelectedJets &genJets, const ROOT::RVec<Float_t> &genJetPt, const ROOT::RVec<Float_t> &genJetPhi, const ROOT::RVec<Float_t> &genJetEta, UInt_t runNumber, const ROOT::RVec<UChar_t> &bootstrapWeights){
+
+  TriggerHistograms *histograms = fSlotHistograms[slot];
+
+  // Variables for jets
+  Double_t jetWeight = 1;           // Weighting for jet pT
+  Double_t leadingJetPt = 0;        // Leading jet pT
+  Double_t leadingJetEta = 0;       // Leading jet eta
+  Double_t leadingJetPhi = 0;       // Leading jet phi
+  Int_t jetIndex = 0;               // Index of the current jet in the jet arrays
+  ULong64_t passingJets = 0;        // Word of the mask from which the passing jets are read
+  Int_t matchedJetIndex = -1;       // Index of the generator level jet matched to a reconstructed jet
+
+  // Fillers for THnSparses
+  const Int_t nFillJet = 6;
+  Double_t fillerJet[nFillJet];
+
+  // Pack the trigger selection into a bit mask. The bin without trigger selection is always filled with the event weight.
+  UInt_t triggerMask = 1u << TriggerHistograms::knTriggerTypes;
+  Double_t triggerWeight[TriggerHistograms::knTriggerTypes+1];
+  triggerWeight[TriggerHistograms::knTriggerTypes] = eventWeight;
+  for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+    if(triggerPrescales[iTrigger] < 0) continue;
+    triggerMask |= 1u << iTrigger;
+    triggerWeight[iTrigger] = eventWeight*triggerPrescales[iTrigger];
+  }
+
+  // The prescale for the base trigger branch is one, as it is meaningless after the selection
+  triggerWeight[fBaseTrigger] = eventWeight;
+
+  // Fill the event information histograms for the events that pass the event cuts
+  histograms->FillHistogram(histograms->fhVertexZ,vz);
+  histograms->FillHistogram(histograms->fhVertexZWeighted,vz,vzWeight);
+  histograms->FillHistogram(histograms->fhCentrality,centrality);
+  histograms->FillHistogram(histograms->fhCentralityWeighted,centrality,centralityWeight);
+  histograms->FillHistogram(histograms->fhPtHat,ptHat);
+  histograms->FillHistogram(histograms->fhPtHatWeighted,ptHat,ptHatWeight);
+
+  // =============================== //
+  //  Reconstructed inclusive jets   //
+  // =============================== //
+
+  for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+    passingJets = jets.fPassMask[iWord];
+    while(passingJets){
+      jetIndex = iWord * 64 + __builtin_ctzll(passingJets);
+      passingJets &= passingJets - 1;
+
+      jetWeight = GetJetPtWeight(jetPt[jetIndex]);
+      fillerJet[0] = jetPt[jetIndex];    // Axis 0 = jet pT
+      fillerJet[1] = jetPhi[jetIndex];   // Axis 1 = jet phi
+      fillerJet[2] = jetEta[jetIndex];   // Axis 2 = jet eta
+      fillerJet[3] = centrality;         // Axis 3 = centrality
+      fillerJet[4] = TriggerHistograms::kReconstructed;  // Axis 4 = Reconstruction flag
+
+      // Axis 5 = Trigger selection
+      histograms->FillJetTriggers(histograms->fhInclusiveJet, fillerJet, triggerMask, triggerWeight, jetWeight);
+      if(histograms->fhInclusiveJetBootstrap) histograms->fhInclusiveJetBootstrap->Fill(fillerJet[0], centrality, TriggerHistograms::kReconstructed, triggerMask, triggerWeight, jetWeight, bootstrapWeights.data());
+      if(histograms->fJetEfficiency) histograms->fJetEfficiency->Fill(EfficiencyAccumulator::kInclusiveJet, fillerJet[0], centrality, TriggerHistograms::kReconstructed, triggerMask, triggerWeight, jetWeight);
+    }
+  }
+
+  // =============================== //
+  //   Reconstructed leading jet     //
+  // =============================== //
+
+  leadingJetPt = 0; leadingJetEta = 0; leadingJetPhi = 0;
+  if(jets.fLeadingJetIndex >= 0){
+    leadingJetPt = jetPt[jets.fLeadingJetIndex];
+    leadingJetEta = jetEta[jets.fLeadingJetIndex];
+    leadingJetPhi = jetPhi[jets.fLeadingJetIndex];
+  }
+
+  jetWeight = GetJetPtWeight(leadingJetPt);
+  fillerJet[0] = leadingJetPt;          // Axis 0 = leading jet pT
+  fillerJet[1] = leadingJetPhi;         // Axis 1 = leading jet phi
+  fillerJet[2] = leadingJetEta;         // Axis 2 = leading jet eta
+  fillerJet[3] = centrality;            // Axis 3 = centrality
+  fillerJet[4] = TriggerHistograms::kReconstructed;  // Axis 4 = Reconstruction flag
+
+  histograms->FillJetTriggers(histograms->fhLeadingJet, fillerJet, triggerMask, triggerWeight, jetWeight);
+  if(histograms->fhLeadingJetBootstrap) histograms->fhLeadingJetBootstrap->Fill(leadingJetPt, centrality, TriggerHistograms::kReconstructed, triggerMask, triggerWeight, jetWeight, bootstrapWeights.data());
+  if(histograms->fJetEfficiency) histograms->fJetEfficiency->Fill(EfficiencyAccumulator::kLeadingJet, leadingJetPt, centrality, TriggerHistograms::kReconstructed, triggerMask, triggerWeight, jetWeight);
+  if(histograms->fLeadingJetPerRun) histograms->fLeadingJetPerRun->Fill(runNumber, leadingJetPt, triggerMask, triggerWeight, jetWeight);
+
+  // Generator level jets are only available for MC
+  if(!fIsMonteCarlo) return;
+
+  // =============================== //
+  //  Generator level inclusive jets //
+  // =============================== //
+
+  for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+    passingJets = genJets.fPassMask[iWord];
+    while(passingJets){
+      jetIndex = iWord * 64 + __builtin_ctzll(passingJets);
+      passingJets &= passingJets - 1;
+
+      jetWeight = GetJetPtWeight(genJetPt[jetIndex]);
+      fillerJet[0] = genJetPt[jetIndex];    // Axis 0 = generator level jet pT
+      fillerJet[1] = genJetPhi[jetIndex];   // Axis 1 = generator level jet phi
+      fillerJet[2] = genJetEta[jetIndex];   // Axis 2 = generator level jet eta
+      fillerJet[3] = centrality;            // Axis 3 = centrality
+      fillerJet[4] = TriggerHistograms::kGeneratorLevel;   // Axis 4 = Generator level flag
+
+      histograms->FillJetTriggers(histograms->fhInclusiveJet, fillerJet, triggerMask, triggerWeight, jetWeight);
+      if(histograms->fhInclusiveJetBootstrap) histograms->fhInclusiveJetBootstrap->Fill(fillerJet[0], centrality, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight, jetWeight, bootstrapWeights.data());
+      if(histograms->fJetEfficiency) histograms->fJetEfficiency->Fill(EfficiencyAccumulator::kInclusiveJet, fillerJet[0], centrality, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight, jetWeight);
+    }
+  }
+
+  // =============================== //
+  //  Generator level leading jet    //
+  // =============================== //
+
+  leadingJetPt = 0; leadingJetEta = 0; leadingJetPhi = 0;
+  if(genJets.fLeadingJetIndex >= 0){
+    leadingJetPt = genJetPt[genJets.fLeadingJetIndex];
+    leadingJetEta = genJetEta[genJets.fLeadingJetIndex];
+    leadingJetPhi = genJetPhi[genJets.fLeadingJetIndex];
+  }
+
+  jetWeight = GetJetPtWeight(leadingJetPt);
+  fillerJet[0] = leadingJetPt;          // Axis 0 = leading generator level jet pT
+  fillerJet[1] = leadingJetPhi;         // Axis 1 = leading generator level jet phi
+  fillerJet[2] = leadingJetEta;         // Axis 2 = leading generator level jet eta
+  fillerJet[3] = centrality;            // Axis 3 = centrality
+  fillerJet[4] = TriggerHistograms::kGeneratorLevel; // Axis 4 = Generator level flag
+
+  histograms->FillJetTriggers(histograms->fhLeadingJet, fillerJet, triggerMask, triggerWeight, jetWeight);
+  if(histograms->fhLeadingJetBootstrap) histograms->fhLeadingJetBootstrap->Fill(leadingJetPt, centrality, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight, jetWeight, bootstrapWeights.data());
+  if(histograms->fJetEfficiency) histograms->fJetEfficiency->Fill(EfficiencyAccumulator::kLeadingJet, leadingJetPt, centrality, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight, jetWeight);
+
+  // ================================================================= //
+  // Match reconstructed jets to generator level jets for the response //
+  // ================================================================= //
+
+  if(!histograms->fhJetResponse) return;
+
+  JetMatcher &jetMatcher = fSlotJetMatchers[slot];
+  jetMatcher.BuildGrid(genJetPt.size(), genJetEta.data(), genJetPhi.data(), genJets.fPassMask);
+
+  for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+    passingJets = jets.fPassMask[iWord];
+    while(passingJets){
+      jetIndex = iWord * 64 + __builtin_ctzll(passingJets);
+      passingJets &= passingJets - 1;
+
+      matchedJetIndex = jetMatcher.FindMatch(jetEta[jetIndex], jetPhi[jetIndex]);
+      if(matchedJetIndex < 0) continue;
+
+      // The jet pT weight is defined for generator level jets
+      jetWeight = GetJetPtWeight(genJetPt[matchedJetIndex]);
+      fillerJet[0] = genJetPt[matchedJetIndex];  // Axis 0 = generator level jet pT
+      fillerJet[1] = jetPt[jetIndex];            // Axis 1 = reconstructed jet pT
+      fillerJet[2] = centrality;                 // Axis 2 = centrality
+
+      // Axis 3 = Trigger selection
+      histograms->FillJetTriggers(histograms->fhJetResponse, fillerJet, triggerMask, triggerWeight, jetWeight, 3);
+    }
+  }
+
+}
+
+/*
+ * Find how far the event gets in the event cut flow before the base trigger requirement
+ *
+ *  Arguments:
+ *   Int_t primaryVertex = Primary vertex filter bit
+ *   Int_t hfCoincidence = HF coincidence filter bit. 1 for pp.
+ *   Int_t clusterCompatibility = Cluster compatibility filter bit. 1 for pp.
+ *   Int_t beamScraping = Beam scraping filter bit. 1 for PbPb.
+ *
+ *   return = Last passed stage in the cut flow. Stage kBeamScraping means that all the event filters are passed.
+ */
+Int_t DataFrameAnalyzer::GetEventFilterStage(Int_t primaryVertex, Int_t hfCoincidence, Int_t clusterCompatibility, Int_t beamScraping) const{
+  if(primaryVertex == 0) return TriggerHistograms::kAll;
+  if(hfCoincidence == 0) return TriggerHistograms::kPrimaryVertex;
+  if(clusterCompatibility == 0) return TriggerHistograms::kHfCoincidence;
+  if(beamScraping == 0) return TriggerHistograms::kClusterCompatibility;
+  return TriggerHistograms::kBeamScraping;
+}
+
+/*
+ * Get the pT hat weight for the event. If stitching weights are given, the weight of the pT hat bin is used.
+ * Otherwise the weight is read from the forest.
+ *
+ *  Arguments:
+ *   Double_t ptHat = pT hat of the event
+ *   Double_t forestWeight = Event weight from the forest
+ *
+ *   return: Weight for the event
+ */
+Double_t DataFrameAnalyzer::GetPtHatWeight(Double_t ptHat, Double_t forestWeight) const{
+  if(fPtHatStitchingWeights.empty()) return forestWeight;
+  const Int_t ptHatBin = std::upper_bound(fPtHatStitchingEdges.begin(), fPtHatStitchingEdges.end(), ptHat) - fPtHatStitchingEdges.begin() - 1;
+  if(ptHatBin < 0) return 0;
+  return fPtHatStitchingWeights[ptHatBin];
+}
+
+/*
+ * Get the jet pT weight. Only MC is weighted.
+ */
+Double_t DataFrameAnalyzer::GetJetPtWeight(Double_t jetPt) const{
+  if(!fIsMonteCarlo) return 1.0;
+  return fWeightProvider.GetJetPtWeight(jetPt);
+}
+
+/*
+ * Use the given weights for the pT hat bins instead of the weight from the forest. The bins are read from the card
+ * with the key PtHatBinEdges.
+ *
+ *  Arguments:
+ *   const std::vector<Double_t> &weights = Weight for each pT hat bin
+ */
+void DataFrameAnalyzer::SetPtHatStitchingWeights(const std::vector<Double_t> &weights){
+
+  fPtHatStitchingEdges.clear();
+  for(Int_t iEdge = 0; iEdge < fCard->GetN("PtHatBinEdges"); iEdge++){
+    fPtHatStitchingEdges.push_back(fCard->Get("PtHatBinEdges",iEdge));
+  }
+
+  if(weights.size() != fPtHatStitchingEdges.size()){
+    cout << "Error! There must be one pT hat stitching weight for each edge in PtHatBinEdges" << endl;
+    assert(0);
+  }
+  fPtHatStitchingWeights = weights;
+
+}
+
+/*
+ * Write the histograms to the current directory
+ */
+void DataFrameAnalyzer::WriteHistograms() const{
+  fHistograms->Write();
+}
+
+/*
+ * Getter for the merged histograms
+ */
+TriggerHistograms* DataFrameAnalyzer::GetHistograms() const{
+  return fHistograms;
+}
@@ -0,0 +1,99 @@
+// Alternative implementation of the trigger analysis on ROOT's RDataFrame
+
+#ifndef DATAFRAMEANALYZER_H
+#define DATAFRAMEANALYZER_H
+
+// C++ includes
+#include <vector>
+#include <string>
+
+// Root includes
+#include <TString.h>
+#include <ROOT/RDataFrame.hxx>
+#include <ROOT/RVec.hxx>
+
+// Own includes
+#include "ConfigurationCard.h"
+#include "TriggerHistograms.h"
+#include "ForestReader.h"
+#include "JetSelectionKernel.h"
+#include "WeightProvider.h"
+#include "JetMatcher.h"
+
+/*
+ * Jets passing the jet cuts in one event, defined as a column of the data frame
+ */
+struct SelectedJets{
+  ULong64_t fPassMask[JetSelectionKernel::knMaskWords]; // Bit i is set if jet i passes the jet cuts
+  Int_t fLeadingJetIndex;                               // Index of the leading passing jet. -1 if none pass.
+};
+
+/*
+ * DataFrameAnalyzer class
+ *
+ * Runs the nominal selection of TriggerAnalyzer as an RDataFrame computation graph. The heavy ion tree is the main
+ * tree, and the HLT, skim and jet trees are attached to it as friends named hlt, skim and jet. The event cuts are
+ * Filter nodes, and the weights, trigger prescales and jet masks are Define nodes, so a branch is only read for the
+ * events reaching the first node using it. The histograms are filled in one TriggerHistograms object per processing
+ * slot, which are merged after the event loop, so the output has the same histogram names as the hand-written loop.
+ *
+ * Only the nominal cuts with the first base trigger are analyzed. Cut variations, other base triggers, HLT object
+ * matching and analysis modules need the hand-written loop.
+ */
+class DataFrameAnalyzer{
+
+public:
+
+  // Constructors and destructor
+  DataFrameAnalyzer(std::vector<TString> fileNameVector, ConfigurationCard *newCard); // Custom constructor
+  ~DataFrameAnalyzer(); // Destructor
+
+  // Methods
+  void RunAnalysis();                  // Build the computation graph and run the event loop
+  void WriteHistograms() const;        // Write the histograms to the current directory
+  TriggerHistograms* GetHistograms() const; // Getter for the merged histograms
+  void SetPtHatStitchingWeights(const std::vector<Double_t> &weights); // Use the given weights for the pT hat bins instead of the forest weight
+
+private:
+
+  // Private methods
+  void ReadConfigurationFromCard();    // Read the configuration from the input card
+  void PrintUnsupportedOptions() const; // Warn about options of the card that the data frame does not analyze
+  Int_t GetEventFilterStage(Int_t primaryVertex, Int_t hfCoincidence, Int_t clusterCompatibility, Int_t beamScraping) const; // Last passed stage of the event filters
+  Double_t GetPtHatWeight(Double_t ptHat, Double_t forestWeight) const; // Get the pT hat weight from the stitching weights or from the forest
+  Double_t GetJetPtWeight(Double_t jetPt) const; // Get the jet pT weight for MC
+  void FillEvent(UInt_t slot, Double_t vz, Double_t centrality, Double_t ptHat, Double_t vzWeight, Double_t centralityWeight, Double_t ptHatWeight, Double_t eventWeight, const ROOT::RVec<Double_t> &triggerPrescales, const SelectedJets &jets, const ROOT::RVec<Float_t> &jetPt, const ROOT::RVec<Float_t> &jetPhi, const ROOT::RVec<Float_t> &jetEta, const SelectedJets &genJets, const ROOT::RVec<Float_t> &genJetPt, const ROOT::RVec<Float_t> &genJetPhi, const ROOT::RVec<Float_t> &genJetEta, UInt_t runNumber, const ROOT::RVec<UChar_t> &bootstrapWeights); // Fill the histograms for an event passing the event cuts
+
+  // Private data members
+  std::vector<TString> fFileNames;          // Files analyzed in the event loop
+  ConfigurationCard *fCard;                 // Configuration card for the analysis
+  TriggerHistograms *fHistograms;           // Histograms merged from all the slots
+  std::vector<TriggerHistograms*> fSlotHistograms; // Histograms filled in each processing slot
+  std::vector<JetMatcher> fSlotJetMatchers; // Matching grid for each processing slot
+
+  // Analyzed data and forest types
+  Int_t fDataType;                   // Analyzed data type
+  Bool_t fIsMonteCarlo;              // True for pp and PbPb MC
+  Int_t fJetType;                    // Type of jets used for analysis. 0 = Calo jets, 1 = PF jets
+  Int_t fJetAxis;                    // Used jet axis type. 0 = Anti-kT jet axis, 1 = WTA axis
+  Int_t fBaseTrigger;                // Trigger index used as base trigger for efficiency study. First one if several are given.
+  Int_t fDebugLevel;                 // Amount of debug messages printed to console
+  Int_t fNumberOfThreads;            // Number of threads used by the implicit multithreading
+
+  // Weights for filling the MC histograms
+  std::vector<Double_t> fPtHatStitchingEdges;   // Lower edges of the pT hat bins for stitching. The last bin has no upper edge.
+  std::vector<Double_t> fPtHatStitchingWeights; // Weight for each pT hat bin. Empty if the weight from the forest is used.
+  WeightProvider fWeightProvider;    // Weighting functions for vz, centrality and jet pT. Needed for MC.
+  Int_t fnBootstrapReplicas;         // Number of bootstrap replicas. 0 = No bootstrap.
+
+  // Event and jet selection cuts
+  Double_t fVzCut;                     // Cut for vertex z-position in an event
+  Double_t fMinimumPtHat;              // Minimum accepted pT hat value
+  Double_t fMaximumPtHat;              // Maximum accepted pT hat value
+  Bool_t fCutBadPhiRegion;             // Cut the phi region with bad tracker performance from the analysis
+  JetSelectionKernel fJetSelection;    // Kernel evaluating the nominal jet cuts
+  Double_t fJetMatchingRadius;         // Maximum distance in eta-phi for matching reconstructed and generator level jets. 0 = No matching.
+
+};
+
+#endif
@@ -0,0 +1,244 @@
+// Implementation for DenseHistogram
+
+// C++ includes
+#include <iostream>
+#include <assert.h>
+#include <algorithm>
+
+// Own includes
+#include "DenseHistogram.h"
+
+using namespace std;
+
+/*
+ * Default constructor
+ */
+DenseHistogram::DenseHistogram() :
+  fHistogram(0),
+  fAxes(),
+  fnStoredBins(0),
+  fSumWeights(),
+  fSumWeightsSquared(),
+  fnFills(0)
+{
+  // Default constructor
+}
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   THnBase *histogram = Histogram giving the binning and to which the sums are added before writing
+ */
+DenseHistogram::DenseHistogram(THnBase *histogram) :
+  fHistogram(histogram),
+  fAxes(),
+  fnStoredBins(0),
+  fSumWeights(),
+  fSumWeightsSquared(),
+  fnFills(0)
+{
+  // Custom constructor
+  const Int_t nAxes = fHistogram->GetNdimensions();
+  fAxes.resize(nAxes);
+  for(Int_t iAxis = 0; iAxis < nAxes; iAxis++){
+    const TAxis *axis = fHistogram->GetAxis(iAxis);
+    DenseAxis &denseAxis = fAxes.at(iAxis);
+    denseAxis.fnBins = axis->GetNbins();
+    denseAxis.fMinimum = axis->GetXmin();
+    denseAxis.fMaximum = axis->GetXmax();
+    denseAxis.fnStoredBins = denseAxis.fnBins;
+    if(axis->GetXbins()->GetSize() > 0){
+      denseAxis.fBinEdges.assign(axis->GetXbins()->GetArray(), axis->GetXbins()->GetArray() + axis->GetXbins()->GetSize());
+      denseAxis.fnStoredBins = denseAxis.fnBins + 2;
+    }
+  }
+
+  // The last axis runs fastest. The bins are allocated on the first fill.
+  fnStoredBins = 1;
+  for(Int_t iAxis = nAxes-1; iAxis >= 0; iAxis--){
+    fAxes.at(iAxis).fStride = fnStoredBins;
+    fnStoredBins *= fAxes.at(iAxis).fnStoredBins;
+  }
+}
+
+/*
+ * Copy constructor
+ */
+DenseHistogram::DenseHistogram(const DenseHistogram& in) :
+  fHistogram(in.fHistogram),
+  fAxes(in.fAxes),
+  fnStoredBins(in.fnStoredBins),
+  fSumWeights(in.fSumWeights),
+  fSumWeightsSquared(in.fSumWeightsSquared),
+  fnFills(in.fnFills)
+{
+  // Copy constructor
+}
+
+/*
+ * Destructor
+ */
+DenseHistogram::~DenseHistogram(){
+  // destructor
+}
+
+/*
+ * Equal sign operator
+ */
+DenseHistogram& DenseHistogram::operator=(const DenseHistogram& in){
+  // Equal sign operator
+
+  if (&in==this) return *this;
+
+  fHistogram = in.fHistogram;
+  fAxes = in.fAxes;
+  fnStoredBins = in.fnStoredBins;
+  fSumWeights = in.fSumWeights;
+  fSumWeightsSquared = in.fSumWeightsSquared;
+  fnFills = in.fnFills;
+
+  return *this;
+}
+
+/*
+ * Find the stored bin for a value on an axis. The uniform bins are found with the same formula as in TAxis, so a
+ * value at a bin edge ends up in the same bin as in the ROOT histogram.
+ *
+ *  Arguments:
+ *   Int_t iAxis = Index of the axis
+ *   Double_t value = Value on the axis
+ *
+ *   return: Index of the stored bin. -1 if the value is outside of a uniform axis.
+ */
+Int_t DenseHistogram::FindBin(Int_t iAxis, Double_t value) const{
+  const DenseAxis &axis = fAxes[iAxis];
+
+  // Variable axes store the underflow and overflow bins, so the bin number of TAxis is used directly
+  if(!axis.fBinEdges.empty()){
+    if(value < axis.fMinimum) return 0;
+    if(!(value < axis.fMaximum)) return axis.fnBins+1;
+    return std::upper_bound(axis.fBinEdges.begin(), axis.fBinEdges.end(), value) - axis.fBinEdges.begin();
+  }
+
+  // The negated comparison also catches NaN
+  if(!(value >= axis.fMinimum && value < axis.fMaximum)) return -1;
+  const Int_t bin = (Int_t)(axis.fnBins*(value-axis.fMinimum)/(axis.fMaximum-axis.fMinimum));
+  return (bin < axis.fnBins) ? bin : axis.fnBins-1;
+}
+
+/*
+ * Fill the bins of all the set trigger bits. The index is calculated once for the other axes, and the trigger bins
+ * are reached by adding the stride of the trigger axis.
+ *
+ *  Arguments:
+ *   const Double_t *values = Values for the axes. The value for the trigger axis is not read.
+ *   Int_t triggerAxis = Index of the trigger axis in the histogram. The value i on the axis is trigger bit i.
+ *   UInt_t triggerMask = Bit i is set if trigger bin i is filled
+ *   const Double_t *triggerWeight = Weight for each trigger bin. Only used for the set bits.
+ *   Double_t jetWeight = Weight for the jet multiplying all the trigger weights
+ *
+ *   return: True if the bins were filled. False if some value is not stored in the dense bins. Then nothing is filled.
+ */
+Bool_t DenseHistogram::FillTriggers(const Double_t *values, Int_t triggerAxis, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight){
+  if(triggerMask == 0) return true;
+
+  Long64_t index = 0;
+  Int_t bin;
+  const Int_t nAxes = fAxes.size();
+  for(Int_t iAxis = 0; iAxis < nAxes; iAxis++){
+    if(iAxis == triggerAxis) continue;
+    bin = FindBin(iAxis, values[iAxis]);
+    if(bin < 0) return false;
+    index += bin * fAxes[iAxis].fStride;
+  }
+
+  // The bins are increasing with the trigger bit, so the lowest and the highest set bit are enough to check the range
+  if(FindBin(triggerAxis, __builtin_ctz(triggerMask)) < 0 || FindBin(triggerAxis, 31 - __builtin_clz(triggerMask)) < 0) return false;
+
+  if(fSumWeights.empty()){
+    fSumWeights.assign(fnStoredBins, 0);
+    fSumWeightsSquared.assign(fnStoredBins, 0);
+  }
+
+  const Long64_t triggerStride = fAxes[triggerAxis].fStride;
+  Int_t iTrigger;
+  Long64_t triggerIndex;
+  Double_t weight;
+  while(triggerMask){
+    iTrigger = __builtin_ctz(triggerMask);
+    triggerMask &= triggerMask - 1;
+    triggerIndex = index + FindBin(triggerAxis, iTrigger) * triggerStride;
+    weight = triggerWeight[iTrigger]*jetWeight;
+    fSumWeights[triggerIndex] += weight;
+    fSumWeightsSquared[triggerIndex] += weight*weight;
+    fnFills++;
+  }
+  return true;
+}
+
+/*
+ * Add the sums to a ROOT histogram with the same binning. The ROOT histogram can hold other fills, so the sums are
+ * added on top of its contents. Used to flush the sums, and to merge the sums of the other workers directly to the
+ * THnSparse, so that the merged histograms do not need dense bins of their own.
+ *
+ *  Arguments:
+ *   THnBase *histogram = Histogram to which the sums are added
+ */
+void DenseHistogram::AddToHistogram(THnBase *histogram) const{
+  if(fnFills == 0) return;
+
+  const Int_t nAxes = fAxes.size();
+  std::vector<Int_t> coordinates(nAxes);
+  Long64_t rootBin;
+  Int_t storedBin;
+  for(Long64_t iBin = 0; iBin < fnStoredBins; iBin++){
+
+    // Every fill adds to the squared weights, while the weights can cancel
+    if(fSumWeightsSquared[iBin] == 0) continue;
+
+    // The ROOT bin numbers include underflow, which is only stored for the variable axes
+    for(Int_t iAxis = 0; iAxis < nAxes; iAxis++){
+      storedBin = (iBin / fAxes[iAxis].fStride) % fAxes[iAxis].fnStoredBins;
+      coordinates[iAxis] = fAxes[iAxis].fBinEdges.empty() ? storedBin+1 : storedBin;
+    }
+    rootBin = histogram->GetBin(coordinates.data());
+    histogram->SetBinContent(rootBin, histogram->GetBinContent(rootBin) + fSumWeights[iBin]);
+    histogram->SetBinError2(rootBin, histogram->GetBinError2(rootBin) + fSumWeightsSquared[iBin]);
+  }
+  histogram->SetEntries(histogram->GetEntries() + fnFills);
+}
+
+/*
+ * Add the sums to the ROOT histogram and empty the dense bins. The ROOT histogram holds the fills outside of the dense
+ * bins and the sums added earlier, so the dense sums are added on top of its contents.
+ */
+void DenseHistogram::FlushToHistogram(){
+  AddToHistogram(fHistogram);
+  Reset();
+}
+
+/*
+ * Empty the dense bins. The memory stays allocated for the following fills.
+ */
+void DenseHistogram::Reset(){
+  if(fnFills == 0) return;
+  std::fill(fSumWeights.begin(), fSumWeights.end(), 0);
+  std::fill(fSumWeightsSquared.begin(), fSumWeightsSquared.end(), 0);
+  fnFills = 0;
+}
+
+/*
+ * Memory used by the dense bins in bytes once they are allocated. The memory budget reserves this from the beginning,
+ * since the bins are allocated on the first fill.
+ */
+Long64_t DenseHistogram::GetMemorySize() const{
+  return 2 * fnStoredBins * sizeof(Double_t);
+}
+
+/*
+ * Getter for the ROOT histogram
+ */
+THnBase* DenseHistogram::GetHistogram() const{
+  return fHistogram;
+}
@@ -0,0 +1,72 @@
+// Dense fixed-bin storage for the fills of a multidimensional histogram
+
+#ifndef DENSEHISTOGRAM_H
+#define DENSEHISTOGRAM_H
+
+// C++ includes
+#include <vector>
+
+// Root includes
+#include <THnBase.h>
+
+/*
+ * DenseHistogram class
+ *
+ * Sums of weights and squared weights for every bin of a THnBase histogram in two contiguous double arrays. The bin
+ * is found with index arithmetic: uniform axes need one subtraction, multiplication and division, and only the axes
+ * with variable bin widths need a binary search. The last axis runs fastest, so the trigger bins of one jet are next
+ * to each other and several of them are filled from one index calculation.
+ *
+ * The ROOT histogram gives the binning. The variable axes have only a few bins, so their underflow and overflow bins
+ * are stored as well. Values outside of the uniform axes are rare, and they are not stored here: the fill is left to
+ * the ROOT histogram instead. Before writing, the dense sums are added to the ROOT histogram, so the written output is
+ * the same THnSparse as without the dense storage.
+ *
+ * The arrays are large, about 500 MB for the default binning of the jet histograms, so they are allocated only on the
+ * first fill. Histograms that are never filled, such as the ones to which the other workers are merged, stay small.
+ */
+class DenseHistogram{
+
+public:
+
+  // Constructors and destructor
+  DenseHistogram(); // Default constructor
+  DenseHistogram(THnBase *histogram); // Custom constructor
+  DenseHistogram(const DenseHistogram& in); // Copy constructor
+  ~DenseHistogram(); // Destructor
+  DenseHistogram& operator=(const DenseHistogram& in); // Equal sign operator
+
+  // Methods
+  Bool_t FillTriggers(const Double_t *values, Int_t triggerAxis, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight); // Fill the bins of all the set trigger bits. False if the values are outside of the dense bins.
+  void AddToHistogram(THnBase *histogram) const; // Add the sums to a ROOT histogram with the same binning
+  void FlushToHistogram();                // Add the sums to the ROOT histogram and empty the dense bins
+  void Reset();                           // Empty the dense bins
+  Long64_t GetMemorySize() const;         // Memory used by the dense bins in bytes once they are allocated
+  THnBase* GetHistogram() const;          // Getter for the ROOT histogram
+
+private:
+
+  // Binning of one axis
+  struct DenseAxis{
+    Int_t fnBins;                  // Number of bins in the axis
+    Double_t fMinimum;             // Lower edge of the axis
+    Double_t fMaximum;             // Upper edge of the axis
+    std::vector<Double_t> fBinEdges; // Bin edges for variable bin widths. Empty for uniform axes.
+    Int_t fnStoredBins;            // Number of stored bins. Variable axes include underflow and overflow.
+    Long64_t fStride;              // Stride of the axis in the dense index
+  };
+
+  // Private methods
+  Int_t FindBin(Int_t iAxis, Double_t value) const; // Find the stored bin on an axis. -1 if the value is not stored.
+
+  // Private data members
+  THnBase *fHistogram;                   // Histogram giving the binning and to which the sums are added. Not owned.
+  std::vector<DenseAxis> fAxes;          // Binning of each axis
+  Long64_t fnStoredBins;                 // Number of stored bins in all the axes
+  std::vector<Double_t> fSumWeights;     // Sum of weights for each stored bin. Empty until the first fill.
+  std::vector<Double_t> fSumWeightsSquared; // Sum of squared weights for each stored bin. Empty until the first fill.
+  Long64_t fnFills;                      // Number of fills since the sums were last added to the ROOT histogram
+
+};
+
+#endif
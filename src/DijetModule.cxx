@@ -0,0 +1,92 @@
+// Implementation for DijetModule
+
+// Root includes
+#include <TMath.h>
+
+// Own includes
+#include "DijetModule.h"
+#include "JetSelectionKernel.h"
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   ConfigurationCard *card = Configuration card for the analysis
+ */
+DijetModule::DijetModule(ConfigurationCard *card) :
+  AnalysisModule("dijet", card)
+{
+  // Custom constructor
+  fhDeltaPhi = new TH1F("dijetDeltaPhi","dijetDeltaPhi",32,0,TMath::Pi()); fhDeltaPhi->Sumw2();
+  fhDijetXj = new TH2F("dijetXj","dijetXj",100,0,500,20,0,1); fhDijetXj->Sumw2();
+}
+
+/*
+ * Destructor
+ */
+DijetModule::~DijetModule(){
+  // destructor
+  delete fhDeltaPhi;
+  delete fhDijetXj;
+}
+
+/*
+ * Create the module for the registry
+ */
+AnalysisModule* DijetModule::Create(ConfigurationCard *card){
+  return new DijetModule(card);
+}
+
+/*
+ * Find the leading and subleading jets passing the nominal jet cuts and fill the dijet histograms
+ *
+ *  Arguments:
+ *   const EventView &event = Event passing the nominal event selection
+ */
+void DijetModule::ProcessEvent(const EventView &event){
+  if(event.fLeadingJetIndex < 0) return;
+
+  // Find the subleading jet from the jets passing the cuts
+  const Double_t leadingJetPt = event.fReader->GetJetPt(event.fLeadingJetIndex);
+  Int_t subleadingJetIndex = -1;
+  Double_t subleadingJetPt = 0;
+  Int_t jetIndex = 0;
+  ULong64_t passingJets = 0;
+  for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+    passingJets = event.fJetPassMask[iWord];
+    while(passingJets){
+      jetIndex = iWord * 64 + __builtin_ctzll(passingJets);
+      passingJets &= passingJets - 1;
+      if(jetIndex == event.fLeadingJetIndex) continue;
+      if(event.fReader->GetJetPt(jetIndex) > subleadingJetPt){
+        subleadingJetPt = event.fReader->GetJetPt(jetIndex);
+        subleadingJetIndex = jetIndex;
+      }
+    }
+  }
+  if(subleadingJetIndex < 0) return;
+
+  // The azimuthal angle between the jets is folded to [0,pi]
+  Double_t deltaPhi = TMath::Abs(event.fReader->GetJetPhi(event.fLeadingJetIndex) - event.fReader->GetJetPhi(subleadingJetIndex));
+  if(deltaPhi > TMath::Pi()) deltaPhi = 2*TMath::Pi() - deltaPhi;
+
+  fhDeltaPhi->Fill(deltaPhi, event.fEventWeight);
+  if(deltaPhi > kBackToBackDeltaPhi) fhDijetXj->Fill(leadingJetPt, subleadingJetPt/leadingJetPt, event.fEventWeight);
+}
+
+/*
+ * Add the histograms from the module of another worker
+ */
+void DijetModule::Merge(const AnalysisModule *other){
+  const DijetModule *otherDijet = static_cast<const DijetModule*>(other);
+  fhDeltaPhi->Add(otherDijet->fhDeltaPhi);
+  fhDijetXj->Add(otherDijet->fhDijetXj);
+}
+
+/*
+ * Write the histograms to the current directory
+ */
+void DijetModule::Write() const{
+  fhDeltaPhi->Write();
+  fhDijetXj->Write();
+}
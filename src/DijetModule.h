@@ -0,0 +1,43 @@
+// Dijet momentum balance filled in the same pass as the trigger analysis
+
+#ifndef DIJETMODULE_H
+#define DIJETMODULE_H
+
+// Root includes
+#include <TH1.h>
+#include <TH2.h>
+#include <TMath.h>
+
+// Own includes
+#include "AnalysisModule.h"
+
+/*
+ * DijetModule class
+ *
+ * Leading and subleading jets from the jets passing the nominal jet cuts. The azimuthal angle between the jets is
+ * filled for all dijets, and the momentum balance xj = subleading pT / leading pT for back-to-back dijets.
+ */
+class DijetModule : public AnalysisModule{
+
+public:
+
+  static constexpr Double_t kBackToBackDeltaPhi = 5*TMath::Pi()/6; // Minimum azimuthal angle between back-to-back jets
+
+  // Constructors and destructor
+  DijetModule(ConfigurationCard *card); // Custom constructor
+  ~DijetModule();                       // Destructor
+
+  // Methods
+  void ProcessEvent(const EventView &event) override; // Find the dijet and fill the histograms
+  void Merge(const AnalysisModule *other) override;   // Add the histograms from another worker
+  void Write() const override;                        // Write the histograms to the current directory
+  static AnalysisModule* Create(ConfigurationCard *card); // Create the module for the registry
+
+private:
+
+  TH1F *fhDeltaPhi;     // Azimuthal angle between the leading and subleading jets
+  TH2F *fhDijetXj;      // Momentum balance for back-to-back dijets. Axes: [leading jet pT][xj]
+
+};
+
+#endif
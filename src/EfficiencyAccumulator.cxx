@@ -0,0 +1,331 @@
+// Implementation for EfficiencyAccumulator
+
+// C++ includes
+#include <iostream>
+#include <algorithm>
+
+// Root includes
+#include <TMath.h>
+#include <TDirectory.h>
+
+// Own includes
+#include "EfficiencyAccumulator.h"
+
+using namespace std;
+
+/*
+ * Default constructor
+ */
+EfficiencyAccumulator::EfficiencyAccumulator() :
+  fnPtBins(0),
+  fMinPt(0),
+  fMaxPt(0),
+  fCentralityBinEdges(),
+  fPassSumWeights(),
+  fPassSumWeightsSquared(),
+  fTotalSumWeights(),
+  fTotalSumWeightsSquared()
+{
+  // Default constructor
+}
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   Int_t nPtBins = Number of bins in the jet pT axis
+ *   Double_t minPt = Lower edge of the jet pT axis
+ *   Double_t maxPt = Upper edge of the jet pT axis
+ *   Int_t nCentralityBins = Number of centrality bins
+ *   const Double_t *centralityBinEdges = Array of nCentralityBins+1 bin edges for centrality
+ */
+EfficiencyAccumulator::EfficiencyAccumulator(Int_t nPtBins, Double_t minPt, Double_t maxPt, Int_t nCentralityBins, const Double_t *centralityBinEdges) :
+  fnPtBins(nPtBins),
+  fMinPt(minPt),
+  fMaxPt(maxPt),
+  fCentralityBinEdges(centralityBinEdges, centralityBinEdges+nCentralityBins+1),
+  fPassSumWeights(),
+  fPassSumWeightsSquared(),
+  fTotalSumWeights(),
+  fTotalSumWeightsSquared()
+{
+  // Custom constructor
+
+  // Underflow and overflow bins are included for jet pT and centrality. Centrality underflow holds pp events.
+  const Long64_t nTotalBins = (Long64_t)knJetTypes * (nCentralityBins+2) * TriggerHistograms::knDataLevels * (fnPtBins+2);
+  fPassSumWeights.assign(nTotalBins * TriggerHistograms::knTriggerTypes, 0);
+  fPassSumWeightsSquared.assign(nTotalBins * TriggerHistograms::knTriggerTypes, 0);
+  fTotalSumWeights.assign(nTotalBins, 0);
+  fTotalSumWeightsSquared.assign(nTotalBins, 0);
+}
+
+/*
+ * Copy constructor
+ */
+EfficiencyAccumulator::EfficiencyAccumulator(const EfficiencyAccumulator& in) :
+  fnPtBins(in.fnPtBins),
+  fMinPt(in.fMinPt),
+  fMaxPt(in.fMaxPt),
+  fCentralityBinEdges(in.fCentralityBinEdges),
+  fPassSumWeights(in.fPassSumWeights),
+  fPassSumWeightsSquared(in.fPassSumWeightsSquared),
+  fTotalSumWeights(in.fTotalSumWeights),
+  fTotalSumWeightsSquared(in.fTotalSumWeightsSquared)
+{
+  // Copy constructor
+}
+
+/*
+ * Destructor
+ */
+EfficiencyAccumulator::~EfficiencyAccumulator(){
+  // destructor
+}
+
+/*
+ * Equal sign operator
+ */
+EfficiencyAccumulator& EfficiencyAccumulator::operator=(const EfficiencyAccumulator& in){
+  // Equal sign operator
+
+  if (&in==this) return *this;
+
+  fnPtBins = in.fnPtBins;
+  fMinPt = in.fMinPt;
+  fMaxPt = in.fMaxPt;
+  fCentralityBinEdges = in.fCentralityBinEdges;
+  fPassSumWeights = in.fPassSumWeights;
+  fPassSumWeightsSquared = in.fPassSumWeightsSquared;
+  fTotalSumWeights = in.fTotalSumWeights;
+  fTotalSumWeightsSquared = in.fTotalSumWeightsSquared;
+
+  return *this;
+}
+
+/*
+ * Find the jet pT bin. Bin 0 is underflow and bin fnPtBins+1 overflow.
+ */
+Int_t EfficiencyAccumulator::FindPtBin(Double_t jetPt) const{
+  if(!(jetPt >= fMinPt)) return 0;
+  if(jetPt >= fMaxPt) return fnPtBins+1;
+  Int_t bin = 1 + (Int_t)((jetPt - fMinPt) / (fMaxPt - fMinPt) * fnPtBins);
+  return (bin > fnPtBins) ? fnPtBins : bin;
+}
+
+/*
+ * Find the centrality bin. Bin 0 is underflow and the last bin overflow, as in the THnSparse histograms. The pp events
+ * have centrality -0.5, which goes to the underflow bin.
+ */
+Int_t EfficiencyAccumulator::FindCentralityBin(Double_t centrality) const{
+  return std::upper_bound(fCentralityBinEdges.begin(), fCentralityBinEdges.end(), centrality) - fCentralityBinEdges.begin();
+}
+
+/*
+ * Fill the accumulators for one jet. The total is filled with the weight of the bin without trigger selection,
+ * and pass for each trigger that fired with the weight of that trigger.
+ *
+ *  Arguments:
+ *   Int_t jetType = Inclusive or leading jet
+ *   Double_t jetPt = Jet pT
+ *   Double_t centrality = Event centrality
+ *   Int_t dataLevel = Reconstructed or generator level
+ *   UInt_t triggerMask = Bit i is set if trigger bin i is filled. Bit knTriggerTypes is the bin without trigger selection.
+ *   const Double_t *triggerWeight = Weight for each trigger bin. Only used for the set bits.
+ *   Double_t jetWeight = Weight for the jet multiplying all the trigger weights
+ */
+void EfficiencyAccumulator::Fill(Int_t jetType, Double_t jetPt, Double_t centrality, Int_t dataLevel, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight){
+
+  const Int_t centralityBin = FindCentralityBin(centrality);
+  const Int_t ptBin = FindPtBin(jetPt);
+
+  // Total for the bin without trigger selection
+  Double_t weight;
+  Long64_t index;
+  if(triggerMask & (1u << TriggerHistograms::knTriggerTypes)){
+    weight = triggerWeight[TriggerHistograms::knTriggerTypes]*jetWeight;
+    index = GetBlockIndex(jetType, centralityBin, dataLevel, TriggerHistograms::knTriggerTypes) + ptBin;
+    fTotalSumWeights[index] += weight;
+    fTotalSumWeightsSquared[index] += weight*weight;
+  }
+
+  // Pass for all the triggers that fired
+  UInt_t passMask = triggerMask & ((1u << TriggerHistograms::knTriggerTypes) - 1);
+  Int_t iTrigger;
+  while(passMask){
+    iTrigger = __builtin_ctz(passMask);
+    passMask &= passMask - 1;
+    weight = triggerWeight[iTrigger]*jetWeight;
+    index = GetBlockIndex(jetType, centralityBin, dataLevel, iTrigger) + ptBin;
+    fPassSumWeights[index] += weight;
+    fPassSumWeightsSquared[index] += weight*weight;
+  }
+
+}
+
+/*
+ * Add the sums from another accumulator with the same binning
+ */
+void EfficiencyAccumulator::Add(const EfficiencyAccumulator *other){
+  for(ULong64_t iBin = 0; iBin < fPassSumWeights.size(); iBin++){
+    fPassSumWeights[iBin] += other->fPassSumWeights[iBin];
+    fPassSumWeightsSquared[iBin] += other->fPassSumWeightsSquared[iBin];
+  }
+  for(ULong64_t iBin = 0; iBin < fTotalSumWeights.size(); iBin++){
+    fTotalSumWeights[iBin] += other->fTotalSumWeights[iBin];
+    fTotalSumWeightsSquared[iBin] += other->fTotalSumWeightsSquared[iBin];
+  }
+}
+
+/*
+ * Index of the first pT bin of a block of sums
+ *
+ *  Arguments:
+ *   Int_t jetType = Inclusive or leading jet
+ *   Int_t centralityBin = Centrality bin including underflow and overflow
+ *   Int_t dataLevel = Reconstructed or generator level
+ *   Int_t trigger = Trigger index for the pass sums, or knTriggerTypes for the total sums
+ *
+ *   return: Index of the pT underflow bin of the block in the pass or total sums
+ */
+Long64_t EfficiencyAccumulator::GetBlockIndex(Int_t jetType, Int_t centralityBin, Int_t dataLevel, Int_t trigger) const{
+  const Int_t nCentralityBins = fCentralityBinEdges.size() + 1;
+  const Long64_t keyIndex = ((Long64_t)jetType * nCentralityBins + centralityBin) * TriggerHistograms::knDataLevels + dataLevel;
+  if(trigger == TriggerHistograms::knTriggerTypes) return keyIndex * (fnPtBins+2);
+  return (keyIndex * TriggerHistograms::knTriggerTypes + trigger) * (fnPtBins+2);
+}
+
+/*
+ * Sum of weights for a bin of the total jets
+ *
+ *  Arguments:
+ *   Int_t jetType = Inclusive or leading jet
+ *   Double_t jetPt = Jet pT in the bin
+ *   Double_t centrality = Centrality in the bin
+ *   Int_t dataLevel = Reconstructed or generator level
+ *
+ *   return: Sum of weights for total in the bin
+ */
+Double_t EfficiencyAccumulator::GetTotalSumWeights(Int_t jetType, Double_t jetPt, Double_t centrality, Int_t dataLevel) const{
+  return fTotalSumWeights[GetBlockIndex(jetType, FindCentralityBin(centrality), dataLevel, TriggerHistograms::knTriggerTypes) + FindPtBin(jetPt)];
+}
+
+/*
+ * Sum of weights for a bin of the jets passing a trigger
+ *
+ *  Arguments:
+ *   Int_t jetType = Inclusive or leading jet
+ *   Double_t jetPt = Jet pT in the bin
+ *   Double_t centrality = Centrality in the bin
+ *   Int_t dataLevel = Reconstructed or generator level
+ *   Int_t trigger = Index of the trigger
+ *
+ *   return: Sum of weights for pass in the bin
+ */
+Double_t EfficiencyAccumulator::GetPassSumWeights(Int_t jetType, Double_t jetPt, Double_t centrality, Int_t dataLevel, Int_t trigger) const{
+  return fPassSumWeights[GetBlockIndex(jetType, FindCentralityBin(centrality), dataLevel, trigger) + FindPtBin(jetPt)];
+}
+
+/*
+ * Memory used by the sums in bytes
+ */
+Long64_t EfficiencyAccumulator::GetMemorySize() const{
+  return (fPassSumWeights.size() + fPassSumWeightsSquared.size() + fTotalSumWeights.size() + fTotalSumWeightsSquared.size()) * sizeof(Double_t);
+}
+
+/*
+ * Convert one block of sums into a histogram in the jet pT binning
+ *
+ *  Arguments:
+ *   TString name = Name of the histogram
+ *   const std::vector<Double_t> &sumWeights = Sums of weights
+ *   const std::vector<Double_t> &sumWeightsSquared = Sums of squared weights
+ *   Long64_t firstIndex = Index of the underflow bin of the block
+ *
+ *   return: Histogram with contents and errors from the sums. It is not attached to any directory.
+ */
+TH1D* EfficiencyAccumulator::CreateHistogram(TString name, const std::vector<Double_t> &sumWeights, const std::vector<Double_t> &sumWeightsSquared, Long64_t firstIndex) const{
+  TH1D *histogram = new TH1D(name, name, fnPtBins, fMinPt, fMaxPt);
+  histogram->SetDirectory(0);
+  histogram->Sumw2();
+  for(Int_t iBin = 0; iBin < fnPtBins+2; iBin++){
+    histogram->SetBinContent(iBin, sumWeights[firstIndex+iBin]);
+    histogram->SetBinError(iBin, TMath::Sqrt(sumWeightsSquared[firstIndex+iBin]));
+  }
+  return histogram;
+}
+
+/*
+ * Write the pass and total histograms to a directory called "efficiency" in the current directory. A TEfficiency
+ * is written for each pass histogram that is consistent with the total.
+ *
+ * Naming: <jetType>Total_C<centrality>_L<level> and <jetType>Pass_C<centrality>_L<level>_T<trigger>, and similarly
+ * <jetType>Efficiency_C<centrality>_L<level>_T<trigger> for the TEfficiency objects. The centrality underflow and
+ * overflow bins are written with CUnderflow and COverflow in place of C<centrality> if they have any fills. For pp,
+ * all the jets are in the underflow bin.
+ */
+void EfficiencyAccumulator::Write() const{
+
+  TDirectory *outputDirectory = gDirectory;
+  TDirectory *efficiencyDirectory = outputDirectory->GetDirectory("efficiency");
+  if(!efficiencyDirectory) efficiencyDirectory = outputDirectory->mkdir("efficiency");
+  efficiencyDirectory->cd();
+
+  const Int_t nCentralityBins = fCentralityBinEdges.size() + 1;
+  std::vector<Bool_t> centralityBinFilled(nCentralityBins, false);
+  Long64_t firstIndex;
+  for(Int_t iCentrality = 0; iCentrality < nCentralityBins; iCentrality++){
+    for(Int_t iJetType = 0; iJetType < knJetTypes; iJetType++){
+      for(Int_t iLevel = 0; iLevel < TriggerHistograms::knDataLevels; iLevel++){
+        for(Int_t iTrigger = 0; iTrigger <= TriggerHistograms::knTriggerTypes; iTrigger++){
+          firstIndex = GetBlockIndex(iJetType, iCentrality, iLevel, iTrigger);
+          const std::vector<Double_t> &sumWeightsSquared = (iTrigger == TriggerHistograms::knTriggerTypes) ? fTotalSumWeightsSquared : fPassSumWeightsSquared;
+          for(Int_t iPt = 0; iPt < fnPtBins+2; iPt++){
+            if(sumWeightsSquared[firstIndex+iPt] != 0) centralityBinFilled.at(iCentrality) = true;
+          }
+        }
+      }
+    }
+  }
+
+  TString centralityName;
+  TH1D *totalHistogram;
+  TH1D *passHistogram;
+  TEfficiency *efficiency;
+  for(Int_t iJetType = 0; iJetType < knJetTypes; iJetType++){
+    for(Int_t iCentrality = 0; iCentrality < nCentralityBins; iCentrality++){
+
+      // The regular centrality bins are numbered from zero
+      if(iCentrality == 0 || iCentrality == nCentralityBins-1){
+        if(!centralityBinFilled.at(iCentrality)) continue;
+        centralityName = (iCentrality == 0) ? "CUnderflow" : "COverflow";
+      } else {
+        centralityName = Form("C%d", iCentrality-1);
+      }
+
+      for(Int_t iLevel = 0; iLevel < TriggerHistograms::knDataLevels; iLevel++){
+
+        totalHistogram = CreateHistogram(Form("%sTotal_%s_L%d", kJetTypeStrings[iJetType].Data(), centralityName.Data(), iLevel), fTotalSumWeights, fTotalSumWeightsSquared, GetBlockIndex(iJetType, iCentrality, iLevel, TriggerHistograms::knTriggerTypes));
+        totalHistogram->Write();
+
+        for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+          passHistogram = CreateHistogram(Form("%sPass_%s_L%d_T%d", kJetTypeStrings[iJetType].Data(), centralityName.Data(), iLevel, iTrigger), fPassSumWeights, fPassSumWeightsSquared, GetBlockIndex(iJetType, iCentrality, iLevel, iTrigger));
+          passHistogram->Write();
+
+          // Prescaled triggers can have more weight in pass than in total, in which case only the histograms are written
+          if(TEfficiency::CheckConsistency(*passHistogram, *totalHistogram, "w")){
+            efficiency = new TEfficiency(*passHistogram, *totalHistogram);
+            efficiency->SetName(Form("%sEfficiency_%s_L%d_T%d", kJetTypeStrings[iJetType].Data(), centralityName.Data(), iLevel, iTrigger));
+            efficiency->Write();
+            delete efficiency;
+          }
+
+          delete passHistogram;
+        } // Trigger loop
+
+        delete totalHistogram;
+      } // Data level loop
+    } // Centrality loop
+  } // Jet type loop
+
+  outputDirectory->cd();
+}
@@ -0,0 +1,74 @@
+// Accumulator for the trigger efficiency turn-on curves filled directly in the event loop
+
+#ifndef EFFICIENCYACCUMULATOR_H
+#define EFFICIENCYACCUMULATOR_H
+
+// C++ includes
+#include <vector>
+
+// Root includes
+#include <TString.h>
+#include <TH1.h>
+#include <TEfficiency.h>
+
+// Own includes
+#include "TriggerHistograms.h"
+
+/*
+ * EfficiencyAccumulator class
+ *
+ * Holds the sum of weights and the sum of squared weights for passed and total jets in the jet pT binning of the
+ * analysis. The accumulators are keyed by jet type (inclusive or leading), centrality bin, data level and trigger.
+ * The centrality bins include underflow and overflow like the THnSparses, so pp events with centrality -0.5 are kept.
+ * A jet counts as passed for every trigger that fired on top of the base trigger, and as total for the bin
+ * without trigger selection. The result is the same turn-on curve that the plotting macro gets by dividing the
+ * projected jet pT histograms, but without going through the THnSparses.
+ *
+ * When written, the pass and total distributions are converted into TH1D histograms with proper errors. If the
+ * histograms are consistent for a binomial efficiency, a TEfficiency object is written next to them.
+ */
+class EfficiencyAccumulator{
+
+public:
+
+  // Jet types for which the efficiency is accumulated
+  enum enumJetTypes {kInclusiveJet, kLeadingJet, knJetTypes};
+
+  // Constructors and destructor
+  EfficiencyAccumulator(); // Default constructor
+  EfficiencyAccumulator(Int_t nPtBins, Double_t minPt, Double_t maxPt, Int_t nCentralityBins, const Double_t *centralityBinEdges); // Custom constructor
+  EfficiencyAccumulator(const EfficiencyAccumulator& in); // Copy constructor
+  ~EfficiencyAccumulator(); // Destructor
+  EfficiencyAccumulator& operator=(const EfficiencyAccumulator& in); // Equal sign operator
+
+  // Methods
+  void Fill(Int_t jetType, Double_t jetPt, Double_t centrality, Int_t dataLevel, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight); // Fill pass and total for all the set trigger bits
+  void Add(const EfficiencyAccumulator *other); // Add the sums from another accumulator
+  void Write() const;                           // Write the pass and total histograms and efficiencies to the current directory
+  Double_t GetTotalSumWeights(Int_t jetType, Double_t jetPt, Double_t centrality, Int_t dataLevel) const; // Sum of weights for total in a bin
+  Double_t GetPassSumWeights(Int_t jetType, Double_t jetPt, Double_t centrality, Int_t dataLevel, Int_t trigger) const; // Sum of weights for pass in a bin
+  Long64_t GetMemorySize() const;               // Memory used by the sums in bytes
+
+private:
+
+  // Private methods
+  Int_t FindPtBin(Double_t jetPt) const;               // Find the pT bin including underflow and overflow
+  Int_t FindCentralityBin(Double_t centrality) const;  // Find the centrality bin including underflow and overflow
+  Long64_t GetBlockIndex(Int_t jetType, Int_t centralityBin, Int_t dataLevel, Int_t trigger) const; // Index of the first pT bin of a block of sums
+  TH1D* CreateHistogram(TString name, const std::vector<Double_t> &sumWeights, const std::vector<Double_t> &sumWeightsSquared, Long64_t firstIndex) const; // Convert sums to a histogram
+
+  // Private data members
+  Int_t fnPtBins;                                  // Number of jet pT bins
+  Double_t fMinPt;                                 // Lower edge of the jet pT axis
+  Double_t fMaxPt;                                 // Upper edge of the jet pT axis
+  std::vector<Double_t> fCentralityBinEdges;       // Bin edges for centrality
+  std::vector<Double_t> fPassSumWeights;           // Sum of weights for passed jets. Index: [jet type][centrality][reco/gen][trigger][pT]
+  std::vector<Double_t> fPassSumWeightsSquared;    // Sum of squared weights for passed jets. Index: [jet type][centrality][reco/gen][trigger][pT]
+  std::vector<Double_t> fTotalSumWeights;          // Sum of weights for all jets. Index: [jet type][centrality][reco/gen][pT]
+  std::vector<Double_t> fTotalSumWeightsSquared;   // Sum of squared weights for all jets. Index: [jet type][centrality][reco/gen][pT]
+
+  const TString kJetTypeStrings[knJetTypes] = {"inclusiveJet", "leadingJet"}; // Names of the jet types
+
+};
+
+#endif
@@ -0,0 +1,466 @@
+// Implementation for FixedPointSum and FixedPointHistogram
+
+// C++ includes
+#include <iostream>
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include <cstring>
+#include <assert.h>
+
+// Root includes
+#include <TMath.h>
+#include <TKey.h>
+
+// Own includes
+#include "FixedPointHistogram.h"
+
+using namespace std;
+
+// Name of the tree holding the exact sums in each directory
+const char *FixedPointHistogram::kStateTreeName = "fixedPointSums";
+
+// ========================================= //
+// =========== FixedPointSum =============== //
+// ========================================= //
+
+/*
+ * Default constructor
+ */
+FixedPointSum::FixedPointSum(){
+  // Default constructor
+  std::fill(fLimb, fLimb+knLimbs, 0);
+}
+
+/*
+ * Add an integer given as limbs, propagating the carry from the lowest limb up
+ */
+void FixedPointSum::AddLimbs(const ULong64_t *addend){
+  ULong64_t carry = 0;
+  ULong64_t sum;
+  for(Int_t iLimb = 0; iLimb < knLimbs; iLimb++){
+    sum = fLimb[iLimb] + addend[iLimb];
+    const ULong64_t overflow = (sum < addend[iLimb]) ? 1 : 0;
+    fLimb[iLimb] = sum + carry;
+    carry = overflow | ((fLimb[iLimb] < carry) ? 1 : 0);
+  }
+}
+
+/*
+ * Add a double to the sum. The bits of the value below the resolution are dropped, and negative values are
+ * truncated the same way as positive ones, so the added integer depends only on the value.
+ *
+ *  Arguments:
+ *   Double_t value = Added value
+ */
+void FixedPointSum::Add(Double_t value){
+  if(value == 0) return;
+
+  if(!TMath::Finite(value)){
+    cout << "Error! Cannot add a value that is not finite to a fixed-point sum" << endl;
+    assert(0);
+  }
+
+  // Write the absolute value as an integer mantissa times a power of two
+  Int_t exponent;
+  const Double_t fraction = std::frexp(TMath::Abs(value), &exponent);
+  ULong64_t mantissa = (ULong64_t)std::ldexp(fraction, 53);
+  Int_t position = exponent - 53 + kFractionBits;
+
+  if(exponent > knLimbs*64 - 1 - kFractionBits){
+    cout << "Error! The value " << value << " is too large for a fixed-point sum" << endl;
+    assert(0);
+  }
+
+  // Drop the bits below the resolution
+  if(position < 0){
+    if(position <= -53) return;
+    mantissa >>= -position;
+    position = 0;
+  }
+
+  // The shifted mantissa covers at most two limbs
+  ULong64_t addend[knLimbs] = {0};
+  const Int_t firstLimb = position / 64;
+  const Int_t shift = position % 64;
+  addend[firstLimb] = mantissa << shift;
+  if(shift > 0 && firstLimb+1 < knLimbs) addend[firstLimb+1] = mantissa >> (64 - shift);
+
+  // Negative values are added as two's complement
+  if(value < 0){
+    ULong64_t carry = 1;
+    for(Int_t iLimb = 0; iLimb < knLimbs; iLimb++){
+      addend[iLimb] = ~addend[iLimb] + carry;
+      carry = (carry && addend[iLimb] == 0) ? 1 : 0;
+    }
+  }
+
+  AddLimbs(addend);
+}
+
+/*
+ * Add another fixed-point sum
+ */
+void FixedPointSum::Add(const FixedPointSum &other){
+  AddLimbs(other.fLimb);
+}
+
+/*
+ * Convert the sum to a double. The conversion depends only on the integer, so equal sums give equal doubles.
+ */
+Double_t FixedPointSum::GetValue() const{
+
+  // Convert the absolute value and set the sign in the end
+  ULong64_t magnitude[knLimbs];
+  std::copy(fLimb, fLimb+knLimbs, magnitude);
+  const Bool_t isNegative = (fLimb[knLimbs-1] >> 63) != 0;
+  if(isNegative){
+    ULong64_t carry = 1;
+    for(Int_t iLimb = 0; iLimb < knLimbs; iLimb++){
+      magnitude[iLimb] = ~magnitude[iLimb] + carry;
+      carry = (carry && magnitude[iLimb] == 0) ? 1 : 0;
+    }
+  }
+
+  Double_t value = 0;
+  for(Int_t iLimb = knLimbs-1; iLimb >= 0; iLimb--){
+    value += std::ldexp((Double_t)magnitude[iLimb], 64*iLimb - kFractionBits);
+  }
+
+  return isNegative ? -value : value;
+}
+
+// ========================================= //
+// ========= FixedPointHistogram =========== //
+// ========================================= //
+
+/*
+ * Default constructor
+ */
+FixedPointHistogram::FixedPointHistogram() :
+  fHistogram(0),
+  fHistogramN(0),
+  fAxisStride(),
+  fBins()
+{
+  // Default constructor
+}
+
+/*
+ * Custom constructor for one dimensional histograms
+ *
+ *  Arguments:
+ *   TH1 *histogram = Histogram giving the binning and to which the sums are copied before writing
+ */
+FixedPointHistogram::FixedPointHistogram(TH1 *histogram) :
+  fHistogram(histogram),
+  fHistogramN(0),
+  fAxisStride(),
+  fBins()
+{
+  // Custom constructor
+}
+
+/*
+ * Custom constructor for multidimensional histograms
+ *
+ *  Arguments:
+ *   THnBase *histogram = Histogram giving the binning and to which the sums are copied before writing
+ */
+FixedPointHistogram::FixedPointHistogram(THnBase *histogram) :
+  fHistogram(0),
+  fHistogramN(histogram),
+  fAxisStride(),
+  fBins()
+{
+  // Custom constructor
+  SetAxisStrides();
+}
+
+/*
+ * Copy constructor
+ */
+FixedPointHistogram::FixedPointHistogram(const FixedPointHistogram& in) :
+  fHistogram(in.fHistogram),
+  fHistogramN(in.fHistogramN),
+  fAxisStride(in.fAxisStride),
+  fBins(in.fBins)
+{
+  // Copy constructor
+}
+
+/*
+ * Destructor
+ */
+FixedPointHistogram::~FixedPointHistogram(){
+  // destructor
+}
+
+/*
+ * Equal sign operator
+ */
+FixedPointHistogram& FixedPointHistogram::operator=(const FixedPointHistogram& in){
+  // Equal sign operator
+
+  if (&in==this) return *this;
+
+  fHistogram = in.fHistogram;
+  fHistogramN = in.fHistogramN;
+  fAxisStride = in.fAxisStride;
+  fBins = in.fBins;
+
+  return *this;
+}
+
+/*
+ * Calculate the strides of the global bin number. The underflow and overflow bins are included for each axis.
+ */
+void FixedPointHistogram::SetAxisStrides(){
+  const Int_t nAxes = fHistogramN->GetNdimensions();
+  fAxisStride.assign(nAxes, 1);
+  for(Int_t iAxis = 1; iAxis < nAxes; iAxis++){
+    fAxisStride[iAxis] = fAxisStride[iAxis-1] * (fHistogramN->GetAxis(iAxis-1)->GetNbins() + 2);
+  }
+}
+
+/*
+ * Fill a one dimensional histogram
+ *
+ *  Arguments:
+ *   Double_t value = Filled value
+ *   Double_t weight = Weight of the fill
+ */
+void FixedPointHistogram::Fill(Double_t value, Double_t weight){
+  FixedPointBin &sums = fBins[fHistogram->FindFixBin(value)];
+  sums.fSumWeights.Add(weight);
+  sums.fSumWeightsSquared.Add(weight*weight);
+  sums.fnFills++;
+}
+
+/*
+ * Fill a multidimensional histogram
+ *
+ *  Arguments:
+ *   const Double_t *values = Values for the axes
+ *   Double_t weight = Weight of the fill
+ */
+void FixedPointHistogram::Fill(const Double_t *values, Double_t weight){
+  Long64_t bin = 0;
+  for(UInt_t iAxis = 0; iAxis < fAxisStride.size(); iAxis++){
+    bin += fHistogramN->GetAxis(iAxis)->FindFixBin(values[iAxis]) * fAxisStride[iAxis];
+  }
+  FixedPointBin &sums = fBins[bin];
+  sums.fSumWeights.Add(weight);
+  sums.fSumWeightsSquared.Add(weight*weight);
+  sums.fnFills++;
+}
+
+/*
+ * Add sums to a bin
+ */
+void FixedPointHistogram::AddBin(Long64_t bin, const FixedPointBin &sums){
+  FixedPointBin &binSums = fBins[bin];
+  binSums.fSumWeights.Add(sums.fSumWeights);
+  binSums.fSumWeightsSquared.Add(sums.fSumWeightsSquared);
+  binSums.fnFills += sums.fnFills;
+}
+
+/*
+ * Add the sums from another histogram with the same binning
+ */
+void FixedPointHistogram::Add(const FixedPointHistogram *other){
+  for(const auto &otherBin : other->fBins) AddBin(otherBin.first, otherBin.second);
+}
+
+/*
+ * Remove all the sums and release their memory
+ */
+void FixedPointHistogram::Reset(){
+  std::unordered_map<Long64_t,FixedPointBin>().swap(fBins);
+}
+
+/*
+ * Estimated memory used by the sums in bytes. Each filled bin has the key and the sums in a hash table node with a
+ * pointer to the next node and a pointer from the bucket array.
+ */
+Long64_t FixedPointHistogram::GetMemorySize() const{
+  return fBins.size() * (sizeof(Long64_t) + sizeof(FixedPointBin) + 2*sizeof(void*));
+}
+
+/*
+ * Getter for the ROOT histogram
+ */
+const TObject* FixedPointHistogram::GetHistogram() const{
+  if(fHistogram) return fHistogram;
+  return fHistogramN;
+}
+
+/*
+ * Set the contents of the ROOT histogram from the exact sums. The bins are set in increasing order, so that also
+ * the internal bin order of a THnSparse does not depend on the order of the fills.
+ */
+void FixedPointHistogram::CopyToHistogram() const{
+
+  std::vector<Long64_t> filledBins;
+  filledBins.reserve(fBins.size());
+  for(const auto &binSums : fBins) filledBins.push_back(binSums.first);
+  std::sort(filledBins.begin(), filledBins.end());
+
+  Long64_t nFills = 0;
+
+  // One dimensional histograms use the global bin number directly
+  if(fHistogram){
+    fHistogram->Reset();
+    for(const Long64_t bin : filledBins){
+      const FixedPointBin &sums = fBins.at(bin);
+      fHistogram->SetBinContent(bin, sums.fSumWeights.GetValue());
+      fHistogram->SetBinError(bin, TMath::Sqrt(sums.fSumWeightsSquared.GetValue()));
+      nFills += sums.fnFills;
+    }
+    fHistogram->ResetStats();
+    fHistogram->SetEntries(nFills);
+    return;
+  }
+
+  // For multidimensional histograms, find the coordinates on each axis from the global bin number
+  const Int_t nAxes = fAxisStride.size();
+  std::vector<Int_t> coordinates(nAxes);
+  Long64_t rootBin;
+  fHistogramN->Reset();
+  fHistogramN->Sumw2();
+  for(const Long64_t bin : filledBins){
+    for(Int_t iAxis = 0; iAxis < nAxes; iAxis++){
+      coordinates[iAxis] = (bin / fAxisStride[iAxis]) % (fHistogramN->GetAxis(iAxis)->GetNbins() + 2);
+    }
+    const FixedPointBin &sums = fBins.at(bin);
+    rootBin = fHistogramN->GetBin(coordinates.data());
+    fHistogramN->SetBinContent(rootBin, sums.fSumWeights.GetValue());
+    fHistogramN->SetBinError2(rootBin, sums.fSumWeightsSquared.GetValue());
+    nFills += sums.fnFills;
+  }
+  fHistogramN->SetEntries(nFills);
+}
+
+/*
+ * Write the exact sums of the histograms as a tree to the current directory. The histograms are sorted by name and
+ * the bins by the bin number, so the tree does not depend on the order of the fills either.
+ *
+ *  Arguments:
+ *   const std::vector<FixedPointHistogram*> &histograms = Histograms written to the tree
+ */
+void FixedPointHistogram::WriteState(const std::vector<FixedPointHistogram*> &histograms){
+
+  char histogramName[256];
+  Long64_t bin;
+  FixedPointBin sums;
+
+  TTree *stateTree = new TTree(kStateTreeName, "Exact sums of weights for the histograms");
+  stateTree->Branch("histogram", histogramName, "histogram/C");
+  stateTree->Branch("bin", &bin, "bin/L");
+  stateTree->Branch("sumWeights", sums.fSumWeights.fLimb, Form("sumWeights[%d]/l", FixedPointSum::knLimbs));
+  stateTree->Branch("sumWeightsSquared", sums.fSumWeightsSquared.fLimb, Form("sumWeightsSquared[%d]/l", FixedPointSum::knLimbs));
+  stateTree->Branch("fills", &sums.fnFills, "fills/L");
+
+  std::vector<FixedPointHistogram*> sortedHistograms = histograms;
+  std::sort(sortedHistograms.begin(), sortedHistograms.end(), [](const FixedPointHistogram *first, const FixedPointHistogram *second){
+    return strcmp(first->GetHistogram()->GetName(), second->GetHistogram()->GetName()) < 0;
+  });
+
+  std::vector<Long64_t> filledBins;
+  for(const FixedPointHistogram *histogram : sortedHistograms){
+    strncpy(histogramName, histogram->GetHistogram()->GetName(), sizeof(histogramName)-1);
+    histogramName[sizeof(histogramName)-1] = '\0';
+
+    filledBins.clear();
+    for(const auto &binSums : histogram->fBins) filledBins.push_back(binSums.first);
+    std::sort(filledBins.begin(), filledBins.end());
+
+    for(const Long64_t filledBin : filledBins){
+      bin = filledBin;
+      sums = histogram->fBins.at(filledBin);
+      stateTree->Fill();
+    }
+  }
+
+  stateTree->Write();
+  delete stateTree;
+}
+
+/*
+ * Recalculate the histograms in a directory and its subdirectories from the state trees. After the outputs of
+ * several jobs are merged, the state tree in a directory holds the rows of all the jobs. The sums for each bin are
+ * added exactly, the histograms are overwritten with the result, and the state tree is replaced with a merged one.
+ * The directory must be in a file opened for updating.
+ *
+ *  Arguments:
+ *   TDirectory *directory = Directory in which the histograms are finalized
+ */
+void FixedPointHistogram::FinalizeDirectory(TDirectory *directory){
+
+  // The list of keys changes when writing, so the subdirectories are collected before finalizing them
+  std::vector<TString> subdirectoryNames;
+  TIter nextKey(directory->GetListOfKeys());
+  TKey *key;
+  while((key = (TKey*)nextKey())){
+    if(TString(key->GetClassName()) == "TDirectoryFile") subdirectoryNames.push_back(key->GetName());
+  }
+  TDirectory *subdirectory;
+  for(const TString &subdirectoryName : subdirectoryNames){
+    subdirectory = directory->GetDirectory(subdirectoryName);
+    if(subdirectory) FinalizeDirectory(subdirectory);
+  }
+
+  TTree *stateTree = (TTree*) directory->Get(kStateTreeName);
+  if(!stateTree) return;
+
+  char histogramName[256];
+  Long64_t bin;
+  FixedPointBin sums;
+  stateTree->SetBranchAddress("histogram", histogramName);
+  stateTree->SetBranchAddress("bin", &bin);
+  stateTree->SetBranchAddress("sumWeights", sums.fSumWeights.fLimb);
+  stateTree->SetBranchAddress("sumWeightsSquared", sums.fSumWeightsSquared.fLimb);
+  stateTree->SetBranchAddress("fills", &sums.fnFills);
+
+  // Add the rows of all the jobs to the histograms read from the directory
+  std::vector<FixedPointHistogram*> histograms;
+  std::vector<TObject*> histogramObjects;
+  std::map<TString,Int_t> histogramIndex;
+  TObject *histogramObject;
+  const Long64_t nEntries = stateTree->GetEntries();
+  for(Long64_t iEntry = 0; iEntry < nEntries; iEntry++){
+    stateTree->GetEntry(iEntry);
+
+    if(histogramIndex.find(histogramName) == histogramIndex.end()){
+      histogramObject = directory->Get(histogramName);
+      if(histogramObject && histogramObject->InheritsFrom("TH1")){
+        ((TH1*)histogramObject)->SetDirectory(0);
+        histograms.push_back(new FixedPointHistogram((TH1*)histogramObject));
+      } else if(histogramObject && histogramObject->InheritsFrom("THnBase")){
+        histograms.push_back(new FixedPointHistogram((THnBase*)histogramObject));
+      } else {
+        cout << "Error! Histogram " << histogramName << " in the fixed-point state tree is not found in directory " << directory->GetName() << endl;
+        assert(0);
+      }
+      histogramObjects.push_back(histogramObject);
+      histogramIndex[histogramName] = histograms.size()-1;
+    }
+
+    histograms.at(histogramIndex[histogramName])->AddBin(bin, sums);
+  }
+  delete stateTree;
+
+  // Overwrite the histograms and the state tree with the exactly merged ones
+  directory->cd();
+  for(UInt_t iHistogram = 0; iHistogram < histograms.size(); iHistogram++){
+    histograms.at(iHistogram)->CopyToHistogram();
+    histogramObjects.at(iHistogram)->Write(histogramObjects.at(iHistogram)->GetName(), TObject::kOverwrite);
+  }
+  directory->Delete(Form("%s;*", kStateTreeName));
+  WriteState(histograms);
+
+  for(UInt_t iHistogram = 0; iHistogram < histograms.size(); iHistogram++){
+    delete histograms.at(iHistogram);
+    delete histogramObjects.at(iHistogram);
+  }
+}
@@ -0,0 +1,106 @@
+// Exact fixed-point sums for histograms, giving results independent of the summation order
+
+#ifndef FIXEDPOINTHISTOGRAM_H
+#define FIXEDPOINTHISTOGRAM_H
+
+// C++ includes
+#include <vector>
+#include <unordered_map>
+
+// Root includes
+#include <TString.h>
+#include <TH1.h>
+#include <THnBase.h>
+#include <TTree.h>
+#include <TDirectory.h>
+
+/*
+ * FixedPointSum class
+ *
+ * Signed 256-bit integer counting units of 2^-128. Each added double is truncated to this resolution, which depends
+ * only on the value itself, and the integer additions are exact. The sum is thus the same for any order of additions
+ * and any grouping into partial sums. Values from 3e-39 up to 1e38 are represented, which covers all the weights
+ * and squared weights in the analysis.
+ */
+class FixedPointSum{
+
+public:
+
+  static const Int_t knLimbs = 4;          // Number of 64-bit limbs in the integer. The lowest limb is first.
+  static const Int_t kFractionBits = 128;  // Number of bits below the unit
+
+  // Constructors
+  FixedPointSum(); // Default constructor
+
+  // Methods
+  void Add(Double_t value);                // Add a double truncated to the resolution
+  void Add(const FixedPointSum &other);    // Add another sum
+  Double_t GetValue() const;               // Convert the sum to the closest double
+
+  ULong64_t fLimb[knLimbs];                // Two's complement limbs of the integer. Public for writing and reading the state.
+
+private:
+
+  void AddLimbs(const ULong64_t *addend);  // Add an integer given as limbs
+
+};
+
+/*
+ * FixedPointHistogram class
+ *
+ * Exact sums of weights and squared weights for the bins of a TH1 or THnBase histogram. The ROOT histogram gives the
+ * binning, but it is not filled. Only the filled bins are stored, indexed with the global bin number including the
+ * underflow and overflow bins. The exact sums are copied to the ROOT histogram before writing.
+ *
+ * Merging the ROOT histograms of different jobs with hadd or TFileMerger is not exact, so the sums are written also
+ * to a state tree next to the histograms. Merging concatenates the state trees, and FinalizeDirectory recalculates the
+ * histograms from the concatenated trees, so that the merged output does not depend on how the input was split.
+ */
+class FixedPointHistogram{
+
+public:
+
+  static const char *kStateTreeName;   // Name of the tree holding the exact sums in each directory
+
+  // Constructors and destructor
+  FixedPointHistogram(); // Default constructor
+  FixedPointHistogram(TH1 *histogram); // Custom constructor for one dimensional histograms
+  FixedPointHistogram(THnBase *histogram); // Custom constructor for multidimensional histograms
+  FixedPointHistogram(const FixedPointHistogram& in); // Copy constructor
+  ~FixedPointHistogram(); // Destructor
+  FixedPointHistogram& operator=(const FixedPointHistogram& in); // Equal sign operator
+
+  // Methods
+  void Fill(Double_t value, Double_t weight = 1);          // Fill a one dimensional histogram
+  void Fill(const Double_t *values, Double_t weight = 1);  // Fill a multidimensional histogram
+  void Add(const FixedPointHistogram *other);              // Add the sums from another histogram with the same binning
+  void CopyToHistogram() const;                            // Set the contents of the ROOT histogram from the exact sums
+  void Reset();                                            // Remove all the sums and release their memory
+  Long64_t GetMemorySize() const;                          // Estimated memory used by the sums in bytes
+  const TObject* GetHistogram() const;                     // Getter for the ROOT histogram
+  static void WriteState(const std::vector<FixedPointHistogram*> &histograms); // Write the sums as a tree to the current directory
+  static void FinalizeDirectory(TDirectory *directory);    // Recalculate merged histograms from the state trees
+
+private:
+
+  // Exact sums for one bin
+  struct FixedPointBin{
+    FixedPointBin() : fSumWeights(), fSumWeightsSquared(), fnFills(0) {}
+    FixedPointSum fSumWeights;          // Sum of weights
+    FixedPointSum fSumWeightsSquared;   // Sum of squared weights
+    Long64_t fnFills;                   // Number of fills
+  };
+
+  // Private methods
+  void SetAxisStrides();                               // Calculate the strides of the global bin number
+  void AddBin(Long64_t bin, const FixedPointBin &sums); // Add sums to a bin
+
+  // Private data members
+  TH1 *fHistogram;                      // One dimensional histogram giving the binning. Not owned.
+  THnBase *fHistogramN;                 // Multidimensional histogram giving the binning. Not owned.
+  std::vector<Long64_t> fAxisStride;    // Stride of each axis in the global bin number of a multidimensional histogram
+  std::unordered_map<Long64_t,FixedPointBin> fBins; // Exact sums for the filled bins
+
+};
+
+#endif
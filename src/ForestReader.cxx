@@ -1,5 +1,8 @@
 // Implementation for ForestReader
 
+// C++ includes
+#include <atomic>
+
 // Own includes
 #include "ForestReader.h"
 
@@ -12,12 +15,17 @@ ForestReader::ForestReader() :
   fJetAxis(0),
   fBaseTrigger(0),
   fIsMiniAOD(false),
+  fReadTriggerObjects(false),
+  fReadEventIdentifiers(false),
   fHeavyIonTree(0),
   fJetTree(0),
   fHltTree(0),
   fSkimTree(0),
   fHiVzBranch(0),
   fHiBinBranch(0),
+  fRunNumberBranch(0),
+  fLumiBlockBranch(0),
+  fEventNumberBranch(0),
   fPtHatBranch(0),
   fEventWeightBranch(0),
   fnJetsBranch(0),
@@ -37,6 +45,9 @@ ForestReader::ForestReader() :
   fVertexZ(-100),
   fHiBin(-1),
   fPtHat(0),
+  fRunNumber(0),
+  fLumiBlock(0),
+  fEventNumber(0),
   fnJets(0),
   fnGenJets(0),
   fEventWeight(1),
@@ -65,6 +76,11 @@ ForestReader::ForestReader() :
     fJetFilterBit[iTrigger] = 1;
     fJetPrescaleNumerator[iTrigger] = 1;
     fJetPrescaleDenominator[iTrigger] = 1;
+    fTriggerObjectTree[iTrigger] = NULL;
+    fTriggerObjectPtVector[iTrigger] = NULL;
+    fTriggerObjectEtaVector[iTrigger] = NULL;
+    fTriggerObjectPhiVector[iTrigger] = NULL;
+    fnTriggerObjects[iTrigger] = 0;
   }
   
 }
@@ -84,12 +100,17 @@ ForestReader::ForestReader(Int_t dataType, Int_t jetType, Int_t jetAxis, Int_t b
   fJetAxis(jetAxis),
   fBaseTrigger(baseTrigger),
   fIsMiniAOD(false),
+  fReadTriggerObjects(false),
+  fReadEventIdentifiers(false),
   fHeavyIonTree(0),
   fJetTree(0),
   fHltTree(0),
   fSkimTree(0),
   fHiVzBranch(0),
   fHiBinBranch(0),
+  fRunNumberBranch(0),
+  fLumiBlockBranch(0),
+  fEventNumberBranch(0),
   fPtHatBranch(0),
   fEventWeightBranch(0),
   fnJetsBranch(0),
@@ -109,6 +130,9 @@ ForestReader::ForestReader(Int_t dataType, Int_t jetType, Int_t jetAxis, Int_t b
   fVertexZ(-100),
   fHiBin(-1),
   fPtHat(0),
+  fRunNumber(0),
+  fLumiBlock(0),
+  fEventNumber(0),
   fnJets(0),
   fnGenJets(0),
   fEventWeight(1),
@@ -138,6 +162,11 @@ ForestReader::ForestReader(Int_t dataType, Int_t jetType, Int_t jetAxis, Int_t b
     fJetFilterBit[iTrigger] = 1;
     fJetPrescaleNumerator[iTrigger] = 1;
     fJetPrescaleDenominator[iTrigger] = 1;
+    fTriggerObjectTree[iTrigger] = NULL;
+    fTriggerObjectPtVector[iTrigger] = NULL;
+    fTriggerObjectEtaVector[iTrigger] = NULL;
+    fTriggerObjectPhiVector[iTrigger] = NULL;
+    fnTriggerObjects[iTrigger] = 0;
   }
 }
 
@@ -150,12 +179,17 @@ ForestReader::ForestReader(const ForestReader& in) :
   fJetAxis(in.fJetAxis),
   fBaseTrigger(in.fBaseTrigger),
   fIsMiniAOD(in.fIsMiniAOD),
+  fReadTriggerObjects(in.fReadTriggerObjects),
+  fReadEventIdentifiers(in.fReadEventIdentifiers),
   fHeavyIonTree(in.fHeavyIonTree),
   fJetTree(in.fJetTree),
   fHltTree(in.fHltTree),
   fSkimTree(in.fSkimTree),
   fHiVzBranch(in.fHiVzBranch),
   fHiBinBranch(in.fHiBinBranch),
+  fRunNumberBranch(in.fRunNumberBranch),
+  fLumiBlockBranch(in.fLumiBlockBranch),
+  fEventNumberBranch(in.fEventNumberBranch),
   fPtHatBranch(in.fPtHatBranch),
   fEventWeightBranch(in.fEventWeightBranch),
   fnJetsBranch(in.fnJetsBranch),
@@ -175,6 +209,9 @@ ForestReader::ForestReader(const ForestReader& in) :
   fVertexZ(in.fVertexZ),
   fHiBin(in.fHiBin),
   fPtHat(in.fPtHat),
+  fRunNumber(in.fRunNumber),
+  fLumiBlock(in.fLumiBlock),
+  fEventNumber(in.fEventNumber),
   fnJets(in.fnJets),
   fnGenJets(in.fnGenJets),
   fEventWeight(in.fEventWeight),
@@ -201,6 +238,16 @@ ForestReader::ForestReader(const ForestReader& in) :
     fJetFilterBit[iTrigger] = in.fJetFilterBit[iTrigger];
     fJetPrescaleNumerator[iTrigger] = in.fJetPrescaleNumerator[iTrigger];
     fJetPrescaleDenominator[iTrigger] = in.fJetPrescaleDenominator[iTrigger];
+    fTriggerObjectTree[iTrigger] = in.fTriggerObjectTree[iTrigger];
+    fTriggerObjectPtVector[iTrigger] = in.fTriggerObjectPtVector[iTrigger];
+    fTriggerObjectEtaVector[iTrigger] = in.fTriggerObjectEtaVector[iTrigger];
+    fTriggerObjectPhiVector[iTrigger] = in.fTriggerObjectPhiVector[iTrigger];
+    fnTriggerObjects[iTrigger] = in.fnTriggerObjects[iTrigger];
+    for(Int_t iObject = 0; iObject < fnMaxTriggerObjects; iObject++){
+      fTriggerObjectPtArray[iTrigger][iObject] = in.fTriggerObjectPtArray[iTrigger][iObject];
+      fTriggerObjectEtaArray[iTrigger][iObject] = in.fTriggerObjectEtaArray[iTrigger][iObject];
+      fTriggerObjectPhiArray[iTrigger][iObject] = in.fTriggerObjectPhiArray[iTrigger][iObject];
+    }
   }
 }
 
@@ -217,12 +264,17 @@ ForestReader& ForestReader::operator=(const ForestReader& in){
   fJetAxis = in.fJetAxis;
   fBaseTrigger = in.fBaseTrigger;
   fIsMiniAOD = in.fIsMiniAOD;
+  fReadTriggerObjects = in.fReadTriggerObjects;
+  fReadEventIdentifiers = in.fReadEventIdentifiers;
   fHeavyIonTree = in.fHeavyIonTree;
   fJetTree = in.fJetTree;
   fHltTree = in.fHltTree;
   fSkimTree = in.fSkimTree;
   fHiVzBranch = in.fHiVzBranch;
   fHiBinBranch = in.fHiBinBranch;
+  fRunNumberBranch = in.fRunNumberBranch;
+  fLumiBlockBranch = in.fLumiBlockBranch;
+  fEventNumberBranch = in.fEventNumberBranch;
   fPtHatBranch = in.fPtHatBranch;
   fEventWeightBranch = in.fEventWeightBranch;
   fnJetsBranch = in.fnJetsBranch;
@@ -242,6 +294,9 @@ ForestReader& ForestReader::operator=(const ForestReader& in){
   fVertexZ = in.fVertexZ;
   fHiBin = in.fHiBin;
   fPtHat = in.fPtHat;
+  fRunNumber = in.fRunNumber;
+  fLumiBlock = in.fLumiBlock;
+  fEventNumber = in.fEventNumber;
   fnJets = in.fnJets;
   fnGenJets = in.fnGenJets;
   fEventWeight = in.fEventWeight;
@@ -266,6 +321,16 @@ ForestReader& ForestReader::operator=(const ForestReader& in){
     fJetFilterBit[iTrigger] = in.fJetFilterBit[iTrigger];
     fJetPrescaleNumerator[iTrigger] = in.fJetPrescaleNumerator[iTrigger];
     fJetPrescaleDenominator[iTrigger] = in.fJetPrescaleDenominator[iTrigger];
+    fTriggerObjectTree[iTrigger] = in.fTriggerObjectTree[iTrigger];
+    fTriggerObjectPtVector[iTrigger] = in.fTriggerObjectPtVector[iTrigger];
+    fTriggerObjectEtaVector[iTrigger] = in.fTriggerObjectEtaVector[iTrigger];
+    fTriggerObjectPhiVector[iTrigger] = in.fTriggerObjectPhiVector[iTrigger];
+    fnTriggerObjects[iTrigger] = in.fnTriggerObjects[iTrigger];
+    for(Int_t iObject = 0; iObject < fnMaxTriggerObjects; iObject++){
+      fTriggerObjectPtArray[iTrigger][iObject] = in.fTriggerObjectPtArray[iTrigger][iObject];
+      fTriggerObjectEtaArray[iTrigger][iObject] = in.fTriggerObjectEtaArray[iTrigger][iObject];
+      fTriggerObjectPhiArray[iTrigger][iObject] = in.fTriggerObjectPhiArray[iTrigger][iObject];
+    }
   }
   
   return *this;
@@ -289,6 +354,21 @@ void ForestReader::Initialize(){
   fHeavyIonTree->SetBranchAddress("vz",&fVertexZ,&fHiVzBranch);
   fHeavyIonTree->SetBranchStatus("hiBin",1);
   fHeavyIonTree->SetBranchAddress("hiBin",&fHiBin,&fHiBinBranch);
+  
+  // The event identifiers are only needed for the bootstrap weights and the run-resolved spectra
+  if(fReadEventIdentifiers){
+    fHeavyIonTree->SetBranchStatus("run",1);
+    fHeavyIonTree->SetBranchAddress("run",&fRunNumber,&fRunNumberBranch);
+    fHeavyIonTree->SetBranchStatus("lumi",1);
+    fHeavyIonTree->SetBranchAddress("lumi",&fLumiBlock,&fLumiBlockBranch);
+    fHeavyIonTree->SetBranchStatus("evt",1);
+    fHeavyIonTree->SetBranchAddress("evt",&fEventNumber,&fEventNumberBranch);
+  } else {
+    fRunNumber = 0;
+    fLumiBlock = 0;
+    fEventNumber = 0;
+  }
+  
   if(fDataType == kPpMC || fDataType == kPbPbMC){
     fHeavyIonTree->SetBranchStatus("pthat",1);
     fHeavyIonTree->SetBranchAddress("pthat",&fPtHat,&fPtHatBranch); // pT hat only for MC
@@ -356,15 +436,16 @@ void ForestReader::Initialize(){
   
   // Connect the branches to the HLT tree
   fHltTree->SetBranchStatus("*",0);
-  TriggerHistograms *triggerProvider = new TriggerHistograms();
+  TString triggerBranchName;
   
   if(fDataType == kPp || fDataType == kPpMC){ // pp data or MC
     
     for(Int_t iTrigger = TriggerHistograms::kCalo40; iTrigger <= TriggerHistograms::kPF100; iTrigger++){
-      fHltTree->SetBranchStatus(Form("HLT_HIAK4%s_v1", triggerProvider->GetTriggerName(iTrigger).Data()),1);
-      fHltTree->SetBranchAddress(Form("HLT_HIAK4%s_v1", triggerProvider->GetTriggerName(iTrigger).Data()), &fJetFilterBit[iTrigger], &fJetFilterBranch[iTrigger]);
-      fHltTree->SetBranchStatus(Form("HLT_HIAK4%s_v1_Prescl", triggerProvider->GetTriggerName(iTrigger).Data()),1);
-      fHltTree->SetBranchAddress(Form("HLT_HIAK4%s_v1_Prescl", triggerProvider->GetTriggerName(iTrigger).Data()), &fJetPrescaleNumerator[iTrigger], &fJetFilterPrescaleNumeratorBranch[iTrigger]);
+      triggerBranchName = GetTriggerBranchName(fDataType, iTrigger);
+      fHltTree->SetBranchStatus(triggerBranchName,1);
+      fHltTree->SetBranchAddress(triggerBranchName, &fJetFilterBit[iTrigger], &fJetFilterBranch[iTrigger]);
+      fHltTree->SetBranchStatus(triggerBranchName + "_Prescl",1);
+      fHltTree->SetBranchAddress(triggerBranchName + "_Prescl", &fJetPrescaleNumerator[iTrigger], &fJetFilterPrescaleNumeratorBranch[iTrigger]);
       
       
       // Only integer prescales for AOD
@@ -373,26 +454,32 @@ void ForestReader::Initialize(){
 
   } else { // PbPb data or MC
     
-    for(Int_t iTrigger = TriggerHistograms::kCalo40; iTrigger <= TriggerHistograms::kCalo100; iTrigger++){
-      fHltTree->SetBranchStatus(Form("HLT_HIPuAK4%sEta5p1_v1", triggerProvider->GetTriggerName(iTrigger).Data()),1);
-      fHltTree->SetBranchAddress(Form("HLT_HIPuAK4%sEta5p1_v1", triggerProvider->GetTriggerName(iTrigger).Data()), &fJetFilterBit[iTrigger], &fJetFilterBranch[iTrigger]);
-      fHltTree->SetBranchStatus(Form("HLT_HIPuAK4%sEta5p1_v1_PrescaleNumerator", triggerProvider->GetTriggerName(iTrigger).Data()),1);
-      fHltTree->SetBranchAddress(Form("HLT_HIPuAK4%sEta5p1_v1_PrescaleNumerator", triggerProvider->GetTriggerName(iTrigger).Data()), &fJetPrescaleNumerator[iTrigger], &fJetFilterPrescaleNumeratorBranch[iTrigger]);
-      fHltTree->SetBranchStatus(Form("HLT_HIPuAK4%sEta5p1_v1_PrescaleDenominator", triggerProvider->GetTriggerName(iTrigger).Data()),1);
-      fHltTree->SetBranchAddress(Form("HLT_HIPuAK4%sEta5p1_v1_PrescaleDenominator", triggerProvider->GetTriggerName(iTrigger).Data()), &fJetPrescaleDenominator[iTrigger], &fJetFilterPrescaleDenominatorBranch[iTrigger]);
-    }
-    for(Int_t iTrigger = TriggerHistograms::kPF60; iTrigger <= TriggerHistograms::kPF100; iTrigger++){
-      fHltTree->SetBranchStatus(Form("HLT_HICsAK4%sEta1p5_v1", triggerProvider->GetTriggerName(iTrigger).Data()),1);
-      fHltTree->SetBranchAddress(Form("HLT_HICsAK4%sEta1p5_v1", triggerProvider->GetTriggerName(iTrigger).Data()), &fJetFilterBit[iTrigger], &fJetFilterBranch[iTrigger]);
-      fHltTree->SetBranchStatus(Form("HLT_HICsAK4%sEta1p5_v1_PrescaleNumerator", triggerProvider->GetTriggerName(iTrigger).Data()),1);
-      fHltTree->SetBranchAddress(Form("HLT_HICsAK4%sEta1p5_v1_PrescaleNumerator", triggerProvider->GetTriggerName(iTrigger).Data()), &fJetPrescaleNumerator[iTrigger], &fJetFilterPrescaleNumeratorBranch[iTrigger]);
-      fHltTree->SetBranchStatus(Form("HLT_HICsAK4%sEta1p5_v1_PrescaleDenominator", triggerProvider->GetTriggerName(iTrigger).Data()),1);
-      fHltTree->SetBranchAddress(Form("HLT_HICsAK4%sEta1p5_v1_PrescaleDenominator", triggerProvider->GetTriggerName(iTrigger).Data()), &fJetPrescaleDenominator[iTrigger], &fJetFilterPrescaleDenominatorBranch[iTrigger]);
+    // Calo jet triggers use pileup subtracted jets and PF jet triggers constituent subtracted jets
+    for(Int_t iTrigger = TriggerHistograms::kCalo40; iTrigger <= TriggerHistograms::kPF100; iTrigger++){
+      triggerBranchName = GetTriggerBranchName(fDataType, iTrigger);
+      fHltTree->SetBranchStatus(triggerBranchName,1);
+      fHltTree->SetBranchAddress(triggerBranchName, &fJetFilterBit[iTrigger], &fJetFilterBranch[iTrigger]);
+      fHltTree->SetBranchStatus(triggerBranchName + "_PrescaleNumerator",1);
+      fHltTree->SetBranchAddress(triggerBranchName + "_PrescaleNumerator", &fJetPrescaleNumerator[iTrigger], &fJetFilterPrescaleNumeratorBranch[iTrigger]);
+      fHltTree->SetBranchStatus(triggerBranchName + "_PrescaleDenominator",1);
+      fHltTree->SetBranchAddress(triggerBranchName + "_PrescaleDenominator", &fJetPrescaleDenominator[iTrigger], &fJetFilterPrescaleDenominatorBranch[iTrigger]);
     }
     
   }
   
-  delete triggerProvider;
+  // Connect the branches for the HLT objects of the studied triggers
+  if(fReadTriggerObjects){
+    for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+      if(!fTriggerObjectTree[iTrigger]) continue;
+      fTriggerObjectTree[iTrigger]->SetBranchStatus("*",0);
+      fTriggerObjectTree[iTrigger]->SetBranchStatus("pt",1);
+      fTriggerObjectTree[iTrigger]->SetBranchAddress("pt",&fTriggerObjectPtVector[iTrigger]);
+      fTriggerObjectTree[iTrigger]->SetBranchStatus("eta",1);
+      fTriggerObjectTree[iTrigger]->SetBranchAddress("eta",&fTriggerObjectEtaVector[iTrigger]);
+      fTriggerObjectTree[iTrigger]->SetBranchStatus("phi",1);
+      fTriggerObjectTree[iTrigger]->SetBranchAddress("phi",&fTriggerObjectPhiVector[iTrigger]);
+    }
+  }
   
   // Connect the branches to the skim tree (different for pp and PbPb data and Monte Carlo)
   fSkimTree->SetBranchStatus("*",0);
@@ -451,6 +538,20 @@ void ForestReader::SetDataType(Int_t dataType){
   }
 }
 
+/*
+ * Setter for reading the HLT objects of the studied triggers. Must be set before the forest is read from a file.
+ */
+void ForestReader::SetReadTriggerObjects(Bool_t readObjects){
+  fReadTriggerObjects = readObjects;
+}
+
+/*
+ * Setter for reading the run, luminosity block and event numbers. Must be set before the forest is read from a file.
+ */
+void ForestReader::SetReadEventIdentifiers(Bool_t readIdentifiers){
+  fReadEventIdentifiers = readIdentifiers;
+}
+
 /*
  * Connect a new tree to the reader
  */
@@ -461,28 +562,89 @@ void ForestReader::ReadForestFromFile(TFile *inputFile){
   TTree* miniAODcheck = (TTree*)inputFile->Get("HiForestInfo/HiForest");
   fIsMiniAOD = !(miniAODcheck == NULL);
   
-  // Helper variable for finding the correct tree
-  const char *treeName[4] = {"none","none","none","none"};
-  
   // Connect a trees from the file to the reader
   fHeavyIonTree = (TTree*)inputFile->Get("hiEvtAnalyzer/HiTree");
   fHltTree = (TTree*)inputFile->Get("hltanalysis/HltTree");
   fSkimTree = (TTree*)inputFile->Get("skimanalysis/HltTree");
+  fJetTree = (TTree*)inputFile->Get(GetJetTreeName(fDataType, fJetType));
+  
+  // The HLT objects are stored in a separate tree for each trigger path, named after the path without the version number
+  if(fReadTriggerObjects){
+    TriggerHistograms *triggerProvider = new TriggerHistograms();
+    TString objectTreeName;
+    for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+      if(fDataType == kPp || fDataType == kPpMC){
+        objectTreeName = Form("hltobject/HLT_HIAK4%s_v", triggerProvider->GetTriggerName(iTrigger).Data());
+      } else if(iTrigger <= TriggerHistograms::kCalo100){
+        objectTreeName = Form("hltobject/HLT_HIPuAK4%sEta5p1_v", triggerProvider->GetTriggerName(iTrigger).Data());
+      } else {
+        objectTreeName = Form("hltobject/HLT_HICsAK4%sEta1p5_v", triggerProvider->GetTriggerName(iTrigger).Data());
+      }
+      fTriggerObjectTree[iTrigger] = (TTree*)inputFile->Get(objectTreeName);
+      if(!fTriggerObjectTree[iTrigger]) cout << "Warning! Could not find HLT object tree " << objectTreeName.Data() << endl;
+    }
+    delete triggerProvider;
+  }
   
-  // The jet tree has different name in different datasets
-  if(fDataType == kPp || fDataType == kPpMC){
+  Initialize();
+}
+
+/*
+ * Name of the jet tree for the data and jet types. The jet tree has different name in different datasets.
+ *
+ *  Arguments:
+ *   Int_t dataType = Analyzed data type. 0 = pp, 1 = PbPb, 2 = ppMC, 3 = PbPbMC
+ *   Int_t jetType = Type of jets. 0 = Calo jets, 1 = PF jets (csPF for PbPb), 2 = puPF jets, 3 = flow subtracted csPF jets
+ *
+ *   return: Name of the jet tree in the forest. "none" if there is no such tree.
+ */
+TString ForestReader::GetJetTreeName(Int_t dataType, Int_t jetType){
+  
+  // Helper variable for finding the correct tree
+  const char *treeName[4] = {"none","none","none","none"};
+  
+  if(dataType == kPp || dataType == kPpMC){
     treeName[0] = "ak4CaloJetAnalyzer/t"; // Tree for calo jets
     treeName[1] = "ak4PFJetAnalyzer/t";   // Tree for PF jets
-  } else if (fDataType == kPbPb || fDataType == kPbPbMC){
+  } else if (dataType == kPbPb || dataType == kPbPbMC){
     treeName[0] = "akPu4CaloJetAnalyzer/t";     // Tree for calo jets
     treeName[1] = "akCs4PFJetAnalyzer/t";       // Tree for csPF jets
     treeName[2] = "akPu4PFJetAnalyzer/t";       // Tree for puPF jets
     treeName[3] = "akFlowPuCs4PFJetAnalyzer/t"; // Tree for flow subtracted csPF jets
   }
   
-  fJetTree = (TTree*)inputFile->Get(treeName[fJetType]);
-  
-  Initialize();
+  if(jetType < 0 || jetType > 3) return "none";
+  return treeName[jetType];
+}
+
+/*
+ * Name of the branch for the decision of a trigger in the HLT tree. The prescale branches add a suffix to this name.
+ *
+ *  Arguments:
+ *   Int_t dataType = Analyzed data type. 0 = pp, 1 = PbPb, 2 = ppMC, 3 = PbPbMC
+ *   Int_t iTrigger = Index of the trigger in TriggerHistograms::enumTriggerSelection
+ *
+ *   return: Name of the trigger branch
+ */
+TString ForestReader::GetTriggerBranchName(Int_t dataType, Int_t iTrigger){
+  TriggerHistograms triggerProvider;
+  if(dataType == kPp || dataType == kPpMC) return Form("HLT_HIAK4%s_v1", triggerProvider.GetTriggerName(iTrigger).Data());
+  if(iTrigger <= TriggerHistograms::kCalo100) return Form("HLT_HIPuAK4%sEta5p1_v1", triggerProvider.GetTriggerName(iTrigger).Data());
+  return Form("HLT_HICsAK4%sEta1p5_v1", triggerProvider.GetTriggerName(iTrigger).Data());
+}
+
+/*
+ * hiBin used for the weights and corrections. Some events in the forests have negative hiBin, for which the values
+ * of hiBin 1 are used. Shared with the RDataFrame engine, so that both engines weight these events the same way.
+ *
+ *  Arguments:
+ *   Int_t hiBin = CMS hiBin read from the forest
+ *
+ *   return: hiBin with negative values replaced by 1
+ */
+Int_t ForestReader::GetValidHiBin(Int_t hiBin){
+  if(hiBin < 0) return 1;
+  return hiBin;
 }
 
 /*
@@ -507,10 +669,63 @@ void ForestReader::BurnForest(){
  * Load an event to memory
  */
 void ForestReader::GetEvent(Int_t nEvent){
-  fHeavyIonTree->GetEntry(nEvent);
-  fJetTree->GetEntry(nEvent);
-  fHltTree->GetEntry(nEvent);
-  fSkimTree->GetEntry(nEvent);
+  for(Int_t iTree = 0; iTree < knForestTrees; iTree++){
+    GetEventFromTree(iTree, nEvent);
+  }
+}
+
+/*
+ * Get the nth event only from one of the trees. This allows reading the trees needed for the event cuts first,
+ * and the jet tree only for the events that pass them.
+ *
+ *  Arguments:
+ *   Int_t iTree = Index of the tree in enumForestTrees
+ *   Int_t nEvent = Index of the event
+ */
+void ForestReader::GetEventFromTree(Int_t iTree, Int_t nEvent){
+  
+  switch(iTree){
+    case kHeavyIonTree:
+      fHeavyIonTree->GetEntry(nEvent);
+      break;
+    case kSkimTree:
+      fSkimTree->GetEntry(nEvent);
+      break;
+    case kHltTree:
+      fHltTree->GetEntry(nEvent);
+      break;
+    case kJetTree:
+      fJetTree->GetEntry(nEvent);
+      
+      // Copy the HLT objects to single precision arrays
+      if(fReadTriggerObjects){
+        for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+          fnTriggerObjects[iTrigger] = 0;
+          if(!fTriggerObjectTree[iTrigger]) continue;
+          fTriggerObjectTree[iTrigger]->GetEntry(nEvent);
+          fnTriggerObjects[iTrigger] = fTriggerObjectPtVector[iTrigger]->size();
+          if(fnTriggerObjects[iTrigger] > fnMaxTriggerObjects){
+            
+            // Events with this many objects are rare, so the warning is only shown for the first one in the job
+            static std::atomic<Bool_t> truncationReported(false);
+            if(!truncationReported.exchange(true)){
+              cout << "Warning! Event " << nEvent << " has " << fnTriggerObjects[iTrigger] << " HLT objects for trigger " << GetTriggerBranchName(fDataType, iTrigger) << ". Only the first " << fnMaxTriggerObjects << " are used for matching. This warning is shown only once." << endl;
+            }
+            fnTriggerObjects[iTrigger] = fnMaxTriggerObjects;
+          }
+          for(Int_t iObject = 0; iObject < fnTriggerObjects[iTrigger]; iObject++){
+            fTriggerObjectPtArray[iTrigger][iObject] = fTriggerObjectPtVector[iTrigger]->at(iObject);
+            fTriggerObjectEtaArray[iTrigger][iObject] = fTriggerObjectEtaVector[iTrigger]->at(iObject);
+            fTriggerObjectPhiArray[iTrigger][iObject] = fTriggerObjectPhiVector[iTrigger]->at(iObject);
+          }
+        }
+      }
+      break;
+    default:
+      cout << "Error! Unknown forest tree index " << iTree << endl;
+      assert(0);
+  }
+  
 }
 
 // Getter for number of events in the tree
@@ -518,6 +733,27 @@ Int_t ForestReader::GetNEvents() const{
   return fJetPtBranch->GetEntries();
 }
 
+/*
+ * Get the entry boundaries of the TTree clusters in the jet tree. The returned vector contains the
+ * first entry of each cluster followed by the number of events in the tree.
+ */
+std::vector<Long64_t> ForestReader::GetClusterBoundaries() const{
+  
+  std::vector<Long64_t> clusterBoundaries;
+  Long64_t nEvents = GetNEvents();
+  
+  // Loop over the clusters in the jet tree
+  TTree::TClusterIterator clusterIterator = fJetTree->GetClusterIterator(0);
+  Long64_t clusterStart = clusterIterator.Next();
+  while(clusterStart < nEvents){
+    clusterBoundaries.push_back(clusterStart);
+    clusterStart = clusterIterator.Next();
+  }
+  
+  clusterBoundaries.push_back(nEvents);
+  return clusterBoundaries;
+}
+
 // Getter for number of jets in an event
 Int_t ForestReader::GetNJets() const{
   return fnJets;
@@ -553,6 +789,31 @@ Float_t ForestReader::GetJetMaxTrackPt(Int_t iJet) const{
   return fJetMaxTrackPtArray[iJet];
 }
 
+// Getter for jet pT array
+const Float_t* ForestReader::GetJetPtArray() const{
+  return fJetPtArray;
+}
+
+// Getter for jet phi array
+const Float_t* ForestReader::GetJetPhiArray() const{
+  return fJetPhiArray;
+}
+
+// Getter for jet eta array
+const Float_t* ForestReader::GetJetEtaArray() const{
+  return fJetEtaArray;
+}
+
+// Getter for jet raw pT array
+const Float_t* ForestReader::GetJetRawPtArray() const{
+  return fJetRawPtArray;
+}
+
+// Getter for maximum track pT array
+const Float_t* ForestReader::GetJetMaxTrackPtArray() const{
+  return fJetMaxTrackPtArray;
+}
+
 // Getter for generator level jet pT
 Float_t ForestReader::GetGeneratorJetPt(Int_t iJet) const{
   return fGenJetPtArray[iJet];
@@ -568,6 +829,21 @@ Float_t ForestReader::GetGeneratorJetEta(Int_t iJet) const{
   return fGenJetEtaArray[iJet];
 }
 
+// Getter for generator level jet pT array
+const Float_t* ForestReader::GetGeneratorJetPtArray() const{
+  return fGenJetPtArray;
+}
+
+// Getter for generator level jet phi array
+const Float_t* ForestReader::GetGeneratorJetPhiArray() const{
+  return fGenJetPhiArray;
+}
+
+// Getter for generator level jet eta array
+const Float_t* ForestReader::GetGeneratorJetEtaArray() const{
+  return fGenJetEtaArray;
+}
+
 // Getter for vertex z position
 Float_t ForestReader::GetVz() const{
   return fVertexZ;
@@ -580,8 +856,7 @@ Float_t ForestReader::GetCentrality() const{
 
 // Getter for hiBin. Return 1 for negative values (for easier handling of tracking efficiency correction)
 Int_t ForestReader::GetHiBin() const{
-  if(fHiBin < 0) return 1;
-  return fHiBin;
+  return GetValidHiBin(fHiBin);
 }
 
 // Getter for pT hat
@@ -594,6 +869,21 @@ Float_t ForestReader::GetEventWeight() const{
   return fEventWeight;
 }
 
+// Getter for run number
+UInt_t ForestReader::GetRunNumber() const{
+  return fRunNumber;
+}
+
+// Getter for luminosity block number
+UInt_t ForestReader::GetLumiBlock() const{
+  return fLumiBlock;
+}
+
+// Getter for event number
+ULong64_t ForestReader::GetEventNumber() const{
+  return fEventNumber;
+}
+
 // Getter for calorimeter jet filter bit. Always 1 for MC (set in the initializer).
 Int_t ForestReader::GetBaseJetFilterBit() const{
   return GetJetFilterBit(fBaseTrigger);
@@ -611,6 +901,32 @@ Double_t ForestReader::GetJetTriggerPrescale(Int_t iTrigger) const{
   return (fJetPrescaleNumerator[iTrigger]*1.0)/fJetPrescaleDenominator[iTrigger];
 }
 
+// Check if the HLT objects are read for the trigger
+Bool_t ForestReader::HasTriggerObjects(Int_t iTrigger) const{
+  if(iTrigger < 0 || iTrigger >= TriggerHistograms::knTriggerTypes) return false;
+  return fReadTriggerObjects && fTriggerObjectTree[iTrigger] != NULL;
+}
+
+// Getter for number of HLT objects of the trigger
+Int_t ForestReader::GetNTriggerObjects(Int_t iTrigger) const{
+  return fnTriggerObjects[iTrigger];
+}
+
+// Getter for HLT object pT
+Float_t ForestReader::GetTriggerObjectPt(Int_t iTrigger, Int_t iObject) const{
+  return fTriggerObjectPtArray[iTrigger][iObject];
+}
+
+// Getter for HLT object eta array
+const Float_t* ForestReader::GetTriggerObjectEtaArray(Int_t iTrigger) const{
+  return fTriggerObjectEtaArray[iTrigger];
+}
+
+// Getter for HLT object phi array
+const Float_t* ForestReader::GetTriggerObjectPhiArray(Int_t iTrigger) const{
+  return fTriggerObjectPhiArray[iTrigger];
+}
+
 // Getter for primary vertex filter bit. Always 1 for MC (set in the initializer).
 Int_t ForestReader::GetPrimaryVertexFilterBit() const{
   return fPrimaryVertexFilterBit;
@@ -23,19 +23,24 @@
 
 // Own includes
 #include "TriggerHistograms.h"
+#include "JetSelectionKernel.h"
 
 using namespace std;
 
 class ForestReader{
   
 private:
-  static const Int_t fnMaxJet = 250;        // Maximum number of jets in an event
+  static const Int_t fnMaxJet = 500;        // Maximum number of jets in an event
+  static const Int_t fnMaxTriggerObjects = JetSelectionKernel::kMaxJets; // Maximum number of HLT objects read for one trigger in an event. Limited by the size of the matching masks.
   
 public:
   
   // Possible data types to be read with the reader class
   enum enumDataTypes{kPp, kPbPb, kPpMC, kPbPbMC, knDataTypes};
   
+  // Trees that can be read separately for an event. The HLT objects are read together with the jet tree.
+  enum enumForestTrees{kHeavyIonTree, kSkimTree, kHltTree, kJetTree, knForestTrees};
+  
   // Constructors and destructors
   ForestReader();                                          // Default constructor
   ForestReader(Int_t dataType, Int_t jetType, Int_t jetAxis, Int_t baseTrigger); // Custom constructor
@@ -45,10 +50,15 @@ public:
   
   // Methods
   void GetEvent(Int_t nEvent);                 // Get the nth event in tree
+  void GetEventFromTree(Int_t iTree, Int_t nEvent); // Get the nth event only from one of the trees
   Int_t GetNEvents() const;                        // Get the number of events
+  std::vector<Long64_t> GetClusterBoundaries() const; // Get the first entries of the TTree clusters in the jet tree
   void ReadForestFromFile(TFile *inputFile);   // Read the forest from a file
   void ReadForestFromFileList(std::vector<TString> fileList);   // Read the forest from a file list
   void BurnForest();                           // Burn the forest
+  static TString GetJetTreeName(Int_t dataType, Int_t jetType);      // Name of the jet tree for the data and jet types
+  static TString GetTriggerBranchName(Int_t dataType, Int_t iTrigger); // Name of the HLT tree branch for a trigger
+  static Int_t GetValidHiBin(Int_t hiBin);   // hiBin used for the weights. Negative values are replaced by 1.
   
   // Getters for leaves in heavy ion tree
   Float_t GetVz() const;              // Getter for vertex z position
@@ -56,6 +66,9 @@ public:
   Int_t GetHiBin() const;             // Getter for CMS hiBin
   Float_t GetPtHat() const;           // Getter for pT hat
   Float_t GetEventWeight() const;     // Getter for event weight in MC
+  UInt_t GetRunNumber() const;        // Getter for run number
+  UInt_t GetLumiBlock() const;        // Getter for luminosity block number
+  ULong64_t GetEventNumber() const;   // Getter for event number
   
   // Getters for leaves in jet tree
   Int_t GetNJets() const;                     // Getter for number of jets
@@ -65,16 +78,33 @@ public:
   Float_t GetJetRawPt(Int_t iJet) const;      // Getter for jet raw pT
   Float_t GetJetMaxTrackPt(Int_t iJet) const; // Getter for maximum track pT inside a jet
   
+  // Getters for the jet arrays, used to evaluate the jet cuts for all jets at once
+  const Float_t* GetJetPtArray() const;          // Getter for jet pT array
+  const Float_t* GetJetPhiArray() const;         // Getter for jet phi array
+  const Float_t* GetJetEtaArray() const;         // Getter for jet eta array
+  const Float_t* GetJetRawPtArray() const;       // Getter for jet raw pT array
+  const Float_t* GetJetMaxTrackPtArray() const;  // Getter for maximum track pT array
+  
   Int_t GetNGeneratorJets() const;                   // Getter for number of generator level jets
   Float_t GetGeneratorJetPt(Int_t iJet) const;       // Getter for generator level jet pT
   Float_t GetGeneratorJetPhi(Int_t iJet) const;      // Getter for generator level jet phi
   Float_t GetGeneratorJetEta(Int_t iJet) const;      // Getter for generator level jet eta
+  const Float_t* GetGeneratorJetPtArray() const;     // Getter for generator level jet pT array
+  const Float_t* GetGeneratorJetPhiArray() const;    // Getter for generator level jet phi array
+  const Float_t* GetGeneratorJetEtaArray() const;    // Getter for generator level jet eta array
   
   // Getters for leaves in HLT tree
   Int_t GetBaseJetFilterBit() const;                    // Getter for base jet filter bit
   Int_t GetJetFilterBit(Int_t iTrigger) const;          // Getter for the selected jet filter bit
   Double_t GetJetTriggerPrescale(Int_t iTrigger) const; // Getter for the prescale value of the chosen trigger
   
+  // Getters for the HLT objects. Only filled if reading trigger objects is enabled.
+  Bool_t HasTriggerObjects(Int_t iTrigger) const;                   // Check if the HLT objects are read for the trigger
+  Int_t GetNTriggerObjects(Int_t iTrigger) const;                   // Getter for number of HLT objects of the trigger
+  Float_t GetTriggerObjectPt(Int_t iTrigger, Int_t iObject) const;  // Getter for HLT object pT
+  const Float_t* GetTriggerObjectEtaArray(Int_t iTrigger) const;    // Getter for HLT object eta array
+  const Float_t* GetTriggerObjectPhiArray(Int_t iTrigger) const;    // Getter for HLT object phi array
+  
   // Getters for leaves in skim tree
   Int_t GetPrimaryVertexFilterBit() const;           // Getter for primary vertex filter bit
   Int_t GetBeamScrapingFilterBit() const;            // Getter got beam scraping filter bit
@@ -83,6 +113,8 @@ public:
   
   // Setter for data type
   void SetDataType(Int_t dataType); // Setter for data type
+  void SetReadTriggerObjects(Bool_t readObjects); // Read the HLT objects from the forest. Must be set before reading the forest.
+  void SetReadEventIdentifiers(Bool_t readIdentifiers); // Read run, lumi and event numbers. Must be set before reading the forest.
   
 private:
   
@@ -94,16 +126,22 @@ private:
   Int_t fJetAxis;         // Jet axis used for the jets. 0 = Anti-kT, 1 = Leading particle flow candidate, 2 = WTA
   Int_t fBaseTrigger;     // Trigger index that is used as a base trigger with respect to which other triggers are compared
   Bool_t fIsMiniAOD;      // Flag for type of the forest True = MiniAOD forest, False = AOD forest
+  Bool_t fReadTriggerObjects; // Flag for reading the HLT objects of the studied triggers
+  Bool_t fReadEventIdentifiers; // Flag for reading the run, luminosity block and event numbers
   
   // Trees in the forest
   TTree *fHeavyIonTree;    // Tree for heavy ion event information
   TTree *fJetTree;         // Tree for jet information
   TTree *fHltTree;         // Tree for high level trigger information
   TTree *fSkimTree;        // Tree for event selection information
+  TTree *fTriggerObjectTree[TriggerHistograms::knTriggerTypes]; // Trees for HLT objects of the studied triggers
   
   // Branches for heavy ion tree
   TBranch *fHiVzBranch;                   // Branch for vertex z-position
   TBranch *fHiBinBranch;                  // Branch for centrality
+  TBranch *fRunNumberBranch;              // Branch for run number
+  TBranch *fLumiBlockBranch;              // Branch for luminosity block number
+  TBranch *fEventNumberBranch;            // Branch for event number
   TBranch *fPtHatBranch;                  // Branch for pT hat
   TBranch *fEventWeightBranch;            // Branch for event weight
   
@@ -135,6 +173,9 @@ private:
   Float_t fVertexZ;    // Vertex z-position
   Int_t fHiBin;        // HiBin = Centrality percentile * 2
   Float_t fPtHat;      // pT hat
+  UInt_t fRunNumber;         // Run number
+  UInt_t fLumiBlock;         // Luminosity block number
+  ULong64_t fEventNumber;    // Event number
   
   // Leaves for jet tree
   Int_t fnJets;          // number of jets in an event
@@ -156,6 +197,17 @@ private:
   Int_t fJetPrescaleNumerator[TriggerHistograms::knTriggerTypes];   // Prescale numerators for jet triggers
   Int_t fJetPrescaleDenominator[TriggerHistograms::knTriggerTypes]; // Prescale denominators for jet triggers
   
+  // Leaves for the HLT object trees
+  std::vector<Double_t> *fTriggerObjectPtVector[TriggerHistograms::knTriggerTypes];   // pT:s of the HLT objects
+  std::vector<Double_t> *fTriggerObjectEtaVector[TriggerHistograms::knTriggerTypes];  // etas of the HLT objects
+  std::vector<Double_t> *fTriggerObjectPhiVector[TriggerHistograms::knTriggerTypes];  // phis of the HLT objects
+  
+  // HLT objects copied to single precision arrays for matching
+  Int_t fnTriggerObjects[TriggerHistograms::knTriggerTypes];                                // Number of HLT objects in an event
+  Float_t fTriggerObjectPtArray[TriggerHistograms::knTriggerTypes][fnMaxTriggerObjects];    // pT:s of the HLT objects
+  Float_t fTriggerObjectEtaArray[TriggerHistograms::knTriggerTypes][fnMaxTriggerObjects];   // etas of the HLT objects
+  Float_t fTriggerObjectPhiArray[TriggerHistograms::knTriggerTypes][fnMaxTriggerObjects];   // phis of the HLT objects
+  
   // Leaves for the skim tree
   Int_t fPrimaryVertexFilterBit;           // Filter bit for primary vertex
   Int_t fBeamScrapingFilterBit;            // Filter bit for beam scraping
@@ -0,0 +1,214 @@
+// Implementation for JetMatcher
+
+// C++ includes
+#include <iostream>
+#include <algorithm>
+#include <assert.h>
+
+// Own includes
+#include "JetMatcher.h"
+
+using namespace std;
+
+/*
+ * Default constructor
+ */
+JetMatcher::JetMatcher() :
+  fMatchingRadius(0),
+  fnEtaCells(1),
+  fnPhiCells(1),
+  fInverseEtaCellSize(0),
+  fInversePhiCellSize(0),
+  fEta(0),
+  fPhi(0),
+  fCellStart(2,0),
+  fCellJets(),
+  fJetCell()
+{
+  // Default constructor
+}
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   Double_t matchingRadius = Maximum distance in eta-phi between matched jets
+ */
+JetMatcher::JetMatcher(Double_t matchingRadius) :
+  fMatchingRadius(matchingRadius),
+  fEta(0),
+  fPhi(0),
+  fCellJets(),
+  fJetCell()
+{
+  // Custom constructor
+  if(fMatchingRadius <= 0){
+    cout << "Error! Jet matching radius must be positive" << endl;
+    assert(0);
+  }
+
+  // The cells must be at least as large as the matching radius, so that all matches are in the neighbouring cells
+  fnEtaCells = TMath::Max(1, (Int_t)(2*kMaxGridEta / fMatchingRadius));
+  fnPhiCells = TMath::Max(1, (Int_t)(TMath::TwoPi() / fMatchingRadius));
+  fInverseEtaCellSize = fnEtaCells / (2*kMaxGridEta);
+  fInversePhiCellSize = fnPhiCells / TMath::TwoPi();
+
+  fCellStart.assign(fnEtaCells*fnPhiCells+1, 0);
+  fCellJets.reserve(JetSelectionKernel::kMaxJets);
+  fJetCell.assign(JetSelectionKernel::kMaxJets, -1);
+}
+
+/*
+ * Copy constructor
+ */
+JetMatcher::JetMatcher(const JetMatcher& in) :
+  fMatchingRadius(in.fMatchingRadius),
+  fnEtaCells(in.fnEtaCells),
+  fnPhiCells(in.fnPhiCells),
+  fInverseEtaCellSize(in.fInverseEtaCellSize),
+  fInversePhiCellSize(in.fInversePhiCellSize),
+  fEta(in.fEta),
+  fPhi(in.fPhi),
+  fCellStart(in.fCellStart),
+  fCellJets(in.fCellJets),
+  fJetCell(in.fJetCell)
+{
+  // Copy constructor
+}
+
+/*
+ * Destructor
+ */
+JetMatcher::~JetMatcher(){
+  // destructor
+}
+
+/*
+ * Equal sign operator
+ */
+JetMatcher& JetMatcher::operator=(const JetMatcher& in){
+  // Equal sign operator
+
+  if (&in==this) return *this;
+
+  fMatchingRadius = in.fMatchingRadius;
+  fnEtaCells = in.fnEtaCells;
+  fnPhiCells = in.fnPhiCells;
+  fInverseEtaCellSize = in.fInverseEtaCellSize;
+  fInversePhiCellSize = in.fInversePhiCellSize;
+  fEta = in.fEta;
+  fPhi = in.fPhi;
+  fCellStart = in.fCellStart;
+  fCellJets = in.fCellJets;
+  fJetCell = in.fJetCell;
+
+  return *this;
+}
+
+/*
+ * Sort the jets selected by the mask into the grid. The jets are first counted for each cell, and then placed to
+ * the jet array starting from the first index of the cell.
+ *
+ *  Arguments:
+ *   const Int_t nJets = Number of jets in the arrays
+ *   const Float_t *eta = Jet eta array
+ *   const Float_t *phi = Jet phi array
+ *   const ULong64_t *jetMask = Bit i is set if jet i is put to the grid
+ */
+void JetMatcher::BuildGrid(const Int_t nJets, const Float_t *eta, const Float_t *phi, const ULong64_t *jetMask){
+
+  fEta = eta;
+  fPhi = phi;
+
+  const Int_t nCells = fnEtaCells*fnPhiCells;
+  std::fill(fCellStart.begin(), fCellStart.end(), 0);
+
+  // Count the jets in each cell
+  Int_t nGridJets = 0;
+  Int_t jetIndex, cell;
+  ULong64_t selectedJets;
+  for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+    selectedJets = jetMask[iWord];
+    while(selectedJets){
+      jetIndex = iWord * 64 + __builtin_ctzll(selectedJets);
+      selectedJets &= selectedJets - 1;
+      if(jetIndex >= nJets) break;
+      cell = GetEtaCell(eta[jetIndex]) * fnPhiCells + GetPhiCell(phi[jetIndex]);
+      fJetCell[jetIndex] = cell;
+      fCellStart[cell+1]++;
+      nGridJets++;
+    }
+  }
+
+  // Convert the counts into the first index of each cell
+  for(Int_t iCell = 0; iCell < nCells; iCell++){
+    fCellStart[iCell+1] += fCellStart[iCell];
+  }
+
+  // Place the jets to the cells. The start indices are shifted while filling and restored afterwards.
+  fCellJets.resize(nGridJets);
+  for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+    selectedJets = jetMask[iWord];
+    while(selectedJets){
+      jetIndex = iWord * 64 + __builtin_ctzll(selectedJets);
+      selectedJets &= selectedJets - 1;
+      if(jetIndex >= nJets) break;
+      fCellJets[fCellStart[fJetCell[jetIndex]]++] = jetIndex;
+    }
+  }
+  for(Int_t iCell = nCells; iCell > 0; iCell--){
+    fCellStart[iCell] = fCellStart[iCell-1];
+  }
+  fCellStart[0] = 0;
+
+}
+
+/*
+ * Find the closest jet in the grid within the matching radius
+ *
+ *  Arguments:
+ *   const Double_t eta = Eta of the matched jet
+ *   const Double_t phi = Phi of the matched jet
+ *
+ *   return: Index of the closest jet in the jet arrays given to BuildGrid. -1 if there is no jet within the matching radius.
+ */
+Int_t JetMatcher::FindMatch(const Double_t eta, const Double_t phi) const{
+
+  const Int_t etaCell = GetEtaCell(eta);
+  const Int_t phiCell = GetPhiCell(phi);
+  const Double_t maxDistanceSquared = fMatchingRadius*fMatchingRadius;
+
+  Int_t bestMatch = -1;
+  Double_t bestDistanceSquared = maxDistanceSquared;
+  Double_t deltaEta, deltaPhi, distanceSquared;
+  Int_t cell, jetIndex, neighbourPhiCell;
+
+  // With fewer than three phi cells the neighbours would visit the same cell several times
+  const Int_t firstPhiOffset = (fnPhiCells < 3) ? 0 : -1;
+  const Int_t lastPhiOffset = (fnPhiCells < 3) ? fnPhiCells-1 : 1;
+
+  for(Int_t iEta = TMath::Max(0, etaCell-1); iEta <= TMath::Min(fnEtaCells-1, etaCell+1); iEta++){
+    for(Int_t iPhiOffset = firstPhiOffset; iPhiOffset <= lastPhiOffset; iPhiOffset++){
+      neighbourPhiCell = (fnPhiCells < 3) ? iPhiOffset : (phiCell + iPhiOffset + fnPhiCells) % fnPhiCells;
+      cell = iEta * fnPhiCells + neighbourPhiCell;
+      for(Int_t iJet = fCellStart[cell]; iJet < fCellStart[cell+1]; iJet++){
+        jetIndex = fCellJets[iJet];
+        deltaEta = eta - fEta[jetIndex];
+        deltaPhi = TMath::Abs(phi - fPhi[jetIndex]);
+        if(deltaPhi > TMath::Pi()) deltaPhi = TMath::TwoPi() - deltaPhi;
+        distanceSquared = deltaEta*deltaEta + deltaPhi*deltaPhi;
+        if(distanceSquared < bestDistanceSquared){
+          bestDistanceSquared = distanceSquared;
+          bestMatch = jetIndex;
+        }
+      }
+    }
+  }
+
+  return bestMatch;
+}
+
+// Getter for the matching radius
+Double_t JetMatcher::GetMatchingRadius() const{
+  return fMatchingRadius;
+}
@@ -0,0 +1,76 @@
+// Matching of reconstructed jets to generator level jets using a spatial grid in eta and phi
+
+#ifndef JETMATCHER_H
+#define JETMATCHER_H
+
+// C++ includes
+#include <vector>
+#include <cmath>
+
+// Root includes
+#include <TMath.h>
+
+// Own includes
+#include "JetSelectionKernel.h"
+
+/*
+ * JetMatcher class
+ *
+ * Generator level jets are sorted once per event into a grid of eta-phi cells, whose size is at least the matching
+ * radius. A reconstructed jet can then only be matched to generator level jets in the same cell or in one of the
+ * eight neighbouring cells, so finding the match takes nearly constant time regardless of the jet multiplicity.
+ * The phi direction wraps around, and jets outside of the eta range of the grid are put to the edge cells.
+ *
+ * The jets in the grid are stored in one array ordered by cell, with the index of the first jet in each cell in a
+ * separate array. Both arrays are reused between events, so no memory is allocated in the event loop.
+ */
+class JetMatcher{
+
+public:
+
+  static constexpr Double_t kMaxGridEta = 5.0;  // Grid covers eta from -kMaxGridEta to kMaxGridEta
+
+  // Constructors and destructor
+  JetMatcher(); // Default constructor
+  JetMatcher(Double_t matchingRadius); // Custom constructor
+  JetMatcher(const JetMatcher& in); // Copy constructor
+  ~JetMatcher(); // Destructor
+  JetMatcher& operator=(const JetMatcher& in); // Equal sign operator
+
+  // Methods
+  void BuildGrid(const Int_t nJets, const Float_t *eta, const Float_t *phi, const ULong64_t *jetMask); // Sort the jets selected by the mask into the grid
+  Int_t FindMatch(const Double_t eta, const Double_t phi) const; // Index of the closest jet in the grid within the matching radius, -1 if none
+  Double_t GetMatchingRadius() const; // Getter for the matching radius
+
+private:
+
+  // Private methods
+  inline Int_t GetEtaCell(const Double_t eta) const{
+    Int_t cell = (Int_t)std::floor((eta + kMaxGridEta) * fInverseEtaCellSize);
+    if(cell < 0) return 0;
+    if(cell >= fnEtaCells) return fnEtaCells-1;
+    return cell;
+  }
+
+  inline Int_t GetPhiCell(const Double_t phi) const{
+    Int_t cell = (Int_t)std::floor((phi + TMath::Pi()) * fInversePhiCellSize);
+    cell %= fnPhiCells;
+    if(cell < 0) cell += fnPhiCells;
+    return cell;
+  }
+
+  // Private data members
+  Double_t fMatchingRadius;          // Maximum distance in eta-phi between matched jets
+  Int_t fnEtaCells;                  // Number of cells in eta
+  Int_t fnPhiCells;                  // Number of cells in phi
+  Double_t fInverseEtaCellSize;      // Inverse of the cell size in eta
+  Double_t fInversePhiCellSize;      // Inverse of the cell size in phi
+  const Float_t *fEta;               // Eta of the jets in the grid
+  const Float_t *fPhi;               // Phi of the jets in the grid
+  std::vector<Int_t> fCellStart;     // Index of the first jet of each cell in fCellJets. Last element is the number of jets.
+  std::vector<Int_t> fCellJets;      // Jet indices ordered by cell
+  std::vector<Int_t> fJetCell;       // Cell of each jet in the grid
+
+};
+
+#endif
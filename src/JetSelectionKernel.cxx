@@ -0,0 +1,239 @@
+// Implementation for JetSelectionKernel
+
+// C++ includes
+#include <cmath>
+
+// Own includes
+#include "JetSelectionKernel.h"
+
+// The vectorized kernel is available for x86 processors. It is compiled for AVX2 independently of the compiler
+// flags and only used if the processor running the analysis supports AVX2.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JETSELECTIONKERNEL_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef JETSELECTIONKERNEL_AVX2
+/*
+ * AVX2 implementation of the jet selection kernel. Evaluates the cuts for eight jets at a time.
+ * The comparisons are written such that NaN values pass the cuts as they do in the scalar jet loop.
+ *
+ *  Arguments:
+ *   Int_t nJets = Number of jets in the event
+ *   const Float_t *jetPt, *jetPhi, *jetEta, *jetRawPt, *jetMaxTrackPt = Jet arrays from the forest
+ *   const Float_t *thresholds = Cut thresholds in order: eta, bad phi low, bad phi high, min pT, max pT, min track fraction, max track fraction
+ *   ULong64_t *passMask = Bit mask where the passing jets are marked
+ *
+ *   return: Number of jets processed. The remaining jets do not fill a full vector and are left for the scalar kernel.
+ */
+template <Bool_t cutBadPhi, Bool_t cutMaxTrackPt>
+__attribute__((target("avx2"))) static Int_t SelectJetsAvx2(Int_t nJets, const Float_t *jetPt, const Float_t *jetPhi, const Float_t *jetEta, const Float_t *jetRawPt, const Float_t *jetMaxTrackPt, const Float_t *thresholds, ULong64_t *passMask){
+  
+  const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  const __m256 etaCut = _mm256_set1_ps(thresholds[0]);
+  const __m256 badPhiLow = _mm256_set1_ps(thresholds[1]);
+  const __m256 badPhiHigh = _mm256_set1_ps(thresholds[2]);
+  const __m256 minPtCut = _mm256_set1_ps(thresholds[3]);
+  const __m256 maxPtCut = _mm256_set1_ps(thresholds[4]);
+  const __m256 minTrackFraction = _mm256_set1_ps(thresholds[5]);
+  const __m256 maxTrackFraction = _mm256_set1_ps(thresholds[6]);
+  
+  __m256 pt, phi, absEta, trackFraction, reject;
+  Int_t iJet = 0;
+  for(; iJet + 8 <= nJets; iJet += 8){
+    
+    // Eta and pT cuts
+    absEta = _mm256_and_ps(_mm256_loadu_ps(jetEta + iJet), absMask);
+    pt = _mm256_loadu_ps(jetPt + iJet);
+    reject = _mm256_cmp_ps(absEta, etaCut, _CMP_GE_OQ);
+    reject = _mm256_or_ps(reject, _mm256_cmp_ps(pt, minPtCut, _CMP_LT_OQ));
+    reject = _mm256_or_ps(reject, _mm256_cmp_ps(pt, maxPtCut, _CMP_GT_OQ));
+    
+    // Cut for the region of large inefficiency in the tracker
+    if(cutBadPhi){
+      phi = _mm256_loadu_ps(jetPhi + iJet);
+      reject = _mm256_or_ps(reject, _mm256_and_ps(_mm256_cmp_ps(phi, badPhiLow, _CMP_GT_OQ), _mm256_cmp_ps(phi, badPhiHigh, _CMP_LT_OQ)));
+    }
+    
+    // Cuts for jets with only very low pT particles or with all the pT taken by one track
+    if(cutMaxTrackPt){
+      trackFraction = _mm256_div_ps(_mm256_loadu_ps(jetMaxTrackPt + iJet), _mm256_loadu_ps(jetRawPt + iJet));
+      reject = _mm256_or_ps(reject, _mm256_cmp_ps(trackFraction, minTrackFraction, _CMP_LE_OQ));
+      reject = _mm256_or_ps(reject, _mm256_cmp_ps(trackFraction, maxTrackFraction, _CMP_GE_OQ));
+    }
+    
+    // Mark the passing jets in the mask. Each group of eight jets falls within one mask word.
+    passMask[iJet >> 6] |= ((ULong64_t)(~_mm256_movemask_ps(reject) & 0xFF)) << (iJet & 63);
+  }
+  
+  return iJet;
+}
+#endif
+
+/*
+ * Default constructor
+ */
+JetSelectionKernel::JetSelectionKernel() :
+  fEtaCut(0),
+  fBadPhiLow(FloatThresholdBelow(-0.1)),
+  fBadPhiHigh(FloatThresholdAbove(1.2)),
+  fMinPtCut(0),
+  fMaxPtCut(0),
+  fMinMaxTrackPtFraction(0),
+  fMaxMaxTrackPtFraction(0),
+  fUseVectorInstructions(false)
+{
+  // Default constructor
+  SetUseVectorInstructions(true);
+}
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   Double_t etaCut = Jets with |eta| at or above this are rejected
+ *   Double_t minPtCut = Jets with pT below this are rejected
+ *   Double_t maxPtCut = Jets with pT above this are rejected
+ *   Double_t minMaxTrackPtFraction = Jets with max track pT / raw pT at or below this are rejected
+ *   Double_t maxMaxTrackPtFraction = Jets with max track pT / raw pT at or above this are rejected
+ */
+JetSelectionKernel::JetSelectionKernel(Double_t etaCut, Double_t minPtCut, Double_t maxPtCut, Double_t minMaxTrackPtFraction, Double_t maxMaxTrackPtFraction) :
+  fEtaCut(FloatThresholdAbove(etaCut)),
+  fBadPhiLow(FloatThresholdBelow(-0.1)),
+  fBadPhiHigh(FloatThresholdAbove(1.2)),
+  fMinPtCut(FloatThresholdAbove(minPtCut)),
+  fMaxPtCut(FloatThresholdBelow(maxPtCut)),
+  fMinMaxTrackPtFraction(FloatThresholdBelow(minMaxTrackPtFraction)),
+  fMaxMaxTrackPtFraction(FloatThresholdAbove(maxMaxTrackPtFraction)),
+  fUseVectorInstructions(false)
+{
+  // Custom constructor
+  SetUseVectorInstructions(true);
+}
+
+/*
+ * Destructor
+ */
+JetSelectionKernel::~JetSelectionKernel(){
+  // destructor
+}
+
+/*
+ * Largest float that is not above the threshold. For a float x, x > threshold if and only if x > FloatThresholdBelow(threshold),
+ * and x <= threshold if and only if x <= FloatThresholdBelow(threshold).
+ */
+Float_t JetSelectionKernel::FloatThresholdBelow(Double_t threshold){
+  Float_t floatThreshold = (Float_t)threshold;
+  if(floatThreshold > threshold) floatThreshold = std::nextafter(floatThreshold, -INFINITY);
+  return floatThreshold;
+}
+
+/*
+ * Smallest float that is not below the threshold. For a float x, x < threshold if and only if x < FloatThresholdAbove(threshold),
+ * and x >= threshold if and only if x >= FloatThresholdAbove(threshold).
+ */
+Float_t JetSelectionKernel::FloatThresholdAbove(Double_t threshold){
+  Float_t floatThreshold = (Float_t)threshold;
+  if(floatThreshold < threshold) floatThreshold = std::nextafter(floatThreshold, INFINITY);
+  return floatThreshold;
+}
+
+/*
+ * Allow or forbid the use of AVX2 instructions. They are only used if the processor supports them.
+ */
+void JetSelectionKernel::SetUseVectorInstructions(Bool_t useVector){
+#ifdef JETSELECTIONKERNEL_AVX2
+  fUseVectorInstructions = useVector && __builtin_cpu_supports("avx2");
+#else
+  fUseVectorInstructions = false;
+#endif
+}
+
+/*
+ * Check if AVX2 instructions are used
+ */
+Bool_t JetSelectionKernel::GetUseVectorInstructions() const{
+  return fUseVectorInstructions;
+}
+
+/*
+ * Scalar implementation of the jet selection kernel
+ *
+ *  Arguments:
+ *   Int_t firstJet = First jet evaluated
+ *   Int_t lastJet = One past the last jet evaluated
+ *   const Float_t *jetPt, *jetPhi, *jetEta, *jetRawPt, *jetMaxTrackPt = Jet arrays from the forest
+ *   ULong64_t *passMask = Bit mask where the passing jets are marked
+ */
+template <Bool_t cutBadPhi, Bool_t cutMaxTrackPt> void JetSelectionKernel::SelectScalar(Int_t firstJet, Int_t lastJet, const Float_t *jetPt, const Float_t *jetPhi, const Float_t *jetEta, const Float_t *jetRawPt, const Float_t *jetMaxTrackPt, ULong64_t *passMask) const{
+  
+  Float_t trackFraction;
+  Bool_t reject;
+  for(Int_t iJet = firstJet; iJet < lastJet; iJet++){
+    
+    reject = (std::fabs(jetEta[iJet]) >= fEtaCut) || (jetPt[iJet] < fMinPtCut) || (jetPt[iJet] > fMaxPtCut);
+    if(cutBadPhi) reject = reject || (jetPhi[iJet] > fBadPhiLow && jetPhi[iJet] < fBadPhiHigh);
+    if(cutMaxTrackPt){
+      trackFraction = jetMaxTrackPt[iJet] / jetRawPt[iJet];
+      reject = reject || (trackFraction <= fMinMaxTrackPtFraction) || (trackFraction >= fMaxMaxTrackPtFraction);
+    }
+    
+    if(!reject) passMask[iJet >> 6] |= 1ULL << (iJet & 63);
+  }
+  
+}
+
+/*
+ * Select the jets passing the cuts in one event
+ *
+ *  Arguments:
+ *   Int_t nJets = Number of jets in the event
+ *   const Float_t *jetPt, *jetPhi, *jetEta, *jetRawPt, *jetMaxTrackPt = Jet arrays from the forest.
+ *                                                                      Phi and track arrays are only read if the corresponding cut is applied.
+ *   ULong64_t *passMask = Array of knMaskWords words. Bit i is set if jet i passes all the cuts.
+ *   template cutBadPhi = Cut the phi region with bad tracker performance
+ *   template cutMaxTrackPt = Cut on the fraction of jet pT taken by the highest pT track
+ *
+ *   return: Index of the leading passing jet with positive pT, or -1 if there is no such jet.
+ *           If several jets have the same highest pT, the first one is returned.
+ */
+template <Bool_t cutBadPhi, Bool_t cutMaxTrackPt> Int_t JetSelectionKernel::SelectJets(Int_t nJets, const Float_t *jetPt, const Float_t *jetPhi, const Float_t *jetEta, const Float_t *jetRawPt, const Float_t *jetMaxTrackPt, ULong64_t *passMask) const{
+  
+  for(Int_t iWord = 0; iWord < knMaskWords; iWord++) passMask[iWord] = 0;
+  if(nJets > kMaxJets) nJets = kMaxJets;
+  
+  // Evaluate full vectors of jets with AVX2 and the rest with the scalar kernel
+  Int_t nVectorJets = 0;
+#ifdef JETSELECTIONKERNEL_AVX2
+  if(fUseVectorInstructions){
+    const Float_t thresholds[7] = {fEtaCut, fBadPhiLow, fBadPhiHigh, fMinPtCut, fMaxPtCut, fMinMaxTrackPtFraction, fMaxMaxTrackPtFraction};
+    nVectorJets = SelectJetsAvx2<cutBadPhi,cutMaxTrackPt>(nJets, jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt, thresholds, passMask);
+  }
+#endif
+  SelectScalar<cutBadPhi,cutMaxTrackPt>(nVectorJets, nJets, jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt, passMask);
+  
+  // Find the leading jet among the passing jets
+  Int_t leadingJetIndex = -1;
+  Float_t leadingJetPt = 0;
+  ULong64_t wordBits;
+  Int_t jetIndex;
+  for(Int_t iWord = 0; iWord < knMaskWords; iWord++){
+    wordBits = passMask[iWord];
+    while(wordBits){
+      jetIndex = iWord * 64 + __builtin_ctzll(wordBits);
+      wordBits &= wordBits - 1;
+      if(jetPt[jetIndex] > leadingJetPt){
+        leadingJetPt = jetPt[jetIndex];
+        leadingJetIndex = jetIndex;
+      }
+    }
+  }
+  
+  return leadingJetIndex;
+}
+
+// Explicit instantiations for all the cut combinations
+template Int_t JetSelectionKernel::SelectJets<true,true>(Int_t, const Float_t*, const Float_t*, const Float_t*, const Float_t*, const Float_t*, ULong64_t*) const;
+template Int_t JetSelectionKernel::SelectJets<true,false>(Int_t, const Float_t*, const Float_t*, const Float_t*, const Float_t*, const Float_t*, ULong64_t*) const;
+template Int_t JetSelectionKernel::SelectJets<false,true>(Int_t, const Float_t*, const Float_t*, const Float_t*, const Float_t*, const Float_t*, ULong64_t*) const;
+template Int_t JetSelectionKernel::SelectJets<false,false>(Int_t, const Float_t*, const Float_t*, const Float_t*, const Float_t*, const Float_t*, ULong64_t*) const;
@@ -0,0 +1,58 @@
+// Kernel evaluating the jet quality cuts for all jets in an event at once
+
+#ifndef JETSELECTIONKERNEL_H
+#define JETSELECTIONKERNEL_H
+
+// Root includes
+#include <TString.h>
+
+/*
+ * JetSelectionKernel class
+ *
+ * Evaluates the jet cuts over the jet arrays of an event in one sweep and returns the result as a bit mask,
+ * where bit i is set if jet i passes all the cuts. The cut thresholds are converted to single precision such
+ * that comparing the Float_t leaves against them gives exactly the same result as the double precision
+ * comparisons in the jet loop. If the processor supports AVX2, eight jets are evaluated with one instruction.
+ * Otherwise a scalar implementation with the same results is used.
+ */
+class JetSelectionKernel{
+
+public:
+
+  static const Int_t kMaxJets = 512;                // Maximum number of jets in the mask. Covers the jet multiplicity of central PbPb events.
+  static const Int_t knMaskWords = kMaxJets / 64;   // Number of 64-bit words in the mask
+
+  // Constructors and destructor
+  JetSelectionKernel(); // Default constructor
+  JetSelectionKernel(Double_t etaCut, Double_t minPtCut, Double_t maxPtCut, Double_t minMaxTrackPtFraction, Double_t maxMaxTrackPtFraction); // Custom constructor
+  ~JetSelectionKernel(); // Destructor
+
+  // Select the jets passing the cuts. Returns the index of the leading passing jet, or -1 if there is none.
+  template <Bool_t cutBadPhi, Bool_t cutMaxTrackPt> Int_t SelectJets(Int_t nJets, const Float_t *jetPt, const Float_t *jetPhi, const Float_t *jetEta, const Float_t *jetRawPt, const Float_t *jetMaxTrackPt, ULong64_t *passMask) const;
+
+  void SetUseVectorInstructions(Bool_t useVector); // Allow or forbid the use of AVX2 instructions
+  Bool_t GetUseVectorInstructions() const;         // Check if AVX2 instructions are used
+
+private:
+
+  // Single precision threshold equivalent to a double precision comparison of a Float_t value
+  static Float_t FloatThresholdBelow(Double_t threshold); // Largest float not above the threshold
+  static Float_t FloatThresholdAbove(Double_t threshold); // Smallest float not below the threshold
+
+  // Scalar implementation of the kernel. The AVX2 implementation is in the source file.
+  template <Bool_t cutBadPhi, Bool_t cutMaxTrackPt> void SelectScalar(Int_t firstJet, Int_t lastJet, const Float_t *jetPt, const Float_t *jetPhi, const Float_t *jetEta, const Float_t *jetRawPt, const Float_t *jetMaxTrackPt, ULong64_t *passMask) const;
+
+  // Cut thresholds. Jets with threshold values exactly at the border are handled as in the jet loop.
+  Float_t fEtaCut;                  // Jets with |eta| at or above this are rejected
+  Float_t fBadPhiLow;               // Jets with phi above this and below fBadPhiHigh are rejected if bad phi cut is applied
+  Float_t fBadPhiHigh;              // Jets with phi below this and above fBadPhiLow are rejected if bad phi cut is applied
+  Float_t fMinPtCut;                // Jets with pT below this are rejected
+  Float_t fMaxPtCut;                // Jets with pT above this are rejected
+  Float_t fMinMaxTrackPtFraction;   // Jets with max track pT / raw pT at or below this are rejected
+  Float_t fMaxMaxTrackPtFraction;   // Jets with max track pT / raw pT at or above this are rejected
+
+  Bool_t fUseVectorInstructions;    // Use the AVX2 implementation of the kernel
+
+};
+
+#endif
@@ -0,0 +1,151 @@
+// Implementation for ProgressMonitor
+
+// Root includes
+#include <TSystem.h>
+#include <TMath.h>
+
+// Own includes
+#include "ProgressMonitor.h"
+
+using namespace std;
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   Int_t nFiles = Number of files in the file list
+ *   Double_t printInterval = Minimum time in seconds between the status lines
+ */
+ProgressMonitor::ProgressMonitor(Int_t nFiles, Double_t printInterval) :
+  fPrintInterval(printInterval),
+  fStartTime(chrono::steady_clock::now()),
+  fnEvents(0),
+  fnAcceptedEvents(0),
+  fnBytesRead(0),
+  fNextPrintTime(printInterval),
+  fFileEntries(nFiles, -1),
+  fWindow()
+{
+  // Custom constructor
+  ProgressSample startSample = {0, 0, 0};
+  fWindow.push_back(startSample);
+}
+
+/*
+ * Destructor
+ */
+ProgressMonitor::~ProgressMonitor(){
+  // destructor
+}
+
+/*
+ * Set the number of entries in a file. Called when a worker opens the file, which can happen several times.
+ *
+ *  Arguments:
+ *   Int_t iFile = Index of the file in the file list
+ *   Long64_t nEntries = Number of entries in the file
+ */
+void ProgressMonitor::SetFileEntries(Int_t iFile, Long64_t nEntries){
+  lock_guard<mutex> printLock(fPrintMutex);
+  fFileEntries.at(iFile) = nEntries;
+}
+
+/*
+ * Add a batch of processed events from a worker. If the print interval has passed, the status lines are printed by
+ * this worker. The other workers do not wait for the printing.
+ *
+ *  Arguments:
+ *   Long64_t nEvents = Number of processed events in the batch
+ *   Long64_t nAcceptedEvents = Number of events in the batch passing the event cuts
+ *   Long64_t nBytesRead = Number of bytes read from the input file for the batch
+ */
+void ProgressMonitor::AddProgress(Long64_t nEvents, Long64_t nAcceptedEvents, Long64_t nBytesRead){
+  fnEvents += nEvents;
+  fnAcceptedEvents += nAcceptedEvents;
+  fnBytesRead += nBytesRead;
+
+  if(fPrintInterval <= 0) return;
+  const Double_t currentTime = chrono::duration<Double_t>(chrono::steady_clock::now() - fStartTime).count();
+  if(currentTime < fNextPrintTime) return;
+
+  unique_lock<mutex> printLock(fPrintMutex, try_to_lock);
+  if(!printLock.owns_lock()) return;
+  if(currentTime < fNextPrintTime) return; // Another worker printed while the lock was taken
+  fNextPrintTime = currentTime + fPrintInterval;
+  PrintStatus(false);
+}
+
+/*
+ * Print the final status line with the rates averaged over the whole run
+ */
+void ProgressMonitor::PrintSummary(){
+  lock_guard<mutex> printLock(fPrintMutex);
+  ProgressSample startSample = {0, 0, 0};
+  fWindow.clear();
+  fWindow.push_back(startSample);
+  PrintStatus(true);
+}
+
+/*
+ * Print one status line to the console and one machine readable line to stderr
+ *
+ *  Arguments:
+ *   Bool_t isFinal = True for the summary in the end of the run
+ */
+void ProgressMonitor::PrintStatus(Bool_t isFinal){
+
+  // Add the current counters to the sliding window. The rates are calculated with respect to the oldest sample.
+  ProgressSample currentSample;
+  currentSample.fTime = chrono::duration<Double_t>(chrono::steady_clock::now() - fStartTime).count();
+  currentSample.fnEvents = fnEvents;
+  currentSample.fnBytesRead = fnBytesRead;
+  fWindow.push_back(currentSample);
+  while((Int_t)fWindow.size() > kWindowSize+1) fWindow.pop_front();
+
+  const ProgressSample &oldestSample = fWindow.front();
+  const Double_t windowTime = currentSample.fTime - oldestSample.fTime;
+  const Double_t eventRate = (windowTime > 0) ? (currentSample.fnEvents - oldestSample.fnEvents) / windowTime : 0;
+  const Double_t byteRate = (windowTime > 0) ? (currentSample.fnBytesRead - oldestSample.fnBytesRead) / windowTime : 0;
+  const Long64_t nAcceptedEvents = fnAcceptedEvents;
+  const Double_t acceptedFraction = (currentSample.fnEvents > 0) ? (Double_t)nAcceptedEvents / currentSample.fnEvents : 0;
+
+  // Estimate the total number of entries. Unopened files are assumed to have the average number of entries.
+  Long64_t nKnownEntries = 0;
+  Int_t nOpenedFiles = 0;
+  for(const Long64_t nEntries : fFileEntries){
+    if(nEntries < 0) continue;
+    nKnownEntries += nEntries;
+    nOpenedFiles++;
+  }
+  const Int_t nFiles = fFileEntries.size();
+  Long64_t nEstimatedEntries = nKnownEntries;
+  if(nOpenedFiles > 0) nEstimatedEntries += (Long64_t)((Double_t)nKnownEntries / nOpenedFiles * (nFiles - nOpenedFiles));
+  if(nEstimatedEntries < currentSample.fnEvents) nEstimatedEntries = currentSample.fnEvents;
+  const Double_t estimatedTime = (eventRate > 0) ? (nEstimatedEntries - currentSample.fnEvents) / eventRate : -1;
+
+  const Double_t residentMemory = GetResidentMemory();
+  const Double_t megaByte = 1024*1024;
+  const Int_t etaSeconds = TMath::Nint(estimatedTime);
+
+  if(isFinal){
+    cout << Form("Finished: %lld events in %.1f s, %.1f events/s, %.2f MB/s, accepted %.1f %%, RSS %.0f MB", currentSample.fnEvents, currentSample.fTime, eventRate, byteRate/megaByte, 100*acceptedFraction, residentMemory) << endl;
+  } else {
+    cout << Form("Progress: %lld/%lld events (%.1f %%), %.1f events/s, %.2f MB/s, accepted %.1f %%, RSS %.0f MB, ETA ", currentSample.fnEvents, nEstimatedEntries, (nEstimatedEntries > 0) ? 100.0*currentSample.fnEvents/nEstimatedEntries : 0, eventRate, byteRate/megaByte, 100*acceptedFraction, residentMemory);
+    if(estimatedTime < 0){
+      cout << "unknown" << endl;
+    } else {
+      cout << Form("%02d:%02d:%02d", etaSeconds/3600, (etaSeconds/60)%60, etaSeconds%60) << endl;
+    }
+  }
+
+  cerr << Form("PROGRESS final=%d time=%.1f events=%lld total=%lld files_opened=%d files=%d rate=%.1f mbps=%.3f accepted=%.4f rss_mb=%.0f eta_s=%.0f", isFinal ? 1 : 0, currentSample.fTime, currentSample.fnEvents, nEstimatedEntries, nOpenedFiles, nFiles, eventRate, byteRate/megaByte, acceptedFraction, residentMemory, estimatedTime) << endl;
+}
+
+/*
+ * Resident memory of the process in MB
+ */
+Double_t ProgressMonitor::GetResidentMemory() const{
+  ProcInfo_t processInfo;
+  if(gSystem->GetProcInfo(&processInfo) != 0) return 0;
+  return processInfo.fMemResident / 1024.0;
+}
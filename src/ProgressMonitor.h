@@ -0,0 +1,71 @@
+// Progress reporting for long analysis runs shared by all the worker threads
+
+#ifndef PROGRESSMONITOR_H
+#define PROGRESSMONITOR_H
+
+// C++ includes
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+// Root includes
+#include <TString.h>
+
+/*
+ * ProgressMonitor class
+ *
+ * The workers add the number of processed and accepted events and the number of bytes read from the input files in
+ * batches, so that the shared counters are not touched for every event. When a batch is added and the print interval
+ * has passed, one status line is printed to the console and one machine readable line to stderr. The event and byte
+ * rates are averaged over a sliding window of the latest status lines.
+ *
+ * The number of entries in a file is known only after the file is opened, so opening all the files in the beginning
+ * is avoided. For the files not opened yet, the average number of entries in the opened files is used for the ETA.
+ */
+class ProgressMonitor{
+
+public:
+
+  static const Int_t kReportBatch = 1000;   // Number of events a worker processes before adding them to the monitor
+  static const Int_t kWindowSize = 10;      // Number of status lines over which the rates are averaged
+
+  // Constructors and destructor
+  ProgressMonitor(Int_t nFiles, Double_t printInterval); // Custom constructor
+  ~ProgressMonitor();                                     // Destructor
+
+  // Methods
+  void SetFileEntries(Int_t iFile, Long64_t nEntries);   // Set the number of entries in a file when it is opened
+  void AddProgress(Long64_t nEvents, Long64_t nAcceptedEvents, Long64_t nBytesRead); // Add a batch of processed events from a worker
+  void PrintSummary();                                    // Print the final status line
+
+private:
+
+  // Private methods
+  void PrintStatus(Bool_t isFinal);                       // Print the status lines. Must be called with the print lock.
+  Double_t GetResidentMemory() const;                     // Resident memory of the process in MB
+
+  // Sample of the counters for the sliding window
+  struct ProgressSample{
+    Double_t fTime;          // Time since the start in seconds
+    Long64_t fnEvents;       // Number of processed events
+    Long64_t fnBytesRead;    // Number of bytes read
+  };
+
+  // Private data members
+  Double_t fPrintInterval;                          // Minimum time in seconds between the status lines
+  std::chrono::steady_clock::time_point fStartTime; // Time when the monitor was created
+  std::atomic<Long64_t> fnEvents;                   // Number of processed events
+  std::atomic<Long64_t> fnAcceptedEvents;           // Number of events passing the event cuts
+  std::atomic<Long64_t> fnBytesRead;                // Number of bytes read from the input files
+  std::atomic<Double_t> fNextPrintTime;             // Time since the start when the next status line is due
+
+  std::mutex fPrintMutex;                           // Lock for printing and the data below
+  std::vector<Long64_t> fFileEntries;               // Number of entries in each file. Negative if the file is not opened yet.
+  std::deque<ProgressSample> fWindow;               // Samples for the sliding window
+
+};
+
+#endif
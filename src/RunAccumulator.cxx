@@ -0,0 +1,376 @@
+// Implementation for RunAccumulator
+
+// C++ includes
+#include <iostream>
+#include <algorithm>
+#include <assert.h>
+
+// Root includes
+#include <TMath.h>
+
+// Own includes
+#include "RunAccumulator.h"
+
+using namespace std;
+
+/*
+ * Default constructor
+ */
+RunAccumulator::RunAccumulator() :
+  fName(""),
+  fMaxRuns(0),
+  fnPtBins(0),
+  fMinPt(0),
+  fMaxPt(0),
+  fSlotSize(0),
+  fRunSlot(),
+  fSpilledRuns(),
+  fSumWeights(),
+  fSumWeightsSquared()
+{
+  // Default constructor
+}
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   TString name = Name for the written histogram
+ *   Int_t maxRuns = Maximum number of runs that are resolved. Other runs go to the "other" bucket.
+ *   Int_t nPtBins = Number of bins in the jet pT axis
+ *   Double_t minPt = Lower edge of the jet pT axis
+ *   Double_t maxPt = Upper edge of the jet pT axis
+ */
+RunAccumulator::RunAccumulator(TString name, Int_t maxRuns, Int_t nPtBins, Double_t minPt, Double_t maxPt) :
+  fName(name),
+  fMaxRuns(maxRuns),
+  fnPtBins(nPtBins),
+  fMinPt(minPt),
+  fMaxPt(maxPt),
+  fRunSlot(),
+  fSpilledRuns(),
+  fSumWeights(),
+  fSumWeightsSquared()
+{
+  // Custom constructor
+  if(fMaxRuns < 1){
+    cout << "Error! The maximum number of runs in the run accumulator must be positive" << endl;
+    assert(0);
+  }
+
+  // Underflow and overflow bins are included for jet pT. Only the "other" bucket is allocated in the beginning.
+  fSlotSize = (fnPtBins+2) * knTriggerBins;
+  fSumWeights.assign(fSlotSize, 0);
+  fSumWeightsSquared.assign(fSlotSize, 0);
+}
+
+/*
+ * Copy constructor
+ */
+RunAccumulator::RunAccumulator(const RunAccumulator& in) :
+  fName(in.fName),
+  fMaxRuns(in.fMaxRuns),
+  fnPtBins(in.fnPtBins),
+  fMinPt(in.fMinPt),
+  fMaxPt(in.fMaxPt),
+  fSlotSize(in.fSlotSize),
+  fRunSlot(in.fRunSlot),
+  fSpilledRuns(in.fSpilledRuns),
+  fSumWeights(in.fSumWeights),
+  fSumWeightsSquared(in.fSumWeightsSquared)
+{
+  // Copy constructor
+}
+
+/*
+ * Destructor
+ */
+RunAccumulator::~RunAccumulator(){
+  // destructor
+}
+
+/*
+ * Equal sign operator
+ */
+RunAccumulator& RunAccumulator::operator=(const RunAccumulator& in){
+  // Equal sign operator
+
+  if (&in==this) return *this;
+
+  fName = in.fName;
+  fMaxRuns = in.fMaxRuns;
+  fnPtBins = in.fnPtBins;
+  fMinPt = in.fMinPt;
+  fMaxPt = in.fMaxPt;
+  fSlotSize = in.fSlotSize;
+  fRunSlot = in.fRunSlot;
+  fSpilledRuns = in.fSpilledRuns;
+  fSumWeights = in.fSumWeights;
+  fSumWeightsSquared = in.fSumWeightsSquared;
+
+  return *this;
+}
+
+/*
+ * Find the jet pT bin. Bin 0 is underflow and bin fnPtBins+1 overflow.
+ */
+Int_t RunAccumulator::FindPtBin(Double_t jetPt) const{
+  if(!(jetPt >= fMinPt)) return 0;
+  if(jetPt >= fMaxPt) return fnPtBins+1;
+  Int_t bin = 1 + (Int_t)((jetPt - fMinPt) / (fMaxPt - fMinPt) * fnPtBins);
+  return (bin > fnPtBins) ? fnPtBins : bin;
+}
+
+/*
+ * Find the slot for a run. A new slot is created for each new run. When the number of runs reaches twice the cap,
+ * the runs with the smallest weight are first moved to the "other" bucket. This way the resolved runs are the ones
+ * with the most weight instead of the ones that happen to come first in the input. Runs already moved to the "other"
+ * bucket stay there, so that their fills are not split between two slots.
+ */
+Int_t RunAccumulator::GetSlot(UInt_t runNumber){
+
+  std::map<UInt_t,Int_t>::const_iterator runIterator = fRunSlot.find(runNumber);
+  if(runIterator != fRunSlot.end()) return runIterator->second;
+  if(fSpilledRuns.count(runNumber)) return 0;
+
+  if((Int_t)fRunSlot.size() >= 2*fMaxRuns) SpillSmallestRuns();
+
+  const Int_t newSlot = fRunSlot.size() + 1;
+  fRunSlot[runNumber] = newSlot;
+  fSumWeights.resize((Long64_t)(newSlot+1) * fSlotSize, 0);
+  fSumWeightsSquared.resize((Long64_t)(newSlot+1) * fSlotSize, 0);
+  return newSlot;
+}
+
+/*
+ * Fill the accumulator for all the trigger bits set in the mask
+ *
+ *  Arguments:
+ *   UInt_t runNumber = Run number of the event
+ *   Double_t jetPt = Jet pT
+ *   UInt_t triggerMask = Bit i is set if trigger bin i is filled
+ *   const Double_t *triggerWeight = Weight for each trigger bin. Only used for the set bits.
+ *   Double_t jetWeight = Weight for the jet multiplying all the trigger weights
+ */
+void RunAccumulator::Fill(UInt_t runNumber, Double_t jetPt, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight){
+
+  const Long64_t firstIndex = (Long64_t)GetSlot(runNumber) * fSlotSize + FindPtBin(jetPt) * knTriggerBins;
+
+  Int_t iTrigger;
+  Double_t weight;
+  while(triggerMask){
+    iTrigger = __builtin_ctz(triggerMask);
+    triggerMask &= triggerMask - 1;
+    weight = triggerWeight[iTrigger]*jetWeight;
+    fSumWeights[firstIndex+iTrigger] += weight;
+    fSumWeightsSquared[firstIndex+iTrigger] += weight*weight;
+  }
+
+}
+
+/*
+ * Sum of weights without trigger selection in a slot. Used to find the rarest runs.
+ */
+Double_t RunAccumulator::GetSlotWeight(Int_t slot) const{
+  Double_t sumWeights = 0;
+  for(Int_t iPt = 0; iPt < fnPtBins+2; iPt++){
+    sumWeights += fSumWeights[(Long64_t)slot * fSlotSize + iPt * knTriggerBins + knTriggerBins-1];
+  }
+  return sumWeights;
+}
+
+/*
+ * Add sums of one slot to a slot of this accumulator
+ */
+void RunAccumulator::AddToSlot(Int_t slot, const Double_t *sumWeights, const Double_t *sumWeightsSquared){
+  const Long64_t firstIndex = (Long64_t)slot * fSlotSize;
+  for(Int_t iValue = 0; iValue < fSlotSize; iValue++){
+    fSumWeights[firstIndex+iValue] += sumWeights[iValue];
+    fSumWeightsSquared[firstIndex+iValue] += sumWeightsSquared[iValue];
+  }
+}
+
+/*
+ * Move the runs with the smallest weight to the "other" bucket until the number of runs is within the cap.
+ * Runs with equal weight are ordered by run number, so the result does not depend on the order of the fills.
+ */
+void RunAccumulator::SpillSmallestRuns(){
+
+  const Int_t nSpilledRuns = (Int_t)fRunSlot.size() - fMaxRuns;
+  if(nSpilledRuns <= 0) return;
+
+  // Sort the runs by weight
+  std::vector<std::pair<Double_t,UInt_t>> runWeights;
+  std::map<UInt_t,Int_t>::const_iterator runIterator;
+  for(runIterator = fRunSlot.begin(); runIterator != fRunSlot.end(); runIterator++){
+    runWeights.push_back(std::make_pair(GetSlotWeight(runIterator->second), runIterator->first));
+  }
+  std::sort(runWeights.begin(), runWeights.end());
+
+  std::vector<UInt_t> spilledRuns;
+  for(Int_t iRun = 0; iRun < nSpilledRuns; iRun++) spilledRuns.push_back(runWeights.at(iRun).second);
+  SpillRuns(spilledRuns);
+
+}
+
+/*
+ * Move resolved runs to the "other" bucket. The runs are remembered, so that their later fills go to the "other"
+ * bucket as well. The kept runs are packed to the slots after the "other" bucket in the order of the run number.
+ *
+ *  Arguments:
+ *   const std::vector<UInt_t> &runNumbers = Resolved runs moved to the "other" bucket
+ */
+void RunAccumulator::SpillRuns(const std::vector<UInt_t> &runNumbers){
+
+  if(runNumbers.empty()) return;
+
+  // Add the runs to the "other" bucket
+  Int_t slot;
+  for(const UInt_t runNumber : runNumbers){
+    slot = fRunSlot.at(runNumber);
+    AddToSlot(0, &fSumWeights[(Long64_t)slot * fSlotSize], &fSumWeightsSquared[(Long64_t)slot * fSlotSize]);
+    fRunSlot.erase(runNumber);
+    fSpilledRuns.insert(runNumber);
+  }
+
+  // Copy the kept runs to new storage
+  std::vector<Double_t> keptSumWeights(fSumWeights.begin(), fSumWeights.begin() + fSlotSize);
+  std::vector<Double_t> keptSumWeightsSquared(fSumWeightsSquared.begin(), fSumWeightsSquared.begin() + fSlotSize);
+  Int_t newSlot = 1;
+  std::map<UInt_t,Int_t>::iterator runIterator;
+  for(runIterator = fRunSlot.begin(); runIterator != fRunSlot.end(); runIterator++){
+    slot = runIterator->second;
+    keptSumWeights.insert(keptSumWeights.end(), fSumWeights.begin() + (Long64_t)slot * fSlotSize, fSumWeights.begin() + (Long64_t)(slot+1) * fSlotSize);
+    keptSumWeightsSquared.insert(keptSumWeightsSquared.end(), fSumWeightsSquared.begin() + (Long64_t)slot * fSlotSize, fSumWeightsSquared.begin() + (Long64_t)(slot+1) * fSlotSize);
+    runIterator->second = newSlot++;
+  }
+  fSumWeights.swap(keptSumWeights);
+  fSumWeightsSquared.swap(keptSumWeightsSquared);
+
+}
+
+/*
+ * Add the sums from another accumulator with the same binning. Runs are matched by run number. A run moved to the
+ * "other" bucket in either accumulator has some of its fills there, so all of its fills are moved there. If the cap
+ * is exceeded after adding, the runs with the smallest weight are moved to the "other" bucket.
+ */
+void RunAccumulator::Add(const RunAccumulator *other){
+
+  // The "other" buckets are added together
+  AddToSlot(0, &other->fSumWeights[0], &other->fSumWeightsSquared[0]);
+
+  // Runs resolved here but moved to the "other" bucket in the other accumulator are moved here too
+  std::vector<UInt_t> spilledRuns;
+  for(const UInt_t runNumber : other->fSpilledRuns){
+    if(fRunSlot.count(runNumber)) spilledRuns.push_back(runNumber);
+    fSpilledRuns.insert(runNumber);
+  }
+  SpillRuns(spilledRuns);
+
+  // Add each run of the other accumulator to the slot of the same run, creating new slots above the cap
+  Int_t slot;
+  std::map<UInt_t,Int_t>::const_iterator runIterator;
+  for(runIterator = other->fRunSlot.begin(); runIterator != other->fRunSlot.end(); runIterator++){
+    if(fSpilledRuns.count(runIterator->first)){
+      slot = 0;
+    } else if(fRunSlot.count(runIterator->first)){
+      slot = fRunSlot[runIterator->first];
+    } else {
+      slot = fRunSlot.size() + 1;
+      fRunSlot[runIterator->first] = slot;
+      fSumWeights.resize((Long64_t)(slot+1) * fSlotSize, 0);
+      fSumWeightsSquared.resize((Long64_t)(slot+1) * fSlotSize, 0);
+    }
+    AddToSlot(slot, &other->fSumWeights[(Long64_t)runIterator->second * fSlotSize], &other->fSumWeightsSquared[(Long64_t)runIterator->second * fSlotSize]);
+  }
+
+  SpillSmallestRuns();
+}
+
+/*
+ * Getter for the number of resolved runs
+ */
+Int_t RunAccumulator::GetNRuns() const{
+  return fRunSlot.size();
+}
+
+/*
+ * Sum of weights without trigger selection for a run
+ *
+ *  Arguments:
+ *   UInt_t runNumber = Run number
+ *
+ *   return: Sum of weights for the run, or -1 if the run is not resolved
+ */
+Double_t RunAccumulator::GetRunWeight(UInt_t runNumber) const{
+  std::map<UInt_t,Int_t>::const_iterator runIterator = fRunSlot.find(runNumber);
+  if(runIterator == fRunSlot.end()) return -1;
+  return GetSlotWeight(runIterator->second);
+}
+
+/*
+ * Check if a run was moved to the "other" bucket. All the fills of such a run are in the "other" bucket.
+ */
+Bool_t RunAccumulator::IsSpilled(UInt_t runNumber) const{
+  return fSpilledRuns.count(runNumber) > 0;
+}
+
+/*
+ * Sum of weights without trigger selection in the "other" bucket
+ */
+Double_t RunAccumulator::GetOtherWeight() const{
+  return GetSlotWeight(0);
+}
+
+/*
+ * Memory used by the sums in bytes when the number of runs is at the high-water mark of twice the cap. The slots are
+ * allocated as new runs are seen, so this is reserved from the beginning.
+ */
+Long64_t RunAccumulator::GetMemorySize() const{
+  return (Long64_t)(2*fMaxRuns+1) * fSlotSize * 2 * sizeof(Double_t);
+}
+
+/*
+ * Convert the accumulator into a TH3D with axes [run][jet pT][trigger] and write it to the current directory.
+ * The runs are in increasing order and labeled with the run number. The last run bin is the "other" bucket.
+ */
+void RunAccumulator::Write() const{
+
+  // Runs filled above the cap since the last spill are moved to the "other" bucket before writing
+  if((Int_t)fRunSlot.size() > fMaxRuns){
+    RunAccumulator cappedAccumulator(*this);
+    cappedAccumulator.SpillSmallestRuns();
+    cappedAccumulator.Write();
+    return;
+  }
+
+  const Int_t nRunBins = fRunSlot.size() + 1;
+  TH3D *runHistogram = new TH3D(fName, fName, nRunBins, -0.5, nRunBins-0.5, fnPtBins, fMinPt, fMaxPt, knTriggerBins, -0.5, knTriggerBins-0.5);
+  runHistogram->Sumw2();
+
+  // The map is ordered by run number, so the runs are in increasing order
+  Int_t slot;
+  Long64_t index;
+  std::map<UInt_t,Int_t>::const_iterator runIterator = fRunSlot.begin();
+  for(Int_t iRunBin = 1; iRunBin <= nRunBins; iRunBin++){
+    if(iRunBin < nRunBins){
+      runHistogram->GetXaxis()->SetBinLabel(iRunBin, Form("%u", runIterator->first));
+      slot = runIterator->second;
+      runIterator++;
+    } else {
+      runHistogram->GetXaxis()->SetBinLabel(iRunBin, "other");
+      slot = 0;
+    }
+
+    for(Int_t iPt = 0; iPt < fnPtBins+2; iPt++){
+      for(Int_t iTrigger = 0; iTrigger < knTriggerBins; iTrigger++){
+        index = (Long64_t)slot * fSlotSize + iPt * knTriggerBins + iTrigger;
+        runHistogram->SetBinContent(iRunBin, iPt, iTrigger+1, fSumWeights[index]);
+        runHistogram->SetBinError(iRunBin, iPt, iTrigger+1, TMath::Sqrt(fSumWeightsSquared[index]));
+      }
+    }
+  }
+
+  runHistogram->Write();
+  delete runHistogram;
+}
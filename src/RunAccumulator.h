@@ -0,0 +1,81 @@
+// Run-resolved accumulator for the leading jet pT spectra used in trigger stability studies
+
+#ifndef RUNACCUMULATOR_H
+#define RUNACCUMULATOR_H
+
+// C++ includes
+#include <vector>
+#include <map>
+#include <set>
+
+// Root includes
+#include <TString.h>
+#include <TH3.h>
+
+// Own includes
+#include "TriggerHistograms.h"
+
+/*
+ * RunAccumulator class
+ *
+ * Holds the sum of weights and the sum of squared weights in [jet pT][trigger] for each run. The trigger axis
+ * has the bin without trigger selection last, so that pass and total for the turn-on curves come from the same
+ * object. Each run gets a slot when it is first seen. The number of resolved runs is limited by a configurable cap.
+ * When the number of runs reaches twice the cap during the filling, when accumulators are merged and before writing,
+ * the runs with the smallest total weight are moved to an "other" bucket until the cap is met. The memory use stays
+ * bounded, and a run with few fills at the start of the input does not take the place of the larger runs after it.
+ *
+ * Once a run is moved to the "other" bucket, its later fills go there as well, and merging moves the run out of the
+ * other accumulators too. A resolved run thus always holds all of its fills and is never split with the "other" bucket.
+ *
+ * When written, the accumulator is converted into a TH3D with axes [run][jet pT][trigger]. The run axis has one
+ * bin per run labeled with the run number, and the last bin is the "other" bucket.
+ */
+class RunAccumulator{
+
+public:
+
+  static const Int_t knTriggerBins = TriggerHistograms::knTriggerTypes+1; // Number of trigger bins. Last bin is for all events.
+
+  // Constructors and destructor
+  RunAccumulator(); // Default constructor
+  RunAccumulator(TString name, Int_t maxRuns, Int_t nPtBins, Double_t minPt, Double_t maxPt); // Custom constructor
+  RunAccumulator(const RunAccumulator& in); // Copy constructor
+  ~RunAccumulator(); // Destructor
+  RunAccumulator& operator=(const RunAccumulator& in); // Equal sign operator
+
+  // Methods
+  void Fill(UInt_t runNumber, Double_t jetPt, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight); // Fill all the set trigger bits for a run
+  void Add(const RunAccumulator *other); // Add the sums from another accumulator
+  void Write() const;                    // Convert to TH3D and write it to the current directory
+  Int_t GetNRuns() const;                // Getter for the number of resolved runs
+  Double_t GetRunWeight(UInt_t runNumber) const; // Sum of weights without trigger selection for a run. -1 if the run is not resolved.
+  Bool_t IsSpilled(UInt_t runNumber) const; // True if the run was moved to the "other" bucket
+  Double_t GetOtherWeight() const;       // Sum of weights without trigger selection in the "other" bucket
+  Long64_t GetMemorySize() const;        // Memory used by the sums in bytes at the high-water mark of runs
+
+private:
+
+  // Private methods
+  Int_t FindPtBin(Double_t jetPt) const;  // Find the pT bin including underflow and overflow
+  Int_t GetSlot(UInt_t runNumber);        // Find or create the slot for a run. Spills the smallest runs at twice the cap.
+  Double_t GetSlotWeight(Int_t slot) const; // Sum of weights without trigger selection in a slot
+  void AddToSlot(Int_t slot, const Double_t *sumWeights, const Double_t *sumWeightsSquared); // Add sums to a slot
+  void SpillSmallestRuns();               // Move the runs with the smallest weight to the "other" bucket until the cap is met
+  void SpillRuns(const std::vector<UInt_t> &runNumbers); // Move the given resolved runs to the "other" bucket
+
+  // Private data members
+  TString fName;                          // Name for the written histogram
+  Int_t fMaxRuns;                         // Maximum number of resolved runs
+  Int_t fnPtBins;                         // Number of jet pT bins
+  Double_t fMinPt;                        // Lower edge of the jet pT axis
+  Double_t fMaxPt;                        // Upper edge of the jet pT axis
+  Int_t fSlotSize;                        // Number of values in one slot
+  std::map<UInt_t,Int_t> fRunSlot;        // Slot index for each resolved run
+  std::set<UInt_t> fSpilledRuns;          // Runs moved to the "other" bucket. Their later fills go there too.
+  std::vector<Double_t> fSumWeights;        // Sum of weights. Index: [slot][pT][trigger]. Slot 0 is the "other" bucket.
+  std::vector<Double_t> fSumWeightsSquared; // Sum of squared weights. Index: [slot][pT][trigger]. Slot 0 is the "other" bucket.
+
+};
+
+#endif
@@ -0,0 +1,97 @@
+// Implementation for RuntimeBudget
+
+// C++ includes
+#include <iostream>
+
+// Own includes
+#include "RuntimeBudget.h"
+
+using namespace std;
+
+// Last stop signal received by the process
+volatile sig_atomic_t RuntimeBudget::fgReceivedSignal = 0;
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   Double_t budgetMinutes = Wall-clock time in minutes available for the job. 0 = No time limit, only stop on signals.
+ */
+RuntimeBudget::RuntimeBudget(Double_t budgetMinutes) :
+  fBudget(budgetMinutes*60),
+  fStartTime(chrono::steady_clock::now()),
+  fLongestUnitTime(0),
+  fStopped(false)
+{
+  // Custom constructor
+}
+
+/*
+ * Destructor
+ */
+RuntimeBudget::~RuntimeBudget(){
+  // destructor
+}
+
+/*
+ * Request a stop on SIGTERM and SIGXCPU instead of terminating. Batch systems send these signals some time before
+ * killing a job that exceeds its limits.
+ */
+void RuntimeBudget::InstallSignalHandlers(){
+  signal(SIGTERM, HandleSignal);
+  signal(SIGXCPU, HandleSignal);
+}
+
+/*
+ * Signal handler. Only records the signal, the workers check it between the units.
+ */
+void RuntimeBudget::HandleSignal(int signalNumber){
+  fgReceivedSignal = signalNumber;
+}
+
+/*
+ * Time in seconds since the budget started
+ */
+Double_t RuntimeBudget::GetElapsedTime() const{
+  return chrono::duration<Double_t>(chrono::steady_clock::now() - fStartTime).count();
+}
+
+/*
+ * Add the time used to process one unit. The longest unit is used to estimate if the next one fits in the budget.
+ *
+ *  Arguments:
+ *   Double_t seconds = Time used for the unit in seconds
+ */
+void RuntimeBudget::AddUnitTime(Double_t seconds){
+  Double_t longestTime = fLongestUnitTime;
+  while(seconds > longestTime && !fLongestUnitTime.compare_exchange_weak(longestTime, seconds)){}
+}
+
+/*
+ * Check if no more units should be started. The reason is printed by the worker that first finds out the stop.
+ *
+ *   return: True if a stop signal was received or the next unit would likely exceed the budget
+ */
+Bool_t RuntimeBudget::IsStopRequested(){
+  if(fStopped) return true;
+
+  TString reason = "";
+  if(fgReceivedSignal != 0){
+    reason = Form("received signal %d", (Int_t)fgReceivedSignal);
+  } else if(fBudget > 0 && GetElapsedTime() + fLongestUnitTime > fBudget*(1-kWriteReserveFraction)){
+    reason = Form("the runtime budget of %.1f minutes is about to be exceeded", fBudget/60);
+  }
+  if(reason == "") return false;
+
+  if(!fStopped.exchange(true)){
+    cout << "Stopping the analysis: " << reason.Data() << ". The started units are finished and the rest are written to the remainder manifest." << endl;
+  }
+  return true;
+}
+
+/*
+ * Check if a stop was requested at some point during the analysis
+ */
+Bool_t RuntimeBudget::IsStopped() const{
+  return fStopped;
+}
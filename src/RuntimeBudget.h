@@ -0,0 +1,53 @@
+// Wall-clock budget for the analysis with a clean stop on batch system signals
+
+#ifndef RUNTIMEBUDGET_H
+#define RUNTIMEBUDGET_H
+
+// C++ includes
+#include <atomic>
+#include <chrono>
+#include <csignal>
+
+// Root includes
+#include <TString.h>
+
+/*
+ * RuntimeBudget class
+ *
+ * Decides when the analysis should stop taking new units of work, so that the histograms can still be written before
+ * the batch system kills the job. A stop is requested when the next unit would likely not finish within the budget,
+ * which is estimated from the longest unit processed so far, or when SIGTERM or SIGXCPU is received. A part of the
+ * budget is reserved for writing the output. The units that are already started are always finished.
+ */
+class RuntimeBudget{
+
+public:
+
+  static constexpr Double_t kWriteReserveFraction = 0.05; // Fraction of the budget reserved for writing the output
+
+  // Constructors and destructor
+  RuntimeBudget(Double_t budgetMinutes);   // Custom constructor
+  ~RuntimeBudget();                        // Destructor
+
+  // Methods
+  static void InstallSignalHandlers();     // Request a stop on SIGTERM and SIGXCPU instead of terminating
+  void AddUnitTime(Double_t seconds);      // Add the time used to process one unit
+  Bool_t IsStopRequested();                // Check if no more units should be started
+  Bool_t IsStopped() const;                // Check if a stop was requested at some point
+
+private:
+
+  // Private methods
+  static void HandleSignal(int signalNumber); // Signal handler recording the signal
+  Double_t GetElapsedTime() const;            // Time in seconds since the budget started
+
+  // Private data members
+  static volatile sig_atomic_t fgReceivedSignal;    // Last received stop signal. 0 if none.
+  Double_t fBudget;                                 // Budget in seconds. 0 = Only stop on signals.
+  std::chrono::steady_clock::time_point fStartTime; // Time when the budget started
+  std::atomic<Double_t> fLongestUnitTime;           // Longest time in seconds used to process one unit
+  std::atomic<Bool_t> fStopped;                     // True after a stop is requested
+
+};
+
+#endif
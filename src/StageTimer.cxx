@@ -0,0 +1,164 @@
+// Implementation for StageTimer
+
+// C++ includes
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+// Root includes
+#include <TTree.h>
+
+// Own includes
+#include "StageTimer.h"
+
+using namespace std;
+
+// Names of the stages for the report
+const char *StageTimer::kStageNames[StageTimer::knStages] = {"FileOpen", "ReadHeavyIonTree", "ReadSkimTree", "ReadHltTree", "ReadJetTree", "EventCuts", "Weights", "JetCuts", "HistogramFill", "OutputWrite", "Other"};
+
+/*
+ * Default constructor
+ */
+StageTimer::StageTimer() :
+  fCurrentStage(kNoStage),
+  fStageStart(std::chrono::steady_clock::now())
+{
+  // Default constructor
+  std::fill(fTime, fTime+knStages, 0);
+  std::fill(fnEntries, fnEntries+knStages, 0);
+}
+
+/*
+ * Copy constructor
+ */
+StageTimer::StageTimer(const StageTimer& in) :
+  fCurrentStage(in.fCurrentStage),
+  fStageStart(in.fStageStart)
+{
+  // Copy constructor
+  std::copy(in.fTime, in.fTime+knStages, fTime);
+  std::copy(in.fnEntries, in.fnEntries+knStages, fnEntries);
+}
+
+/*
+ * Destructor
+ */
+StageTimer::~StageTimer(){
+  // destructor
+}
+
+/*
+ * Equal sign operator
+ */
+StageTimer& StageTimer::operator=(const StageTimer& in){
+  // Equal sign operator
+
+  if (&in==this) return *this;
+
+  std::copy(in.fTime, in.fTime+knStages, fTime);
+  std::copy(in.fnEntries, in.fnEntries+knStages, fnEntries);
+  fCurrentStage = in.fCurrentStage;
+  fStageStart = in.fStageStart;
+
+  return *this;
+}
+
+/*
+ * Switch the timer to a stage. The time since the previous switch is added to the stage that was running.
+ *
+ *  Arguments:
+ *   const Int_t stage = Stage to which the timer is switched. kNoStage stops the timer.
+ *
+ *   return: Stage that was running before the switch
+ */
+Int_t StageTimer::Switch(const Int_t stage){
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const Int_t previousStage = fCurrentStage;
+  if(previousStage != kNoStage) fTime[previousStage] += std::chrono::duration<Double_t>(now - fStageStart).count();
+  if(stage != kNoStage && stage != previousStage) fnEntries[stage]++;
+  fCurrentStage = stage;
+  fStageStart = now;
+  return previousStage;
+}
+
+/*
+ * Add the times from another timer. The running stage of the other timer is not included.
+ */
+void StageTimer::Add(const StageTimer *other){
+  for(Int_t iStage = 0; iStage < knStages; iStage++){
+    fTime[iStage] += other->fTime[iStage];
+    fnEntries[iStage] += other->fnEntries[iStage];
+  }
+}
+
+/*
+ * Set all the times to zero and stop the timer
+ */
+void StageTimer::Reset(){
+  std::fill(fTime, fTime+knStages, 0);
+  std::fill(fnEntries, fnEntries+knStages, 0);
+  fCurrentStage = kNoStage;
+  fStageStart = std::chrono::steady_clock::now();
+}
+
+// Getter for the time used in a stage
+Double_t StageTimer::GetTime(const Int_t stage) const{
+  return fTime[stage];
+}
+
+// Getter for the time used in all the stages
+Double_t StageTimer::GetTotalTime() const{
+  Double_t totalTime = 0;
+  for(Int_t iStage = 0; iStage < knStages; iStage++) totalTime += fTime[iStage];
+  return totalTime;
+}
+
+/*
+ * Print the time and the fraction of the total time for each stage
+ *
+ *  Arguments:
+ *   TString title = Title printed before the report
+ */
+void StageTimer::Print(TString title) const{
+  
+  // The report is printed at once, so that the lines from different workers are not mixed
+  const Double_t totalTime = GetTotalTime();
+  TString report = Form("Timing report: %s\n", title.Data());
+  for(Int_t iStage = 0; iStage < knStages; iStage++){
+    report += Form("  %-18s %10.3f s %6.1f %% %12lld entries\n", kStageNames[iStage], fTime[iStage], (totalTime > 0) ? 100*fTime[iStage]/totalTime : 0, fnEntries[iStage]);
+  }
+  report += Form("  %-18s %10.3f s\n", "Total", totalTime);
+  cout << report.Data() << flush;
+}
+
+/*
+ * Write the report as a TTree to the current directory. The tree has one entry for each stage, so that the trees
+ * from several jobs can be merged and the stages summed with TTree::Draw.
+ *
+ *  Arguments:
+ *   TString name = Name of the written tree
+ */
+void StageTimer::Write(TString name) const{
+
+  Int_t stage;
+  char stageName[32];
+  Double_t time;
+  Long64_t nEntries;
+
+  TTree *timingTree = new TTree(name, "Time used in each stage of the analysis");
+  timingTree->Branch("stage", &stage, "stage/I");
+  timingTree->Branch("stageName", stageName, "stageName/C");
+  timingTree->Branch("time", &time, "time/D");
+  timingTree->Branch("entries", &nEntries, "entries/L");
+
+  for(stage = 0; stage < knStages; stage++){
+    strncpy(stageName, kStageNames[stage], sizeof(stageName)-1);
+    stageName[sizeof(stageName)-1] = '\0';
+    time = fTime[stage];
+    nEntries = fnEntries[stage];
+    timingTree->Fill();
+  }
+
+  timingTree->Write();
+  delete timingTree;
+}
@@ -0,0 +1,70 @@
+// Timing of the analysis stages for finding where the processing time is used
+
+#ifndef STAGETIMER_H
+#define STAGETIMER_H
+
+// C++ includes
+#include <chrono>
+
+// Root includes
+#include <TString.h>
+
+/*
+ * StageTimer class
+ *
+ * Accumulates the time used in each stage of the analysis. At any moment, the timer is in one stage, and switching to
+ * another stage adds the time since the previous switch to the stage that was running. This way nested stages are
+ * counted exclusively, and only one clock reading is needed for each switch. When the timer is in kNoStage, the time
+ * is not counted to any stage, which is used when a worker is waiting for work.
+ *
+ * Each worker has its own timers, so no synchronization is needed. The timers of the workers are added together in
+ * the end. The Scope class switches to a stage for the lifetime of the scope and back to the previous stage when the
+ * scope ends.
+ */
+class StageTimer{
+
+public:
+
+  // Timed stages of the analysis. Stage kOther is the time in the analysis loop not belonging to any other stage.
+  enum enumStages{kFileOpen, kReadHeavyIonTree, kReadSkimTree, kReadHltTree, kReadJetTree, kEventCuts, kWeights, kJetCuts, kHistogramFill, kOutputWrite, kOther, knStages};
+  static const Int_t kNoStage = -1;             // Stage in which the time is not counted
+  static const char *kStageNames[knStages];     // Names of the stages for the report
+
+  /*
+   * Switch the timer to a stage for the lifetime of the scope
+   */
+  class Scope{
+  public:
+    Scope(StageTimer *timer, Int_t stage) : fTimer(timer), fPreviousStage(timer->Switch(stage)) {}
+    ~Scope(){ fTimer->Switch(fPreviousStage); }
+  private:
+    StageTimer *fTimer;     // Timer switched to the stage
+    Int_t fPreviousStage;   // Stage restored when the scope ends
+  };
+
+  // Constructors and destructor
+  StageTimer(); // Default constructor
+  StageTimer(const StageTimer& in); // Copy constructor
+  ~StageTimer(); // Destructor
+  StageTimer& operator=(const StageTimer& in); // Equal sign operator
+
+  // Methods
+  Int_t Switch(const Int_t stage);        // Switch to a stage and return the previous stage
+  void Add(const StageTimer *other);      // Add the times from another timer
+  void Reset();                           // Set all the times to zero and stop the timer
+  Double_t GetTime(const Int_t stage) const; // Time in seconds used in a stage
+  Double_t GetTotalTime() const;          // Time in seconds used in all the stages
+  void Print(TString title) const;        // Print the report to the console
+  void Write(TString name) const;         // Write the report as a TTree to the current directory
+
+private:
+
+  // Private data members
+  Double_t fTime[knStages];                         // Time in seconds used in each stage
+  Long64_t fnEntries[knStages];                     // Number of times each stage is entered
+  Int_t fCurrentStage;                              // Stage that is currently running
+  std::chrono::steady_clock::time_point fStageStart; // Time of the previous switch
+
+};
+
+#endif
@@ -1,14 +1,24 @@
 // Class for the main analysis algorithms for the energy-energy correlator analysis
 
+// C++ includes
+#include <algorithm>
+#include <limits>
+
 // Root includes
 #include <TFile.h>
+#include <TDirectory.h>
 #include <TMath.h>
+#include <TROOT.h>
+#include <TSystem.h>
 
 // Own includes
 #include "TriggerAnalyzer.h"
 
 using namespace std;
 
+// Tree from which each of the event cuts is read
+const Int_t TriggerAnalyzer::kEventCutTree[TriggerAnalyzer::knEventCuts] = {ForestReader::kSkimTree, ForestReader::kSkimTree, ForestReader::kSkimTree, ForestReader::kSkimTree, ForestReader::kHltTree, ForestReader::kHeavyIonTree};
+
 /*
  * Default constructor
  */
@@ -16,18 +26,49 @@ TriggerAnalyzer::TriggerAnalyzer() :
   fFileNames(0),
   fCard(0),
   fHistograms(0),
-  fVzWeightFunction(0),
-  fCentralityWeightFunctionCentral(0),
-  fCentralityWeightFunctionPeripheral(0),
-  fPtWeightFunction(0),
+  fInputFile(0),
+  fCurrentFileIndex(-1),
   fDataType(-1),
   fJetType(0),
   fBaseTrigger(1),
   fDebugLevel(0),
+  fNumberOfThreads(1),
   fVzWeight(1),
   fCentralityWeight(1),
   fPtHatWeight(1),
   fTotalEventWeight(1),
+  fPtHatStitchingEdges(),
+  fPtHatStitchingWeights(),
+  fnBootstrapReplicas(0),
+  fBootstrapWeights(),
+  fAdaptiveEventCuts(false),
+  fnEventCutWarmUpEvents(0),
+  fnEventCutMeasuredEvents(0),
+  fBaseTriggerMask(0),
+  fLooseVzCut(0),
+  fEventCutOrder(),
+  fEventCutRejections(knEventCuts,0),
+  fTreeReadTime(ForestReader::knForestTrees,0),
+  fFileTimer(),
+  fTotalTimer(),
+  fProgressInterval(0),
+  fProgressMonitor(0),
+  fReportedBytesRead(0),
+  fCheckpointFileInterval(0),
+  fCheckpointMinuteInterval(0),
+  fCheckpointFileName(""),
+  fCheckpoint(0),
+  fPreviousUnits(),
+  fPreviousFileEntries(),
+  fRuntimeBudget(0),
+  fUnprocessedUnits(),
+  fHistogramMemoryBudget(0),
+  fSpillFileBaseName("histogramSpill"),
+  fSpillFileNames(),
+  fAnalysisModuleNames(),
+  fAnalysisModules(),
+  fNominalJetPassMask(JetSelectionKernel::knMaskWords,0),
+  fNominalLeadingJetIndex(-1),
   fJetAxis(0),
   fVzCut(0),
   fMinimumPtHat(0),
@@ -37,15 +78,29 @@ TriggerAnalyzer::TriggerAnalyzer() :
   fJetMaximumPtCut(0),
   fCutBadPhiRegion(false),
   fMinimumMaxTrackPtFraction(0),
-  fMaximumMaxTrackPtFraction(0)
+  fMaximumMaxTrackPtFraction(0),
+  fJetMatchingRadius(0),
+  fJetMatcher(),
+  fTriggerObjectMatchingRadius(0),
+  fTriggerObjectMatcher(),
+  fGenericEventLoop(false)
 {
   // Default constructor
   fHistograms = new TriggerHistograms();
   fHistograms->CreateHistograms();
   
+  // Before the rejections are measured, the event cuts are evaluated in the order of the cut flow
+  for(Int_t iCut = 0; iCut < knEventCuts; iCut++) fEventCutOrder.push_back(iCut);
+  
   // Initialize readers to null
   fJetReader = NULL;
   
+  // The default configuration has only the nominal cuts
+  CreateCutVariations();
+  
+  // Select the event loop matching the default configuration
+  SelectEventLoop();
+  
 }
 
 /*
@@ -55,10 +110,35 @@ TriggerAnalyzer::TriggerAnalyzer(std::vector<TString> fileNameVector, Configurat
   fFileNames(fileNameVector),
   fCard(newCard),
   fHistograms(0),
+  fInputFile(0),
+  fCurrentFileIndex(-1),
   fVzWeight(1),
   fCentralityWeight(1),
   fPtHatWeight(1),
-  fTotalEventWeight(1)
+  fTotalEventWeight(1),
+  fPtHatStitchingEdges(),
+  fPtHatStitchingWeights(),
+  fnEventCutMeasuredEvents(0),
+  fEventCutOrder(),
+  fEventCutRejections(knEventCuts,0),
+  fTreeReadTime(ForestReader::knForestTrees,0),
+  fFileTimer(),
+  fTotalTimer(),
+  fProgressMonitor(0),
+  fReportedBytesRead(0),
+  fCheckpointFileName(""),
+  fCheckpoint(0),
+  fPreviousUnits(),
+  fPreviousFileEntries(),
+  fRuntimeBudget(0),
+  fUnprocessedUnits(),
+  fSpillFileBaseName("histogramSpill"),
+  fSpillFileNames(),
+  fAnalysisModuleNames(),
+  fAnalysisModules(),
+  fNominalJetPassMask(JetSelectionKernel::knMaskWords,0),
+  fNominalLeadingJetIndex(-1),
+  fGenericEventLoop(false)
 {
   // Custom constructor
   fHistograms = new TriggerHistograms(fCard);
@@ -70,43 +150,18 @@ TriggerAnalyzer::TriggerAnalyzer(std::vector<TString> fileNameVector, Configurat
   // Configurure the analyzer from input card
   ReadConfigurationFromCard();
   
-  // pT weight function for Pythia to match 2017 MC and data pT spectra. Derived from all jets above 120 GeV
-  fPtWeightFunction = new TF1("fPtWeightFunction","pol3",0,500);
-  fPtWeightFunction->SetParameters(0.79572,0.0021861,-6.35407e-06,6.66435e-09); // From JECv6
+  // Create the histograms and jet selections for the cut variations
+  CreateCutVariations();
   
-  // Find the correct folder for track correction tables based on data type
-  if(fDataType == ForestReader::kPp || fDataType == ForestReader::kPpMC){
-    
-    // Weight function for 2017 MC
-    fVzWeightFunction = new TF1("fvz","pol6",-15,15);  // Weight function for 2017 MC
-    fVzWeightFunction->SetParameters(0.973805, 0.00339418, 0.000757544, -1.37331e-06, -2.82953e-07, -3.06778e-10, 3.48615e-09);
-    fCentralityWeightFunctionCentral = NULL;
-    fCentralityWeightFunctionPeripheral = NULL;
-    
-  } else if (fDataType == ForestReader::kPbPb || fDataType == ForestReader::kPbPbMC){
-    
-    // The vz weight function is rederived from the miniAOD dataset.
-    // Macro used for derivation: deriveMonteCarloWeights.C, Git hash: f95771aa3242a7a9ed385c1ff364500481088eec
-    // Input files: eecAnalysis_akFlowJets_wtaAxis_cutBadPhi_miniAODtesting_processed_2023-01-30.root
-    //              PbPbMC2018_RecoGen_eecAnalysis_akFlowJets_mAOD_4pC_wtaAxis_jetTrig_cutBadPhi_processed_2023-02-10.root
-    fVzWeightFunction = new TF1("fvz","pol6",-15,15);
-    fVzWeightFunction->SetParameters(1.0082, -0.0190011, 0.000779051, -2.15118e-05, -6.70894e-06, 1.47181e-07, 6.65274e-09);
-    
-    // The centrality weight function is rederived for the miniAOD dataset.
-    // Macro used for derivation: deriveMonteCarloWeights.C, Git hash: f95771aa3242a7a9ed385c1ff364500481088eec
-    // Input files: eecAnalysis_akFlowJets_wtaAxis_cutBadPhi_miniAODtesting_processed_2023-01-30.root
-    //              PbPbMC2018_RecoGen_eecAnalysis_akFlowJets_mAOD_4pC_wtaAxis_jetTrig_cutBadPhi_processed_2023-02-10.root
-    fCentralityWeightFunctionCentral = new TF1("fCentralWeight","pol6",0,30);
-    fCentralityWeightFunctionCentral->SetParameters(4.44918,-0.0544424, -0.0248668,0.00254486,-0.000117819,2.65985e-06,-2.35606e-08);
-    fCentralityWeightFunctionPeripheral = new TF1("fPeripheralWeight","pol6",30,90);
-    fCentralityWeightFunctionPeripheral->SetParameters(3.41938,-0.0643178, -0.00186948,7.67356e-05,-1.06981e-06,7.04102e-09,-1.84554e-11);
-    
-    
-  } else {
-    fVzWeightFunction = NULL;
-    fCentralityWeightFunctionCentral = NULL;
-    fCentralityWeightFunctionPeripheral = NULL;
-  }
+  // Create the additional analyses run in the same pass
+  fAnalysisModules = CreateAnalysisModules();
+  
+  // Select the event loop specialized for the configuration
+  SelectEventLoop();
+  
+  // Weights for Monte Carlo. Polynomial weight functions by default, histograms from a file if requested in the card.
+  fWeightProvider = WeightProvider(fDataType);
+  if(fCard->Get("WeightSource") == WeightProvider::kHistogram) fWeightProvider.LoadHistogramWeights(fCard->GetStr("WeightFile"));
   
 }
 
@@ -118,18 +173,50 @@ TriggerAnalyzer::TriggerAnalyzer(const TriggerAnalyzer& in) :
   fFileNames(in.fFileNames),
   fCard(in.fCard),
   fHistograms(in.fHistograms),
-  fVzWeightFunction(in.fVzWeightFunction),
-  fCentralityWeightFunctionCentral(in.fCentralityWeightFunctionCentral),
-  fCentralityWeightFunctionPeripheral(in.fCentralityWeightFunctionPeripheral),
-  fPtWeightFunction(in.fPtWeightFunction),
+  fInputFile(in.fInputFile),
+  fCurrentFileIndex(in.fCurrentFileIndex),
   fDataType(in.fDataType),
   fJetType(in.fJetType),
   fBaseTrigger(in.fBaseTrigger),
   fDebugLevel(in.fDebugLevel),
+  fNumberOfThreads(in.fNumberOfThreads),
   fVzWeight(in.fVzWeight),
   fCentralityWeight(in.fCentralityWeight),
   fPtHatWeight(in.fPtHatWeight),
   fTotalEventWeight(in.fTotalEventWeight),
+  fPtHatStitchingEdges(in.fPtHatStitchingEdges),
+  fPtHatStitchingWeights(in.fPtHatStitchingWeights),
+  fWeightProvider(in.fWeightProvider),
+  fnBootstrapReplicas(in.fnBootstrapReplicas),
+  fBootstrapWeights(in.fBootstrapWeights),
+  fAdaptiveEventCuts(in.fAdaptiveEventCuts),
+  fnEventCutWarmUpEvents(in.fnEventCutWarmUpEvents),
+  fnEventCutMeasuredEvents(in.fnEventCutMeasuredEvents),
+  fBaseTriggerMask(in.fBaseTriggerMask),
+  fLooseVzCut(in.fLooseVzCut),
+  fEventCutOrder(in.fEventCutOrder),
+  fEventCutRejections(in.fEventCutRejections),
+  fTreeReadTime(in.fTreeReadTime),
+  fFileTimer(in.fFileTimer),
+  fTotalTimer(in.fTotalTimer),
+  fProgressInterval(in.fProgressInterval),
+  fProgressMonitor(in.fProgressMonitor),
+  fReportedBytesRead(in.fReportedBytesRead),
+  fCheckpointFileInterval(in.fCheckpointFileInterval),
+  fCheckpointMinuteInterval(in.fCheckpointMinuteInterval),
+  fCheckpointFileName(in.fCheckpointFileName),
+  fCheckpoint(in.fCheckpoint),
+  fPreviousUnits(in.fPreviousUnits),
+  fPreviousFileEntries(in.fPreviousFileEntries),
+  fRuntimeBudget(in.fRuntimeBudget),
+  fUnprocessedUnits(in.fUnprocessedUnits),
+  fHistogramMemoryBudget(in.fHistogramMemoryBudget),
+  fSpillFileBaseName(in.fSpillFileBaseName),
+  fSpillFileNames(in.fSpillFileNames),
+  fAnalysisModuleNames(in.fAnalysisModuleNames),
+  fAnalysisModules(in.fAnalysisModules),
+  fNominalJetPassMask(in.fNominalJetPassMask),
+  fNominalLeadingJetIndex(in.fNominalLeadingJetIndex),
   fJetAxis(in.fJetAxis),
   fVzCut(in.fVzCut),
   fMinimumPtHat(in.fMinimumPtHat),
@@ -139,7 +226,14 @@ TriggerAnalyzer::TriggerAnalyzer(const TriggerAnalyzer& in) :
   fJetMaximumPtCut(in.fJetMaximumPtCut),
   fCutBadPhiRegion(in.fCutBadPhiRegion),
   fMinimumMaxTrackPtFraction(in.fMinimumMaxTrackPtFraction),
-  fMaximumMaxTrackPtFraction(in.fMaximumMaxTrackPtFraction)
+  fMaximumMaxTrackPtFraction(in.fMaximumMaxTrackPtFraction),
+  fJetMatchingRadius(in.fJetMatchingRadius),
+  fJetMatcher(in.fJetMatcher),
+  fTriggerObjectMatchingRadius(in.fTriggerObjectMatchingRadius),
+  fTriggerObjectMatcher(in.fTriggerObjectMatcher),
+  fCutVariations(in.fCutVariations),
+  fGenericEventLoop(in.fGenericEventLoop),
+  fEventLoop(in.fEventLoop)
 {
   // Copy constructor
   
@@ -157,18 +251,50 @@ TriggerAnalyzer& TriggerAnalyzer::operator=(const TriggerAnalyzer& in){
   fFileNames = in.fFileNames;
   fCard = in.fCard;
   fHistograms = in.fHistograms;
-  fVzWeightFunction = in.fVzWeightFunction;
-  fCentralityWeightFunctionCentral = in.fCentralityWeightFunctionCentral;
-  fCentralityWeightFunctionPeripheral = in.fCentralityWeightFunctionPeripheral;
-  fPtWeightFunction = in.fPtWeightFunction;
+  fInputFile = in.fInputFile;
+  fCurrentFileIndex = in.fCurrentFileIndex;
   fDataType = in.fDataType;
   fJetType = in.fJetType;
   fBaseTrigger = in.fBaseTrigger;
   fDebugLevel = in.fDebugLevel;
+  fNumberOfThreads = in.fNumberOfThreads;
   fVzWeight = in.fVzWeight;
   fCentralityWeight = in.fCentralityWeight;
   fPtHatWeight = in.fPtHatWeight;
   fTotalEventWeight = in.fTotalEventWeight;
+  fPtHatStitchingEdges = in.fPtHatStitchingEdges;
+  fPtHatStitchingWeights = in.fPtHatStitchingWeights;
+  fWeightProvider = in.fWeightProvider;
+  fnBootstrapReplicas = in.fnBootstrapReplicas;
+  fBootstrapWeights = in.fBootstrapWeights;
+  fAdaptiveEventCuts = in.fAdaptiveEventCuts;
+  fnEventCutWarmUpEvents = in.fnEventCutWarmUpEvents;
+  fnEventCutMeasuredEvents = in.fnEventCutMeasuredEvents;
+  fBaseTriggerMask = in.fBaseTriggerMask;
+  fLooseVzCut = in.fLooseVzCut;
+  fEventCutOrder = in.fEventCutOrder;
+  fEventCutRejections = in.fEventCutRejections;
+  fTreeReadTime = in.fTreeReadTime;
+  fFileTimer = in.fFileTimer;
+  fTotalTimer = in.fTotalTimer;
+  fProgressInterval = in.fProgressInterval;
+  fProgressMonitor = in.fProgressMonitor;
+  fReportedBytesRead = in.fReportedBytesRead;
+  fCheckpointFileInterval = in.fCheckpointFileInterval;
+  fCheckpointMinuteInterval = in.fCheckpointMinuteInterval;
+  fCheckpointFileName = in.fCheckpointFileName;
+  fCheckpoint = in.fCheckpoint;
+  fPreviousUnits = in.fPreviousUnits;
+  fPreviousFileEntries = in.fPreviousFileEntries;
+  fRuntimeBudget = in.fRuntimeBudget;
+  fUnprocessedUnits = in.fUnprocessedUnits;
+  fHistogramMemoryBudget = in.fHistogramMemoryBudget;
+  fSpillFileBaseName = in.fSpillFileBaseName;
+  fSpillFileNames = in.fSpillFileNames;
+  fAnalysisModuleNames = in.fAnalysisModuleNames;
+  fAnalysisModules = in.fAnalysisModules;
+  fNominalJetPassMask = in.fNominalJetPassMask;
+  fNominalLeadingJetIndex = in.fNominalLeadingJetIndex;
   fJetAxis = in.fJetAxis;
   fVzCut = in.fVzCut;
   fMinimumPtHat = in.fMinimumPtHat;
@@ -179,6 +305,13 @@ TriggerAnalyzer& TriggerAnalyzer::operator=(const TriggerAnalyzer& in){
   fCutBadPhiRegion = in.fCutBadPhiRegion;
   fMinimumMaxTrackPtFraction = in.fMinimumMaxTrackPtFraction;
   fMaximumMaxTrackPtFraction = in.fMaximumMaxTrackPtFraction;
+  fJetMatchingRadius = in.fJetMatchingRadius;
+  fJetMatcher = in.fJetMatcher;
+  fTriggerObjectMatchingRadius = in.fTriggerObjectMatchingRadius;
+  fTriggerObjectMatcher = in.fTriggerObjectMatcher;
+  fCutVariations = in.fCutVariations;
+  fGenericEventLoop = in.fGenericEventLoop;
+  fEventLoop = in.fEventLoop;
   
   return *this;
 }
@@ -189,11 +322,12 @@ TriggerAnalyzer& TriggerAnalyzer::operator=(const TriggerAnalyzer& in){
 TriggerAnalyzer::~TriggerAnalyzer(){
   // destructor
   delete fHistograms;
-  if(fVzWeightFunction) delete fVzWeightFunction;
-  if(fCentralityWeightFunctionCentral) delete fCentralityWeightFunctionCentral;
-  if(fCentralityWeightFunctionPeripheral) delete fCentralityWeightFunctionPeripheral;
-  if(fPtWeightFunction) delete fPtWeightFunction;
+  for(UInt_t iVariation = 1; iVariation < fCutVariations.size(); iVariation++){
+    delete fCutVariations.at(iVariation).fHistograms;
+  }
+  CloseInputFile();
   if(fJetReader) delete fJetReader;
+  for(AnalysisModule *module : fAnalysisModules) delete module;
 }
 
 /*
@@ -215,6 +349,11 @@ void TriggerAnalyzer::ReadConfigurationFromCard(){
   fMaximumPtHat = fCard->Get("HighPtHatCut"); // Maximum accepted pT hat value
   fBaseTrigger = fCard->Get("BaseTrigger");   // Base trigger for trigger efficiency analysis
   
+  // Order of the event cuts. Before the rejections are measured, the cuts are evaluated in the order of the cut flow.
+  fAdaptiveEventCuts = (fCard->Get("AdaptiveEventCuts") == 1);          // Order the event cuts by measured rejection per cost
+  fnEventCutWarmUpEvents = fCard->Get("EventCutWarmUpEvents");          // Number of events used to measure the rejection and cost
+  for(Int_t iCut = 0; iCut < knEventCuts; iCut++) fEventCutOrder.push_back(iCut);
+  
   //****************************************
   //          Jet selection cuts
   //****************************************
@@ -232,373 +371,1065 @@ void TriggerAnalyzer::ReadConfigurationFromCard(){
   //****************************************
   fJetType = fCard->Get("JetType");              // Select the type of analyzed jets (Calo, CSPF, PuPF, FlowPF)
   fJetAxis = fCard->Get("JetAxis");              // Select between escheme and WTA axes
+  fJetMatchingRadius = fCard->Get("JetMatchingRadius"); // Matching radius for reconstructed and generator level jets in MC
+  if(fJetMatchingRadius > 0) fJetMatcher = JetMatcher(fJetMatchingRadius);
+  fTriggerObjectMatchingRadius = fCard->Get("TriggerObjectMatchingRadius"); // Matching radius for jets and HLT objects
+  if(fTriggerObjectMatchingRadius > 0) fTriggerObjectMatcher = JetMatcher(fTriggerObjectMatchingRadius);
 
   
   //************************************************
-  //              Debug messages
+  //              Parallel processing
+  //************************************************
+  fNumberOfThreads = fCard->Get("NumberOfThreads");  // Number of worker threads used to process the files
+  if(fNumberOfThreads < 1) fNumberOfThreads = 1;
+  
+  //************************************************
+  //       Bootstrap for statistical uncertainties
+  //************************************************
+  fnBootstrapReplicas = fCard->Get("NumberOfBootstrapReplicas"); // Number of Poisson bootstrap replicas for the jet pT spectra
+  if(fnBootstrapReplicas < 0) fnBootstrapReplicas = 0;
+  fBootstrapWeights.assign(fnBootstrapReplicas, 1);
+  
+  //************************************************
+  //      Checkpoints for resuming interrupted jobs
+  //************************************************
+  fCheckpointFileInterval = fCard->Get("CheckpointFiles");     // Number of completed input files between checkpoints
+  fCheckpointMinuteInterval = fCard->Get("CheckpointMinutes"); // Number of minutes between checkpoints
+  
+  //************************************************
+  //      Memory budget for the sparse histograms
+  //************************************************
+  fHistogramMemoryBudget = fCard->Get("HistogramMemoryMB"); // Memory in MB for the sparse histograms before they are spilled to a file
+  
+  //************************************************
+  //   Additional analyses run in the same pass
+  //************************************************
+  const Int_t nAnalysisModules = fCard->Get("NumberOfAnalysisModules");
+  TString moduleKey;
+  for(Int_t iModule = 1; iModule <= nAnalysisModules; iModule++){
+    moduleKey = Form("AnalysisModule%d", iModule);
+    fAnalysisModuleNames.push_back(fCard->GetStr(moduleKey));
+    if(std::count(fAnalysisModuleNames.begin(), fAnalysisModuleNames.end(), fAnalysisModuleNames.back()) > 1){
+      cout << "Error! The analysis module " << fAnalysisModuleNames.back().Data() << " is given more than once" << endl;
+      assert(0);
+    }
+  }
+  
+  // The histograms of the analysis modules are filled in the order of the events, so their sums are not exact
+  if(nAnalysisModules > 0 && fCard->Get("ReproducibleSums") == 1){
+    cout << "Error! ReproducibleSums cannot be used together with analysis modules, since their sums are not exact" << endl;
+    assert(0);
+  }
+  
+  //************************************************
+  //       Progress reporting and debug messages
   //************************************************
+  fProgressInterval = fCard->Get("ProgressInterval"); // Minimum time in seconds between the progress status lines
   fDebugLevel = fCard->Get("DebugLevel");
 }
 
+/*
+ * Create the cut variations for all the base triggers. The base triggers are given as a list in the card with the
+ * key BaseTrigger. The nominal cuts from the card are the first variation, and its histograms for the first base
+ * trigger are written to the main directory of the output file. Additional variations are read from the card lines
+ * CutVariation1, CutVariation2, ... with the format: name JetEtaCut MinMaxTrackPtFraction MaxMaxTrackPtFraction
+ * ZVertexCut CutBadPhi. Each additional variation gets its own histograms, which are written to a directory named
+ * after the variation. For additional base triggers, all the histograms go to a directory named after the trigger.
+ */
+void TriggerAnalyzer::CreateCutVariations(){
+  
+  fCutVariations.clear();
+  
+  // Nominal cuts
+  std::vector<CutVariation> cutSets;
+  CutVariation variation;
+  variation.fName = "";
+  variation.fJetEtaCut = fJetEtaCut;
+  variation.fMinimumMaxTrackPtFraction = fMinimumMaxTrackPtFraction;
+  variation.fMaximumMaxTrackPtFraction = fMaximumMaxTrackPtFraction;
+  variation.fVzCut = fVzCut;
+  variation.fCutBadPhiRegion = fCutBadPhiRegion;
+  variation.fJetSelection = JetSelectionKernel(fJetEtaCut, fJetMinimumPtCut, fJetMaximumPtCut, fMinimumMaxTrackPtFraction, fMaximumMaxTrackPtFraction);
+  cutSets.push_back(variation);
+  
+  // Without a card, only the nominal cuts with the default base trigger are used
+  if(!fCard){
+    variation.fBaseTriggerName = "";
+    variation.fBaseTrigger = fBaseTrigger;
+    variation.fHistograms = fHistograms;
+    fCutVariations.push_back(variation);
+    fBaseTriggerMask = 1u << fBaseTrigger;
+    fLooseVzCut = fVzCut;
+    return;
+  }
+  
+  // Read the cut variations from the card
+  const Int_t nVariations = fCard->Get("NumberOfCutVariations");
+  TString variationKey;
+  for(Int_t iVariation = 1; iVariation <= nVariations; iVariation++){
+    variationKey = Form("CutVariation%d", iVariation);
+    
+    // Check that the variation is properly defined
+    if(fCard->GetN(variationKey) != 6){
+      cout << "Error! " << variationKey.Data() << " must give a name and values for JetEtaCut, MinMaxTrackPtFraction, MaxMaxTrackPtFraction, ZVertexCut and CutBadPhi" << endl;
+      assert(0);
+    }
+    variation.fName = fCard->GetStr(variationKey);
+    for(const CutVariation &previousVariation : cutSets){
+      if(previousVariation.fName == variation.fName){
+        cout << "Error! The name " << variation.fName.Data() << " is used for more than one cut variation" << endl;
+        assert(0);
+      }
+    }
+    
+    // Read the cuts for the variation
+    variation.fJetEtaCut = fCard->Get(variationKey,1);
+    variation.fMinimumMaxTrackPtFraction = fCard->Get(variationKey,2);
+    variation.fMaximumMaxTrackPtFraction = fCard->Get(variationKey,3);
+    variation.fVzCut = fCard->Get(variationKey,4);
+    variation.fCutBadPhiRegion = (fCard->Get(variationKey,5) == 1);
+    variation.fJetSelection = JetSelectionKernel(variation.fJetEtaCut, fJetMinimumPtCut, fJetMaximumPtCut, variation.fMinimumMaxTrackPtFraction, variation.fMaximumMaxTrackPtFraction);
+    cutSets.push_back(variation);
+  }
+  
+  // Histograms with the same names are created for each base trigger and variation, so they are not attached to the current directory
+  const Int_t nBaseTriggers = fCard->GetN("BaseTrigger");
+  const Bool_t addDirectoryStatus = TH1::AddDirectoryStatus();
+  TH1::AddDirectory(kFALSE);
+  
+  // Combine all the cut variations with all the base triggers
+  UInt_t usedBaseTriggers = 0;
+  Int_t baseTrigger;
+  TriggerHistograms dummyHistograms;
+  for(Int_t iBaseTrigger = 0; iBaseTrigger < nBaseTriggers; iBaseTrigger++){
+    baseTrigger = fCard->Get("BaseTrigger",iBaseTrigger);
+    
+    // Check that the base trigger is known and given only once
+    if(baseTrigger < 0 || baseTrigger >= TriggerHistograms::knTriggerTypes){
+      cout << "Error! Unknown base trigger index " << baseTrigger << endl;
+      assert(0);
+    }
+    if(usedBaseTriggers & (1u << baseTrigger)){
+      cout << "Error! Base trigger " << dummyHistograms.GetTriggerName(baseTrigger).Data() << " is given more than once" << endl;
+      assert(0);
+    }
+    usedBaseTriggers |= 1u << baseTrigger;
+    
+    for(UInt_t iVariation = 0; iVariation < cutSets.size(); iVariation++){
+      variation = cutSets.at(iVariation);
+      variation.fBaseTrigger = baseTrigger;
+      variation.fBaseTriggerName = (iBaseTrigger == 0) ? "" : dummyHistograms.GetTriggerName(baseTrigger);
+      
+      // The nominal histograms already exist, others are created here
+      if(iBaseTrigger == 0 && iVariation == 0){
+        variation.fHistograms = fHistograms;
+      } else {
+        variation.fHistograms = new TriggerHistograms(fCard);
+        variation.fHistograms->CreateHistograms();
+      }
+      fCutVariations.push_back(variation);
+    }
+  }
+  
+  TH1::AddDirectory(addDirectoryStatus);
+  
+  // An event can only pass the event cuts if it passes them for the loosest combination of the variations
+  fBaseTriggerMask = usedBaseTriggers;
+  fLooseVzCut = 0;
+  for(const CutVariation &cutSet : cutSets){
+    if(cutSet.fVzCut > fLooseVzCut) fLooseVzCut = cutSet.fVzCut;
+  }
+}
+
 /*
  * Main analysis loop
+ *
+ * The input files are processed by a pool of workers. Each worker is an analyzer of its own with separate
+ * forest reader and histograms. Initially each worker gets a share of the files. When a worker opens a file,
+ * it splits the file into TTree clusters, and workers that run out of tasks steal files and clusters from the
+ * others. In the end the histograms from all the workers are merged to the histograms of this analyzer.
  */
 void TriggerAnalyzer::RunAnalysis(){
   
+  // Report the accuracy of the tabulated Monte Carlo weights
+  if(fDebugLevel > 0) fWeightProvider.PrintTableErrors();
+  
   //************************************************
-  //  Define variables needed in the analysis loop
+  //        Create analyzers for the workers
   //************************************************
   
-  // Input files and forest readers for analysis
-  TFile *inputFile;
+  // The first worker is this analyzer, the other workers are new analyzers configured from the same card
+  std::vector<TriggerAnalyzer*> workers;
+  workers.push_back(this);
+  if(fNumberOfThreads > 1){
+    ROOT::EnableThreadSafety();
+    const Bool_t addDirectoryStatus = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(kFALSE); // Histograms with the same name are created for all workers
+    for(Int_t iWorker = 1; iWorker < fNumberOfThreads; iWorker++){
+      workers.push_back(new TriggerAnalyzer(fFileNames, fCard));
+      if(!fPtHatStitchingWeights.empty()) workers.back()->SetPtHatStitchingWeights(fPtHatStitchingWeights);
+      workers.back()->fPreviousUnits = fPreviousUnits;
+      workers.back()->fPreviousFileEntries = fPreviousFileEntries;
+      workers.back()->fRuntimeBudget = fRuntimeBudget;
+      workers.back()->fSpillFileBaseName = fSpillFileBaseName;
+      workers.back()->SetGenericEventLoop(fGenericEventLoop);
+    }
+    TH1::AddDirectory(addDirectoryStatus);
+  }
   
-  // Event variables
-  Int_t nEvents = 0;                // Number of events
-  Double_t vz = 0;                  // Vertex z-position
-  Double_t centrality = 0;          // Event centrality
-  Int_t hiBin = 0;                  // CMS hiBin (centrality * 2)
-  Double_t ptHat = 0;               // pT hat for MC events
+  // The memory budget must leave room for the sparse histograms after the dense bins and accumulators of all workers
+  if(fHistogramMemoryBudget > 0){
+    const Double_t megaByte = 1024*1024;
+    Double_t fixedMemory = 0;
+    for(const CutVariation &variation : fCutVariations) fixedMemory += variation.fHistograms->GetFixedMemory();
+    if(fixedMemory*fNumberOfThreads >= fHistogramMemoryBudget*megaByte){
+      cout << Form("Error! The dense jet histograms and accumulators of %d workers need %.1f MB, which does not fit in HistogramMemoryMB %.0f", fNumberOfThreads, fixedMemory*fNumberOfThreads/megaByte, fHistogramMemoryBudget) << endl;
+      assert(0);
+    }
+  }
   
-  // Variables for jets
-  Int_t nJets = 0;                  // Number of jets in an event
-  Double_t jetPt = 0;               // pT of the i:th jet in the event
-  Double_t jetPhi = 0;              // phi of the i:th jet in the event
-  Double_t jetEta = 0;              // eta of the i:th jet in the event
-  Double_t jetPtWeight = 1;         // Weighting for jet pT
-  Double_t leadingJetPt = 0;        // Leading jet pT
-  Double_t leadingJetEta = 0;       // Leading jet eta
-  Double_t leadingJetPhi = 0;       // Leading jet phi
+  //************************************************
+  //     Give the files to the workers as tasks
+  //************************************************
   
-  // File name helper variables
-  TString currentFile;
+  WorkStealingScheduler *scheduler = new WorkStealingScheduler(fNumberOfThreads);
   
-  // Trigger selection array for the events
-  Bool_t triggerSelection[TriggerHistograms::knTriggerTypes];   // Table of triggers that fires this event
-  Double_t triggerPrescale[TriggerHistograms::knTriggerTypes];  // Prescale value for the chosen trigger
+  // The progress of all the workers is reported together
+  if(fProgressInterval > 0){
+    fProgressMonitor = new ProgressMonitor(fFileNames.size(), fProgressInterval);
+    for(TriggerAnalyzer *worker : workers) worker->fProgressMonitor = fProgressMonitor;
+  }
   
-  // Fillers for THnSparses
-  const Int_t nFillJet = 6;
-  Double_t fillerJet[nFillJet];
+  // The units completed by the workers are collected for the checkpoints
+  Int_t nFiles = fFileNames.size();
+  if(fCheckpointFileName != "" && (fCheckpointFileInterval > 0 || fCheckpointMinuteInterval > 0)){
+    fCheckpoint = new AnalysisCheckpoint(fCheckpointFileName, fFileNames, fNumberOfThreads, fCheckpointFileInterval, fCheckpointMinuteInterval);
+    if(!fPreviousUnits.empty()){
+      std::vector<AnalysisTask> previousUnits;
+      for(const std::vector<AnalysisTask> &fileUnits : fPreviousUnits) previousUnits.insert(previousUnits.end(), fileUnits.begin(), fileUnits.end());
+      fCheckpoint->SetPreviousUnits(previousUnits, fPreviousFileEntries);
+    }
+    for(TriggerAnalyzer *worker : workers) worker->fCheckpoint = fCheckpoint;
+  }
+  
+  // Distribute the files evenly to start with. The workers split the files into clusters later.
+  // Files completed in the previous runs are not opened at all.
+  AnalysisTask fileTask;
+  for(Int_t iFile = 0; iFile < nFiles; iFile++){
+    if(!fPreviousUnits.empty() && fPreviousFileEntries.at(iFile) >= 0 && IsPreviouslyCompleted(iFile, 0, fPreviousFileEntries.at(iFile))) continue;
+    fileTask.fFileIndex = iFile;
+    fileTask.fFirstEntry = 0;
+    fileTask.fLastEntry = -1;
+    scheduler->PushTask(iFile % fNumberOfThreads, fileTask);
+  }
+  
+  //************************************************
+  //       Main analysis loop over all tasks
+  //************************************************
+  
+  scheduler->Run([this, &workers, scheduler](Int_t iWorker, const AnalysisTask& task){
+    workers.at(iWorker)->ProcessTask(task, iWorker, scheduler);
+    if(fCheckpoint && fCheckpoint->IsDue()) WriteCheckpoint(workers);
+  });
+  
+  //************************************************
+  //    Merge the worker histograms and clean up
+  //************************************************
+  
+  CloseInputFile();
+  for(AnalysisModule *module : fAnalysisModules) module->End();
+  for(Int_t iWorker = 1; iWorker < fNumberOfThreads; iWorker++){
+    workers.at(iWorker)->CloseInputFile();
+    for(UInt_t iModule = 0; iModule < fAnalysisModules.size(); iModule++){
+      workers.at(iWorker)->fAnalysisModules.at(iModule)->End();
+      fAnalysisModules.at(iModule)->Merge(workers.at(iWorker)->fAnalysisModules.at(iModule));
+    }
+    fUnprocessedUnits.insert(fUnprocessedUnits.end(), workers.at(iWorker)->fUnprocessedUnits.begin(), workers.at(iWorker)->fUnprocessedUnits.end());
+    fSpillFileNames.insert(fSpillFileNames.end(), workers.at(iWorker)->fSpillFileNames.begin(), workers.at(iWorker)->fSpillFileNames.end());
+    for(UInt_t iVariation = 0; iVariation < fCutVariations.size(); iVariation++){
+      fCutVariations.at(iVariation).fHistograms->Merge(workers.at(iWorker)->fCutVariations.at(iVariation).fHistograms);
+    }
+    fTotalTimer.Add(&workers.at(iWorker)->fTotalTimer);
+    delete workers.at(iWorker);
+  }
+  
+  // List the units left unprocessed after a stop in the order of the file list
+  std::sort(fUnprocessedUnits.begin(), fUnprocessedUnits.end(), [](const AnalysisTask &first, const AnalysisTask &second){
+    if(first.fFileIndex != second.fFileIndex) return first.fFileIndex < second.fFileIndex;
+    return first.fFirstEntry < second.fFirstEntry;
+  });
+  
+  // Report where the time was used, summed over the workers
+  if(fDebugLevel > 0) fTotalTimer.Print("all files");
+  
+  // Report how the work was shared between the workers
+  if(fDebugLevel > 0) scheduler->PrintStatistics();
+  
+  delete scheduler;
+  
+  if(fProgressMonitor){
+    fProgressMonitor->PrintSummary();
+    delete fProgressMonitor;
+    fProgressMonitor = NULL;
+  }
+  
+  // The final histograms are written by the caller, so no more checkpoints are needed
+  if(fCheckpoint){
+    delete fCheckpoint;
+    fCheckpoint = NULL;
+  }
+  
+}
+
+/*
+ * Process one task given by the scheduler
+ *
+ *  Arguments:
+ *   const AnalysisTask& task = Range of entries in a file to be analyzed
+ *   Int_t iWorker = Index of the worker processing this task
+ *   WorkStealingScheduler *scheduler = Scheduler to which the clusters of an unsplit file are given
+ */
+void TriggerAnalyzer::ProcessTask(const AnalysisTask& task, Int_t iWorker, WorkStealingScheduler *scheduler){
+  
+  // After a stop is requested, the remaining tasks are only recorded as unprocessed
+  if(fRuntimeBudget && fRuntimeBudget->IsStopRequested()){
+    AddUnprocessedUnit(task);
+    return;
+  }
+  
+  // Time used for the task outside of the timed stages goes to the other stage. Waiting for tasks is not counted.
+  StageTimer::Scope taskScope(&fFileTimer, StageTimer::kOther);
+  
+  // Open the file for the task if it is not already open
+  if(task.fFileIndex != fCurrentFileIndex) OpenInputFile(task.fFileIndex);
+  
+  Long64_t firstEntry = task.fFirstEntry;
+  Long64_t lastEntry = task.fLastEntry;
+  
+  // If the whole file is given as a task, split it into clusters. Process the first cluster now and give the rest
+  // back to the scheduler, so that idle workers can steal them. Clusters completed in the previous runs are skipped.
+  if(lastEntry < 0){
+    std::vector<Long64_t> clusterBoundaries = fJetReader->GetClusterBoundaries();
+    if(clusterBoundaries.size() < 2) return; // No events in the file
+    
+    std::vector<AnalysisTask> clusterTasks;
+    AnalysisTask clusterTask;
+    clusterTask.fFileIndex = task.fFileIndex;
+    for(UInt_t iCluster = 0; iCluster < clusterBoundaries.size()-1; iCluster++){
+      clusterTask.fFirstEntry = clusterBoundaries.at(iCluster);
+      clusterTask.fLastEntry = clusterBoundaries.at(iCluster+1);
+      if(IsPreviouslyCompleted(task.fFileIndex, clusterTask.fFirstEntry, clusterTask.fLastEntry)) continue;
+      clusterTasks.push_back(clusterTask);
+    }
+    if(clusterTasks.empty()) return; // All the clusters are completed
+    
+    firstEntry = clusterTasks.front().fFirstEntry;
+    lastEntry = clusterTasks.front().fLastEntry;
+    clusterTasks.erase(clusterTasks.begin());
+    scheduler->PushSubtasks(iWorker, clusterTasks);
+  }
+  
+  // With checkpoints, the histograms and the completed units of a worker change only while it holds its lock
+  const std::chrono::steady_clock::time_point unitStartTime = std::chrono::steady_clock::now();
+  if(fCheckpoint){
+    std::lock_guard<std::mutex> workerLock(fCheckpoint->GetWorkerMutex(iWorker));
+    ProcessEntryRange(firstEntry, lastEntry);
+    AnalysisTask completedUnit;
+    completedUnit.fFileIndex = task.fFileIndex;
+    completedUnit.fFirstEntry = firstEntry;
+    completedUnit.fLastEntry = lastEntry;
+    fCheckpoint->AddCompletedUnit(iWorker, completedUnit, fJetReader->GetNEvents());
+  } else {
+    ProcessEntryRange(firstEntry, lastEntry);
+  }
+  
+  // The runtime budget estimates from the unit times if the next unit still fits in
+  if(fRuntimeBudget) fRuntimeBudget->AddUnitTime(std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - unitStartTime).count());
+  
+  // Keep the memory of the sparse histograms within the budget
+  if(fHistogramMemoryBudget > 0) SpillHistogramsOverBudget(iWorker);
+  
+}
+
+/*
+ * Record a task that is not processed because of a stop. For a whole file, only the ranges not completed in the
+ * previous runs are recorded. The last range of a file has a negative last entry, meaning the end of the file.
+ *
+ *  Arguments:
+ *   const AnalysisTask& task = Task left unprocessed
+ */
+void TriggerAnalyzer::AddUnprocessedUnit(const AnalysisTask& task){
+  
+  if(task.fLastEntry >= 0 || fPreviousUnits.empty()){
+    fUnprocessedUnits.push_back(task);
+    return;
+  }
+  
+  // Find the gaps between the previously completed units
+  std::vector<AnalysisTask> previousUnits = fPreviousUnits.at(task.fFileIndex);
+  std::sort(previousUnits.begin(), previousUnits.end(), [](const AnalysisTask &first, const AnalysisTask &second){
+    return first.fFirstEntry < second.fFirstEntry;
+  });
+  
+  AnalysisTask remainingUnit;
+  remainingUnit.fFileIndex = task.fFileIndex;
+  Long64_t firstRemainingEntry = 0;
+  for(const AnalysisTask &previousUnit : previousUnits){
+    if(previousUnit.fFirstEntry > firstRemainingEntry){
+      remainingUnit.fFirstEntry = firstRemainingEntry;
+      remainingUnit.fLastEntry = previousUnit.fFirstEntry;
+      fUnprocessedUnits.push_back(remainingUnit);
+    }
+    firstRemainingEntry = TMath::Max(firstRemainingEntry, previousUnit.fLastEntry);
+  }
+  
+  // The rest of the file after the last completed unit
+  const Long64_t nFileEntries = fPreviousFileEntries.at(task.fFileIndex);
+  if(firstRemainingEntry == std::numeric_limits<Long64_t>::max()) return;
+  if(nFileEntries >= 0 && firstRemainingEntry >= nFileEntries) return;
+  remainingUnit.fFirstEntry = firstRemainingEntry;
+  remainingUnit.fLastEntry = -1;
+  fUnprocessedUnits.push_back(remainingUnit);
+  
+}
 
+/*
+ * Open the i:th file from the file list and read the forest from it
+ *
+ *  Arguments:
+ *   Int_t iFile = Index of the opened file in the file list
+ */
+void TriggerAnalyzer::OpenInputFile(Int_t iFile){
+  
+  // Only one file is kept open at a time
+  CloseInputFile();
+  StageTimer::Scope openScope(&fFileTimer, StageTimer::kFileOpen);
+  
+  // Create the forest reader when the first file is opened
+  if(!fJetReader){
+    fJetReader = new ForestReader(fDataType, fJetType, fJetAxis, fBaseTrigger);
+    fJetReader->SetReadTriggerObjects(fTriggerObjectMatchingRadius > 0);
+    fJetReader->SetReadEventIdentifiers(fnBootstrapReplicas > 0 || fHistograms->fLeadingJetPerRun != NULL);
+  }
   
   //************************************************
-  //      Define forest reader for data files
+  //              Find and open files
   //************************************************
   
-  fJetReader = new ForestReader(fDataType, fJetType, fJetAxis, fBaseTrigger);
+  // Find the filename and open the input file
+  TString currentFile = fFileNames.at(iFile);
+  fInputFile = TFile::Open(currentFile);
+  
+  // Check that the file exists
+  if(!fInputFile){
+    cout << "Error! Could not find the file: " << currentFile.Data() << endl;
+    assert(0);
+  }
+  
+  // Check that the file is open
+  if(!fInputFile->IsOpen()){
+    cout << "Error! Could not open the file: " << currentFile.Data() << endl;
+    assert(0);
+  }
+  
+  // Check that the file is not zombie
+  if(fInputFile->IsZombie()){
+    cout << "Error! The following file is a zombie: " << currentFile.Data() << endl;
+    assert(0);
+  }
   
+  // Print the used files
+  if(fDebugLevel > 0) cout << "Reading from file: " << currentFile.Data() << endl;
   
   //************************************************
-  //       Main analysis loop over all files
+  //            Read forest from file
   //************************************************
   
-  // Loop over files
-  Int_t nFiles = fFileNames.size();
-  for(Int_t iFile = 0; iFile < nFiles; iFile++) {
+  // If file is good, read the forest from the file
+  fJetReader->ReadForestFromFile(fInputFile);  // There might be a memory leak in handling the forest...
+  fCurrentFileIndex = iFile;
+  
+  // The bytes read when opening the file are included in the progress
+  fReportedBytesRead = 0;
+  if(fProgressMonitor) fProgressMonitor->SetFileEntries(iFile, fJetReader->GetNEvents());
+  
+  for(AnalysisModule *module : fAnalysisModules) module->BeginFile(iFile, currentFile);
+  
+}
+
+/*
+ * Close the currently open input file
+ */
+void TriggerAnalyzer::CloseInputFile(){
+  if(!fInputFile) return;
+  
+  // Report the time used for the file and add it to the total. The running stage continues after the reset.
+  const Int_t runningStage = fFileTimer.Switch(StageTimer::kNoStage);
+  if(fDebugLevel > 0) fFileTimer.Print(fFileNames.at(fCurrentFileIndex));
+  fTotalTimer.Add(&fFileTimer);
+  fFileTimer.Reset();
+  fFileTimer.Switch(runningStage);
+  
+  fInputFile->Close();
+  delete fInputFile;
+  fInputFile = NULL;
+  fCurrentFileIndex = -1;
+}
+
+/*
+ * Add a batch of processed events to the progress monitor together with the bytes read from the current file
+ *
+ *  Arguments:
+ *   const Long64_t nEvents = Number of processed events in the batch
+ *   const Long64_t nAcceptedEvents = Number of events in the batch passing the event cuts
+ */
+void TriggerAnalyzer::ReportProgress(const Long64_t nEvents, const Long64_t nAcceptedEvents){
+  const Long64_t bytesRead = fInputFile->GetBytesRead();
+  fProgressMonitor->AddProgress(nEvents, nAcceptedEvents, bytesRead - fReportedBytesRead);
+  fReportedBytesRead = bytesRead;
+}
+
+/*
+ * Run the event loop over a range of entries in the currently open file
+ *
+ *  Arguments:
+ *   Long64_t firstEntry = First analyzed entry
+ *   Long64_t lastEntry = One past the last analyzed entry
+ */
+void TriggerAnalyzer::ProcessEntryRange(Long64_t firstEntry, Long64_t lastEntry){
+  (this->*fEventLoop)(firstEntry, lastEntry);
+}
+
+/*
+ * Select the event loop specialized for the analyzed data type. Done once when the analyzer is configured, so that
+ * the checks for the data type are not repeated for every event and jet. The bad phi region cut can be different
+ * for each cut variation, so the jet loop specialized for it is selected separately for each variation.
+ */
+void TriggerAnalyzer::SelectEventLoop(){
+  
+  // The generic loop reads the data type from the analyzer for every event, as was done before the specialization
+  if(fGenericEventLoop){
+    fEventLoop = &TriggerAnalyzer::EventLoop<kGenericDataType>;
+    return;
+  }
+  
+  switch(fDataType){
+    case ForestReader::kPp:
+      fEventLoop = &TriggerAnalyzer::EventLoop<ForestReader::kPp>;
+      break;
+    case ForestReader::kPbPb:
+      fEventLoop = &TriggerAnalyzer::EventLoop<ForestReader::kPbPb>;
+      break;
+    case ForestReader::kPpMC:
+      fEventLoop = &TriggerAnalyzer::EventLoop<ForestReader::kPpMC>;
+      break;
+    case ForestReader::kPbPbMC:
+      fEventLoop = &TriggerAnalyzer::EventLoop<ForestReader::kPbPbMC>;
+      break;
+    default:
+      // Unknown data types get the weights reserved for them, so that the user will not miss it
+      fEventLoop = &TriggerAnalyzer::EventLoop<ForestReader::knDataTypes>;
+      break;
+  }
+  
+}
+
+/*
+ * Event loop specialized for one data type
+ *
+ *  Arguments:
+ *   Long64_t firstEntry = First analyzed entry
+ *   Long64_t lastEntry = One past the last analyzed entry
+ *   template dataType = Analyzed data type. kGenericDataType checks the data type of the analyzer at run time.
+ */
+template <Int_t dataType> void TriggerAnalyzer::EventLoop(Long64_t firstEntry, Long64_t lastEntry){
+  
+  //************************************************
+  //  Define variables needed in the analysis loop
+  //************************************************
+  
+  // Event variables
+  Double_t vz = 0;                  // Vertex z-position
+  Double_t centrality = 0;          // Event centrality
+  Int_t hiBin = 0;                  // CMS hiBin (centrality * 2)
+  Double_t ptHat = 0;               // pT hat for MC events
+  Int_t eventFilterStage = 0;       // Last stage of the event cut flow passed by the event before the base trigger
+  Int_t eventCutStage = 0;          // Last stage of the event cut flow passed by the event with the loosest cut variation
+  TriggerHistograms *histograms;    // Histograms for the current cut variation
+  Bool_t isAcceptedEvent = false;   // Flag for events passing the event cuts for any cut variation
+  Bool_t isNominalEvent = false;    // Flag for events passing the event cuts of the nominal variation
+  EventView eventView;              // Event given to the analysis modules
+  
+  // Events not yet reported to the progress monitor
+  Long64_t nUnreportedEvents = 0;
+  Long64_t nUnreportedAcceptedEvents = 0;
+  
+  // Trigger selection for the events
+  UInt_t triggerMask = 0;       // Bit i is set if trigger i fired in this event. Bit knTriggerTypes is for the bin without trigger selection.
+  Double_t triggerWeight[TriggerHistograms::knTriggerTypes+1];  // Event weight multiplied by the trigger prescale for each set bit
+  Double_t baseTriggerWeight[TriggerHistograms::knTriggerTypes+1];  // Trigger weights where the base trigger of the current variation is not prescaled
+  
+  //************************************************
+  //         Main event loop for the entries
+  //************************************************
+  
+  for(Long64_t iEvent = firstEntry; iEvent < lastEntry; iEvent++){
     
     //************************************************
-    //              Find and open files
+    //         Read basic event information
     //************************************************
     
-    // Find the filename and open the input file
-    currentFile = fFileNames.at(iFile);
-    inputFile = TFile::Open(currentFile);
+    // Report the progress in batches, so that the counters shared by the workers are not updated for every event
+    if(fProgressMonitor && nUnreportedEvents == ProgressMonitor::kReportBatch){
+      ReportProgress(nUnreportedEvents, nUnreportedAcceptedEvents);
+      nUnreportedEvents = 0;
+      nUnreportedAcceptedEvents = 0;
+    }
+    nUnreportedEvents++;
     
-    // Check that the file exists
-    if(!inputFile){
-      cout << "Error! Could not find the file: " << currentFile.Data() << endl;
-      assert(0);
+    // Read the event to memory. In the adaptive mode, the other trees are read only when the event cuts need them.
+    for(Int_t iTree = 0; iTree < ForestReader::knForestTrees; iTree++){
+      if(fAdaptiveEventCuts && iTree != ForestReader::kHeavyIonTree) continue;
+      fFileTimer.Switch(StageTimer::kReadHeavyIonTree + iTree);
+      fJetReader->GetEventFromTree(iTree, iEvent);
     }
+    fFileTimer.Switch(StageTimer::kWeights);
 
-    // Check that the file is open
-    if(!inputFile->IsOpen()){
-      cout << "Error! Could not open the file: " << currentFile.Data() << endl;
-      assert(0);
-    }
+    // Get vz, centrality and pT hat information
+    vz = fJetReader->GetVz();
+    centrality = fJetReader->GetCentrality();
+    hiBin = fJetReader->GetHiBin();
+    ptHat = fJetReader->GetPtHat();
     
-    // Check that the file is not zombie
-    if(inputFile->IsZombie()){
-      cout << "Error! The following file is a zombie: " << currentFile.Data() << endl;
-      assert(0);
+    // We need to apply pT hat cuts before getting pT hat weight. There might be rare events above the upper
+    // limit from which the weights are calculated, which could cause the code to crash.
+    if(ptHat < fMinimumPtHat || ptHat >= fMaximumPtHat) continue;
+    
+    // Get the weighting for the event
+    fVzWeight = GetVzWeight<dataType>(vz);
+    fCentralityWeight = GetCentralityWeight<dataType>(hiBin);
+    fPtHatWeight = GetPtHatWeight(ptHat);
+    fTotalEventWeight = fVzWeight*fCentralityWeight*fPtHatWeight;
+    
+    //  ============================================
+    //  ===== Apply all the event quality cuts =====
+    //  ============================================
+    
+    fFileTimer.Switch(StageTimer::kEventCuts);
+    
+    // The event filters are the same for all cut variations and base triggers, so they are checked only once
+    if(fAdaptiveEventCuts){
+      
+      // The base trigger and vz cuts are checked here for the loosest variation. The jets are needed only if this passes.
+      eventCutStage = EvaluateEventCuts(iEvent, vz);
+      eventFilterStage = TMath::Min(eventCutStage, (Int_t)TriggerHistograms::kBeamScraping);
+      if(eventCutStage == TriggerHistograms::kVzCut){
+        fFileTimer.Switch(StageTimer::kReadJetTree);
+        fJetReader->GetEventFromTree(ForestReader::kJetTree, iEvent);
+        fFileTimer.Switch(StageTimer::kEventCuts);
+      }
+      
+    } else {
+      eventFilterStage = GetEventFilterStage(fJetReader);
     }
     
-
-    // Print the used files
-    if(fDebugLevel > 0) cout << "Reading from file: " << currentFile.Data() << endl;
-
+    // Pack the trigger selection into a bit mask. The bin without trigger selection is always filled with the event weight.
+    if(eventFilterStage == TriggerHistograms::kBeamScraping){
+      triggerMask = 1u << TriggerHistograms::knTriggerTypes;
+      triggerWeight[TriggerHistograms::knTriggerTypes] = fTotalEventWeight;
+      for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+        if(!fJetReader->GetJetFilterBit(iTrigger)) continue;
+        triggerMask |= 1u << iTrigger;
+        triggerWeight[iTrigger] = fTotalEventWeight*fJetReader->GetJetTriggerPrescale(iTrigger);
+      }
+      
+      // The bootstrap weights depend only on the event identity, so they are the same for all cut variations
+      if(fnBootstrapReplicas > 0){
+        BootstrapHistogram::GeneratePoissonWeights(fJetReader->GetRunNumber(), fJetReader->GetLumiBlock(), fJetReader->GetEventNumber(), fnBootstrapReplicas, fBootstrapWeights.data());
+      }
+    }
     
     //************************************************
-    //            Read forest from file
+    //   Fill the histograms for all cut variations
     //************************************************
     
-    // If file is good, read the forest from the file
-    fJetReader->ReadForestFromFile(inputFile);  // There might be a memory leak in handling the forest...
-    nEvents = fJetReader->GetNEvents();
-
-    //************************************************
-    //         Main event loop for each file
-    //************************************************
+    fFileTimer.Switch(StageTimer::kHistogramFill);
     
-    for(Int_t iEvent = 0; iEvent < nEvents; iEvent++){ // nEvents
+    isAcceptedEvent = false;
+    isNominalEvent = false;
+    for(CutVariation &variation : fCutVariations){
+      histograms = variation.fHistograms;
       
-      //************************************************
-      //         Read basic event information
-      //************************************************
+      // Fill event counter histogram for all the passed event filters
+      for(Int_t iStage = TriggerHistograms::kAll; iStage <= eventFilterStage; iStage++){
+        histograms->FillHistogram(histograms->fhEvents,iStage);
+      }
+      if(eventFilterStage < TriggerHistograms::kBeamScraping) continue;
       
-      // Print to console how the analysis is progressing
-      if(fDebugLevel > 1 && iEvent % 1000 == 0) cout << "Analyzing event " << iEvent << endl;
+      // Jet trigger requirement for the base trigger of this variation
+      if(!(triggerMask & (1u << variation.fBaseTrigger))) continue;
+      histograms->FillHistogram(histograms->fhEvents,TriggerHistograms::kCaloJet);
       
-      // Read the event to memory
-      fJetReader->GetEvent(iEvent);
-
-      // Get vz, centrality and pT hat information
-      vz = fJetReader->GetVz();
-      centrality = fJetReader->GetCentrality();
-      hiBin = fJetReader->GetHiBin();
-      ptHat = fJetReader->GetPtHat();
+      // Cut for vertex z-position
+      if(TMath::Abs(vz) > variation.fVzCut) continue;
+      histograms->FillHistogram(histograms->fhEvents,TriggerHistograms::kVzCut);
+      isAcceptedEvent = true;
+      if(&variation == &fCutVariations.front()) isNominalEvent = true;
       
-      // We need to apply pT hat cuts before getting pT hat weight. There might be rare events above the upper
-      // limit from which the weights are calculated, which could cause the code to crash.
-      if(ptHat < fMinimumPtHat || ptHat >= fMaximumPtHat) continue;
+      // ======================================
+      // ===== Event quality cuts applied =====
+      // ======================================
       
-      // Get the weighting for the event
-      fVzWeight = GetVzWeight(vz);
-      fCentralityWeight = GetCentralityWeight(hiBin);
-      fPtHatWeight = fJetReader->GetEventWeight();
-      fTotalEventWeight = fVzWeight*fCentralityWeight*fPtHatWeight;
+      // Fill the event information histograms for the events that pass the event cuts
+      histograms->FillHistogram(histograms->fhVertexZ,vz);                     // z vertex distribution from all events
+      histograms->FillHistogram(histograms->fhVertexZWeighted,vz,fVzWeight);   // z-vertex distribution weighted with the weight function
+      histograms->FillHistogram(histograms->fhCentrality,centrality);          // Centrality filled from all events
+      histograms->FillHistogram(histograms->fhCentralityWeighted,centrality,fCentralityWeight); // Centrality weighted with the centrality weighting function
+      histograms->FillHistogram(histograms->fhPtHat,ptHat);                    // pT hat histogram
+      histograms->FillHistogram(histograms->fhPtHatWeighted,ptHat,fPtHatWeight); // pT het histogram weighted with corresponding cross section and event number
       
-      // Fill event counter histogram
-      fHistograms->fhEvents->Fill(TriggerHistograms::kAll);          // All the events looped over
+      // The prescale for the base trigger branch is one, as it is meaningless after the selection
+      std::copy(triggerWeight, triggerWeight+TriggerHistograms::knTriggerTypes+1, baseTriggerWeight);
+      baseTriggerWeight[variation.fBaseTrigger] = fTotalEventWeight;
       
-      //  ============================================
-      //  ===== Apply all the event quality cuts =====
-      //  ============================================
+      // Fill the jet histograms with the jet loop specialized for the bad phi region cut
+      if(variation.fCutBadPhiRegion){
+        FillJetHistograms<dataType,true>(variation, centrality, triggerMask, baseTriggerWeight);
+      } else {
+        FillJetHistograms<dataType,false>(variation, centrality, triggerMask, baseTriggerWeight);
+      }
       
-      if(!PassEventCuts(fJetReader)) continue;
-      
-      // Fill the event information histograms for the events that pass the event cuts
-      fHistograms->fhVertexZ->Fill(vz);                            // z vertex distribution from all events
-      fHistograms->fhVertexZWeighted->Fill(vz,fVzWeight);          // z-vertex distribution weighted with the weight function
-      fHistograms->fhCentrality->Fill(centrality);                 // Centrality filled from all events
-      fHistograms->fhCentralityWeighted->Fill(centrality,fCentralityWeight); // Centrality weighted with the centrality weighting function
-      fHistograms->fhPtHat->Fill(ptHat);                           // pT hat histogram
-      fHistograms->fhPtHatWeighted->Fill(ptHat,fPtHatWeight);      // pT het histogram weighted with corresponding cross section and event number
-      
-      // Determine the trigger selection for all included triggers
-      for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
-        triggerSelection[iTrigger] = fJetReader->GetJetFilterBit(iTrigger);
-        triggerPrescale[iTrigger] = fJetReader->GetJetTriggerPrescale(iTrigger);
-      }
+    } // Loop over cut variations
+    
+    if(isAcceptedEvent) nUnreportedAcceptedEvents++;
+    
+    // The analysis modules analyze the events passing the nominal selection. All the trees are read for these events.
+    if(isNominalEvent && !fAnalysisModules.empty()){
+      eventView.fReader = fJetReader;
+      eventView.fFileIndex = fCurrentFileIndex;
+      eventView.fEntry = iEvent;
+      eventView.fVz = vz;
+      eventView.fCentrality = centrality;
+      eventView.fHiBin = hiBin;
+      eventView.fPtHat = ptHat;
+      eventView.fEventWeight = fTotalEventWeight;
+      eventView.fTriggerMask = triggerMask;
+      eventView.fTriggerWeight = triggerWeight;
+      eventView.fJetPassMask = fNominalJetPassMask.data();
+      eventView.fLeadingJetIndex = fNominalLeadingJetIndex;
+      for(AnalysisModule *module : fAnalysisModules) module->ProcessEvent(eventView);
+    }
+    
+  } // Event loop
+  
+  fFileTimer.Switch(StageTimer::kOther);
+  if(fProgressMonitor) ReportProgress(nUnreportedEvents, nUnreportedAcceptedEvents);
+  
+}
+
+/*
+ * Fill the jet histograms of one cut variation for the current event
+ *
+ *  Arguments:
+ *   const CutVariation &variation = Cut variation giving the jet selection and the filled histograms
+ *   const Double_t centrality = Centrality of the event
+ *   const UInt_t triggerMask = Bit i is set if trigger bin i is filled
+ *   const Double_t *triggerWeight = Event weight multiplied by the trigger prescale for each set bit
+ *   template dataType = Analyzed data type
+ *   template cutBadPhi = Flag for cutting the phi region with bad tracker performance
+ */
+template <Int_t dataType, Bool_t cutBadPhi> void TriggerAnalyzer::FillJetHistograms(const CutVariation &variation, const Double_t centrality, const UInt_t triggerMask, const Double_t *triggerWeight){
+  
+  // Generator level jets are only available for MC
+  const Int_t analyzedDataType = (dataType == kGenericDataType) ? fDataType : dataType;
+  const Bool_t isMonteCarlo = (analyzedDataType == ForestReader::kPpMC || analyzedDataType == ForestReader::kPbPbMC);
+  
+  // Histograms for this cut variation
+  TriggerHistograms *histograms = variation.fHistograms;
+  
+  // Variables for jets
+  Int_t nJets = 0;                  // Number of jets in an event
+  Double_t jetPt = 0;               // pT of the i:th jet in the event
+  Double_t jetPhi = 0;              // phi of the i:th jet in the event
+  Double_t jetEta = 0;              // eta of the i:th jet in the event
+  Double_t jetPtWeight = 1;         // Weighting for jet pT
+  Double_t leadingJetPt = 0;        // Leading jet pT
+  Double_t leadingJetEta = 0;       // Leading jet eta
+  Double_t leadingJetPhi = 0;       // Leading jet phi
+  Int_t leadingJetIndex = -1;       // Index of the leading jet in the jet arrays
+  Int_t jetIndex = 0;               // Index of the current jet in the jet arrays
+  ULong64_t jetPassMask[JetSelectionKernel::knMaskWords]; // Bit mask for the jets passing the jet cuts
+  ULong64_t passingJets = 0;        // Word of the mask from which the passing jets are read
+  ULong64_t recoJetPassMask[JetSelectionKernel::knMaskWords]; // Mask for the reconstructed jets kept for matching
+  ULong64_t triggerObjectMask[JetSelectionKernel::knMaskWords]; // Mask for the HLT objects put to the matching grid
+  Int_t nTriggerObjects = 0;        // Number of HLT objects for a trigger in the event
+  Int_t matchedJetIndex = -1;       // Index of the generator level jet matched to a reconstructed jet
+  
+  // Fillers for THnSparses
+  const Int_t nFillJet = 6;
+  Double_t fillerJet[nFillJet];
+  
+  //***********************************************************************
+  //    Loop over all jets and fill histograms for different triggers
+  //***********************************************************************
+  
+  // Jet loop
+  nJets = fJetReader->GetNJets();
+  
+  //  ========================================
+  //  ======== Apply jet quality cuts ========
+  //  ========================================
+  
+  // Evaluate the eta, bad phi region, max track pT fraction and jet pT cuts for all the jets at once
+  fFileTimer.Switch(StageTimer::kJetCuts);
+  leadingJetIndex = variation.fJetSelection.SelectJets<cutBadPhi,true>(nJets, fJetReader->GetJetPtArray(), fJetReader->GetJetPhiArray(), fJetReader->GetJetEtaArray(), fJetReader->GetJetRawPtArray(), fJetReader->GetJetMaxTrackPtArray(), jetPassMask);
+  fFileTimer.Switch(StageTimer::kHistogramFill);
+  
+  // The nominal jet selection is shared with the analysis modules
+  if(!fAnalysisModules.empty() && &variation == &fCutVariations.front()){
+    std::copy(jetPassMask, jetPassMask+JetSelectionKernel::knMaskWords, fNominalJetPassMask.begin());
+    fNominalLeadingJetIndex = leadingJetIndex;
+  }
+  
+  //  ========================================
+  //  ======= Jet quality cuts applied =======
+  //  ========================================
+  
+  // Loop over the jets marked as passing in the mask
+  for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+    passingJets = jetPassMask[iWord];
+    while(passingJets){
+      jetIndex = iWord * 64 + __builtin_ctzll(passingJets);
+      passingJets &= passingJets - 1;
       
-      // Set the prescale for the base trigger branch to one, as it is meaningless after the selection
-      triggerPrescale[fBaseTrigger] = 1;
+      jetPt = fJetReader->GetJetPt(jetIndex);
+      jetPhi = fJetReader->GetJetPhi(jetIndex);
+      jetEta = fJetReader->GetJetEta(jetIndex);
       
-      // ======================================
-      // ===== Event quality cuts applied =====
-      // ======================================
+      //************************************************
+      //         Fill histograms for all jets
+      //************************************************
+    
+      // Find the pT weight for the jet
+      jetPtWeight = GetJetPtWeight<dataType>(jetPt);
+  
+      // Fill the axes in correct order
+      fillerJet[0] = jetPt;          // Axis 0 = jet pT
+      fillerJet[1] = jetPhi;         // Axis 1 = jet phi
+      fillerJet[2] = jetEta;         // Axis 2 = jet eta
+      fillerJet[3] = centrality;     // Axis 3 = centrality
+      fillerJet[4] = TriggerHistograms::kReconstructed;  // Axis 4 = Reconstruction flag
       
-      //***********************************************************************
-      //    Loop over all jets and fill histograms for different triggers
-      //***********************************************************************
+      // Axis 5 = Trigger selection. Filled for the bin without trigger selection and for all the triggers that fired on top of the base trigger.
+      histograms->FillJetTriggers(histograms->fhInclusiveJet, fillerJet, triggerMask, triggerWeight, jetPtWeight);
+      if(histograms->fhInclusiveJetBootstrap) histograms->fhInclusiveJetBootstrap->Fill(jetPt, centrality, TriggerHistograms::kReconstructed, triggerMask, triggerWeight, jetPtWeight, fBootstrapWeights.data());
+      if(histograms->fJetEfficiency) histograms->fJetEfficiency->Fill(EfficiencyAccumulator::kInclusiveJet, jetPt, centrality, TriggerHistograms::kReconstructed, triggerMask, triggerWeight, jetPtWeight);
+  
+    }
+  } // End of jet loop
+  
+  // Find the leading jet among the jets passing the cuts
+  leadingJetPt = 0; leadingJetEta = 0; leadingJetPhi = 0;
+  if(leadingJetIndex >= 0){
+    leadingJetPt = fJetReader->GetJetPt(leadingJetIndex);
+    leadingJetEta = fJetReader->GetJetEta(leadingJetIndex);
+    leadingJetPhi = fJetReader->GetJetPhi(leadingJetIndex);
+  }
+  
+  // =============================== //
+  // Fill the leading jet histograms //
+  // =============================== //
+  
+  // Find the pT weight for the jet
+  jetPtWeight = GetJetPtWeight<dataType>(leadingJetPt);
+  
+  // Fill the axes in correct order
+  fillerJet[0] = leadingJetPt;          // Axis 0 = leading jet pT
+  fillerJet[1] = leadingJetPhi;         // Axis 1 = leading jet phi
+  fillerJet[2] = leadingJetEta;         // Axis 2 = leading jet eta
+  fillerJet[3] = centrality;            // Axis 3 = centrality
+  fillerJet[4] = TriggerHistograms::kReconstructed;  // Axis 4 = Reconstruction flag
+  
+  // Axis 5 = Trigger selection. Filled for the bin without trigger selection and for all the triggers that fired on top of the base trigger.
+  histograms->FillJetTriggers(histograms->fhLeadingJet, fillerJet, triggerMask, triggerWeight, jetPtWeight);
+  if(histograms->fhLeadingJetBootstrap) histograms->fhLeadingJetBootstrap->Fill(leadingJetPt, centrality, TriggerHistograms::kReconstructed, triggerMask, triggerWeight, jetPtWeight, fBootstrapWeights.data());
+  if(histograms->fJetEfficiency) histograms->fJetEfficiency->Fill(EfficiencyAccumulator::kLeadingJet, leadingJetPt, centrality, TriggerHistograms::kReconstructed, triggerMask, triggerWeight, jetPtWeight);
+  if(histograms->fLeadingJetPerRun) histograms->fLeadingJetPerRun->Fill(fJetReader->GetRunNumber(), leadingJetPt, triggerMask, triggerWeight, jetPtWeight);
+  
+  // =========================================== //
+  // Match reconstructed jets to the HLT objects //
+  // =========================================== //
+  
+  if(histograms->fhJetTriggerObject){
+    for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+      if(!fJetReader->HasTriggerObjects(iTrigger)) continue;
       
-      // Jet loop
-      nJets = fJetReader->GetNJets();
-      leadingJetPt = 0; leadingJetEta = 0; leadingJetPhi = 0;
-      for(Int_t jetIndex = 0; jetIndex < nJets; jetIndex++) {
-        
-        jetPt = fJetReader->GetJetPt(jetIndex);
-        jetPhi = fJetReader->GetJetPhi(jetIndex);
-        jetEta = fJetReader->GetJetEta(jetIndex);
-        
-        //  ========================================
-        //  ======== Apply jet quality cuts ========
-        //  ========================================
-        
-        if(TMath::Abs(jetEta) >= fJetEtaCut) continue; // Cut for jet eta
-        if(fCutBadPhiRegion && (jetPhi > -0.1 && jetPhi < 1.2)) continue; // Cut the area of large inefficiency in tracker
-        
-        if(fMinimumMaxTrackPtFraction >= fJetReader->GetJetMaxTrackPt(jetIndex)/fJetReader->GetJetRawPt(jetIndex)) {
-          continue; // Cut for jets with only very low pT particles
+      // Only the objects of the triggers that fired are used. For other triggers, none of the jets has a match.
+      nTriggerObjects = (triggerMask & (1u << iTrigger)) ? fJetReader->GetNTriggerObjects(iTrigger) : 0;
+      if(nTriggerObjects > 0){
+        for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+          triggerObjectMask[iWord] = 0;
+          if(nTriggerObjects >= (iWord+1)*64) triggerObjectMask[iWord] = ~0ULL;
+          else if(nTriggerObjects > iWord*64) triggerObjectMask[iWord] = (1ULL << (nTriggerObjects - iWord*64)) - 1;
         }
-        if(fMaximumMaxTrackPtFraction <= fJetReader->GetJetMaxTrackPt(jetIndex)/fJetReader->GetJetRawPt(jetIndex)) {
-          continue; // Cut for jets where all the pT is taken by one track
+        fTriggerObjectMatcher.BuildGrid(nTriggerObjects, fJetReader->GetTriggerObjectEtaArray(iTrigger), fJetReader->GetTriggerObjectPhiArray(iTrigger), triggerObjectMask);
+      }
+      
+      // Find the closest HLT object for each reconstructed jet passing the cuts
+      for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+        passingJets = jetPassMask[iWord];
+        while(passingJets){
+          jetIndex = iWord * 64 + __builtin_ctzll(passingJets);
+          passingJets &= passingJets - 1;
+          
+          jetPt = fJetReader->GetJetPt(jetIndex);
+          matchedJetIndex = (nTriggerObjects > 0) ? fTriggerObjectMatcher.FindMatch(fJetReader->GetJetEta(jetIndex), fJetReader->GetJetPhi(jetIndex)) : -1;
+          
+          // Fill the axes in correct order
+          fillerJet[0] = jetPt;                                                                      // Axis 0 = offline jet pT
+          fillerJet[1] = (matchedJetIndex < 0) ? -1 : fJetReader->GetTriggerObjectPt(iTrigger, matchedJetIndex); // Axis 1 = online jet pT
+          fillerJet[2] = centrality;                                                                 // Axis 2 = centrality
+          fillerJet[3] = iTrigger;                                                                   // Axis 3 = trigger
+          
+          // All the jets from events passing the base trigger are filled, so the weight is that of the bin without trigger selection
+          histograms->FillHistogram(histograms->fhJetTriggerObject, fillerJet, triggerWeight[TriggerHistograms::knTriggerTypes]*GetJetPtWeight<dataType>(jetPt));
         }
+      } // Loop over reconstructed jets
+      
+    } // Loop over triggers
+  } // Trigger object matching
+  
+  // For MC, do another jet loop using generator level jets
+  if(isMonteCarlo){
+    
+    // Generator level jet loop
+    nJets = fJetReader->GetNGeneratorJets();
+    
+    //  ==========================================
+    //  ======== Apply jet kinematic cuts ========
+    //  ==========================================
+    
+    // Keep the reconstructed jet selection for matching
+    std::copy(jetPassMask, jetPassMask+JetSelectionKernel::knMaskWords, recoJetPassMask);
+    
+    // Only eta and pT cuts are applied for generator level jets
+    fFileTimer.Switch(StageTimer::kJetCuts);
+    leadingJetIndex = variation.fJetSelection.SelectJets<false,false>(nJets, fJetReader->GetGeneratorJetPtArray(), fJetReader->GetGeneratorJetPhiArray(), fJetReader->GetGeneratorJetEtaArray(), NULL, NULL, jetPassMask);
+    fFileTimer.Switch(StageTimer::kHistogramFill);
+    
+    // Loop over the generator level jets marked as passing in the mask
+    for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+      passingJets = jetPassMask[iWord];
+      while(passingJets){
+        jetIndex = iWord * 64 + __builtin_ctzll(passingJets);
+        passingJets &= passingJets - 1;
         
-        
-        //  ========================================
-        //  ======= Jet quality cuts applied =======
-        //  ========================================
-        
-        // After the jet pT can been corrected, apply analysis jet pT cuts
-        if(jetPt < fJetMinimumPtCut) continue;
-        if(jetPt > fJetMaximumPtCut) continue;
+        jetPt = fJetReader->GetGeneratorJetPt(jetIndex);
+        jetPhi = fJetReader->GetGeneratorJetPhi(jetIndex);
+        jetEta = fJetReader->GetGeneratorJetEta(jetIndex);
         
         //************************************************
-        //         Fill histograms for all jets
+        //     Fill histograms for generator level jets
         //************************************************
-        
-        // Remember the leading jet
-        if(jetPt > leadingJetPt) {
-          leadingJetPt = jetPt; leadingJetEta = jetEta; leadingJetPhi = jetPhi;
-        }
-        
+      
         // Find the pT weight for the jet
-        jetPtWeight = GetJetPtWeight(jetPt);
-        
+        jetPtWeight = GetJetPtWeight<dataType>(jetPt);
+    
         // Fill the axes in correct order
-        fillerJet[0] = jetPt;          // Axis 0 = jet pT
-        fillerJet[1] = jetPhi;         // Axis 1 = jet phi
-        fillerJet[2] = jetEta;         // Axis 2 = jet eta
+        fillerJet[0] = jetPt;          // Axis 0 = generator level jet pT
+        fillerJet[1] = jetPhi;         // Axis 1 = generator level jet phi
+        fillerJet[2] = jetEta;         // Axis 2 = generator level jet eta
         fillerJet[3] = centrality;     // Axis 3 = centrality
-        fillerJet[4] = TriggerHistograms::kReconstructed;  // Axis 4 = Reconstruction flag
-        fillerJet[5] = TriggerHistograms::knTriggerTypes;  // Axis 5 = Trigger selection
-        
-        fHistograms->fhInclusiveJet->Fill(fillerJet,fTotalEventWeight*jetPtWeight); // Fill the data point to histogram
-        
-        // Apply a trigger selection on top of the base trigger to evaluate the trigger efficiency of the other triggers
-        for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
-          if(triggerSelection[iTrigger]){
-            fillerJet[5] = iTrigger;
-            
-            fHistograms->fhInclusiveJet->Fill(fillerJet,fTotalEventWeight*jetPtWeight*triggerPrescale[iTrigger]); // Fill the data point to histogram
-          }
-        }
+        fillerJet[4] = TriggerHistograms::kGeneratorLevel;   // Axis 4 = Generator level flag
         
-      } // End of jet loop
-      
-      // =============================== //
-      // Fill the leading jet histograms //
-      // =============================== //
-      
-      // Find the pT weight for the jet
-      jetPtWeight = GetJetPtWeight(leadingJetPt);
-      
-      // Fill the axes in correct order
-      fillerJet[0] = leadingJetPt;          // Axis 0 = leading jet pT
-      fillerJet[1] = leadingJetPhi;         // Axis 1 = leading jet phi
-      fillerJet[2] = leadingJetEta;         // Axis 2 = leading jet eta
-      fillerJet[3] = centrality;            // Axis 3 = centrality
-      fillerJet[4] = TriggerHistograms::kReconstructed;  // Axis 4 = Reconstruction flag
-      fillerJet[5] = TriggerHistograms::knTriggerTypes;  // Axis 5 = Trigger selection
-      
-      fHistograms->fhLeadingJet->Fill(fillerJet,fTotalEventWeight*jetPtWeight); // Fill the data point to histogram
-      
-      // Apply a trigger selection on top of the base trigger to evaluate the trigger efficiency of the other triggers
-      for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
-        if(triggerSelection[iTrigger]){
-          fillerJet[5] = iTrigger;
-          
-          fHistograms->fhLeadingJet->Fill(fillerJet,fTotalEventWeight*jetPtWeight*triggerPrescale[iTrigger]); // Fill the data point to histogram
-        }
+        // Axis 5 = Trigger selection. Filled for the bin without trigger selection and for all the triggers that fired on top of the base trigger.
+        histograms->FillJetTriggers(histograms->fhInclusiveJet, fillerJet, triggerMask, triggerWeight, jetPtWeight);
+        if(histograms->fhInclusiveJetBootstrap) histograms->fhInclusiveJetBootstrap->Fill(jetPt, centrality, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight, jetPtWeight, fBootstrapWeights.data());
+        if(histograms->fJetEfficiency) histograms->fJetEfficiency->Fill(EfficiencyAccumulator::kInclusiveJet, jetPt, centrality, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight, jetPtWeight);
+    
       }
+    } // End of jet loop
+    
+    // Find the leading generator level jet among the jets passing the cuts
+    leadingJetPt = 0; leadingJetEta = 0; leadingJetPhi = 0;
+    if(leadingJetIndex >= 0){
+      leadingJetPt = fJetReader->GetGeneratorJetPt(leadingJetIndex);
+      leadingJetEta = fJetReader->GetGeneratorJetEta(leadingJetIndex);
+      leadingJetPhi = fJetReader->GetGeneratorJetPhi(leadingJetIndex);
+    }
+    
+    // =============================================== //
+    // Fill the leading generator level jet histograms //
+    // =============================================== //
+    
+    // Find the pT weight for the jet
+    jetPtWeight = GetJetPtWeight<dataType>(leadingJetPt);
+    
+    // Fill the axes in correct order
+    fillerJet[0] = leadingJetPt;          // Axis 0 = leading generator level jet pT
+    fillerJet[1] = leadingJetPhi;         // Axis 1 = leading generator level jet phi
+    fillerJet[2] = leadingJetEta;         // Axis 2 = leading generator level jet eta
+    fillerJet[3] = centrality;            // Axis 3 = centrality
+    fillerJet[4] = TriggerHistograms::kGeneratorLevel; // Axis 4 = Generator level flag
+    
+    // Axis 5 = Trigger selection. Filled for the bin without trigger selection and for all the triggers that fired on top of the base trigger.
+    histograms->FillJetTriggers(histograms->fhLeadingJet, fillerJet, triggerMask, triggerWeight, jetPtWeight);
+    if(histograms->fhLeadingJetBootstrap) histograms->fhLeadingJetBootstrap->Fill(leadingJetPt, centrality, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight, jetPtWeight, fBootstrapWeights.data());
+    if(histograms->fJetEfficiency) histograms->fJetEfficiency->Fill(EfficiencyAccumulator::kLeadingJet, leadingJetPt, centrality, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight, jetPtWeight);
+    
+    // ================================================================= //
+    // Match reconstructed jets to generator level jets for the response //
+    // ================================================================= //
+    
+    if(histograms->fhJetResponse){
       
-      // For MC, do another jet loop using generator level jets
-      if(fDataType == ForestReader::kPpMC || fDataType == ForestReader::kPbPbMC){
-        
-        // Generator level jet loop
-        nJets = fJetReader->GetNGeneratorJets();
-        leadingJetPt = 0; leadingJetEta = 0; leadingJetPhi = 0;
-        for(Int_t jetIndex = 0; jetIndex < nJets; jetIndex++) {
-          
-          jetPt = fJetReader->GetGeneratorJetPt(jetIndex);
-          jetPhi = fJetReader->GetGeneratorJetPhi(jetIndex);
-          jetEta = fJetReader->GetGeneratorJetEta(jetIndex);
-          
-          //  ==========================================
-          //  ======== Apply jet kinematic cuts ========
-          //  ==========================================
-          
-          if(TMath::Abs(jetEta) >= fJetEtaCut) continue; // Cut for jet eta
-          if(jetPt < fJetMinimumPtCut) continue;
-          if(jetPt > fJetMaximumPtCut) continue;
-          
-          //************************************************
-          //     Fill histograms for generator level jets
-          //************************************************
+      // Sort the generator level jets passing the cuts into the eta-phi grid
+      fJetMatcher.BuildGrid(nJets, fJetReader->GetGeneratorJetEtaArray(), fJetReader->GetGeneratorJetPhiArray(), jetPassMask);
+      
+      // Find the closest generator level jet for each reconstructed jet passing the cuts
+      for(Int_t iWord = 0; iWord < JetSelectionKernel::knMaskWords; iWord++){
+        passingJets = recoJetPassMask[iWord];
+        while(passingJets){
+          jetIndex = iWord * 64 + __builtin_ctzll(passingJets);
+          passingJets &= passingJets - 1;
           
-          // Remember the leading jet
-          if(jetPt > leadingJetPt) {
-            leadingJetPt = jetPt; leadingJetEta = jetEta; leadingJetPhi = jetPhi;
-          }
+          matchedJetIndex = fJetMatcher.FindMatch(fJetReader->GetJetEta(jetIndex), fJetReader->GetJetPhi(jetIndex));
+          if(matchedJetIndex < 0) continue;
           
-          // Find the pT weight for the jet
-          jetPtWeight = GetJetPtWeight(jetPt);
+          // The jet pT weight is defined for generator level jets
+          jetPt = fJetReader->GetGeneratorJetPt(matchedJetIndex);
+          jetPtWeight = GetJetPtWeight<dataType>(jetPt);
           
           // Fill the axes in correct order
-          fillerJet[0] = jetPt;          // Axis 0 = generator level jet pT
-          fillerJet[1] = jetPhi;         // Axis 1 = generator level jet phi
-          fillerJet[2] = jetEta;         // Axis 2 = generator level jet eta
-          fillerJet[3] = centrality;     // Axis 3 = centrality
-          fillerJet[4] = TriggerHistograms::kGeneratorLevel;   // Axis 4 = Generator level flag
-          fillerJet[5] = TriggerHistograms::knTriggerTypes;    // Axis 5 = Trigger selection
+          fillerJet[0] = jetPt;                              // Axis 0 = generator level jet pT
+          fillerJet[1] = fJetReader->GetJetPt(jetIndex);     // Axis 1 = reconstructed jet pT
+          fillerJet[2] = centrality;                         // Axis 2 = centrality
           
-          fHistograms->fhInclusiveJet->Fill(fillerJet,fTotalEventWeight*jetPtWeight); // Fill the data point to histogram
+          // Axis 3 = Trigger selection. Filled for the bin without trigger selection and for all the triggers that fired on top of the base trigger.
+          histograms->FillJetTriggers(histograms->fhJetResponse, fillerJet, triggerMask, triggerWeight, jetPtWeight, 3);
           
-          // Apply a trigger selection on top of the base trigger to evaluate the trigger efficiency of the other triggers
-          for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
-            if(triggerSelection[iTrigger]){
-              fillerJet[5] = iTrigger;
-              
-              fHistograms->fhInclusiveJet->Fill(fillerJet,fTotalEventWeight*jetPtWeight*triggerPrescale[iTrigger]); // Fill the data point to histogram
-            }
-          }
-          
-        } // End of jet loop
-        
-        // =============================================== //
-        // Fill the leading generator level jet histograms //
-        // =============================================== //
-        
-        // Find the pT weight for the jet
-        jetPtWeight = GetJetPtWeight(leadingJetPt);
-        
-        // Fill the axes in correct order
-        fillerJet[0] = leadingJetPt;          // Axis 0 = leading generator level jet pT
-        fillerJet[1] = leadingJetPhi;         // Axis 1 = leading generator level jet phi
-        fillerJet[2] = leadingJetEta;         // Axis 2 = leading generator level jet eta
-        fillerJet[3] = centrality;            // Axis 3 = centrality
-        fillerJet[4] = TriggerHistograms::kGeneratorLevel; // Axis 4 = Generator level flag
-        fillerJet[5] = TriggerHistograms::knTriggerTypes;  // Axis 5 = Trigger selection
-        
-        fHistograms->fhLeadingJet->Fill(fillerJet,fTotalEventWeight*jetPtWeight); // Fill the data point to histogram
-        
-        // Apply a trigger selection on top of the base trigger to evaluate the trigger efficiency of the other triggers
-        for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
-          if(triggerSelection[iTrigger]){
-            fillerJet[5] = iTrigger;
-            
-            fHistograms->fhLeadingJet->Fill(fillerJet,fTotalEventWeight*jetPtWeight*triggerPrescale[iTrigger]); // Fill the data point to histogram
-          }
         }
-        
-      } // MC if
-      
+      } // Loop over reconstructed jets
       
-    } // Event loop
+    } // Jet matching
     
-    //************************************************
-    //      Cleanup at the end of the file loop
-    //************************************************
-    
-    // Close the input files after the event has been read
-    inputFile->Close();
-    
-  } // File loop
+  } // MC if
   
 }
 
-
 /*
  * Get the proper vz weighting depending on analyzed system
  *
  *  Arguments:
  *   const Double_t vz = Vertex z position for the event
+ *   template dataType = Analyzed data type. Known at compile time, so the weight can be inlined, unless kGenericDataType.
  *
  *   return: Multiplicative correction factor for vz
  */
-Double_t TriggerAnalyzer::GetVzWeight(const Double_t vz) const{
-  if(fDataType == ForestReader::kPp || fDataType == ForestReader::kPbPb) return 1;  // No correction for real data
-  if(fDataType == ForestReader::kPbPbMC || fDataType == ForestReader::kPpMC) return fVzWeightFunction->Eval(vz); // Weight for 2018 MC
+template <Int_t dataType> inline Double_t TriggerAnalyzer::GetVzWeight(const Double_t vz) const{
+  const Int_t analyzedDataType = (dataType == kGenericDataType) ? fDataType : dataType;
+  if(analyzedDataType == ForestReader::kPp || analyzedDataType == ForestReader::kPbPb) return 1;  // No correction for real data
+  if(analyzedDataType == ForestReader::kPbPbMC || analyzedDataType == ForestReader::kPpMC) return fWeightProvider.GetVzWeight(vz); // Weight for 2018 MC
   return -1; // Return crazy value for unknown data types, so user will not miss it
 }
 
@@ -607,15 +1438,16 @@ Double_t TriggerAnalyzer::GetVzWeight(const Double_t vz) const{
  *
  *  Arguments:
  *   const Int_t hiBin = CMS hiBin
+ *   template dataType = Analyzed data type. Known at compile time, so the weight can be inlined, unless kGenericDataType.
  *
  *   return: Multiplicative correction factor for the given CMS hiBin
  */
-Double_t TriggerAnalyzer::GetCentralityWeight(const Int_t hiBin) const{
-  if(fDataType != ForestReader::kPbPbMC) return 1;
+template <Int_t dataType> inline Double_t TriggerAnalyzer::GetCentralityWeight(const Int_t hiBin) const{
+  const Int_t analyzedDataType = (dataType == kGenericDataType) ? fDataType : dataType;
+  if(analyzedDataType != ForestReader::kPbPbMC) return 1;
   
-  // No weighting for the most peripheral centrality bins. Different weight function for central and peripheral.
-  if(hiBin < 60) return fCentralityWeightFunctionCentral->Eval(hiBin/2.0);
-  return (hiBin < 194) ? fCentralityWeightFunctionPeripheral->Eval(hiBin/2.0) : 1;
+  // Weights are tabulated for each hiBin in the weight provider
+  return fWeightProvider.GetCentralityWeight(hiBin);
 }
 
 /*
@@ -623,51 +1455,600 @@ Double_t TriggerAnalyzer::GetCentralityWeight(const Int_t hiBin) const{
  *
  *  Arguments:
  *   const Double_t jetPt = Jet pT for the weighted jet
+ *   template dataType = Analyzed data type. Known at compile time, so the weight can be inlined, unless kGenericDataType.
  *
  *   return: Multiplicative correction factor for the jet pT
  */
-Double_t TriggerAnalyzer::GetJetPtWeight(const Double_t jetPt) const{
-  if(fDataType == ForestReader::kPbPb || fDataType == ForestReader::kPp) return 1.0;  // No weight for data
+template <Int_t dataType> inline Double_t TriggerAnalyzer::GetJetPtWeight(const Double_t jetPt) const{
+  const Int_t analyzedDataType = (dataType == kGenericDataType) ? fDataType : dataType;
+  if(analyzedDataType == ForestReader::kPbPb || analyzedDataType == ForestReader::kPp) return 1.0;  // No weight for data
   
-  return fPtWeightFunction->Eval(jetPt);
+  return fWeightProvider.GetJetPtWeight(jetPt);
 }
 
 /*
- * Check if the event passes all the track cuts
+ * Get the pT hat weight for the event. If stitching weights are given, the weight of the pT hat bin is used.
+ * Otherwise the weight is read from the forest.
+ *
+ *  Arguments:
+ *   const Double_t ptHat = pT hat of the event
+ *
+ *   return: Weight for the event
+ */
+Double_t TriggerAnalyzer::GetPtHatWeight(const Double_t ptHat) const{
+  if(fPtHatStitchingWeights.empty()) return fJetReader->GetEventWeight();
+  const Int_t ptHatBin = std::upper_bound(fPtHatStitchingEdges.begin(), fPtHatStitchingEdges.end(), ptHat) - fPtHatStitchingEdges.begin() - 1;
+  if(ptHatBin < 0) return 0;
+  return fPtHatStitchingWeights[ptHatBin];
+}
+
+/*
+ * Find how far the event gets in the event cut flow before the base trigger requirement. The base trigger and the
+ * vz cut can be different for each cut variation, so they are applied separately for each variation.
  *
  *  Arguments:
  *   ForestReader *eventReader = ForestReader containing the event information checked for event cuts
  *
- *   return = True if all event cuts are passed, false otherwise
+ *   return = Last passed stage in the cut flow. Stage kBeamScraping means that all the event filters are passed.
  */
-Bool_t TriggerAnalyzer::PassEventCuts(ForestReader *eventReader){
+Int_t TriggerAnalyzer::GetEventFilterStage(ForestReader *eventReader) const{
 
   // Primary vertex has at least two tracks, is within 25 cm in z-rirection and within 2 cm in xy-direction. Only applied for data.
-  if(eventReader->GetPrimaryVertexFilterBit() == 0) return false;
-  fHistograms->fhEvents->Fill(TriggerHistograms::kPrimaryVertex);
+  if(eventReader->GetPrimaryVertexFilterBit() == 0) return TriggerHistograms::kAll;
   
   // Have at least two HF towers on each side of the detector with an energy deposit of 4 GeV. Only applied for PbPb data.
-  if(eventReader->GetHfCoincidenceFilterBit() == 0) return false;
-  fHistograms->fhEvents->Fill(TriggerHistograms::kHfCoincidence);
+  if(eventReader->GetHfCoincidenceFilterBit() == 0) return TriggerHistograms::kPrimaryVertex;
   
   // Calculated from pixel clusters. Ensures that measured and predicted primary vertices are compatible. Only applied for PbPb data.
-  if(eventReader->GetClusterCompatibilityFilterBit() == 0) return false;
-  fHistograms->fhEvents->Fill(TriggerHistograms::kClusterCompatibility);
+  if(eventReader->GetClusterCompatibilityFilterBit() == 0) return TriggerHistograms::kHfCoincidence;
   
   // Cut for beam scraping. Only applied for pp data.
-  if(eventReader->GetBeamScrapingFilterBit() == 0) return false;
-  fHistograms->fhEvents->Fill(TriggerHistograms::kBeamScraping);
+  if(eventReader->GetBeamScrapingFilterBit() == 0) return TriggerHistograms::kClusterCompatibility;
+  
+  return TriggerHistograms::kBeamScraping;
   
-  // Jet trigger requirement.
-  if(eventReader->GetBaseJetFilterBit() == 0) return false;
-  fHistograms->fhEvents->Fill(TriggerHistograms::kCaloJet);
+}
+
+/*
+ * Evaluate the event cuts in the adaptive order and find the last passed stage of the cut flow. The result of each
+ * evaluated cut is set to a bit mask, and the stage is the first cut that is not passed in the order of the cut flow.
+ * After a cut has failed, the cuts after it in the cut flow do not change the stage, so they are skipped together with
+ * the trees read only for them. The cuts before it still need to be evaluated, which keeps the cut flow identical to
+ * the fixed order. The base trigger and vz cuts are checked for the loosest cut variation, so they only tell if any
+ * variation can accept the event.
+ *
+ * During the warm-up, all the cuts are evaluated and all the trees read, so that the rejection of each cut and the
+ * time used to read each tree are measured. After the warm-up, the cuts are ordered by the measured rejection per cost.
+ *
+ *  Arguments:
+ *   const Int_t iEvent = Index of the event in the forest. The heavy ion tree must already be read.
+ *   const Double_t vz = Vertex z-position of the event
+ *
+ *   return = Last passed stage in the cut flow. Stage kVzCut means that the event passes for the loosest cut variation.
+ */
+Int_t TriggerAnalyzer::EvaluateEventCuts(const Int_t iEvent, const Double_t vz){
   
-  // Cut for vertex z-position
-  if(TMath::Abs(eventReader->GetVz()) > fVzCut) return false;
-  fHistograms->fhEvents->Fill(TriggerHistograms::kVzCut);
+  const Bool_t isWarmUp = (fnEventCutMeasuredEvents < fnEventCutWarmUpEvents);
   
-  return true;
+  UInt_t treeReadMask = 1u << ForestReader::kHeavyIonTree;
+  UInt_t passedCutMask = 0;
+  Int_t firstFailedCut = knEventCuts;
+  Int_t eventCut, tree;
+  chrono::steady_clock::time_point startTime;
+  for(Int_t iCut = 0; iCut < knEventCuts; iCut++){
+    eventCut = fEventCutOrder[iCut];
+    if(eventCut > firstFailedCut && !isWarmUp) continue;
+    
+    // Read the tree needed for the cut if it is not read yet
+    tree = kEventCutTree[eventCut];
+    if(!(treeReadMask & (1u << tree))){
+      StageTimer::Scope readScope(&fFileTimer, StageTimer::kReadHeavyIonTree + tree);
+      if(isWarmUp) startTime = chrono::steady_clock::now();
+      fJetReader->GetEventFromTree(tree, iEvent);
+      if(isWarmUp) fTreeReadTime[tree] += chrono::duration<Double_t>(chrono::steady_clock::now() - startTime).count();
+      treeReadMask |= 1u << tree;
+    }
+    
+    if(PassEventCut(eventCut, vz)){
+      passedCutMask |= 1u << eventCut;
+    } else if(eventCut < firstFailedCut){
+      firstFailedCut = eventCut;
+    }
+  }
+  
+  // Count the rejections in the warm-up, and order the cuts when the warm-up is done
+  if(isWarmUp){
+    for(Int_t iCut = 0; iCut < knEventCuts; iCut++){
+      if(!(passedCutMask & (1u << iCut))) fEventCutRejections[iCut]++;
+    }
+    fnEventCutMeasuredEvents++;
+    if(fnEventCutMeasuredEvents == fnEventCutWarmUpEvents) OrderEventCuts();
+  }
+  
+  // The first unset bit in the mask is the first failed cut in the order of the cut flow
+  return TriggerHistograms::kAll + __builtin_ctz(~passedCutMask);
+}
+
+/*
+ * Check if the current event passes one of the event cuts
+ *
+ *  Arguments:
+ *   const Int_t iCut = Index of the event cut in enumEventCuts
+ *   const Double_t vz = Vertex z-position of the event
+ *
+ *   return = True if the event passes the cut
+ */
+Bool_t TriggerAnalyzer::PassEventCut(const Int_t iCut, const Double_t vz) const{
+  
+  switch(iCut){
+    case kPrimaryVertexCut:
+      return fJetReader->GetPrimaryVertexFilterBit() != 0;
+    case kHfCoincidenceCut:
+      return fJetReader->GetHfCoincidenceFilterBit() != 0;
+    case kClusterCompatibilityCut:
+      return fJetReader->GetClusterCompatibilityFilterBit() != 0;
+    case kBeamScrapingCut:
+      return fJetReader->GetBeamScrapingFilterBit() != 0;
+    case kBaseTriggerCut:
+      for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+        if((fBaseTriggerMask & (1u << iTrigger)) && fJetReader->GetJetFilterBit(iTrigger)) return true;
+      }
+      return false;
+    case kVertexZCut:
+      return TMath::Abs(vz) <= fLooseVzCut;
+    default:
+      cout << "Error! Unknown event cut index " << iCut << endl;
+      assert(0);
+  }
+  
+  return false;
+}
+
+/*
+ * Order the event cuts by the rejection per cost measured in the warm-up. The cost of a cut is the average time used
+ * to read its tree, so the cuts that reject most events with the least reading are evaluated first. The heavy ion tree
+ * is always read, so the vz cut is practically free.
+ */
+void TriggerAnalyzer::OrderEventCuts(){
+  
+  // A small cost is used for the cuts from the heavy ion tree to avoid dividing by zero
+  const Double_t minimumCost = 1e-9;
+  Double_t rejectionPerCost[knEventCuts];
+  Double_t cost;
+  for(Int_t iCut = 0; iCut < knEventCuts; iCut++){
+    cost = fTreeReadTime[kEventCutTree[iCut]] / fnEventCutMeasuredEvents;
+    rejectionPerCost[iCut] = fEventCutRejections[iCut] / fnEventCutMeasuredEvents / TMath::Max(cost, minimumCost);
+  }
+  
+  // Cuts with equal rejection per cost stay in the order of the cut flow
+  std::stable_sort(fEventCutOrder.begin(), fEventCutOrder.end(), [&rejectionPerCost](Int_t firstCut, Int_t secondCut){
+    return rejectionPerCost[firstCut] > rejectionPerCost[secondCut];
+  });
+  
+  if(fDebugLevel > 0){
+    cout << "Event cut order after " << fnEventCutMeasuredEvents << " warm-up events:";
+    for(Int_t iCut = 0; iCut < knEventCuts; iCut++){
+      cout << " " << fEventCutOrder[iCut] << " (rejection " << fEventCutRejections[fEventCutOrder[iCut]] / fnEventCutMeasuredEvents << ")";
+    }
+    cout << endl;
+  }
+  
+}
+
+/*
+ * Write the histograms to the current directory. The histograms for the additional base triggers are written
+ * to directories named after the trigger, and the histograms for the cut variations to subdirectories named
+ * after the variations.
+ */
+void TriggerAnalyzer::WriteHistograms() const{
+  
+  // The time for writing is added to a copy of the total timing, which is written after the histograms
+  StageTimer writeTimer = fTotalTimer;
+  writeTimer.Switch(StageTimer::kOutputWrite);
+  
+  std::vector<TriggerHistograms*> histograms;
+  for(const CutVariation &variation : fCutVariations) histograms.push_back(variation.fHistograms);
+  WriteVariationHistograms(histograms);
+  WriteAnalysisModules(fAnalysisModules);
+  
+  // The timing report goes to the main directory next to the card
+  writeTimer.Switch(StageTimer::kNoStage);
+  writeTimer.Write("timing");
+  
+}
+
+/*
+ * Write the histograms of the cut variations to the current directory. The histograms for the additional base triggers
+ * are written to directories named after the trigger, and the histograms for the cut variations to subdirectories
+ * named after the variations.
+ *
+ *  Arguments:
+ *   const std::vector<TriggerHistograms*> &histograms = Histograms for each cut variation in the order of fCutVariations
+ *   Bool_t onlySparse = True: Write only the sparse jet histograms. False: Write all the histograms.
+ */
+void TriggerAnalyzer::WriteVariationHistograms(const std::vector<TriggerHistograms*> &histograms, Bool_t onlySparse) const{
+  
+  TDirectory *outputDirectory = gDirectory;
+  TDirectory *baseTriggerDirectory;
+  TDirectory *variationDirectory;
+  
+  for(UInt_t iVariation = 0; iVariation < fCutVariations.size(); iVariation++){
+    const CutVariation &variation = fCutVariations.at(iVariation);
+    
+    // Find the directory for the base trigger
+    baseTriggerDirectory = outputDirectory;
+    if(variation.fBaseTriggerName != ""){
+      baseTriggerDirectory = outputDirectory->GetDirectory(variation.fBaseTriggerName);
+      if(!baseTriggerDirectory) baseTriggerDirectory = outputDirectory->mkdir(variation.fBaseTriggerName);
+    }
+    
+    // Find the directory for the cut variation
+    variationDirectory = baseTriggerDirectory;
+    if(variation.fName != "") variationDirectory = baseTriggerDirectory->mkdir(variation.fName);
+    
+    variationDirectory->cd();
+    if(onlySparse){
+      histograms.at(iVariation)->WriteSparse();
+    } else {
+      histograms.at(iVariation)->Write();
+    }
+    
+  }
+  
+  outputDirectory->cd();
+  
+}
+
+/*
+ * Create the analysis modules given in the card
+ *
+ *   return: New modules in the order of the card. The caller owns them.
+ */
+std::vector<AnalysisModule*> TriggerAnalyzer::CreateAnalysisModules() const{
+  std::vector<AnalysisModule*> modules;
+  for(const TString &moduleName : fAnalysisModuleNames) modules.push_back(AnalysisModule::Create(moduleName, fCard));
+  return modules;
+}
+
+/*
+ * Write the histograms of the analysis modules to the current directory. Each module gets a directory named after it.
+ *
+ *  Arguments:
+ *   const std::vector<AnalysisModule*> &modules = Analysis modules in the order of the card
+ */
+void TriggerAnalyzer::WriteAnalysisModules(const std::vector<AnalysisModule*> &modules) const{
+  TDirectory *outputDirectory = gDirectory;
+  for(const AnalysisModule *module : modules){
+    outputDirectory->mkdir(module->GetName())->cd();
+    module->Write();
+  }
+  outputDirectory->cd();
+}
+
+/*
+ * Write the sparse histograms of all the cut variations to a spill file and empty them, if their memory exceeds the
+ * share of this worker from the budget. The dense bins and accumulators are not reduced by spilling, so their memory
+ * is taken from the share first. The spill files are merged with the rest of the output in the end. The axes driving
+ * the memory growth are reported on the first spill of each worker.
+ *
+ *  Arguments:
+ *   Int_t iWorker = Index of the worker, used in the spill file name
+ */
+void TriggerAnalyzer::SpillHistogramsOverBudget(Int_t iWorker){
+  
+  const Double_t megaByte = 1024*1024;
+  Double_t histogramMemory = 0;
+  Double_t fixedMemory = 0;
+  for(const CutVariation &variation : fCutVariations){
+    histogramMemory += variation.fHistograms->GetSparseMemory();
+    fixedMemory += variation.fHistograms->GetFixedMemory();
+  }
+  if(histogramMemory < fHistogramMemoryBudget*megaByte/fNumberOfThreads - fixedMemory) return;
+  
+  std::vector<TriggerHistograms*> histograms;
+  for(const CutVariation &variation : fCutVariations) histograms.push_back(variation.fHistograms);
+  
+  TDirectory *currentDirectory = gDirectory;
+  const TString spillFileName = Form("%s%d_%d.root", fSpillFileBaseName.Data(), iWorker, (Int_t)fSpillFileNames.size());
+  TFile *spillFile = new TFile(spillFileName, "RECREATE");
+  WriteVariationHistograms(histograms, true);
+  spillFile->Close();
+  delete spillFile;
+  currentDirectory->cd();
+  fSpillFileNames.push_back(spillFileName);
+  
+  cout << Form("Worker %d spilled %.1f MB of sparse histograms to %s", iWorker, histogramMemory/megaByte, spillFileName.Data()) << endl;
+  if(fSpillFileNames.size() == 1 || fDebugLevel > 1) fCutVariations.front().fHistograms->PrintSparseGrowth();
+  
+  for(TriggerHistograms *variationHistograms : histograms) variationHistograms->ResetSparse();
+}
+
+/*
+ * Write a checkpoint with the histograms merged from all the workers and the list of units they have completed.
+ * Each worker is paused only while its histograms are added, so the others keep processing. The checkpoint is first
+ * written to a temporary file, which is renamed when complete, so that the previous checkpoint stays valid until then.
+ *
+ *  Arguments:
+ *   const std::vector<TriggerAnalyzer*> &workers = Analyzers of all the workers
+ */
+void TriggerAnalyzer::WriteCheckpoint(const std::vector<TriggerAnalyzer*> &workers){
+  
+  // Only one worker writes the checkpoint
+  if(!fCheckpoint->TryBeginWrite()) return;
+  
+  // Histograms to which the histograms of all the workers are merged. The other workers create histograms at the same
+  // time, so the global TH1::AddDirectory flag is not changed. Instead, the current directory, which is separate for
+  // each thread, is set to none while the histograms are created, so that they are not added to any directory.
+  std::vector<TriggerHistograms*> checkpointHistograms;
+  std::vector<AnalysisModule*> checkpointModules;
+  {
+    TDirectory::TContext detachedContext(nullptr);
+    for(UInt_t iVariation = 0; iVariation < fCutVariations.size(); iVariation++){
+      checkpointHistograms.push_back(new TriggerHistograms(fCard));
+      checkpointHistograms.back()->CreateHistograms();
+    }
+    checkpointModules = CreateAnalysisModules();
+  }
+  
+  // The histograms and the completed units of each worker are read while holding the lock of the worker
+  std::vector<AnalysisTask> completedUnits;
+  for(UInt_t iWorker = 0; iWorker < workers.size(); iWorker++){
+    std::lock_guard<std::mutex> workerLock(fCheckpoint->GetWorkerMutex(iWorker));
+    for(UInt_t iVariation = 0; iVariation < fCutVariations.size(); iVariation++){
+      checkpointHistograms.at(iVariation)->Merge(workers.at(iWorker)->fCutVariations.at(iVariation).fHistograms);
+    }
+    for(UInt_t iModule = 0; iModule < checkpointModules.size(); iModule++){
+      checkpointModules.at(iModule)->Merge(workers.at(iWorker)->fAnalysisModules.at(iModule));
+    }
+    const std::vector<AnalysisTask> &workerUnits = fCheckpoint->GetWorkerUnits(iWorker);
+    completedUnits.insert(completedUnits.end(), workerUnits.begin(), workerUnits.end());
+  }
+  
+  // Write everything to a temporary file and replace the previous checkpoint with it
+  TDirectory *currentDirectory = gDirectory;
+  const TString checkpointFileName = fCheckpoint->GetFileName();
+  const TString temporaryFileName = checkpointFileName + ".tmp";
+  TFile *checkpointFile = new TFile(temporaryFileName, "RECREATE");
+  WriteVariationHistograms(checkpointHistograms);
+  WriteAnalysisModules(checkpointModules);
+  fCheckpoint->WriteUnits(completedUnits);
+  checkpointFile->Close();
+  delete checkpointFile;
+  currentDirectory->cd();
+  
+  if(gSystem->Rename(temporaryFileName, checkpointFileName) != 0){
+    cout << "Warning! Could not rename " << temporaryFileName.Data() << " to " << checkpointFileName.Data() << ". The previous checkpoint is kept." << endl;
+  } else if(fDebugLevel > 0){
+    cout << "Wrote checkpoint " << checkpointFileName.Data() << " with " << completedUnits.size() << " completed units" << endl;
+  }
+  
+  for(TriggerHistograms *histograms : checkpointHistograms) delete histograms;
+  for(AnalysisModule *module : checkpointModules) delete module;
+  fCheckpoint->FinishWrite();
+}
+
+/*
+ * Check if a range of entries in a file was completed in the previous runs. The units from the previous runs do not
+ * overlap, so the range is completed if the units cover all of its entries.
+ *
+ *  Arguments:
+ *   Int_t iFile = Index of the file in the file list
+ *   Long64_t firstEntry = First entry of the range
+ *   Long64_t lastEntry = One past the last entry of the range
+ *
+ *   return: True if all the entries in the range were completed in the previous runs
+ */
+Bool_t TriggerAnalyzer::IsPreviouslyCompleted(Int_t iFile, Long64_t firstEntry, Long64_t lastEntry) const{
+  if(fPreviousUnits.empty()) return false;
+  
+  Long64_t nCompletedEntries = 0;
+  for(const AnalysisTask &unit : fPreviousUnits.at(iFile)){
+    nCompletedEntries += TMath::Max(0LL, TMath::Min(unit.fLastEntry, lastEntry) - TMath::Max(unit.fFirstEntry, firstEntry));
+  }
+  return nCompletedEntries == lastEntry - firstEntry;
+}
+
+/*
+ * Write checkpoints to the given file during the analysis. How often they are written is given in the card with the
+ * keys CheckpointFiles and CheckpointMinutes.
+ */
+void TriggerAnalyzer::SetCheckpointFile(TString fileName){
+  fCheckpointFileName = fileName;
+}
+
+/*
+ * Skip the units completed in the previous runs, as read from their checkpoints
+ *
+ *  Arguments:
+ *   const std::vector<AnalysisTask> &units = Units completed in the previous runs
+ *   const std::vector<Long64_t> &fileEntries = Number of entries in each input file. Negative if not known.
+ */
+void TriggerAnalyzer::SetPreviousUnits(const std::vector<AnalysisTask> &units, const std::vector<Long64_t> &fileEntries){
+  fPreviousUnits.assign(fFileNames.size(), std::vector<AnalysisTask>());
+  for(const AnalysisTask &unit : units) fPreviousUnits.at(unit.fFileIndex).push_back(unit);
+  fPreviousFileEntries = fileEntries;
+}
+
+/*
+ * Stop the analysis cleanly when the runtime budget runs out or the batch system asks for it. The budget is shared by
+ * all the workers and is not owned by the analyzer.
+ */
+void TriggerAnalyzer::SetRuntimeBudget(RuntimeBudget *budget){
+  fRuntimeBudget = budget;
+}
+
+/*
+ * Units of entries that were not processed because the analysis was stopped, in the order of the file list. A negative
+ * last entry means the end of the file.
+ */
+std::vector<AnalysisTask> TriggerAnalyzer::GetUnprocessedUnits() const{
+  return fUnprocessedUnits;
+}
+
+/*
+ * Beginning of the names of the files to which the sparse histograms are spilled when they exceed the memory budget.
+ * The index of the worker and the spill are added to the name.
+ */
+void TriggerAnalyzer::SetSpillFileBase(TString baseName){
+  fSpillFileBaseName = baseName;
+}
+
+/*
+ * Use the event loop that checks the data type at run time instead of the loop specialized for it at compile time.
+ * The output is the same, so this is only needed to measure the speedup of the specialization.
+ */
+void TriggerAnalyzer::SetGenericEventLoop(Bool_t useGeneric){
+  fGenericEventLoop = useGeneric;
+  SelectEventLoop();
+}
+
+/*
+ * Files to which the sparse histograms were spilled during the analysis. They need to be merged with the histograms
+ * written in the end.
+ */
+std::vector<TString> TriggerAnalyzer::GetSpillFileNames() const{
+  return fSpillFileNames;
+}
+
+/*
+ * Use the given weights for the pT hat bins instead of the weight from the forest. The bins are read from the card
+ * with the key PtHatBinEdges. The weights should be calculated with CalculatePtHatStitchingWeights from the full file
+ * list, so that all the workers and processes use the same weights.
+ *
+ *  Arguments:
+ *   const std::vector<Double_t> &weights = Weight for each pT hat bin
+ */
+void TriggerAnalyzer::SetPtHatStitchingWeights(const std::vector<Double_t> &weights){
+  
+  fPtHatStitchingEdges.clear();
+  for(Int_t iEdge = 0; iEdge < fCard->GetN("PtHatBinEdges"); iEdge++){
+    fPtHatStitchingEdges.push_back(fCard->Get("PtHatBinEdges",iEdge));
+  }
+  
+  if(weights.size() != fPtHatStitchingEdges.size()){
+    cout << "Error! There must be one pT hat stitching weight for each edge in PtHatBinEdges" << endl;
+    assert(0);
+  }
+  fPtHatStitchingWeights = weights;
+  
+}
+
+/*
+ * Calculate the weights for stitching together MC samples generated in pT hat bins
+ *
+ * The file list can contain several samples, each generated with pT hat above one of the edges in PtHatBinEdges.
+ * The cross section of each sample is given in the card with the key PtHatCrossSections. The cross section of a bin
+ * is the difference between the cross sections of the samples starting from its lower and upper edges, and the weight
+ * in the bin is its cross section divided by the number of events in it from all the samples. The last bin has no
+ * upper edge.
+ *
+ * The number of events in each pT hat bin must be counted from the full samples, not only from the files of one job.
+ * The counts are read from the card with the key PtHatEventCounts. If they are not given, the pT hat branch is read
+ * in a fast pre-pass from the files in the list, and the counts are printed in the card format with a warning.
+ *
+ *  Arguments:
+ *   const std::vector<TString> &fileNameVector = Files from which the events are counted if there are no counts in the card
+ *   ConfigurationCard *card = Card with the pT hat bins and the cross sections
+ *
+ *   return: Weight for each pT hat bin
+ */
+std::vector<Double_t> TriggerAnalyzer::CalculatePtHatStitchingWeights(const std::vector<TString> &fileNameVector, ConfigurationCard *card){
+  
+  // Stitching is only meaningful for MC
+  const Int_t dataType = card->Get("DataType");
+  if(dataType != ForestReader::kPpMC && dataType != ForestReader::kPbPbMC){
+    cout << "Error! pT hat stitching can only be used for MC" << endl;
+    assert(0);
+  }
+  
+  // Read the pT hat bins and the cross sections from the card
+  const Int_t nPtHatBins = card->GetN("PtHatBinEdges");
+  if(card->GetN("PtHatCrossSections") != nPtHatBins){
+    cout << "Error! PtHatCrossSections must give a cross section for each edge in PtHatBinEdges" << endl;
+    assert(0);
+  }
+  std::vector<Double_t> ptHatEdges, crossSections;
+  for(Int_t iBin = 0; iBin < nPtHatBins; iBin++){
+    ptHatEdges.push_back(card->Get("PtHatBinEdges",iBin));
+    crossSections.push_back(card->Get("PtHatCrossSections",iBin));
+  }
+  
+  // Read the event counts from the card if they are given
+  std::vector<Long64_t> nEvents(nPtHatBins, 0);
+  const Bool_t countsFromCard = (card->GetStr("PtHatEventCounts") != "");
+  if(countsFromCard){
+    if(card->GetN("PtHatEventCounts") != nPtHatBins){
+      cout << "Error! PtHatEventCounts must give the number of events for each edge in PtHatBinEdges" << endl;
+      assert(0);
+    }
+    for(Int_t iBin = 0; iBin < nPtHatBins; iBin++){
+      nEvents[iBin] = TMath::Nint(card->Get("PtHatEventCounts",iBin));
+    }
+  }
+
+  // Otherwise count the events in each pT hat bin reading only the pT hat branch
+  Long64_t nEventsBelow = 0;
+  TFile *inputFile;
+  TTree *heavyIonTree;
+  Float_t ptHat = 0;
+  Int_t ptHatBin;
+  if(!countsFromCard){
+    for(const TString &fileName : fileNameVector){
+      inputFile = TFile::Open(fileName);
+      if(!inputFile || inputFile->IsZombie()){
+        cout << "Error! Could not open the file for pT hat counting: " << fileName.Data() << endl;
+        assert(0);
+      }
+      heavyIonTree = (TTree*)inputFile->Get("hiEvtAnalyzer/HiTree");
+      if(!heavyIonTree){
+        cout << "Error! No heavy ion tree for pT hat counting in the file: " << fileName.Data() << endl;
+        assert(0);
+      }
+      heavyIonTree->SetBranchStatus("*",0);
+      heavyIonTree->SetBranchStatus("pthat",1);
+      heavyIonTree->SetBranchAddress("pthat",&ptHat);
+      for(Long64_t iEvent = 0; iEvent < heavyIonTree->GetEntries(); iEvent++){
+        heavyIonTree->GetEntry(iEvent);
+        ptHatBin = std::upper_bound(ptHatEdges.begin(), ptHatEdges.end(), ptHat) - ptHatEdges.begin() - 1;
+        if(ptHatBin < 0){
+          nEventsBelow++;
+        } else {
+          nEvents[ptHatBin]++;
+        }
+      }
+      inputFile->Close();
+      delete inputFile;
+    }
+
+    // The counts from the file list of one job are only correct if the job analyzes the full samples
+    cout << "Warning! The pT hat stitching weights use the events counted from the file list of this job. If the samples are split into several jobs, give the counts for the full samples in the card:" << endl;
+    cout << "PtHatEventCounts";
+    for(Int_t iBin = 0; iBin < nPtHatBins; iBin++) cout << " " << nEvents[iBin];
+    cout << endl;
+  }
+
+  // Calculate the weights from the cross sections and event counts
+  std::vector<Double_t> weights(nPtHatBins, 0);
+  Double_t binCrossSection;
+  for(Int_t iBin = 0; iBin < nPtHatBins; iBin++){
+    binCrossSection = crossSections[iBin] - ((iBin+1 < nPtHatBins) ? crossSections[iBin+1] : 0);
+    if(binCrossSection < 0){
+      cout << "Error! PtHatCrossSections must not increase with the pT hat" << endl;
+      assert(0);
+    }
+    if(nEvents[iBin] > 0) weights[iBin] = binCrossSection / nEvents[iBin];
+  }
+  
+  // Print the weights
+  if(card->Get("DebugLevel") > 0){
+    cout << "pT hat stitching weights:" << endl;
+    for(Int_t iBin = 0; iBin < nPtHatBins; iBin++){
+      cout << "  pT hat > " << ptHatEdges[iBin] << ": " << nEvents[iBin] << " events, weight " << weights[iBin] << endl;
+    }
+    if(nEventsBelow > 0) cout << "  " << nEventsBelow << " events below the lowest pT hat edge get zero weight" << endl;
+  }
   
+  return weights;
 }
 
 /*
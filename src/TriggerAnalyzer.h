@@ -10,6 +10,7 @@
 #include <tuple>      // For returning several arguments in a transparent manner
 #include <fstream>
 #include <string>
+#include <chrono>
 
 // Root includes
 #include <TString.h>
@@ -20,11 +21,46 @@
 #include "ConfigurationCard.h"
 #include "TriggerHistograms.h"
 #include "ForestReader.h"
+#include "WorkStealingScheduler.h"
+#include "JetSelectionKernel.h"
+#include "WeightProvider.h"
+#include "BootstrapHistogram.h"
+#include "EfficiencyAccumulator.h"
+#include "JetMatcher.h"
+#include "RunAccumulator.h"
+#include "StageTimer.h"
+#include "ProgressMonitor.h"
+#include "AnalysisCheckpoint.h"
+#include "RuntimeBudget.h"
+#include "AnalysisModule.h"
+
+/*
+ * Set of cuts varied for systematic uncertainty studies together with the base trigger used for the efficiency.
+ * Each combination of base trigger and cut variation has its own histograms, so all of them can be filled from
+ * one pass over the input files.
+ */
+struct CutVariation{
+  TString fName;                        // Name of the variation. Histograms are written to a directory with this name.
+  TString fBaseTriggerName;             // Name of the base trigger directory. Empty for the first base trigger.
+  Int_t fBaseTrigger;                   // Trigger index used as base trigger for efficiency study
+  Double_t fJetEtaCut;                  // Eta cut around midrapidity
+  Double_t fMinimumMaxTrackPtFraction;  // Cut for jets consisting only from soft particles
+  Double_t fMaximumMaxTrackPtFraction;  // Cut for jets consisting only from one high pT
+  Double_t fVzCut;                      // Cut for vertez z-position in an event
+  Bool_t fCutBadPhiRegion;              // Cut the phi region with bad tracker performance from the analysis
+  JetSelectionKernel fJetSelection;     // Kernel evaluating the jet cuts of this variation
+  TriggerHistograms *fHistograms;       // Histograms filled for this variation
+};
 
 class TriggerAnalyzer{
   
 public:
   
+  // Event cuts in the order of the cut flow. Passing cut i takes the event to the stage i+1 of the event histogram.
+  enum enumEventCuts{kPrimaryVertexCut, kHfCoincidenceCut, kClusterCompatibilityCut, kBeamScrapingCut, kBaseTriggerCut, kVertexZCut, knEventCuts};
+  static const Int_t kEventCutTree[knEventCuts]; // Forest tree from which each event cut is read
+  static const Int_t kGenericDataType = -1;      // Data type template argument for the event loop checking the data type at run time
+  
   // Constructors and destructor
   TriggerAnalyzer(); // Default constructor
   TriggerAnalyzer(std::vector<TString> fileNameVector, ConfigurationCard *newCard); // Custom constructor
@@ -35,38 +71,118 @@ public:
   // Methods
   void RunAnalysis();                     // Run the dijet analysis
   TriggerHistograms* GetHistograms() const;   // Getter for histograms
+  void WriteHistograms() const;           // Write the histograms for all base triggers and cut variations to the current directory
+  void SetPtHatStitchingWeights(const std::vector<Double_t> &weights); // Use the given weights for the pT hat bins instead of the forest weight
+  void SetCheckpointFile(TString fileName); // Write checkpoints to the given file during the analysis
+  void SetPreviousUnits(const std::vector<AnalysisTask> &units, const std::vector<Long64_t> &fileEntries); // Skip the units completed in the previous runs
+  void SetRuntimeBudget(RuntimeBudget *budget); // Stop cleanly when the runtime budget runs out or a stop signal is received
+  std::vector<AnalysisTask> GetUnprocessedUnits() const; // Units left unprocessed after a stop
+  void SetSpillFileBase(TString baseName); // Beginning of the names of the files to which the histograms are spilled
+  void SetGenericEventLoop(Bool_t useGeneric); // Check the data type at run time instead of using the specialized event loop. For benchmarks.
+  std::vector<TString> GetSpillFileNames() const; // Files to which the histograms were spilled during the analysis
+  
+  static std::vector<Double_t> CalculatePtHatStitchingWeights(const std::vector<TString> &fileNameVector, ConfigurationCard *card); // Count the events in pT hat bins and calculate the stitching weights
   
 private:
   
   // Private methods
   void ReadConfigurationFromCard(); // Read all the configuration from the input card
+  void CreateCutVariations();       // Create the histograms and jet selections for the cut variations
   
-  Bool_t PassEventCuts(ForestReader *eventReader); // Check if the event passes the event cuts
-  Double_t GetVzWeight(const Double_t vz) const;  // Get the proper vz weighting depending on analyzed system
-  Double_t GetCentralityWeight(const Int_t hiBin) const; // Get the proper centrality weighting depending on analyzed system
-  Double_t GetJetPtWeight(const Double_t jetPt) const; // Get the proper jet pT weighting for 2017 and 2018 MC
+  void ProcessTask(const AnalysisTask& task, Int_t iWorker, WorkStealingScheduler *scheduler); // Process one task given by the scheduler
+  void ProcessEntryRange(Long64_t firstEntry, Long64_t lastEntry); // Run the event loop over a range of entries in the current file
+  void SelectEventLoop();           // Select the event loop specialized for the analyzed data type
+  template <Int_t dataType> void EventLoop(Long64_t firstEntry, Long64_t lastEntry); // Event loop specialized for data type
+  template <Int_t dataType, Bool_t cutBadPhi> void FillJetHistograms(const CutVariation &variation, const Double_t centrality, const UInt_t triggerMask, const Double_t *triggerWeight); // Fill the jet histograms for one cut variation
+  void OpenInputFile(Int_t iFile);  // Open the i:th file from the file list and read the forest from it
+  void CloseInputFile();            // Close the currently open input file
+  void ReportProgress(const Long64_t nEvents, const Long64_t nAcceptedEvents); // Add a batch of processed events to the progress monitor
+  void AddUnprocessedUnit(const AnalysisTask& task); // Record a task that is not processed because of a stop
+  Bool_t IsPreviouslyCompleted(Int_t iFile, Long64_t firstEntry, Long64_t lastEntry) const; // Check if a range of entries was completed in the previous runs
+  void WriteCheckpoint(const std::vector<TriggerAnalyzer*> &workers); // Write the merged histograms of the workers and the completed units to the checkpoint file
+  void WriteVariationHistograms(const std::vector<TriggerHistograms*> &histograms, Bool_t onlySparse = false) const; // Write the histograms of the cut variations to the current directory
+  std::vector<AnalysisModule*> CreateAnalysisModules() const; // Create the analysis modules given in the card
+  void WriteAnalysisModules(const std::vector<AnalysisModule*> &modules) const; // Write the histograms of the analysis modules to the current directory
+  void SpillHistogramsOverBudget(Int_t iWorker); // Write the sparse histograms to a spill file and empty them if their memory exceeds the budget
+  
+  Int_t GetEventFilterStage(ForestReader *eventReader) const; // Find the last passed stage of the event cut flow before the base trigger
+  Int_t EvaluateEventCuts(const Int_t iEvent, const Double_t vz); // Evaluate the event cuts in the adaptive order and find the last passed stage of the cut flow
+  Bool_t PassEventCut(const Int_t iCut, const Double_t vz) const; // Check if the current event passes one of the event cuts
+  void OrderEventCuts();            // Order the event cuts by the rejection per cost measured in the warm-up
+  template <Int_t dataType> Double_t GetVzWeight(const Double_t vz) const;  // Get the proper vz weighting depending on analyzed system
+  template <Int_t dataType> Double_t GetCentralityWeight(const Int_t hiBin) const; // Get the proper centrality weighting depending on analyzed system
+  template <Int_t dataType> Double_t GetJetPtWeight(const Double_t jetPt) const; // Get the proper jet pT weighting for 2017 and 2018 MC
+  Double_t GetPtHatWeight(const Double_t ptHat) const; // Get the pT hat weight from the stitching weights or from the forest
   
   // Private data members
   ForestReader *fJetReader;                 // Reader for jets in the event
   std::vector<TString> fFileNames;          // Vector for all the files to loop over
   ConfigurationCard *fCard;                 // Configuration card for the analysis
   TriggerHistograms *fHistograms;           // Filled histograms
-  TF1 *fVzWeightFunction;                   // Weighting function for vz. Needed for MC.
-  TF1 *fCentralityWeightFunctionCentral;    // Weighting function for central centrality classes. Needed for MC.
-  TF1 *fCentralityWeightFunctionPeripheral; // Weighting function for peripheral centrality classes. Needed for MC.
-  TF1 *fPtWeightFunction;                   // Weighting function for jet pT. Needed for MC.
+  TFile *fInputFile;                        // Currently open input file
+  Int_t fCurrentFileIndex;                  // Index of the currently open input file in the file list
   
   // Analyzed data and forest types
   Int_t fDataType;                   // Analyzed data type
   Int_t fJetType;                    // Type of jets used for analysis. 0 = Calo jets, 1 = PF jets
-  Int_t fBaseTrigger;                // Trigger index used as base trigger for efficiency study
+  Int_t fBaseTrigger;                // Trigger index used as base trigger for efficiency study. First one if several are given.
   Int_t fDebugLevel;                 // Amount of debug messages printed to console
+  Int_t fNumberOfThreads;            // Number of worker threads used to process the files
   
   // Weights for filling the MC histograms
   Double_t fVzWeight;                // Weight for vz in MC
   Double_t fCentralityWeight;        // Weight for centrality in MC
   Double_t fPtHatWeight;             // Weight for pT hat in MC
   Double_t fTotalEventWeight;        // Combined weight factor for MC
+  std::vector<Double_t> fPtHatStitchingEdges;   // Lower edges of the pT hat bins for stitching. The last bin has no upper edge.
+  std::vector<Double_t> fPtHatStitchingWeights; // Weight for each pT hat bin. Empty if the weight from the forest is used.
+  WeightProvider fWeightProvider;    // Weighting functions for vz, centrality and jet pT. Needed for MC.
+  
+  // Bootstrap replicas for statistical uncertainties
+  Int_t fnBootstrapReplicas;                 // Number of bootstrap replicas. 0 = No bootstrap.
+  std::vector<UChar_t> fBootstrapWeights;    // Poisson weights of the current event for each replica
+  
+  // Adaptive ordering of the event cuts
+  Bool_t fAdaptiveEventCuts;                 // Evaluate the event cuts in the order of measured rejection per cost and read the trees only when needed
+  Int_t fnEventCutWarmUpEvents;              // Number of events in which all the event cuts are evaluated to measure their rejection and cost
+  Int_t fnEventCutMeasuredEvents;            // Number of events measured so far in the warm-up
+  UInt_t fBaseTriggerMask;                   // Bit i is set if trigger i is the base trigger of any cut variation
+  Double_t fLooseVzCut;                      // Loosest vz cut of all the cut variations
+  std::vector<Int_t> fEventCutOrder;         // Order in which the event cuts are evaluated
+  std::vector<Double_t> fEventCutRejections; // Number of events rejected by each event cut in the warm-up
+  std::vector<Double_t> fTreeReadTime;       // Time in seconds used to read each forest tree in the warm-up
+  
+  // Timing of the analysis stages
+  StageTimer fFileTimer;                     // Time used in each stage for the currently open file
+  StageTimer fTotalTimer;                    // Time used in each stage for all the closed files
+  
+  // Progress reporting
+  Double_t fProgressInterval;                // Minimum time in seconds between the progress status lines. 0 = No progress reporting.
+  ProgressMonitor *fProgressMonitor;         // Progress monitor shared by all the workers. Owned by the analyzer running the analysis.
+  Long64_t fReportedBytesRead;               // Number of bytes read from the current file that are already reported
+  
+  // Checkpoints for resuming interrupted jobs
+  Int_t fCheckpointFileInterval;             // Number of completed input files between checkpoints. 0 = Not used.
+  Double_t fCheckpointMinuteInterval;        // Number of minutes between checkpoints. 0 = Not used.
+  TString fCheckpointFileName;               // File to which the checkpoints are written. Empty if no checkpoints are written.
+  AnalysisCheckpoint *fCheckpoint;           // Completed units shared by all the workers. Owned by the analyzer running the analysis.
+  std::vector<std::vector<AnalysisTask>> fPreviousUnits; // Units completed in the previous runs for each input file
+  std::vector<Long64_t> fPreviousFileEntries; // Number of entries in each input file from the previous runs. Negative if not known.
+  
+  // Clean stop before the runtime limit
+  RuntimeBudget *fRuntimeBudget;             // Runtime budget shared by all the workers. Not owned. Null if not used.
+  std::vector<AnalysisTask> fUnprocessedUnits; // Units not processed because the analysis was stopped
+  
+  // Memory budget for the sparse histograms
+  Double_t fHistogramMemoryBudget;           // Memory in MB for the sparse histograms of all the workers. 0 = No limit.
+  TString fSpillFileBaseName;                // Beginning of the names of the spill files
+  std::vector<TString> fSpillFileNames;      // Files to which the sparse histograms were spilled
+  
+  // Additional analyses sharing the event reading and selection
+  std::vector<TString> fAnalysisModuleNames;       // Names of the analysis modules given in the card
+  std::vector<AnalysisModule*> fAnalysisModules;   // Analysis modules of this worker
+  std::vector<ULong64_t> fNominalJetPassMask;      // Jets passing the nominal jet cuts in the current event, given to the modules
+  Int_t fNominalLeadingJetIndex;                   // Leading jet passing the nominal jet cuts in the current event
   
   // Jet and track selection cuts
   Int_t fJetAxis;                      // Used jet axis type. 0 = Anti-kT jet axis, 1 = Axis from leading PF candidate
@@ -79,6 +195,15 @@ private:
   Bool_t fCutBadPhiRegion;             // Cut the phi region with bad tracker performance from the analysis
   Double_t fMinimumMaxTrackPtFraction; // Cut for jets consisting only from soft particles
   Double_t fMaximumMaxTrackPtFraction; // Cut for jets consisting only from one high pT
+  Double_t fJetMatchingRadius;         // Maximum distance in eta-phi for matching reconstructed and generator level jets. 0 = No matching.
+  JetMatcher fJetMatcher;              // Eta-phi grid for matching reconstructed jets to generator level jets in MC
+  Double_t fTriggerObjectMatchingRadius; // Maximum distance in eta-phi for matching jets to HLT objects. 0 = HLT objects are not read.
+  JetMatcher fTriggerObjectMatcher;    // Eta-phi grid for matching reconstructed jets to HLT objects
+  std::vector<CutVariation> fCutVariations; // Cut variations for all base triggers filled in the same pass. The first one is the nominal selection.
+  
+  // Event loop specialized for the analyzed data type and cuts, selected once when the analyzer is configured
+  Bool_t fGenericEventLoop;            // Use the event loop checking the data type at run time
+  void (TriggerAnalyzer::*fEventLoop)(Long64_t firstEntry, Long64_t lastEntry);
 
 };
 
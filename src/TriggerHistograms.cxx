@@ -1,7 +1,9 @@
 // Histograms needed in the trigger analysis
 
 // C++ includes
+#include <iostream>
 #include <assert.h>
+#include <algorithm>
 
 // Root includes
 #include <TFile.h>
@@ -9,6 +11,14 @@
 
 // Own includes
 #include "TriggerHistograms.h"
+#include "BootstrapHistogram.h"
+#include "EfficiencyAccumulator.h"
+#include "RunAccumulator.h"
+#include "FixedPointHistogram.h"
+#include "DenseHistogram.h"
+#include "ForestReader.h"
+
+using namespace std;
 
 /*
  * Default constructor
@@ -23,7 +33,20 @@ TriggerHistograms::TriggerHistograms() :
   fhPtHatWeighted(0),
   fhInclusiveJet(0),
   fhLeadingJet(0),
-  fCard(0)
+  fhInclusiveJetEta(0),
+  fhInclusiveJetPhi(0),
+  fhLeadingJetEta(0),
+  fhLeadingJetPhi(0),
+  fhJetTriggerObject(0),
+  fhJetResponse(0),
+  fhInclusiveJetBootstrap(0),
+  fhLeadingJetBootstrap(0),
+  fLeadingJetPerRun(0),
+  fJetEfficiency(0),
+  fCard(0),
+  fTurnOnOnly(false),
+  fFixedPointHistograms(),
+  fDenseHistograms()
 {
   // Default constructor
   
@@ -42,7 +65,20 @@ TriggerHistograms::TriggerHistograms(ConfigurationCard *newCard) :
   fhPtHatWeighted(0),
   fhInclusiveJet(0),
   fhLeadingJet(0),
-  fCard(newCard)
+  fhInclusiveJetEta(0),
+  fhInclusiveJetPhi(0),
+  fhLeadingJetEta(0),
+  fhLeadingJetPhi(0),
+  fhJetTriggerObject(0),
+  fhJetResponse(0),
+  fhInclusiveJetBootstrap(0),
+  fhLeadingJetBootstrap(0),
+  fLeadingJetPerRun(0),
+  fJetEfficiency(0),
+  fCard(newCard),
+  fTurnOnOnly(false),
+  fFixedPointHistograms(),
+  fDenseHistograms()
 {
   // Custom constructor
 
@@ -61,7 +97,20 @@ TriggerHistograms::TriggerHistograms(const TriggerHistograms& in) :
   fhPtHatWeighted(in.fhPtHatWeighted),
   fhInclusiveJet(in.fhInclusiveJet),
   fhLeadingJet(in.fhLeadingJet),
-  fCard(in.fCard)
+  fhInclusiveJetEta(in.fhInclusiveJetEta),
+  fhInclusiveJetPhi(in.fhInclusiveJetPhi),
+  fhLeadingJetEta(in.fhLeadingJetEta),
+  fhLeadingJetPhi(in.fhLeadingJetPhi),
+  fhJetTriggerObject(in.fhJetTriggerObject),
+  fhJetResponse(in.fhJetResponse),
+  fhInclusiveJetBootstrap(in.fhInclusiveJetBootstrap),
+  fhLeadingJetBootstrap(in.fhLeadingJetBootstrap),
+  fLeadingJetPerRun(in.fLeadingJetPerRun),
+  fJetEfficiency(in.fJetEfficiency),
+  fCard(in.fCard),
+  fTurnOnOnly(in.fTurnOnOnly),
+  fFixedPointHistograms(in.fFixedPointHistograms),
+  fDenseHistograms(in.fDenseHistograms)
 {
   // Copy constructor
   
@@ -84,7 +133,20 @@ TriggerHistograms& TriggerHistograms::operator=(const TriggerHistograms& in){
   fhPtHatWeighted = in.fhPtHatWeighted;
   fhInclusiveJet = in.fhInclusiveJet;
   fhLeadingJet = in.fhLeadingJet;
+  fhInclusiveJetEta = in.fhInclusiveJetEta;
+  fhInclusiveJetPhi = in.fhInclusiveJetPhi;
+  fhLeadingJetEta = in.fhLeadingJetEta;
+  fhLeadingJetPhi = in.fhLeadingJetPhi;
+  fhJetTriggerObject = in.fhJetTriggerObject;
+  fhJetResponse = in.fhJetResponse;
+  fhInclusiveJetBootstrap = in.fhInclusiveJetBootstrap;
+  fhLeadingJetBootstrap = in.fhLeadingJetBootstrap;
+  fLeadingJetPerRun = in.fLeadingJetPerRun;
+  fJetEfficiency = in.fJetEfficiency;
   fCard = in.fCard;
+  fTurnOnOnly = in.fTurnOnOnly;
+  fFixedPointHistograms = in.fFixedPointHistograms;
+  fDenseHistograms = in.fDenseHistograms;
   
   return *this;
 }
@@ -103,6 +165,18 @@ TriggerHistograms::~TriggerHistograms(){
   delete fhPtHatWeighted;
   delete fhInclusiveJet;
   delete fhLeadingJet;
+  delete fhInclusiveJetEta;
+  delete fhInclusiveJetPhi;
+  delete fhLeadingJetEta;
+  delete fhLeadingJetPhi;
+  delete fhJetTriggerObject;
+  delete fhJetResponse;
+  delete fhInclusiveJetBootstrap;
+  delete fhLeadingJetBootstrap;
+  delete fLeadingJetPerRun;
+  delete fJetEfficiency;
+  for(FixedPointHistogram *fixedPointHistogram : fFixedPointHistograms) delete fixedPointHistogram;
+  for(DenseHistogram *denseHistogram : fDenseHistograms) delete denseHistogram;
 }
 
 /*
@@ -120,6 +194,123 @@ TString TriggerHistograms::GetTriggerName(Int_t iTrigger) const{
   return kTriggerStrings[iTrigger];
 }
 
+/*
+ * Fill a jet histogram for several trigger bins in one call. The trigger selection is given as a bit mask,
+ * and only the set bits are visited.
+ *
+ * The values are always given for the full axes of the histogram. In the turn-on-only mode, the inclusive and
+ * leading jet histograms have only the pT, centrality, data level and trigger axes, so those values are picked
+ * here, and the eta and phi histograms are filled from the same values if they are booked.
+ *
+ *  Arguments:
+ *   THnSparseF *histogram = Filled jet histogram
+ *   Double_t *filler = Values for the axes. The value for the trigger axis is set here.
+ *   UInt_t triggerMask = Bit i is set if trigger bin i is filled
+ *   const Double_t *triggerWeight = Weight for each trigger bin. Only used for the set bits.
+ *   Double_t jetWeight = Weight for the jet multiplying all the trigger weights
+ *   Int_t triggerAxis = Index of the trigger selection axis in the full axes of the histogram
+ */
+void TriggerHistograms::FillJetTriggers(THnSparseF *histogram, Double_t *filler, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight, Int_t triggerAxis){
+  
+  if(!fTurnOnOnly || (histogram != fhInclusiveJet && histogram != fhLeadingJet)){
+    FillTriggerBins(histogram, filler, triggerMask, triggerWeight, jetWeight, triggerAxis);
+    return;
+  }
+  
+  // Axes: [jet pT or eta or phi][cent][reco/gen][trigger]
+  Double_t fillerTurnOn[4] = {filler[0], filler[3], filler[4], 0};
+  FillTriggerBins(histogram, fillerTurnOn, triggerMask, triggerWeight, jetWeight, 3);
+  
+  THnSparseF *etaHistogram = (histogram == fhInclusiveJet) ? fhInclusiveJetEta : fhLeadingJetEta;
+  THnSparseF *phiHistogram = (histogram == fhInclusiveJet) ? fhInclusiveJetPhi : fhLeadingJetPhi;
+  if(etaHistogram){
+    fillerTurnOn[0] = filler[2];
+    FillTriggerBins(etaHistogram, fillerTurnOn, triggerMask, triggerWeight, jetWeight, 3);
+    fillerTurnOn[0] = filler[1];
+    FillTriggerBins(phiHistogram, fillerTurnOn, triggerMask, triggerWeight, jetWeight, 3);
+  }
+}
+
+/*
+ * Fill the trigger bins of a histogram with the values for its booked axes. THnSparse needs one fill for each bin.
+ * If the histogram has dense bins, they are filled for all the trigger bins from one index calculation, and the
+ * THnSparse is filled only for the values outside of the dense bins.
+ *
+ *  Arguments:
+ *   THnSparseF *histogram = Filled histogram
+ *   Double_t *filler = Values for the axes. The value for the trigger axis is set here.
+ *   UInt_t triggerMask = Bit i is set if trigger bin i is filled
+ *   const Double_t *triggerWeight = Weight for each trigger bin. Only used for the set bits.
+ *   Double_t jetWeight = Weight for the jet multiplying all the trigger weights
+ *   Int_t triggerAxis = Index of the trigger selection axis in the histogram
+ */
+void TriggerHistograms::FillTriggerBins(THnSparseF *histogram, Double_t *filler, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight, Int_t triggerAxis){
+  DenseHistogram *denseHistogram = FindDenseHistogram(histogram);
+  if(denseHistogram && denseHistogram->FillTriggers(filler, triggerAxis, triggerMask, triggerWeight, jetWeight)) return;
+  Int_t iTrigger;
+  while(triggerMask){
+    iTrigger = __builtin_ctz(triggerMask);
+    triggerMask &= triggerMask - 1;
+    filler[triggerAxis] = iTrigger;
+    FillHistogram(histogram,filler,triggerWeight[iTrigger]*jetWeight);
+  }
+}
+
+/*
+ * Find the fixed-point sums that replace the fills of a histogram. There are only a few histograms, so a linear
+ * search is fast enough.
+ */
+FixedPointHistogram* TriggerHistograms::FindFixedPointHistogram(const TObject *histogram) const{
+  for(FixedPointHistogram *fixedPointHistogram : fFixedPointHistograms){
+    if(fixedPointHistogram->GetHistogram() == histogram) return fixedPointHistogram;
+  }
+  cout << "Error! No fixed-point sums for histogram " << histogram->GetName() << endl;
+  assert(0);
+  return NULL;
+}
+
+/*
+ * Find the dense bins for a histogram. Only the jet histograms filled for several triggers have them.
+ */
+DenseHistogram* TriggerHistograms::FindDenseHistogram(const THnSparseF *histogram) const{
+  for(DenseHistogram *denseHistogram : fDenseHistograms){
+    if(denseHistogram->GetHistogram() == histogram) return denseHistogram;
+  }
+  return NULL;
+}
+
+/*
+ * Fill a one dimensional histogram. If the fixed-point sums are enabled, they are filled instead of the histogram.
+ *
+ *  Arguments:
+ *   TH1F *histogram = Filled histogram
+ *   Double_t value = Filled value
+ *   Double_t weight = Weight of the fill
+ */
+void TriggerHistograms::FillHistogram(TH1F *histogram, Double_t value, Double_t weight){
+  if(fFixedPointHistograms.empty()){
+    histogram->Fill(value,weight);
+    return;
+  }
+  FindFixedPointHistogram(histogram)->Fill(value,weight);
+}
+
+/*
+ * Fill a multidimensional histogram. If the fixed-point sums are enabled, they are filled instead of the histogram.
+ *
+ *  Arguments:
+ *   THnSparseF *histogram = Filled histogram
+ *   const Double_t *filler = Values for the axes
+ *   Double_t weight = Weight of the fill
+ */
+void TriggerHistograms::FillHistogram(THnSparseF *histogram, const Double_t *filler, Double_t weight){
+  if(fFixedPointHistograms.empty()){
+    histogram->Fill(filler,weight);
+    return;
+  }
+  FindFixedPointHistogram(histogram)->Fill(filler,weight);
+}
+
 /*
  * Create the necessary histograms
  */
@@ -206,6 +397,37 @@ void TriggerHistograms::CreateHistograms(){
   
   // ======== THnSparse for all jets ========
   
+  // For the trigger turn-on curves, only the jet pT, centrality, data level and trigger axes are needed
+  fTurnOnOnly = (fCard->Get("TurnOnOnlyHistograms") == 1);
+  if(fTurnOnOnly){
+    const Int_t nAxesTurnOn = 4;
+    Int_t nBinsTurnOn[nAxesTurnOn] = {nPtBinsJet, nWideCentralityBins, nDataLevelBins, nTriggerSelectionBins};
+    Double_t lowBinBorderTurnOn[nAxesTurnOn] = {minPtJet, minCentrality, minDataLevel, minTriggerSelection};
+    Double_t highBinBorderTurnOn[nAxesTurnOn] = {maxPtJet, maxCentrality, maxDataLevel, maxTriggerSelection};
+    
+    // Axes: [jet pT][centrality][reco/gen][trigger selection]
+    fhInclusiveJet = new THnSparseF("inclusiveJet","inclusiveJet",nAxesTurnOn,nBinsTurnOn,lowBinBorderTurnOn,highBinBorderTurnOn); fhInclusiveJet->Sumw2();
+    fhLeadingJet = new THnSparseF("leadingJet","leadingJet",nAxesTurnOn,nBinsTurnOn,lowBinBorderTurnOn,highBinBorderTurnOn); fhLeadingJet->Sumw2();
+    fhInclusiveJet->SetBinEdges(1,wideCentralityBins);
+    fhLeadingJet->SetBinEdges(1,wideCentralityBins);
+    
+    // Optional eta and phi distributions, each replacing the pT axis of the above histograms
+    if(fCard->Get("TurnOnEtaPhiHistograms") == 1){
+      nBinsTurnOn[0] = nEtaBins; lowBinBorderTurnOn[0] = minEta; highBinBorderTurnOn[0] = maxEta;
+      fhInclusiveJetEta = new THnSparseF("inclusiveJetEta","inclusiveJetEta",nAxesTurnOn,nBinsTurnOn,lowBinBorderTurnOn,highBinBorderTurnOn); fhInclusiveJetEta->Sumw2();
+      fhLeadingJetEta = new THnSparseF("leadingJetEta","leadingJetEta",nAxesTurnOn,nBinsTurnOn,lowBinBorderTurnOn,highBinBorderTurnOn); fhLeadingJetEta->Sumw2();
+      
+      nBinsTurnOn[0] = nPhiBins; lowBinBorderTurnOn[0] = minPhi; highBinBorderTurnOn[0] = maxPhi;
+      fhInclusiveJetPhi = new THnSparseF("inclusiveJetPhi","inclusiveJetPhi",nAxesTurnOn,nBinsTurnOn,lowBinBorderTurnOn,highBinBorderTurnOn); fhInclusiveJetPhi->Sumw2();
+      fhLeadingJetPhi = new THnSparseF("leadingJetPhi","leadingJetPhi",nAxesTurnOn,nBinsTurnOn,lowBinBorderTurnOn,highBinBorderTurnOn); fhLeadingJetPhi->Sumw2();
+      
+      fhInclusiveJetEta->SetBinEdges(1,wideCentralityBins);
+      fhLeadingJetEta->SetBinEdges(1,wideCentralityBins);
+      fhInclusiveJetPhi->SetBinEdges(1,wideCentralityBins);
+      fhLeadingJetPhi->SetBinEdges(1,wideCentralityBins);
+    }
+  }
+  
   // Axis 0 for the jet histogram: jet pT
   nBinsJet[0] = nPtBinsJet;         // nBins for any jet pT
   lowBinBorderJet[0] = minPtJet;    // low bin border for any jet pT
@@ -237,18 +459,120 @@ void TriggerHistograms::CreateHistograms(){
   highBinBorderJet[5] = maxTriggerSelection; // high bin border for data levels
   
   // Create the histogram for all jets using the above binning information
-  fhInclusiveJet = new THnSparseF("inclusiveJet","inclusiveJet",nAxesJet,nBinsJet,lowBinBorderJet,highBinBorderJet); fhInclusiveJet->Sumw2();
-  fhLeadingJet = new THnSparseF("leadingJet","leadingJet",nAxesJet,nBinsJet,lowBinBorderJet,highBinBorderJet); fhLeadingJet->Sumw2();
-
-  // Set custom centrality bins for histograms
-  fhInclusiveJet->SetBinEdges(3,wideCentralityBins);
-  fhLeadingJet->SetBinEdges(3,wideCentralityBins);
+  if(!fTurnOnOnly){
+    fhInclusiveJet = new THnSparseF("inclusiveJet","inclusiveJet",nAxesJet,nBinsJet,lowBinBorderJet,highBinBorderJet); fhInclusiveJet->Sumw2();
+    fhLeadingJet = new THnSparseF("leadingJet","leadingJet",nAxesJet,nBinsJet,lowBinBorderJet,highBinBorderJet); fhLeadingJet->Sumw2();
+    
+    // Set custom centrality bins for histograms
+    fhInclusiveJet->SetBinEdges(3,wideCentralityBins);
+    fhLeadingJet->SetBinEdges(3,wideCentralityBins);
+  }
+  
+  // ======== THnSparse for jets matched to HLT objects ========
+  
+  if(fCard->Get("TriggerObjectMatchingRadius") > 0){
+    const Int_t nAxesTriggerObject = 4;
+    
+    // The first bin of the online pT axis is reserved for jets without a matching HLT object
+    const Double_t minOnlinePt = minPtJet - (maxPtJet-minPtJet)/nPtBinsJet;
+    Int_t nBinsTriggerObject[nAxesTriggerObject] = {nPtBinsJet, nPtBinsJet+1, nWideCentralityBins, knTriggerTypes};
+    Double_t lowBinBorderTriggerObject[nAxesTriggerObject] = {minPtJet, minOnlinePt, minCentrality, -0.5};
+    Double_t highBinBorderTriggerObject[nAxesTriggerObject] = {maxPtJet, maxPtJet, maxCentrality, knTriggerTypes-0.5};
+    
+    // Axes: [offline jet pT][online jet pT][centrality][trigger]
+    fhJetTriggerObject = new THnSparseF("jetTriggerObject","jetTriggerObject",nAxesTriggerObject,nBinsTriggerObject,lowBinBorderTriggerObject,highBinBorderTriggerObject); fhJetTriggerObject->Sumw2();
+    fhJetTriggerObject->SetBinEdges(2,wideCentralityBins);
+  }
+  
+  // ======== THnSparse for matched jets in MC ========
+  
+  const Int_t dataType = fCard->Get("DataType");
+  if((dataType == ForestReader::kPpMC || dataType == ForestReader::kPbPbMC) && fCard->Get("JetMatchingRadius") > 0){
+    const Int_t nAxesResponse = 4;
+    Int_t nBinsResponse[nAxesResponse] = {nPtBinsJet, nPtBinsJet, nWideCentralityBins, nTriggerSelectionBins};
+    Double_t lowBinBorderResponse[nAxesResponse] = {minPtJet, minPtJet, minCentrality, minTriggerSelection};
+    Double_t highBinBorderResponse[nAxesResponse] = {maxPtJet, maxPtJet, maxCentrality, maxTriggerSelection};
+    
+    // Axes: [generator level jet pT][reconstructed jet pT][centrality][trigger selection]
+    fhJetResponse = new THnSparseF("jetResponse","jetResponse",nAxesResponse,nBinsResponse,lowBinBorderResponse,highBinBorderResponse); fhJetResponse->Sumw2();
+    fhJetResponse->SetBinEdges(2,wideCentralityBins);
+  }
+  
+  // The bootstrap replicas, run accumulators and efficiency accumulators add doubles in the order of the fills
+  if(fCard->Get("ReproducibleSums") == 1 && (fCard->Get("NumberOfBootstrapReplicas") > 0 || fCard->Get("MaxRunsPerRunAccumulator") > 0 || fCard->Get("FillEfficiencyAccumulators") == 1)){
+    cout << "Error! ReproducibleSums cannot be used together with NumberOfBootstrapReplicas, MaxRunsPerRunAccumulator or FillEfficiencyAccumulators, since their sums are not exact" << endl;
+    assert(0);
+  }
+  
+  // ======== Bootstrap replicas for jet pT spectra ========
+  
+  const Int_t nBootstrapReplicas = fCard->Get("NumberOfBootstrapReplicas");
+  if(nBootstrapReplicas > 0){
+    fhInclusiveJetBootstrap = new BootstrapHistogram("inclusiveJetBootstrap",nBootstrapReplicas,nPtBinsJet,minPtJet,maxPtJet,nWideCentralityBins,wideCentralityBins);
+    fhLeadingJetBootstrap = new BootstrapHistogram("leadingJetBootstrap",nBootstrapReplicas,nPtBinsJet,minPtJet,maxPtJet,nWideCentralityBins,wideCentralityBins);
+  }
+  
+  // ======== Run-resolved leading jet spectra ========
+  
+  const Int_t maxRuns = fCard->Get("MaxRunsPerRunAccumulator");
+  if(maxRuns > 0){
+    fLeadingJetPerRun = new RunAccumulator("leadingJetPerRun",maxRuns,nPtBinsJet,minPtJet,maxPtJet);
+  }
+  
+  // ======== Accumulators for trigger efficiency ========
+  
+  if(fCard->Get("FillEfficiencyAccumulators") == 1){
+    fJetEfficiency = new EfficiencyAccumulator(nPtBinsJet,minPtJet,maxPtJet,nWideCentralityBins,wideCentralityBins);
+  }
+  
+  // ======== Fixed-point sums for reproducible merging ========
+  
+  if(fCard->Get("ReproducibleSums") == 1){
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhVertexZ));
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhVertexZWeighted));
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhEvents));
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhCentrality));
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhCentralityWeighted));
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhPtHat));
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhPtHatWeighted));
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhInclusiveJet));
+    fFixedPointHistograms.push_back(new FixedPointHistogram(fhLeadingJet));
+    if(fhInclusiveJetEta){
+      fFixedPointHistograms.push_back(new FixedPointHistogram(fhInclusiveJetEta));
+      fFixedPointHistograms.push_back(new FixedPointHistogram(fhInclusiveJetPhi));
+      fFixedPointHistograms.push_back(new FixedPointHistogram(fhLeadingJetEta));
+      fFixedPointHistograms.push_back(new FixedPointHistogram(fhLeadingJetPhi));
+    }
+    if(fhJetTriggerObject) fFixedPointHistograms.push_back(new FixedPointHistogram(fhJetTriggerObject));
+    if(fhJetResponse) fFixedPointHistograms.push_back(new FixedPointHistogram(fhJetResponse));
+  }
+  
+  // ======== Dense bins for fast filling of the jet histograms ========
+  
+  // The fixed-point sums replace the fills, so the dense bins are only used without them
+  if(fCard->Get("DenseJetHistograms") == 1 && fFixedPointHistograms.empty()){
+    fDenseHistograms.push_back(new DenseHistogram(fhInclusiveJet));
+    fDenseHistograms.push_back(new DenseHistogram(fhLeadingJet));
+    if(fhInclusiveJetEta){
+      fDenseHistograms.push_back(new DenseHistogram(fhInclusiveJetEta));
+      fDenseHistograms.push_back(new DenseHistogram(fhInclusiveJetPhi));
+      fDenseHistograms.push_back(new DenseHistogram(fhLeadingJetEta));
+      fDenseHistograms.push_back(new DenseHistogram(fhLeadingJetPhi));
+    }
+    if(fhJetResponse) fDenseHistograms.push_back(new DenseHistogram(fhJetResponse));
+  }
 }
 
 /*
  * Write the histograms to file
  */
-void TriggerHistograms::Write() const{
+void TriggerHistograms::Write(){
+  
+  // The ROOT histograms are not filled when the fixed-point sums are used, so the sums are copied to them first
+  for(const FixedPointHistogram *fixedPointHistogram : fFixedPointHistograms) fixedPointHistogram->CopyToHistogram();
+  
+  // The dense bins are added to the THnSparse holding the fills outside of them
+  for(DenseHistogram *denseHistogram : fDenseHistograms) denseHistogram->FlushToHistogram();
   
   // Write the histograms to file
   fhVertexZ->Write();
@@ -260,13 +584,194 @@ void TriggerHistograms::Write() const{
   fhPtHatWeighted->Write();
   fhInclusiveJet->Write();
   fhLeadingJet->Write();
+  if(fhInclusiveJetEta) fhInclusiveJetEta->Write();
+  if(fhInclusiveJetPhi) fhInclusiveJetPhi->Write();
+  if(fhLeadingJetEta) fhLeadingJetEta->Write();
+  if(fhLeadingJetPhi) fhLeadingJetPhi->Write();
+  if(fhJetTriggerObject) fhJetTriggerObject->Write();
+  if(fhJetResponse) fhJetResponse->Write();
+  if(fhInclusiveJetBootstrap) fhInclusiveJetBootstrap->Write();
+  if(fhLeadingJetBootstrap) fhLeadingJetBootstrap->Write();
+  if(fLeadingJetPerRun) fLeadingJetPerRun->Write();
+  if(fJetEfficiency) fJetEfficiency->Write();
+  
+  // The exact sums are needed for merging the outputs of several jobs reproducibly
+  if(!fFixedPointHistograms.empty()) FixedPointHistogram::WriteState(fFixedPointHistograms);
+  
+}
+
+/*
+ * Add the histograms from another histogram object to these histograms.
+ * Used to combine the histograms filled by different workers.
+ */
+void TriggerHistograms::Merge(const TriggerHistograms *other){
+  
+  // With the fixed-point sums, the merged result does not depend on the order in which the workers are merged
+  if(fFixedPointHistograms.empty()){
+    fhVertexZ->Add(other->fhVertexZ);
+    fhVertexZWeighted->Add(other->fhVertexZWeighted);
+    fhEvents->Add(other->fhEvents);
+    fhCentrality->Add(other->fhCentrality);
+    fhCentralityWeighted->Add(other->fhCentralityWeighted);
+    fhPtHat->Add(other->fhPtHat);
+    fhPtHatWeighted->Add(other->fhPtHatWeighted);
+    fhInclusiveJet->Add(other->fhInclusiveJet);
+    fhLeadingJet->Add(other->fhLeadingJet);
+    if(fhInclusiveJetEta) fhInclusiveJetEta->Add(other->fhInclusiveJetEta);
+    if(fhInclusiveJetPhi) fhInclusiveJetPhi->Add(other->fhInclusiveJetPhi);
+    if(fhLeadingJetEta) fhLeadingJetEta->Add(other->fhLeadingJetEta);
+    if(fhLeadingJetPhi) fhLeadingJetPhi->Add(other->fhLeadingJetPhi);
+    if(fhJetTriggerObject) fhJetTriggerObject->Add(other->fhJetTriggerObject);
+    if(fhJetResponse) fhJetResponse->Add(other->fhJetResponse);
+    
+    // The dense sums of the other histograms are added directly to the THnSparse, so no dense bins are allocated here
+    for(UInt_t iHistogram = 0; iHistogram < fDenseHistograms.size(); iHistogram++){
+      other->fDenseHistograms.at(iHistogram)->AddToHistogram(fDenseHistograms.at(iHistogram)->GetHistogram());
+    }
+  } else {
+    for(UInt_t iHistogram = 0; iHistogram < fFixedPointHistograms.size(); iHistogram++){
+      fFixedPointHistograms.at(iHistogram)->Add(other->fFixedPointHistograms.at(iHistogram));
+    }
+  }
+  if(fhInclusiveJetBootstrap) fhInclusiveJetBootstrap->Add(other->fhInclusiveJetBootstrap);
+  if(fhLeadingJetBootstrap) fhLeadingJetBootstrap->Add(other->fhLeadingJetBootstrap);
+  if(fLeadingJetPerRun) fLeadingJetPerRun->Add(other->fLeadingJetPerRun);
+  if(fJetEfficiency) fJetEfficiency->Add(other->fJetEfficiency);
   
 }
 
+/*
+ * List the created sparse jet histograms. These are the histograms whose memory grows with the filled bins.
+ */
+std::vector<THnSparseF*> TriggerHistograms::GetSparseHistograms() const{
+  std::vector<THnSparseF*> sparseHistograms;
+  sparseHistograms.push_back(fhInclusiveJet);
+  sparseHistograms.push_back(fhLeadingJet);
+  if(fhInclusiveJetEta) sparseHistograms.push_back(fhInclusiveJetEta);
+  if(fhInclusiveJetPhi) sparseHistograms.push_back(fhInclusiveJetPhi);
+  if(fhLeadingJetEta) sparseHistograms.push_back(fhLeadingJetEta);
+  if(fhLeadingJetPhi) sparseHistograms.push_back(fhLeadingJetPhi);
+  if(fhJetTriggerObject) sparseHistograms.push_back(fhJetTriggerObject);
+  if(fhJetResponse) sparseHistograms.push_back(fhJetResponse);
+  return sparseHistograms;
+}
+
+/*
+ * Memory in bytes used by the filled bins of a sparse histogram. ROOT gives the memory of the bin chunks and the hash
+ * table as a fraction of the memory of a dense histogram with the same binning, including underflow and overflow.
+ */
+Double_t TriggerHistograms::EstimateSparseMemory(const THnSparseF *histogram) const{
+  if(histogram->GetNbins() == 0) return 0;
+  Double_t nDenseBins = 1;
+  for(Int_t iAxis = 0; iAxis < histogram->GetNdimensions(); iAxis++) nDenseBins *= histogram->GetAxis(iAxis)->GetNbins() + 2;
+  return histogram->GetSparseFractionMem() * nDenseBins * sizeof(Float_t);
+}
+
+/*
+ * Estimated memory in bytes used by the sparse jet histograms. With the fixed-point sums, the memory is in the sums
+ * and the ROOT histograms stay empty until they are written. The dense bins have a fixed size that spilling does not
+ * reduce, so only the fills outside of them are counted.
+ */
+Double_t TriggerHistograms::GetSparseMemory() const{
+  Double_t memory = 0;
+  for(THnSparseF *histogram : GetSparseHistograms()){
+    if(fFixedPointHistograms.empty()){
+      memory += EstimateSparseMemory(histogram);
+    } else {
+      memory += FindFixedPointHistogram(histogram)->GetMemorySize();
+    }
+  }
+  return memory;
+}
+
+/*
+ * Memory in bytes used by the dense bins, the bootstrap replicas and the accumulators. It does not grow with the
+ * filled bins and is not reduced by spilling, so it is taken from the memory budget before the sparse histograms.
+ */
+Double_t TriggerHistograms::GetFixedMemory() const{
+  Double_t memory = 0;
+  for(const DenseHistogram *denseHistogram : fDenseHistograms) memory += denseHistogram->GetMemorySize();
+  if(fhInclusiveJetBootstrap) memory += fhInclusiveJetBootstrap->GetMemorySize();
+  if(fhLeadingJetBootstrap) memory += fhLeadingJetBootstrap->GetMemorySize();
+  if(fLeadingJetPerRun) memory += fLeadingJetPerRun->GetMemorySize();
+  if(fJetEfficiency) memory += fJetEfficiency->GetMemorySize();
+  return memory;
+}
+
+/*
+ * Write only the sparse jet histograms to a file that is opened somewhere else. Used to spill the partial histograms
+ * when their memory grows too large. The exact sums are written with them, so that the spills merge reproducibly.
+ */
+void TriggerHistograms::WriteSparse(){
+  for(DenseHistogram *denseHistogram : fDenseHistograms) denseHistogram->FlushToHistogram();
+  std::vector<FixedPointHistogram*> sparseFixedPointHistograms;
+  for(THnSparseF *histogram : GetSparseHistograms()){
+    if(!fFixedPointHistograms.empty()){
+      sparseFixedPointHistograms.push_back(FindFixedPointHistogram(histogram));
+      sparseFixedPointHistograms.back()->CopyToHistogram();
+    }
+    histogram->Write();
+  }
+  if(!sparseFixedPointHistograms.empty()) FixedPointHistogram::WriteState(sparseFixedPointHistograms);
+}
+
+/*
+ * Empty the sparse jet histograms and release their memory after they are spilled
+ */
+void TriggerHistograms::ResetSparse(){
+  for(THnSparseF *histogram : GetSparseHistograms()){
+    histogram->Reset();
+    histogram->Sumw2(); // Reset also turns off the error calculation
+    if(!fFixedPointHistograms.empty()) FindFixedPointHistogram(histogram)->Reset();
+  }
+  for(DenseHistogram *denseHistogram : fDenseHistograms) denseHistogram->Reset();
+}
+
+/*
+ * Print how many bins are occupied on each axis of the sparse jet histograms. The number of filled bins grows with
+ * the product of the occupied bins on the axes, so the axes with most occupied bins drive the memory growth. With the
+ * fixed-point sums, the ROOT histograms are filled only when written, so this should be called after WriteSparse.
+ */
+void TriggerHistograms::PrintSparseGrowth() const{
+  for(THnSparseF *histogram : GetSparseHistograms()){
+    const Long64_t nFilledBins = histogram->GetNbins();
+    if(nFilledBins == 0) continue;
+    
+    const TString *axisNames = fTurnOnOnly ? kTurnOnAxisNames : kJetAxisNames;
+    if(histogram == fhInclusiveJetEta || histogram == fhLeadingJetEta) axisNames = kJetEtaAxisNames;
+    if(histogram == fhInclusiveJetPhi || histogram == fhLeadingJetPhi) axisNames = kJetPhiAxisNames;
+    if(histogram == fhJetTriggerObject) axisNames = kTriggerObjectAxisNames;
+    if(histogram == fhJetResponse) axisNames = kResponseAxisNames;
+    
+    // Mark the occupied bins on each axis, including underflow and overflow
+    const Int_t nAxes = histogram->GetNdimensions();
+    std::vector<std::vector<Bool_t>> isOccupied(nAxes);
+    for(Int_t iAxis = 0; iAxis < nAxes; iAxis++) isOccupied.at(iAxis).assign(histogram->GetAxis(iAxis)->GetNbins()+2, false);
+    std::vector<Int_t> coordinates(nAxes);
+    for(Long64_t iBin = 0; iBin < nFilledBins; iBin++){
+      histogram->GetBinContent(iBin, coordinates.data());
+      for(Int_t iAxis = 0; iAxis < nAxes; iAxis++) isOccupied.at(iAxis).at(coordinates.at(iAxis)) = true;
+    }
+    
+    // List the axes from the most occupied bins to the least
+    std::vector<std::pair<Int_t,Int_t>> occupiedBins;
+    for(Int_t iAxis = 0; iAxis < nAxes; iAxis++){
+      occupiedBins.push_back(std::make_pair(std::count(isOccupied.at(iAxis).begin(), isOccupied.at(iAxis).end(), true), iAxis));
+    }
+    std::sort(occupiedBins.rbegin(), occupiedBins.rend());
+    
+    cout << Form("  %s: %lld filled bins, %.1f MB. Occupied bins per axis:", histogram->GetName(), nFilledBins, EstimateSparseMemory(histogram)/(1024.0*1024.0));
+    for(const std::pair<Int_t,Int_t> &axisBins : occupiedBins){
+      cout << Form(" %s %d/%d", axisNames[axisBins.second].Data(), axisBins.first, histogram->GetAxis(axisBins.second)->GetNbins()+2);
+    }
+    cout << endl;
+  }
+}
+
 /*
  * Write the histograms to a given file
  */
-void TriggerHistograms::Write(TString outputFileName) const{
+void TriggerHistograms::Write(TString outputFileName){
   
   // Define the output file
   TFile *outputFile = new TFile(outputFileName, "RECREATE");
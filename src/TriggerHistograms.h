@@ -3,6 +3,9 @@
 #ifndef TRIGGERHISTOGRAMS_H
 #define TRIGGERHISTOGRAMS_H
 
+// C++ includes
+#include <vector>
+
 // Root includes
 #include <TH1.h>
 #include <TH2.h>
@@ -11,6 +14,12 @@
 // Own includes
 #include "ConfigurationCard.h"
 
+class BootstrapHistogram;
+class DenseHistogram;
+class EfficiencyAccumulator;
+class FixedPointHistogram;
+class RunAccumulator;
+
 class TriggerHistograms{
   
 public:
@@ -29,10 +38,19 @@ public:
   
   // Methods
   void CreateHistograms();                      // Create all histograms
-  void Write() const;                           // Write the histograms to a file that is opened somewhere else
-  void Write(TString outputFileName) const;     // Write the histograms to a file
+  void Write();                                 // Write the histograms to a file that is opened somewhere else. Flushes the dense bins.
+  void Write(TString outputFileName);           // Write the histograms to a file
+  void Merge(const TriggerHistograms *other);   // Add the histograms from another histogram object to these histograms
   void SetCard(ConfigurationCard *newCard);     // Set a new configuration card for the histogram class
   TString GetTriggerName(Int_t iTrigger) const; // Getter for the trigger name
+  void FillJetTriggers(THnSparseF *histogram, Double_t *filler, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight, Int_t triggerAxis = 5); // Fill a jet histogram for several trigger bins in one call
+  void FillHistogram(TH1F *histogram, Double_t value, Double_t weight = 1);               // Fill a histogram, using the fixed-point sums if enabled
+  void FillHistogram(THnSparseF *histogram, const Double_t *filler, Double_t weight = 1); // Fill a histogram, using the fixed-point sums if enabled
+  Double_t GetSparseMemory() const;             // Estimated memory in bytes used by the sparse jet histograms
+  Double_t GetFixedMemory() const;              // Memory in bytes of the dense bins and accumulators, which is not reduced by spilling
+  void WriteSparse();                           // Write only the sparse jet histograms to a file that is opened somewhere else
+  void ResetSparse();                           // Empty the sparse jet histograms and release their memory
+  void PrintSparseGrowth() const;               // Print how many bins are occupied on each axis of the sparse jet histograms
   
   // Histograms defined public to allow easier access to them. Should not be abused
   // Notation in comments: l = leading jet, s = subleading jet, inc - inclusive jet, uc = uncorrected, ptw = pT weighted
@@ -43,14 +61,39 @@ public:
   TH1F *fhCentralityWeighted;      // Weighted centrality distribution (only meaningful for MC)
   TH1F *fhPtHat;                   // pT hat for MC events (only meaningful for MC)
   TH1F *fhPtHatWeighted;           // Weighted pT hat distribution
-  THnSparseF *fhInclusiveJet;      // Inclusive jet information. Axes: [jet pT][jet phi][jet eta][cent][reco/gen][trigger]
-  THnSparseF *fhLeadingJet;        // Leading jet information. Axes: [jet pT][jet phi][jet eta][cent][reco/gen][trigger]
+  THnSparseF *fhInclusiveJet;      // Inclusive jet information. Axes: [jet pT][jet phi][jet eta][cent][reco/gen][trigger]. Turn-on-only: [jet pT][cent][reco/gen][trigger]
+  THnSparseF *fhLeadingJet;        // Leading jet information. Axes: [jet pT][jet phi][jet eta][cent][reco/gen][trigger]. Turn-on-only: [jet pT][cent][reco/gen][trigger]
+  THnSparseF *fhInclusiveJetEta;   // Inclusive jet eta in turn-on-only mode if requested. Axes: [jet eta][cent][reco/gen][trigger]
+  THnSparseF *fhInclusiveJetPhi;   // Inclusive jet phi in turn-on-only mode if requested. Axes: [jet phi][cent][reco/gen][trigger]
+  THnSparseF *fhLeadingJetEta;     // Leading jet eta in turn-on-only mode if requested. Axes: [jet eta][cent][reco/gen][trigger]
+  THnSparseF *fhLeadingJetPhi;     // Leading jet phi in turn-on-only mode if requested. Axes: [jet phi][cent][reco/gen][trigger]
+  THnSparseF *fhJetTriggerObject;  // Reconstructed jets with the pT of the matched HLT object. -1 if no match. Axes: [offline pT][online pT][cent][trigger]
+  THnSparseF *fhJetResponse;       // Response for reconstructed jets matched to generator level jets (only MC). Axes: [gen pT][reco pT][cent][trigger]
+  BootstrapHistogram *fhInclusiveJetBootstrap; // Bootstrap replicas for inclusive jets. Axes: [jet pT][cent][reco/gen][trigger][replica]
+  BootstrapHistogram *fhLeadingJetBootstrap;   // Bootstrap replicas for leading jets. Axes: [jet pT][cent][reco/gen][trigger][replica]
+  RunAccumulator *fLeadingJetPerRun;           // Leading jet pT for each run. Axes: [run][jet pT][trigger]
+  EfficiencyAccumulator *fJetEfficiency;       // Pass and total sums for the trigger turn-on curves. Keys: [jet type][cent][reco/gen][trigger]
   
 private:
   
+  void FillTriggerBins(THnSparseF *histogram, Double_t *filler, UInt_t triggerMask, const Double_t *triggerWeight, Double_t jetWeight, Int_t triggerAxis); // Fill the trigger bins of a histogram with the booked axes
+  FixedPointHistogram* FindFixedPointHistogram(const TObject *histogram) const; // Find the fixed-point sums for a histogram
+  DenseHistogram* FindDenseHistogram(const THnSparseF *histogram) const;      // Find the dense bins for a histogram. NULL if not used.
+  std::vector<THnSparseF*> GetSparseHistograms() const; // List the created sparse jet histograms
+  Double_t EstimateSparseMemory(const THnSparseF *histogram) const; // Memory in bytes used by the filled bins of a sparse histogram
+  
   ConfigurationCard *fCard;    // Card for binning info
+  Bool_t fTurnOnOnly;          // The jet histograms have only the axes needed for the trigger turn-on curves
+  std::vector<FixedPointHistogram*> fFixedPointHistograms; // Exact sums replacing the fills of the ROOT histograms. Empty if not used.
+  std::vector<DenseHistogram*> fDenseHistograms; // Dense bins for the jet histograms filled for several triggers. Empty if not used.
   const TString kEventTypeStrings[knEventTypes] = {"All", "PrimVertex", "HfCoin2Th4", "ClustCompt", "BeamScrape", "CaloJet", "v_{z} cut"}; // Strings corresponding to event types
   const TString kTriggerStrings[knTriggerTypes] = {"CaloJet40", "CaloJet60", "CaloJet80", "CaloJet100", "PFJet60", "PFJet80", "PFJet100"};
+  const TString kJetAxisNames[6] = {"jet pT", "jet phi", "jet eta", "centrality", "reco/gen", "trigger"};           // Axes of the jet histograms
+  const TString kTurnOnAxisNames[4] = {"jet pT", "centrality", "reco/gen", "trigger"};                             // Axes of the jet histograms in turn-on-only mode
+  const TString kJetEtaAxisNames[4] = {"jet eta", "centrality", "reco/gen", "trigger"};                            // Axes of the jet eta histograms
+  const TString kJetPhiAxisNames[4] = {"jet phi", "centrality", "reco/gen", "trigger"};                            // Axes of the jet phi histograms
+  const TString kTriggerObjectAxisNames[4] = {"offline pT", "online pT", "centrality", "trigger"};                // Axes of the HLT object histogram
+  const TString kResponseAxisNames[4] = {"gen pT", "reco pT", "centrality", "trigger"};                           // Axes of the response histogram
   
 };
 
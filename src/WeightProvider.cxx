@@ -0,0 +1,350 @@
+// Implementation for WeightProvider
+
+// C++ includes
+#include <assert.h>
+#include <cmath>
+
+// Root includes
+#include <TMath.h>
+
+// Own includes
+#include "WeightProvider.h"
+#include "ForestReader.h"
+
+using namespace std;
+
+/*
+ * Default constructor. All the weights are one.
+ */
+WeightProvider::WeightProvider() :
+  fWeightSource(kPolynomial),
+  fUseCentralityPolynomials(false),
+  fVzWeightHistogram(0),
+  fCentralityWeightHistogram(0),
+  fJetPtWeightHistogram(0)
+{
+  // Default constructor
+  const Double_t unitWeight[1] = {1};
+  SetPolynomial(fVzPolynomial, 0, unitWeight);
+  SetPolynomial(fCentralPolynomial, 0, unitWeight);
+  SetPolynomial(fPeripheralPolynomial, 0, unitWeight);
+  SetPolynomial(fJetPtPolynomial, 0, unitWeight);
+  BuildTable(fVzTable, fVzPolynomial, 0, 0);
+  BuildTable(fJetPtTable, fJetPtPolynomial, 0, 0);
+  BuildCentralityTable();
+}
+
+/*
+ * Custom constructor. Set up the polynomial weight functions for the given data type.
+ *
+ *  Arguments:
+ *   Int_t dataType = Analyzed data type
+ */
+WeightProvider::WeightProvider(Int_t dataType) :
+  fWeightSource(kPolynomial),
+  fUseCentralityPolynomials(false),
+  fVzWeightHistogram(0),
+  fCentralityWeightHistogram(0),
+  fJetPtWeightHistogram(0)
+{
+  // Custom constructor
+  const Double_t unitWeight[1] = {1};
+  SetPolynomial(fVzPolynomial, 0, unitWeight);
+  SetPolynomial(fCentralPolynomial, 0, unitWeight);
+  SetPolynomial(fPeripheralPolynomial, 0, unitWeight);
+
+  // pT weight function for Pythia to match 2017 MC and data pT spectra. Derived from all jets above 120 GeV
+  const Double_t jetPtCoefficients[4] = {0.79572,0.0021861,-6.35407e-06,6.66435e-09}; // From JECv6
+  SetPolynomial(fJetPtPolynomial, 3, jetPtCoefficients);
+  BuildTable(fJetPtTable, fJetPtPolynomial, 0, 500);
+
+  // Find the correct weight functions based on data type
+  if(dataType == ForestReader::kPp || dataType == ForestReader::kPpMC){
+
+    // Weight function for 2017 MC
+    const Double_t vzCoefficients[7] = {0.973805, 0.00339418, 0.000757544, -1.37331e-06, -2.82953e-07, -3.06778e-10, 3.48615e-09};
+    SetPolynomial(fVzPolynomial, 6, vzCoefficients);
+    BuildTable(fVzTable, fVzPolynomial, -15, 15);
+
+  } else if (dataType == ForestReader::kPbPb || dataType == ForestReader::kPbPbMC){
+
+    // The vz weight function is rederived from the miniAOD dataset.
+    // Macro used for derivation: deriveMonteCarloWeights.C, Git hash: f95771aa3242a7a9ed385c1ff364500481088eec
+    // Input files: eecAnalysis_akFlowJets_wtaAxis_cutBadPhi_miniAODtesting_processed_2023-01-30.root
+    //              PbPbMC2018_RecoGen_eecAnalysis_akFlowJets_mAOD_4pC_wtaAxis_jetTrig_cutBadPhi_processed_2023-02-10.root
+    const Double_t vzCoefficients[7] = {1.0082, -0.0190011, 0.000779051, -2.15118e-05, -6.70894e-06, 1.47181e-07, 6.65274e-09};
+    SetPolynomial(fVzPolynomial, 6, vzCoefficients);
+    BuildTable(fVzTable, fVzPolynomial, -15, 15);
+
+    // The centrality weight function is rederived for the miniAOD dataset.
+    // Macro used for derivation: deriveMonteCarloWeights.C, Git hash: f95771aa3242a7a9ed385c1ff364500481088eec
+    // Input files: eecAnalysis_akFlowJets_wtaAxis_cutBadPhi_miniAODtesting_processed_2023-01-30.root
+    //              PbPbMC2018_RecoGen_eecAnalysis_akFlowJets_mAOD_4pC_wtaAxis_jetTrig_cutBadPhi_processed_2023-02-10.root
+    const Double_t centralCoefficients[7] = {4.44918,-0.0544424, -0.0248668,0.00254486,-0.000117819,2.65985e-06,-2.35606e-08};
+    const Double_t peripheralCoefficients[7] = {3.41938,-0.0643178, -0.00186948,7.67356e-05,-1.06981e-06,7.04102e-09,-1.84554e-11};
+    SetPolynomial(fCentralPolynomial, 6, centralCoefficients);
+    SetPolynomial(fPeripheralPolynomial, 6, peripheralCoefficients);
+    fUseCentralityPolynomials = true;
+
+  } else {
+    BuildTable(fVzTable, fVzPolynomial, 0, 0);
+  }
+
+  BuildCentralityTable();
+}
+
+/*
+ * Copy constructor
+ */
+WeightProvider::WeightProvider(const WeightProvider& in) :
+  fWeightSource(in.fWeightSource),
+  fVzPolynomial(in.fVzPolynomial),
+  fCentralPolynomial(in.fCentralPolynomial),
+  fPeripheralPolynomial(in.fPeripheralPolynomial),
+  fJetPtPolynomial(in.fJetPtPolynomial),
+  fUseCentralityPolynomials(in.fUseCentralityPolynomials),
+  fVzTable(in.fVzTable),
+  fJetPtTable(in.fJetPtTable),
+  fVzWeightHistogram(in.fVzWeightHistogram ? (TH1*)in.fVzWeightHistogram->Clone() : 0),
+  fCentralityWeightHistogram(in.fCentralityWeightHistogram ? (TH1*)in.fCentralityWeightHistogram->Clone() : 0),
+  fJetPtWeightHistogram(in.fJetPtWeightHistogram ? (TH1*)in.fJetPtWeightHistogram->Clone() : 0)
+{
+  // Copy constructor
+  for(Int_t iHiBin = 0; iHiBin <= kMaxHiBin; iHiBin++){
+    fCentralityTable[iHiBin] = in.fCentralityTable[iHiBin];
+  }
+}
+
+/*
+ * Destructor
+ */
+WeightProvider::~WeightProvider(){
+  // destructor
+  DeleteHistograms();
+}
+
+/*
+ * Equal sign operator
+ */
+WeightProvider& WeightProvider::operator=(const WeightProvider& in){
+  // Equal sign operator
+
+  if (&in==this) return *this;
+
+  fWeightSource = in.fWeightSource;
+  fVzPolynomial = in.fVzPolynomial;
+  fCentralPolynomial = in.fCentralPolynomial;
+  fPeripheralPolynomial = in.fPeripheralPolynomial;
+  fJetPtPolynomial = in.fJetPtPolynomial;
+  fUseCentralityPolynomials = in.fUseCentralityPolynomials;
+  fVzTable = in.fVzTable;
+  fJetPtTable = in.fJetPtTable;
+  for(Int_t iHiBin = 0; iHiBin <= kMaxHiBin; iHiBin++){
+    fCentralityTable[iHiBin] = in.fCentralityTable[iHiBin];
+  }
+
+  DeleteHistograms();
+  fVzWeightHistogram = in.fVzWeightHistogram ? (TH1*)in.fVzWeightHistogram->Clone() : 0;
+  fCentralityWeightHistogram = in.fCentralityWeightHistogram ? (TH1*)in.fCentralityWeightHistogram->Clone() : 0;
+  fJetPtWeightHistogram = in.fJetPtWeightHistogram ? (TH1*)in.fJetPtWeightHistogram->Clone() : 0;
+
+  return *this;
+}
+
+/*
+ * Delete the weight histograms
+ */
+void WeightProvider::DeleteHistograms(){
+  if(fVzWeightHistogram) delete fVzWeightHistogram;
+  if(fCentralityWeightHistogram) delete fCentralityWeightHistogram;
+  if(fJetPtWeightHistogram) delete fJetPtWeightHistogram;
+  fVzWeightHistogram = 0;
+  fCentralityWeightHistogram = 0;
+  fJetPtWeightHistogram = 0;
+}
+
+/*
+ * Set the coefficients for a polynomial
+ *
+ *  Arguments:
+ *   WeightPolynomial &polynomial = Polynomial that is set
+ *   Int_t degree = Degree of the polynomial
+ *   const Double_t *coefficients = Array of degree+1 coefficients starting from the constant term
+ */
+void WeightProvider::SetPolynomial(WeightPolynomial &polynomial, Int_t degree, const Double_t *coefficients){
+  assert(degree >= 0 && degree <= WeightPolynomial::kMaxDegree);
+  polynomial.fDegree = degree;
+  for(Int_t iDegree = 0; iDegree <= WeightPolynomial::kMaxDegree; iDegree++){
+    polynomial.fCoefficient[iDegree] = (iDegree <= degree) ? coefficients[iDegree] : 0;
+  }
+}
+
+/*
+ * Tabulate a polynomial for linear interpolation. For linear interpolation with node spacing h the error is
+ * bounded by h^2/8 * max|f''|. The second derivative is bounded by sum_k k(k-1)|c_k| M^(k-2), where M is the
+ * largest absolute value in the range. The node spacing is chosen such that this bound is below the tolerance,
+ * after which the error is verified at the midpoints and quarter points of all the intervals.
+ *
+ *  Arguments:
+ *   WeightTable &table = Table that is built
+ *   const WeightPolynomial &polynomial = Tabulated polynomial
+ *   Double_t minimum = Lower edge of the table range
+ *   Double_t maximum = Upper edge of the table range. If not above minimum, the table is left empty.
+ */
+void WeightProvider::BuildTable(WeightTable &table, const WeightPolynomial &polynomial, Double_t minimum, Double_t maximum){
+
+  // Empty table does not cover any values
+  table.fMinimum = minimum;
+  table.fMaximum = minimum;
+  table.fInverseStep = 0;
+  table.fErrorBound = 0;
+  table.fMaximumError = 0;
+  table.fValues.clear();
+  if(maximum <= minimum) return;
+
+  // Bound for the second derivative of the polynomial in the table range
+  Double_t largestValue = TMath::Max(TMath::Abs(minimum), TMath::Abs(maximum));
+  Double_t secondDerivativeBound = 0;
+  for(Int_t iDegree = 2; iDegree <= polynomial.fDegree; iDegree++){
+    secondDerivativeBound += iDegree*(iDegree-1)*TMath::Abs(polynomial.fCoefficient[iDegree])*TMath::Power(largestValue,iDegree-2);
+  }
+
+  // Find the number of intervals needed to reach the tolerance
+  Int_t nIntervals = 1;
+  if(secondDerivativeBound > 0){
+    Double_t maximumStep = TMath::Sqrt(8*kTableTolerance/secondDerivativeBound);
+    nIntervals = (Int_t)std::ceil((maximum - minimum) / maximumStep);
+  }
+  if(nIntervals > kMaxTableNodes-1){
+    cout << "ERROR: Weight table would need more than " << kMaxTableNodes << " nodes to reach the tolerance " << kTableTolerance << endl;
+    assert(0);
+  }
+
+  // Fill the table
+  Double_t step = (maximum - minimum) / nIntervals;
+  table.fMaximum = maximum;
+  table.fInverseStep = nIntervals / (maximum - minimum);
+  table.fErrorBound = step*step/8*secondDerivativeBound;
+  table.fValues.resize(nIntervals+1);
+  for(Int_t iNode = 0; iNode <= nIntervals; iNode++){
+    table.fValues[iNode] = polynomial.Eval(minimum + iNode*step);
+  }
+
+  // Verify the interpolation error inside each interval
+  Double_t position, error;
+  for(Int_t iNode = 0; iNode < nIntervals; iNode++){
+    for(Int_t iPoint = 1; iPoint < 4; iPoint++){
+      position = minimum + (iNode + iPoint/4.0)*step;
+      error = TMath::Abs(table.Interpolate(position) - polynomial.Eval(position));
+      if(error > table.fMaximumError) table.fMaximumError = error;
+    }
+  }
+  if(table.fMaximumError > kTableTolerance){
+    cout << "ERROR: Weight table interpolation error " << table.fMaximumError << " is above the tolerance " << kTableTolerance << endl;
+    assert(0);
+  }
+}
+
+/*
+ * Tabulate the centrality weight for each hiBin between 0 and 200
+ */
+void WeightProvider::BuildCentralityTable(){
+  for(Int_t iHiBin = 0; iHiBin <= kMaxHiBin; iHiBin++){
+    fCentralityTable[iHiBin] = CalculateCentralityWeight(iHiBin);
+  }
+}
+
+/*
+ * Calculate the centrality weight without the table
+ *
+ *  Arguments:
+ *   const Int_t hiBin = CMS hiBin
+ *
+ *   return: Multiplicative correction factor for the given CMS hiBin
+ */
+Double_t WeightProvider::CalculateCentralityWeight(const Int_t hiBin) const{
+
+  // Centrality weight histograms are given as a function of centrality percentile
+  if(fWeightSource == kHistogram) return GetHistogramWeight(fCentralityWeightHistogram, hiBin/2.0);
+
+  if(!fUseCentralityPolynomials) return 1;
+
+  // No weighting for the most peripheral centrality bins. Different weight function for central and peripheral.
+  if(hiBin < 60) return fCentralPolynomial.Eval(hiBin/2.0);
+  return (hiBin < 194) ? fPeripheralPolynomial.Eval(hiBin/2.0) : 1;
+}
+
+/*
+ * Read a weight from a histogram. Values outside of the histogram range get the weight from the closest bin.
+ *
+ *  Arguments:
+ *   const TH1 *histogram = Weight histogram. If null, the weight is one.
+ *   const Double_t value = Value for which the weight is read
+ *
+ *   return: Multiplicative correction factor for the value
+ */
+Double_t WeightProvider::GetHistogramWeight(const TH1 *histogram, const Double_t value) const{
+  if(histogram == NULL) return 1;
+  Int_t bin = histogram->GetXaxis()->FindFixBin(value);
+  if(bin < 1) bin = 1;
+  if(bin > histogram->GetNbinsX()) bin = histogram->GetNbinsX();
+  return histogram->GetBinContent(bin);
+}
+
+/*
+ * Replace the polynomial weights by histograms read from a file. The histograms are searched with the names
+ * vzWeight (as a function of vz), centralityWeight (as a function of centrality percentile) and jetPtWeight
+ * (as a function of jet pT). If a histogram is not found from the file, the corresponding weight is one.
+ *
+ *  Arguments:
+ *   TString fileName = Name of the file containing the weight histograms
+ */
+void WeightProvider::LoadHistogramWeights(TString fileName){
+
+  TFile *weightFile = TFile::Open(fileName);
+  if(weightFile == NULL || weightFile->IsZombie()){
+    cout << "ERROR: Could not open weight file " << fileName.Data() << endl;
+    assert(0);
+  }
+
+  // Read the histograms and detach them from the file
+  const char *histogramNames[3] = {"vzWeight", "centralityWeight", "jetPtWeight"};
+  TH1 *histograms[3];
+  for(Int_t iHistogram = 0; iHistogram < 3; iHistogram++){
+    histograms[iHistogram] = (TH1*) weightFile->Get(histogramNames[iHistogram]);
+    if(histograms[iHistogram] == NULL){
+      cout << "Warning: Histogram " << histogramNames[iHistogram] << " not found from " << fileName.Data() << ". Using weight one." << endl;
+      continue;
+    }
+    histograms[iHistogram] = (TH1*) histograms[iHistogram]->Clone();
+    histograms[iHistogram]->SetDirectory(0);
+  }
+  weightFile->Close();
+  delete weightFile;
+
+  DeleteHistograms();
+  fVzWeightHistogram = histograms[0];
+  fCentralityWeightHistogram = histograms[1];
+  fJetPtWeightHistogram = histograms[2];
+  fWeightSource = kHistogram;
+
+  // The centrality weights are tabulated also from histograms
+  BuildCentralityTable();
+}
+
+/*
+ * Print the verified interpolation errors to console
+ */
+void WeightProvider::PrintTableErrors() const{
+  if(fWeightSource == kHistogram){
+    cout << "Weights are read from histograms" << endl;
+    return;
+  }
+  cout << Form("vz weight table: %d nodes, error bound %g, largest verified error %g", (Int_t)fVzTable.fValues.size(), fVzTable.fErrorBound, fVzTable.fMaximumError) << endl;
+  cout << Form("jet pT weight table: %d nodes, error bound %g, largest verified error %g", (Int_t)fJetPtTable.fValues.size(), fJetPtTable.fErrorBound, fJetPtTable.fMaximumError) << endl;
+}
+
+// Getter for the source of the weights
+Int_t WeightProvider::GetWeightSource() const{
+  return fWeightSource;
+}
@@ -0,0 +1,148 @@
+// Provider for the Monte Carlo weights in vz, centrality and jet pT
+
+#ifndef WEIGHTPROVIDER_H
+#define WEIGHTPROVIDER_H
+
+// C++ includes
+#include <iostream>
+#include <vector>
+
+// Root includes
+#include <TString.h>
+#include <TFile.h>
+#include <TH1.h>
+
+/*
+ * Polynomial weight function evaluated inline with Horner's method
+ */
+struct WeightPolynomial{
+
+  static const Int_t kMaxDegree = 6;      // Highest supported polynomial degree
+
+  Int_t fDegree;                          // Degree of the polynomial
+  Double_t fCoefficient[kMaxDegree+1];    // Coefficients starting from the constant term
+
+  // Evaluate the polynomial at x
+  inline Double_t Eval(const Double_t x) const{
+    Double_t value = fCoefficient[fDegree];
+    for(Int_t iDegree = fDegree-1; iDegree >= 0; iDegree--){
+      value = value*x + fCoefficient[iDegree];
+    }
+    return value;
+  }
+};
+
+/*
+ * Table for a weight function with linear interpolation between equidistant nodes.
+ * Values outside of the table range are not covered by the table.
+ */
+struct WeightTable{
+
+  Double_t fMinimum;              // Lower edge of the table range
+  Double_t fMaximum;              // Upper edge of the table range
+  Double_t fInverseStep;          // Inverse of the distance between nodes
+  Double_t fErrorBound;           // Analytic upper bound for the interpolation error
+  Double_t fMaximumError;         // Largest interpolation error found when verifying the table
+  std::vector<Double_t> fValues;  // Function values at the nodes
+
+  // Check if x is covered by the table. False also for NaN.
+  inline Bool_t Covers(const Double_t x) const{
+    return x >= fMinimum && x < fMaximum;
+  }
+
+  // Interpolate the function value at x. The value must be covered by the table.
+  inline Double_t Interpolate(const Double_t x) const{
+    Double_t position = (x - fMinimum) * fInverseStep;
+    Int_t iNode = (Int_t)position;
+    if(iNode > (Int_t)fValues.size() - 2) iNode = fValues.size() - 2;
+    Double_t fraction = position - iNode;
+    return fValues[iNode] + fraction*(fValues[iNode+1] - fValues[iNode]);
+  }
+};
+
+/*
+ * WeightProvider class
+ *
+ * Gives the vz, centrality and jet pT weights for Monte Carlo. By default the weights are the polynomial fits
+ * derived for the 2017 pp and 2018 PbPb Monte Carlo. The centrality weight is tabulated exactly for each hiBin
+ * between 0 and 200. The vz and jet pT weights are interpolated from tables inside the fit ranges, where the
+ * node spacing is chosen from an analytic bound for the interpolation error and the result is verified when
+ * the tables are built. Outside of the table ranges the polynomials are evaluated directly. Alternatively the
+ * weights can be read from histograms in a file.
+ */
+class WeightProvider{
+
+public:
+
+  // Possible sources for the weights
+  enum enumWeightSource{kPolynomial, kHistogram, knWeightSources};
+
+  static constexpr Double_t kTableTolerance = 1e-6;  // Maximum allowed interpolation error in the tables
+  static const Int_t kMaxTableNodes = 100000;       // Maximum number of nodes in a table
+  static const Int_t kMaxHiBin = 200;               // Largest tabulated hiBin
+
+  // Constructors and destructor
+  WeightProvider(); // Default constructor
+  WeightProvider(Int_t dataType); // Custom constructor
+  WeightProvider(const WeightProvider& in); // Copy constructor
+  ~WeightProvider(); // Destructor
+  WeightProvider& operator=(const WeightProvider& in); // Equal sign operator
+
+  // Methods
+  void LoadHistogramWeights(TString fileName); // Replace the polynomial weights by histograms from a file
+  void PrintTableErrors() const;               // Print the verified interpolation errors to console
+  Int_t GetWeightSource() const;               // Getter for the source of the weights
+
+  // Weight for vertex z position
+  inline Double_t GetVzWeight(const Double_t vz) const{
+    if(fWeightSource == kHistogram) return GetHistogramWeight(fVzWeightHistogram, vz);
+    if(fVzTable.Covers(vz)) return fVzTable.Interpolate(vz);
+    return fVzPolynomial.Eval(vz);
+  }
+
+  // Weight for CMS hiBin
+  inline Double_t GetCentralityWeight(const Int_t hiBin) const{
+    if(hiBin >= 0 && hiBin <= kMaxHiBin) return fCentralityTable[hiBin];
+    return CalculateCentralityWeight(hiBin);
+  }
+
+  // Weight for jet pT
+  inline Double_t GetJetPtWeight(const Double_t jetPt) const{
+    if(fWeightSource == kHistogram) return GetHistogramWeight(fJetPtWeightHistogram, jetPt);
+    if(fJetPtTable.Covers(jetPt)) return fJetPtTable.Interpolate(jetPt);
+    return fJetPtPolynomial.Eval(jetPt);
+  }
+
+private:
+
+  // Private methods
+  void SetPolynomial(WeightPolynomial &polynomial, Int_t degree, const Double_t *coefficients); // Set the coefficients for a polynomial
+  void BuildTable(WeightTable &table, const WeightPolynomial &polynomial, Double_t minimum, Double_t maximum); // Tabulate a polynomial with verified error
+  void BuildCentralityTable();                                  // Tabulate the centrality weight for each hiBin
+  Double_t CalculateCentralityWeight(const Int_t hiBin) const;  // Calculate the centrality weight without the table
+  Double_t GetHistogramWeight(const TH1 *histogram, const Double_t value) const; // Read a weight from a histogram
+  void DeleteHistograms();                                      // Delete the weight histograms
+
+  // Private data members
+  Int_t fWeightSource;                    // Source of the weights
+
+  // Polynomial weights
+  WeightPolynomial fVzPolynomial;                    // Weight function for vz
+  WeightPolynomial fCentralPolynomial;               // Weight function for central centrality classes
+  WeightPolynomial fPeripheralPolynomial;            // Weight function for peripheral centrality classes
+  WeightPolynomial fJetPtPolynomial;                 // Weight function for jet pT
+  Bool_t fUseCentralityPolynomials;                  // Apply the centrality weight functions
+
+  // Tables for the weights
+  WeightTable fVzTable;                              // Table for the vz weight
+  WeightTable fJetPtTable;                           // Table for the jet pT weight
+  Double_t fCentralityTable[kMaxHiBin+1];            // Centrality weight for each hiBin
+
+  // Histogram weights
+  TH1 *fVzWeightHistogram;                           // Weight histogram for vz
+  TH1 *fCentralityWeightHistogram;                   // Weight histogram for centrality
+  TH1 *fJetPtWeightHistogram;                        // Weight histogram for jet pT
+
+};
+
+#endif
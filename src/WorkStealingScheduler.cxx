@@ -0,0 +1,265 @@
+// Implementation for WorkStealingScheduler
+
+// C++ includes
+#include <thread>
+
+// Own includes
+#include "WorkStealingScheduler.h"
+
+using namespace std;
+
+/*
+ * Custom constructor
+ *
+ *  Arguments:
+ *   Int_t nWorkers = Number of worker threads processing the tasks
+ */
+WorkStealingScheduler::WorkStealingScheduler(Int_t nWorkers) :
+  fnWorkers(nWorkers > 0 ? nWorkers : 1),
+  fTaskQueue(fnWorkers),
+  fQueueMutex(fnWorkers),
+  fnPendingTasks(0),
+  fnQueuedTasks(0),
+  fIdleMutex(),
+  fTaskAvailable(),
+  fBusyTime(fnWorkers,0),
+  fIdleTime(fnWorkers,0),
+  fnProcessedTasks(fnWorkers,0),
+  fnStolenTasks(fnWorkers,0)
+{
+  // Custom constructor
+
+}
+
+/*
+ * Destructor
+ */
+WorkStealingScheduler::~WorkStealingScheduler(){
+  // destructor
+}
+
+/*
+ * Add a task to the end of the queue of a worker. Used to give the initial tasks to the workers.
+ *
+ *  Arguments:
+ *   Int_t iWorker = Index of the worker to which the task is given
+ *   const AnalysisTask& task = Task added to the queue
+ */
+void WorkStealingScheduler::PushTask(Int_t iWorker, const AnalysisTask& task){
+  fnPendingTasks++;
+  {
+    lock_guard<mutex> queueLock(fQueueMutex.at(iWorker));
+    fTaskQueue.at(iWorker).push_back(task);
+  }
+  fnQueuedTasks++;
+  NotifyIdleWorkers();
+}
+
+/*
+ * Add tasks to the front of the queue of a worker. Used when a worker splits a file into clusters.
+ * The worker continues with the clusters in the order they are given, while other workers steal
+ * from the back of the queue.
+ *
+ *  Arguments:
+ *   Int_t iWorker = Index of the worker to which the tasks are given
+ *   const std::vector<AnalysisTask>& tasks = Tasks added to the queue
+ */
+void WorkStealingScheduler::PushSubtasks(Int_t iWorker, const std::vector<AnalysisTask>& tasks){
+  if(tasks.empty()) return;
+  fnPendingTasks += tasks.size();
+  {
+    lock_guard<mutex> queueLock(fQueueMutex.at(iWorker));
+    fTaskQueue.at(iWorker).insert(fTaskQueue.at(iWorker).begin(), tasks.begin(), tasks.end());
+  }
+  fnQueuedTasks += tasks.size();
+  NotifyIdleWorkers();
+}
+
+/*
+ * Wake up the workers waiting for tasks. The lock is taken before notifying, so a worker that has just checked the
+ * counters and is about to wait cannot miss the notification.
+ */
+void WorkStealingScheduler::NotifyIdleWorkers(){
+  lock_guard<mutex> idleLock(fIdleMutex);
+  fTaskAvailable.notify_all();
+}
+
+/*
+ * Take a task from the front of the own queue of a worker
+ *
+ *  Arguments:
+ *   Int_t iWorker = Index of the worker asking for a task
+ *   AnalysisTask &task = Found task is written here
+ *
+ *   return: True if a task was found, false if the queue is empty
+ */
+Bool_t WorkStealingScheduler::PopTask(Int_t iWorker, AnalysisTask &task){
+  lock_guard<mutex> queueLock(fQueueMutex.at(iWorker));
+  if(fTaskQueue.at(iWorker).empty()) return false;
+  task = fTaskQueue.at(iWorker).front();
+  fTaskQueue.at(iWorker).pop_front();
+  fnQueuedTasks--;
+  return true;
+}
+
+/*
+ * Take a task from the back of the queue of another worker. Unsplit files are at the back of the
+ * queues, so these are stolen before the clusters of files another worker is already reading.
+ * Clusters are stolen in a batch: half of the clusters of the same file at the back of the victim
+ * queue are moved to the front of the own queue. This way the thief reads a contiguous range from
+ * one file and does not need to open a different file for each stolen cluster.
+ *
+ *  Arguments:
+ *   Int_t iWorker = Index of the worker asking for a task
+ *   AnalysisTask &task = Found task is written here
+ *
+ *   return: True if a task was stolen, false if all the other queues are empty
+ */
+Bool_t WorkStealingScheduler::StealTask(Int_t iWorker, AnalysisTask &task){
+
+  // Stolen clusters in increasing entry order
+  deque<AnalysisTask> stolenTasks;
+
+  // Go through the other workers starting from the next one, so that victims are spread evenly
+  for(Int_t iOffset = 1; iOffset < fnWorkers; iOffset++){
+    Int_t iVictim = (iWorker + iOffset) % fnWorkers;
+    lock_guard<mutex> queueLock(fQueueMutex.at(iVictim));
+    deque<AnalysisTask> &victimQueue = fTaskQueue.at(iVictim);
+    if(victimQueue.empty()) continue;
+    stolenTasks.push_front(victimQueue.back());
+    victimQueue.pop_back();
+
+    // Count the clusters of the same file left at the back of the queue and take half of them
+    if(stolenTasks.front().fLastEntry >= 0){
+      Int_t nSameFile = 0;
+      for(auto queuedTask = victimQueue.rbegin(); queuedTask != victimQueue.rend(); queuedTask++){
+        if(queuedTask->fFileIndex != stolenTasks.front().fFileIndex || queuedTask->fLastEntry < 0) break;
+        nSameFile++;
+      }
+      for(Int_t iStolen = 0; iStolen < (nSameFile+1)/2; iStolen++){
+        stolenTasks.push_front(victimQueue.back());
+        victimQueue.pop_back();
+      }
+    }
+    break;
+  }
+
+  if(stolenTasks.empty()) return false;
+
+  // Process the first stolen task now and queue the rest. They stay counted as queued tasks.
+  task = stolenTasks.front();
+  stolenTasks.pop_front();
+  fnQueuedTasks--;
+  fnStolenTasks.at(iWorker) += stolenTasks.size() + 1;
+  if(!stolenTasks.empty()){
+    lock_guard<mutex> queueLock(fQueueMutex.at(iWorker));
+    fTaskQueue.at(iWorker).insert(fTaskQueue.at(iWorker).begin(), stolenTasks.begin(), stolenTasks.end());
+  }
+
+  return true;
+}
+
+/*
+ * Main loop for one worker. Process tasks until there are no queued or running tasks left.
+ *
+ *  Arguments:
+ *   Int_t iWorker = Index of the worker
+ *   std::function<void(Int_t, const AnalysisTask&)> processTask = Function processing one task
+ */
+void WorkStealingScheduler::WorkerLoop(Int_t iWorker, std::function<void(Int_t, const AnalysisTask&)> processTask){
+
+  AnalysisTask task;
+  chrono::steady_clock::time_point startTime;
+  chrono::steady_clock::time_point idleStartTime = chrono::steady_clock::now();
+
+  while(true){
+
+    // First try to get a task from own queue, then from the queues of other workers
+    Bool_t foundTask = PopTask(iWorker, task);
+    if(!foundTask) foundTask = StealTask(iWorker, task);
+
+    // If there are no tasks available, sleep until new tasks are queued or all the running tasks are finished.
+    // Running tasks can still give new subtasks.
+    if(!foundTask){
+      if(fnPendingTasks == 0) break;
+      unique_lock<mutex> idleLock(fIdleMutex);
+      fTaskAvailable.wait(idleLock, [this]{ return fnQueuedTasks > 0 || fnPendingTasks == 0; });
+      continue;
+    }
+
+    // Process the task and record the time spent on it
+    startTime = chrono::steady_clock::now();
+    fIdleTime.at(iWorker) += chrono::duration<Double_t>(startTime - idleStartTime).count();
+    processTask(iWorker, task);
+    idleStartTime = chrono::steady_clock::now();
+    fBusyTime.at(iWorker) += chrono::duration<Double_t>(idleStartTime - startTime).count();
+    fnProcessedTasks.at(iWorker)++;
+    if(--fnPendingTasks == 0) NotifyIdleWorkers();
+
+  }
+
+  // Time waiting for the other workers to finish the last tasks is idle time
+  fIdleTime.at(iWorker) += chrono::duration<Double_t>(chrono::steady_clock::now() - idleStartTime).count();
+}
+
+/*
+ * Process all the tasks. The first worker runs in the calling thread and the rest in new threads.
+ *
+ *  Arguments:
+ *   std::function<void(Int_t, const AnalysisTask&)> processTask = Function processing one task. Arguments are worker index and task.
+ */
+void WorkStealingScheduler::Run(std::function<void(Int_t, const AnalysisTask&)> processTask){
+
+  // Start the worker threads
+  vector<thread> workerThreads;
+  for(Int_t iWorker = 1; iWorker < fnWorkers; iWorker++){
+    workerThreads.push_back(thread(&WorkStealingScheduler::WorkerLoop, this, iWorker, processTask));
+  }
+
+  // Use the calling thread as the first worker
+  WorkerLoop(0, processTask);
+
+  // Wait until all the workers are done
+  for(thread &workerThread : workerThreads){
+    workerThread.join();
+  }
+
+}
+
+/*
+ * Print busy and idle times for each worker to the console
+ */
+void WorkStealingScheduler::PrintStatistics() const{
+
+  cout << endl << "======== Worker statistics ========" << endl;
+  for(Int_t iWorker = 0; iWorker < fnWorkers; iWorker++){
+    cout << Form("Worker %2d: busy %9.2f s, idle %9.2f s, tasks %6d, stolen %6d", iWorker, fBusyTime.at(iWorker), fIdleTime.at(iWorker), fnProcessedTasks.at(iWorker), fnStolenTasks.at(iWorker)) << endl;
+  }
+  cout << endl;
+
+}
+
+// Getter for the number of workers
+Int_t WorkStealingScheduler::GetNWorkers() const{
+  return fnWorkers;
+}
+
+// Getter for the time a worker spent processing tasks
+Double_t WorkStealingScheduler::GetBusyTime(Int_t iWorker) const{
+  return fBusyTime.at(iWorker);
+}
+
+// Getter for the time a worker spent waiting for tasks
+Double_t WorkStealingScheduler::GetIdleTime(Int_t iWorker) const{
+  return fIdleTime.at(iWorker);
+}
+
+// Getter for the number of tasks processed by a worker
+Int_t WorkStealingScheduler::GetNProcessedTasks(Int_t iWorker) const{
+  return fnProcessedTasks.at(iWorker);
+}
+
+// Getter for the number of tasks a worker stole from others
+Int_t WorkStealingScheduler::GetNStolenTasks(Int_t iWorker) const{
+  return fnStolenTasks.at(iWorker);
+}
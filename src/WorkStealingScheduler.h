@@ -0,0 +1,76 @@
+// Scheduler distributing analysis tasks to worker threads. Idle workers steal tasks from busy ones.
+
+#ifndef WORKSTEALINGSCHEDULER_H
+#define WORKSTEALINGSCHEDULER_H
+
+// C++ includes
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+
+// Root includes
+#include <TString.h>
+
+/*
+ * Unit of work for the scheduler: a range of entries from one file in the input file list.
+ * A task with negative last entry covers the whole file. Such a task is split into TTree clusters
+ * by the worker that picks it up.
+ */
+struct AnalysisTask{
+  Int_t fFileIndex;      // Index of the file in the input file list
+  Long64_t fFirstEntry;  // First entry included in the task
+  Long64_t fLastEntry;   // One past the last entry included in the task. Negative if the file is not split yet.
+};
+
+class WorkStealingScheduler{
+
+public:
+
+  // Constructors and destructor
+  WorkStealingScheduler(Int_t nWorkers); // Custom constructor
+  ~WorkStealingScheduler();              // Destructor
+
+  // Methods
+  void PushTask(Int_t iWorker, const AnalysisTask& task);                  // Add a task to the end of the queue of a worker
+  void PushSubtasks(Int_t iWorker, const std::vector<AnalysisTask>& tasks); // Add tasks to the front of the queue of a worker
+  void Run(std::function<void(Int_t, const AnalysisTask&)> processTask);   // Process all the tasks with the worker threads
+  void PrintStatistics() const;                                            // Print busy and idle times for each worker
+
+  // Getters
+  Int_t GetNWorkers() const;                    // Getter for the number of workers
+  Double_t GetBusyTime(Int_t iWorker) const;    // Getter for the time a worker spent processing tasks
+  Double_t GetIdleTime(Int_t iWorker) const;    // Getter for the time a worker spent waiting for tasks
+  Int_t GetNProcessedTasks(Int_t iWorker) const; // Getter for the number of tasks processed by a worker
+  Int_t GetNStolenTasks(Int_t iWorker) const;    // Getter for the number of tasks a worker stole from others
+
+private:
+
+  // Private methods
+  Bool_t PopTask(Int_t iWorker, AnalysisTask &task);   // Take a task from the front of the own queue
+  Bool_t StealTask(Int_t iWorker, AnalysisTask &task); // Take a task from the back of the queue of another worker
+  void WorkerLoop(Int_t iWorker, std::function<void(Int_t, const AnalysisTask&)> processTask); // Main loop for one worker
+  void NotifyIdleWorkers();                            // Wake up the workers waiting for tasks
+
+  // Private data members
+  Int_t fnWorkers;                                  // Number of worker threads
+  std::vector<std::deque<AnalysisTask>> fTaskQueue; // Local task queue for each worker
+  std::vector<std::mutex> fQueueMutex;              // Lock for the task queue of each worker
+  std::atomic<Long64_t> fnPendingTasks;             // Number of tasks that are queued or being processed
+  std::atomic<Long64_t> fnQueuedTasks;              // Number of tasks waiting in the queues
+  std::mutex fIdleMutex;                            // Lock for the idle workers waiting for new tasks
+  std::condition_variable fTaskAvailable;           // Wakes up the idle workers when tasks are added or all tasks are done
+
+  // Statistics for each worker
+  std::vector<Double_t> fBusyTime;      // Time in seconds spent processing tasks
+  std::vector<Double_t> fIdleTime;      // Time in seconds spent without a task to process
+  std::vector<Int_t> fnProcessedTasks;  // Number of tasks processed
+  std::vector<Int_t> fnStolenTasks;     // Number of tasks stolen from other workers
+
+};
+
+#endif
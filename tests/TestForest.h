@@ -0,0 +1,213 @@
+// Small generated forests and configuration cards for the test programs that run the full analysis
+
+#ifndef TESTFOREST_H
+#define TESTFOREST_H
+
+// C++ includes
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <random>
+
+// Root includes
+#include <TFile.h>
+#include <TTree.h>
+#include <TDirectory.h>
+#include <TString.h>
+#include <TMath.h>
+
+// Own includes
+#include "ForestReader.h"
+#include "TriggerHistograms.h"
+
+/*
+ * Write a forest with random events containing all the branches read by ForestReader
+ *
+ * Some events fail the event filters or the vz cut, and every twentieth event has a negative hiBin as in the forests
+ * for events without a centrality. The jet triggers fire around their thresholds in the leading jet pT.
+ *
+ *  Arguments:
+ *   TString fileName = Name of the written file
+ *   Int_t dataType = Data type of the forest. 0 = pp, 1 = PbPb, 2 = ppMC, 3 = PbPbMC
+ *   Int_t jetType = Jet type for which the jet tree is written. See ForestReader::GetJetTreeName.
+ *   Int_t nEvents = Number of events in the forest
+ *   Int_t minJets = Minimum number of jets in an event
+ *   Int_t maxJets = Maximum number of jets in an event
+ *   Int_t eventsPerCluster = Number of events in each TTree cluster, so that the workers can split the file
+ *   UInt_t seed = Seed for the random numbers
+ */
+inline void WriteTestForest(TString fileName, Int_t dataType, Int_t jetType, Int_t nEvents, Int_t minJets, Int_t maxJets, Int_t eventsPerCluster, UInt_t seed){
+
+  const Bool_t isPp = (dataType == ForestReader::kPp || dataType == ForestReader::kPpMC);
+  const Double_t triggerThreshold[TriggerHistograms::knTriggerTypes] = {40, 60, 80, 100, 60, 80, 100};
+
+  // Variables for the branches
+  Float_t vz, ptHat, eventWeight;
+  Int_t hiBin;
+  UInt_t runNumber, lumiBlock;
+  ULong64_t eventNumber;
+  Int_t triggerBit[TriggerHistograms::knTriggerTypes];
+  Int_t prescaleNumerator = 1;
+  Int_t prescaleDenominator = 1;
+  Int_t primaryVertexFilter, hfCoincidenceFilter, clusterCompatibilityFilter, beamScrapingFilter;
+  Int_t nJets, nGenJets;
+  std::vector<Float_t> jetPt(maxJets), jetPhi(maxJets), jetEta(maxJets), jetWTAPhi(maxJets), jetWTAEta(maxJets), jetRawPt(maxJets), jetMaxTrackPt(maxJets);
+  std::vector<Float_t> genJetPt(maxJets), genJetPhi(maxJets), genJetEta(maxJets), genJetWTAPhi(maxJets), genJetWTAEta(maxJets);
+
+  TDirectory *currentDirectory = gDirectory;
+  TFile *forestFile = new TFile(fileName, "RECREATE");
+
+  // Heavy ion tree
+  forestFile->mkdir("hiEvtAnalyzer")->cd();
+  TTree *heavyIonTree = new TTree("HiTree", "HiTree");
+  heavyIonTree->Branch("vz", &vz, "vz/F");
+  heavyIonTree->Branch("hiBin", &hiBin, "hiBin/I");
+  heavyIonTree->Branch("run", &runNumber, "run/i");
+  heavyIonTree->Branch("lumi", &lumiBlock, "lumi/i");
+  heavyIonTree->Branch("evt", &eventNumber, "evt/l");
+  heavyIonTree->Branch("pthat", &ptHat, "pthat/F");
+  heavyIonTree->Branch("weight", &eventWeight, "weight/F");
+
+  // HLT tree. The prescales are one, so that the trigger weights are the same as the event weights.
+  forestFile->mkdir("hltanalysis")->cd();
+  TTree *hltTree = new TTree("HltTree", "HltTree");
+  TString triggerBranchName;
+  for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+    triggerBranchName = ForestReader::GetTriggerBranchName(dataType, iTrigger);
+    hltTree->Branch(triggerBranchName, &triggerBit[iTrigger], triggerBranchName + "/I");
+    if(isPp){
+      hltTree->Branch(triggerBranchName + "_Prescl", &prescaleNumerator, triggerBranchName + "_Prescl/I");
+    } else {
+      hltTree->Branch(triggerBranchName + "_PrescaleNumerator", &prescaleNumerator, triggerBranchName + "_PrescaleNumerator/I");
+      hltTree->Branch(triggerBranchName + "_PrescaleDenominator", &prescaleDenominator, triggerBranchName + "_PrescaleDenominator/I");
+    }
+  }
+
+  // Skim tree
+  forestFile->mkdir("skimanalysis")->cd();
+  TTree *skimTree = new TTree("HltTree", "HltTree");
+  if(isPp){
+    skimTree->Branch("pPAprimaryVertexFilter", &primaryVertexFilter, "pPAprimaryVertexFilter/I");
+    skimTree->Branch("pBeamScrapingFilter", &beamScrapingFilter, "pBeamScrapingFilter/I");
+  } else {
+    skimTree->Branch("pprimaryVertexFilter", &primaryVertexFilter, "pprimaryVertexFilter/I");
+    skimTree->Branch("phfCoincFilter2Th4", &hfCoincidenceFilter, "phfCoincFilter2Th4/I");
+    skimTree->Branch("pclusterCompatibilityFilter", &clusterCompatibilityFilter, "pclusterCompatibilityFilter/I");
+  }
+
+  // Jet tree with both jet axes
+  TString jetDirectoryName = ForestReader::GetJetTreeName(dataType, jetType);
+  jetDirectoryName.Remove(jetDirectoryName.Index("/"));
+  forestFile->mkdir(jetDirectoryName)->cd();
+  TTree *jetTree = new TTree("t", "t");
+  jetTree->Branch("nref", &nJets, "nref/I");
+  jetTree->Branch("jtpt", jetPt.data(), "jtpt[nref]/F");
+  jetTree->Branch("jtphi", jetPhi.data(), "jtphi[nref]/F");
+  jetTree->Branch("jteta", jetEta.data(), "jteta[nref]/F");
+  jetTree->Branch("WTAphi", jetWTAPhi.data(), "WTAphi[nref]/F");
+  jetTree->Branch("WTAeta", jetWTAEta.data(), "WTAeta[nref]/F");
+  jetTree->Branch("rawpt", jetRawPt.data(), "rawpt[nref]/F");
+  jetTree->Branch("trackMax", jetMaxTrackPt.data(), "trackMax[nref]/F");
+  jetTree->Branch("ngen", &nGenJets, "ngen/I");
+  jetTree->Branch("genpt", genJetPt.data(), "genpt[ngen]/F");
+  jetTree->Branch("genphi", genJetPhi.data(), "genphi[ngen]/F");
+  jetTree->Branch("geneta", genJetEta.data(), "geneta[ngen]/F");
+  jetTree->Branch("WTAgenphi", genJetWTAPhi.data(), "WTAgenphi[ngen]/F");
+  jetTree->Branch("WTAgeneta", genJetWTAEta.data(), "WTAgeneta[ngen]/F");
+
+  // All the trees have the same clusters
+  TTree *forestTrees[4] = {heavyIonTree, hltTree, skimTree, jetTree};
+  for(TTree *tree : forestTrees) tree->SetAutoFlush(eventsPerCluster);
+
+  // Generate the events
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<Double_t> uniform(0, 1);
+  std::uniform_int_distribution<Int_t> jetNumberDistribution(minJets, maxJets);
+  std::uniform_int_distribution<Int_t> hiBinDistribution(0, 199);
+  std::exponential_distribution<Double_t> jetPtDistribution(1/30.0);
+  std::normal_distribution<Double_t> smearing(0, 10);
+  Double_t leadingJetPt;
+  for(Int_t iEvent = 0; iEvent < nEvents; iEvent++){
+
+    vz = 40*uniform(generator) - 20;
+    hiBin = (iEvent % 20 == 7) ? -1 : hiBinDistribution(generator);
+    runNumber = 326500 + iEvent % 3;
+    lumiBlock = 1 + iEvent / 50;
+    eventNumber = (ULong64_t)seed * 1000000 + iEvent;
+    ptHat = 15 + 300*uniform(generator);
+    eventWeight = 0.5 + uniform(generator);
+
+    primaryVertexFilter = (uniform(generator) < 0.97);
+    hfCoincidenceFilter = (uniform(generator) < 0.97);
+    clusterCompatibilityFilter = (uniform(generator) < 0.97);
+    beamScrapingFilter = (uniform(generator) < 0.97);
+
+    nJets = jetNumberDistribution(generator);
+    nGenJets = nJets;
+    leadingJetPt = 0;
+    for(Int_t iJet = 0; iJet < nJets; iJet++){
+      jetPt[iJet] = 10 + jetPtDistribution(generator);
+      jetPhi[iJet] = TMath::TwoPi()*uniform(generator) - TMath::Pi();
+      jetEta[iJet] = 4*uniform(generator) - 2;
+      jetWTAPhi[iJet] = jetPhi[iJet] + 0.02*(uniform(generator) - 0.5);
+      jetWTAEta[iJet] = jetEta[iJet] + 0.02*(uniform(generator) - 0.5);
+      jetRawPt[iJet] = jetPt[iJet]*(0.8 + 0.4*uniform(generator));
+      jetMaxTrackPt[iJet] = jetRawPt[iJet]*uniform(generator);
+      genJetPt[iJet] = jetPt[iJet]*(0.8 + 0.4*uniform(generator));
+      genJetPhi[iJet] = jetPhi[iJet];
+      genJetEta[iJet] = jetEta[iJet];
+      genJetWTAPhi[iJet] = jetWTAPhi[iJet];
+      genJetWTAEta[iJet] = jetWTAEta[iJet];
+      if(jetPt[iJet] > leadingJetPt) leadingJetPt = jetPt[iJet];
+    }
+
+    for(Int_t iTrigger = 0; iTrigger < TriggerHistograms::knTriggerTypes; iTrigger++){
+      triggerBit[iTrigger] = (leadingJetPt + smearing(generator) > triggerThreshold[iTrigger]);
+    }
+
+    for(TTree *tree : forestTrees) tree->Fill();
+  }
+
+  forestFile->Write();
+  forestFile->Close();
+  delete forestFile;
+  currentDirectory->cd();
+}
+
+/*
+ * Write a configuration card that is a copy of a template card with some of the values replaced. The same key
+ * cannot be given twice in a card, so the replaced lines are left out from the copy.
+ *
+ *  Arguments:
+ *   TString cardName = Name of the written card
+ *   TString templateCardName = Card from which the other lines are copied
+ *   const std::vector<std::pair<TString,TString>> &values = Keys and their new values. Keys that are not in the template are added to the end.
+ */
+inline void WriteTestCard(TString cardName, TString templateCardName, const std::vector<std::pair<TString,TString>> &values){
+  std::ifstream templateCard(templateCardName.Data());
+  std::ofstream card(cardName.Data());
+  std::vector<Bool_t> isWritten(values.size(), false);
+  std::string line;
+  std::string key;
+  Bool_t isReplaced;
+  while(std::getline(templateCard, line)){
+    std::istringstream lineStream(line);
+    key = "";
+    lineStream >> key;
+    isReplaced = false;
+    for(UInt_t iValue = 0; iValue < values.size(); iValue++){
+      if(key != values.at(iValue).first.Data()) continue;
+      card << values.at(iValue).first.Data() << " " << values.at(iValue).second.Data() << std::endl;
+      isWritten.at(iValue) = true;
+      isReplaced = true;
+    }
+    if(!isReplaced) card << line << std::endl;
+  }
+  for(UInt_t iValue = 0; iValue < values.size(); iValue++){
+    if(!isWritten.at(iValue)) card << values.at(iValue).first.Data() << " " << values.at(iValue).second.Data() << std::endl;
+  }
+}
+
+#endif
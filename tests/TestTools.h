@@ -0,0 +1,55 @@
+// Small helpers shared by the test programs in this directory
+
+#ifndef TESTTOOLS_H
+#define TESTTOOLS_H
+
+// C++ includes
+#include <iostream>
+
+// Root includes
+#include <Rtypes.h>
+#include <TMath.h>
+
+// Number of failed checks in the test program
+static Int_t gnFailedChecks = 0;
+
+/*
+ * Report a failed check
+ *
+ *  Arguments:
+ *   Bool_t condition = Checked condition. A failure is reported if this is false.
+ *   const char *description = Description of the check printed for failures
+ */
+inline void Check(Bool_t condition, const char *description){
+  if(condition) return;
+  std::cout << "Failed: " << description << std::endl;
+  gnFailedChecks++;
+}
+
+/*
+ * Check that two numbers agree within a relative tolerance
+ */
+inline void CheckClose(Double_t value, Double_t expected, Double_t tolerance, const char *description){
+  const Bool_t isClose = TMath::Abs(value - expected) <= tolerance * TMath::Max(1.0, TMath::Abs(expected));
+  if(!isClose) std::cout << "Got " << value << ", expected " << expected << std::endl;
+  Check(isClose, description);
+}
+
+/*
+ * Print the summary of the test program
+ *
+ *  Arguments:
+ *   const char *testName = Name of the test program
+ *
+ *   return: Exit code for the program. Nonzero if any of the checks failed.
+ */
+inline Int_t TestResult(const char *testName){
+  if(gnFailedChecks == 0){
+    std::cout << testName << ": all checks passed" << std::endl;
+    return 0;
+  }
+  std::cout << testName << ": " << gnFailedChecks << " checks failed" << std::endl;
+  return 1;
+}
+
+#endif
@@ -0,0 +1,110 @@
+// Benchmark for the event loop specialized at compile time: time per event for the generic and the specialized loop
+// on PbPb events with hundreds of jets, and a bin-by-bin comparison of their outputs with tests/compareOutputs
+
+// C++ includes
+#include <vector>
+#include <chrono>
+
+// Root includes
+#include <TFile.h>
+#include <TSystem.h>
+#include <TH1.h>
+
+// Own includes
+#include "ConfigurationCard.h"
+#include "TriggerAnalyzer.h"
+#include "TestTools.h"
+#include "TestForest.h"
+
+using namespace std;
+
+// Generated forests with the jet multiplicity of central PbPb events
+const Int_t knFiles = 2;
+const Int_t knEventsPerFile = 1000;
+const Int_t kMinJets = 300;
+const Int_t kMaxJets = 500;
+const Int_t knRepeats = 3;
+
+/*
+ * Run the analysis several times with the generic or the specialized event loop and write the output of the last run
+ *
+ *  Arguments:
+ *   ConfigurationCard *card = Card for the analysis
+ *   const std::vector<TString> &fileNames = Analyzed forests
+ *   Bool_t useGeneric = True for the generic event loop, false for the specialized one
+ *   TString outputFileName = File to which the histograms are written
+ *
+ *   return: Time in seconds of the fastest run
+ */
+Double_t TimeAnalysis(ConfigurationCard *card, const std::vector<TString> &fileNames, Bool_t useGeneric, TString outputFileName){
+  Double_t fastestTime = -1;
+  for(Int_t iRepeat = 0; iRepeat < knRepeats; iRepeat++){
+    TriggerAnalyzer *analyzer = new TriggerAnalyzer(fileNames, card);
+    analyzer->SetGenericEventLoop(useGeneric);
+    const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    analyzer->RunAnalysis();
+    const Double_t elapsedTime = chrono::duration<Double_t>(chrono::steady_clock::now() - startTime).count();
+    if(fastestTime < 0 || elapsedTime < fastestTime) fastestTime = elapsedTime;
+
+    if(iRepeat == knRepeats-1){
+      TFile *outputFile = new TFile(outputFileName, "RECREATE");
+      analyzer->WriteHistograms();
+      outputFile->Close();
+      delete outputFile;
+    }
+    delete analyzer;
+  }
+  return fastestTime;
+}
+
+/*
+ * Time the generic and the specialized event loop for one data type and compare their outputs
+ *
+ *  Arguments:
+ *   const char *title = Title printed before the timings
+ *   Int_t dataType = Analyzed data type. 1 = PbPb, 3 = PbPbMC
+ *
+ *   return: True if the outputs of the two loops agree exactly
+ */
+Bool_t BenchmarkDataType(const char *title, Int_t dataType){
+
+  std::vector<TString> fileNames;
+  for(Int_t iFile = 0; iFile < knFiles; iFile++){
+    fileNames.push_back(Form("benchmarkEventLoop_forest%d.root", iFile));
+    WriteTestForest(fileNames.back(), dataType, 3, knEventsPerFile, kMinJets, kMaxJets, 100, 31 + iFile);
+  }
+  TString cardName = "benchmarkEventLoop.input";
+  WriteTestCard(cardName, "cardTriggerPbPb.input", {{"DataType", Form("%d", dataType)}, {"LowPtHatCut", "0"}, {"HighPtHatCut", "5020"}, {"NumberOfThreads", "1"}, {"ProgressInterval", "0"}, {"DebugLevel", "0"}});
+  ConfigurationCard *card = new ConfigurationCard(cardName);
+
+  TString genericFileName = "benchmarkEventLoop_generic.root";
+  TString specializedFileName = "benchmarkEventLoop_specialized.root";
+  const Double_t genericTime = TimeAnalysis(card, fileNames, true, genericFileName);
+  const Double_t specializedTime = TimeAnalysis(card, fileNames, false, specializedFileName);
+
+  const Double_t nEvents = knFiles*knEventsPerFile;
+  cout << Form("%s: %d events with %d to %d jets, fastest of %d runs", title, knFiles*knEventsPerFile, kMinJets, kMaxJets, knRepeats) << endl;
+  cout << Form("%-18s %10.2f us/event", "generic loop", 1e6 * genericTime / nEvents) << endl;
+  cout << Form("%-18s %10.2f us/event", "specialized loop", 1e6 * specializedTime / nEvents) << endl;
+  cout << Form("%-18s %10.2f", "speedup", genericTime / specializedTime) << endl;
+
+  // The outputs are compared with the same program as the outputs from the real forests
+  const Bool_t sameOutput = (gSystem->Exec(Form("./tests/compareOutputs %s %s", genericFileName.Data(), specializedFileName.Data())) == 0);
+
+  delete card;
+  for(const TString &fileName : fileNames) gSystem->Unlink(fileName);
+  gSystem->Unlink(cardName);
+  gSystem->Unlink(genericFileName);
+  gSystem->Unlink(specializedFileName);
+  return sameOutput;
+}
+
+int main(){
+
+  TH1::AddDirectory(kFALSE); // The histograms with the same names are created for every run
+
+  // The specialized loop must give exactly the same histograms as the generic one
+  Check(BenchmarkDataType("Central PbPb data", ForestReader::kPbPb), "generic and specialized loops give the same output for PbPb data");
+  Check(BenchmarkDataType("Central PbPb MC", ForestReader::kPbPbMC), "generic and specialized loops give the same output for PbPb MC");
+  return TestResult("benchmarkEventLoop");
+}
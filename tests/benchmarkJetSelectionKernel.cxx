@@ -0,0 +1,134 @@
+// Benchmark for JetSelectionKernel: time per event for the double precision jet loop, the scalar kernel and the AVX2 kernel
+
+// C++ includes
+#include <vector>
+#include <random>
+#include <chrono>
+
+// Own includes
+#include "JetSelectionKernel.h"
+#include "TestTools.h"
+
+using namespace std;
+
+// Number of jets in the generated events: a typical forest, and central PbPb events with hundreds of jets where
+// the number of jets is rarely a multiple of the vector width
+const Int_t knJetsPerEvent = 40;
+const Int_t kMinHighMultiplicityJets = 300;
+const Int_t kMaxHighMultiplicityJets = 500;
+
+// The total number of jets is the same in both cases, so that the times per jet can be compared
+const Int_t knJetsTotal = 800000;
+const Int_t knRepeats = 50;
+
+/*
+ * Jet cuts as they are applied in the jet loop without the kernel
+ *
+ *  return: Index of the leading passing jet, or -1 if there is none
+ */
+Int_t ReferenceSelection(Int_t nJets, const Float_t *jetPt, const Float_t *jetPhi, const Float_t *jetEta, const Float_t *jetRawPt, const Float_t *jetMaxTrackPt){
+  Int_t leadingJetIndex = -1;
+  Double_t leadingJetPt = 0;
+  for(Int_t iJet = 0; iJet < nJets; iJet++){
+    if(TMath::Abs(jetEta[iJet]) >= 1.6) continue;
+    if(jetPhi[iJet] > -0.1 && jetPhi[iJet] < 1.2) continue;
+    if(0.01 >= jetMaxTrackPt[iJet]/jetRawPt[iJet]) continue;
+    if(0.98 <= jetMaxTrackPt[iJet]/jetRawPt[iJet]) continue;
+    if(jetPt[iJet] < 80) continue;
+    if(jetPt[iJet] > 5020) continue;
+    if(jetPt[iJet] > leadingJetPt){
+      leadingJetPt = jetPt[iJet];
+      leadingJetIndex = iJet;
+    }
+  }
+  return leadingJetIndex;
+}
+
+/*
+ * Time a selection function over all the generated events
+ *
+ *  Arguments:
+ *   const char *name = Name printed with the result
+ *   Int_t nEvents = Number of generated events
+ *   Long64_t nJets = Number of jets in all the events
+ *   Selection selectEvent = Selection for the event with the given index, returning the leading jet index
+ *
+ *   return: Sum of the leading jet indices, used to check that the selections agree
+ */
+template <typename Selection> Long64_t TimeSelection(const char *name, Int_t nEvents, Long64_t nJets, Selection selectEvent){
+  Long64_t indexSum = 0;
+  const chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+  for(Int_t iRepeat = 0; iRepeat < knRepeats; iRepeat++){
+    for(Int_t iEvent = 0; iEvent < nEvents; iEvent++) indexSum += selectEvent(iEvent);
+  }
+  const Double_t elapsedTime = chrono::duration<Double_t>(chrono::steady_clock::now() - startTime).count();
+  cout << Form("%-16s %10.2f ns/event %8.3f ns/jet", name, 1e9 * elapsedTime / ((Double_t)nEvents * knRepeats), 1e9 * elapsedTime / ((Double_t)nJets * knRepeats)) << endl;
+  return indexSum;
+}
+
+/*
+ * Generate events with a number of jets between the given limits and time the jet loop and the kernels on them
+ *
+ *  Arguments:
+ *   const char *title = Title printed before the timings
+ *   Int_t minJets = Smallest number of jets in an event
+ *   Int_t maxJets = Largest number of jets in an event
+ *
+ *   return: True if the kernels find the same leading jets as the jet loop
+ */
+Bool_t BenchmarkMultiplicity(const char *title, Int_t minJets, Int_t maxJets){
+
+  // Generate the jets for all the events in the layout of the forest arrays
+  std::mt19937 generator(12345);
+  std::uniform_int_distribution<Int_t> multiplicityDistribution(minJets, maxJets);
+  std::uniform_real_distribution<Float_t> ptDistribution(20, 300);
+  std::uniform_real_distribution<Float_t> phiDistribution(-3.2, 3.2);
+  std::uniform_real_distribution<Float_t> etaDistribution(-2.5, 2.5);
+  std::uniform_real_distribution<Float_t> fractionDistribution(0, 1);
+  std::vector<Int_t> eventOffset(1, 0);
+  while(eventOffset.back() < knJetsTotal) eventOffset.push_back(eventOffset.back() + multiplicityDistribution(generator));
+  const Int_t nEvents = eventOffset.size() - 1;
+  const Int_t nValues = eventOffset.back();
+  std::vector<Float_t> jetPt(nValues), jetPhi(nValues), jetEta(nValues), jetRawPt(nValues), jetMaxTrackPt(nValues);
+  for(Int_t iValue = 0; iValue < nValues; iValue++){
+    jetPt.at(iValue) = ptDistribution(generator);
+    jetPhi.at(iValue) = phiDistribution(generator);
+    jetEta.at(iValue) = etaDistribution(generator);
+    jetRawPt.at(iValue) = jetPt.at(iValue) * 0.9f;
+    jetMaxTrackPt.at(iValue) = jetRawPt.at(iValue) * fractionDistribution(generator);
+  }
+
+  JetSelectionKernel vectorKernel(1.6, 80, 5020, 0.01, 0.98);
+  JetSelectionKernel scalarKernel(1.6, 80, 5020, 0.01, 0.98);
+  scalarKernel.SetUseVectorInstructions(false);
+  ULong64_t passMask[JetSelectionKernel::knMaskWords];
+
+  cout << Form("%s: %d events with %d to %d jets", title, nEvents, minJets, maxJets) << endl;
+  const Long64_t referenceSum = TimeSelection("jet loop", nEvents, nValues, [&](Int_t iEvent){
+    const Int_t offset = eventOffset[iEvent];
+    return ReferenceSelection(eventOffset[iEvent+1] - offset, &jetPt[offset], &jetPhi[offset], &jetEta[offset], &jetRawPt[offset], &jetMaxTrackPt[offset]);
+  });
+  const Long64_t scalarSum = TimeSelection("scalar kernel", nEvents, nValues, [&](Int_t iEvent){
+    const Int_t offset = eventOffset[iEvent];
+    return scalarKernel.SelectJets<true,true>(eventOffset[iEvent+1] - offset, &jetPt[offset], &jetPhi[offset], &jetEta[offset], &jetRawPt[offset], &jetMaxTrackPt[offset], passMask);
+  });
+  Long64_t vectorSum = scalarSum;
+  if(vectorKernel.GetUseVectorInstructions()){
+    vectorSum = TimeSelection("AVX2 kernel", nEvents, nValues, [&](Int_t iEvent){
+      const Int_t offset = eventOffset[iEvent];
+      return vectorKernel.SelectJets<true,true>(eventOffset[iEvent+1] - offset, &jetPt[offset], &jetPhi[offset], &jetEta[offset], &jetRawPt[offset], &jetMaxTrackPt[offset], passMask);
+    });
+  } else {
+    cout << "AVX2 is not available on this processor" << endl;
+  }
+
+  return scalarSum == referenceSum && vectorSum == referenceSum;
+}
+
+int main(){
+
+  // The timed selections must find the same leading jets
+  Check(BenchmarkMultiplicity("Typical multiplicity", knJetsPerEvent, knJetsPerEvent), "kernels find the same leading jets as the jet loop");
+  Check(BenchmarkMultiplicity("Central PbPb multiplicity", kMinHighMultiplicityJets, kMaxHighMultiplicityJets), "kernels find the same leading jets as the jet loop in high multiplicity events");
+  return TestResult("benchmarkJetSelectionKernel");
+}
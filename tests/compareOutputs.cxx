@@ -0,0 +1,164 @@
+// Compare the histograms in two analysis output files bin by bin
+//
+// Used to check that a change meant only for speed, such as the event loop specialized at compile time, gives the
+// same output as before. Build the program with "make tests/compareOutputs", run the analysis with the old and the
+// new code on the same file list and a single thread, and compare:
+//
+//   ./tests/compareOutputs <reference.root> <candidate.root> [relative tolerance]
+//
+// The program returns nonzero if any histogram differs or is missing from one of the files. With several threads
+// the fills are summed in a different order, so a small tolerance is needed unless ReproducibleSums is used.
+// "make benchmark" runs it on the outputs of the generic and the specialized event loop from tests/benchmarkEventLoop.
+
+// C++ includes
+#include <iostream>
+#include <vector>
+
+// Root includes
+#include <TFile.h>
+#include <TKey.h>
+#include <TList.h>
+#include <TH1.h>
+#include <THnBase.h>
+#include <TMath.h>
+
+using namespace std;
+
+/*
+ * Check that two numbers agree within a relative tolerance
+ */
+Bool_t AreEqual(Double_t first, Double_t second, Double_t tolerance){
+  if(first == second) return true;
+  return TMath::Abs(first - second) <= tolerance * TMath::Max(TMath::Abs(first), TMath::Abs(second));
+}
+
+/*
+ * Compare two multidimensional histograms. Bins filled in only one of them must be empty in the other.
+ *
+ *  return: Number of differing bins
+ */
+Long64_t CompareHistograms(const THnBase *reference, THnBase *candidate, Double_t tolerance){
+  const Int_t nAxes = reference->GetNdimensions();
+  if(candidate->GetNdimensions() != nAxes) return 1;
+
+  Long64_t nDifferences = 0;
+  std::vector<Int_t> coordinates(nAxes);
+  Long64_t candidateBin;
+  Double_t candidateContent, candidateError2;
+  for(Long64_t iBin = 0; iBin < reference->GetNbins(); iBin++){
+    const Double_t referenceContent = reference->GetBinContent(iBin, coordinates.data());
+    candidateBin = candidate->GetBin(coordinates.data(), kFALSE);
+    candidateContent = (candidateBin < 0) ? 0 : candidate->GetBinContent(candidateBin);
+    candidateError2 = (candidateBin < 0) ? 0 : candidate->GetBinError2(candidateBin);
+    if(!AreEqual(referenceContent, candidateContent, tolerance) || !AreEqual(reference->GetBinError2(iBin), candidateError2, tolerance)) nDifferences++;
+  }
+
+  // Bins only filled in the candidate
+  Long64_t referenceBin;
+  THnBase *referenceCopy = const_cast<THnBase*>(reference);
+  for(Long64_t iBin = 0; iBin < candidate->GetNbins(); iBin++){
+    candidateContent = candidate->GetBinContent(iBin, coordinates.data());
+    referenceBin = referenceCopy->GetBin(coordinates.data(), kFALSE);
+    if(referenceBin < 0 && (candidateContent != 0 || candidate->GetBinError2(iBin) != 0)) nDifferences++;
+  }
+
+  if(!AreEqual(reference->GetEntries(), candidate->GetEntries(), tolerance)) nDifferences++;
+  return nDifferences;
+}
+
+/*
+ * Compare two one to three dimensional histograms
+ *
+ *  return: Number of differing bins
+ */
+Long64_t CompareHistograms(const TH1 *reference, const TH1 *candidate, Double_t tolerance){
+  if(reference->GetNcells() != candidate->GetNcells()) return 1;
+  Long64_t nDifferences = 0;
+  for(Int_t iBin = 0; iBin < reference->GetNcells(); iBin++){
+    if(!AreEqual(reference->GetBinContent(iBin), candidate->GetBinContent(iBin), tolerance)) nDifferences++;
+    else if(!AreEqual(reference->GetBinError(iBin), candidate->GetBinError(iBin), tolerance)) nDifferences++;
+  }
+  return nDifferences;
+}
+
+/*
+ * Compare the histograms in a directory and its subdirectories
+ *
+ *  Arguments:
+ *   TDirectory *reference = Directory in the reference file
+ *   TDirectory *candidate = Directory in the compared file
+ *   TString path = Path of the directory for the printouts
+ *   Double_t tolerance = Relative tolerance for the bin contents and errors
+ *
+ *   return: Number of histograms that differ or are missing
+ */
+Int_t CompareDirectories(TDirectory *reference, TDirectory *candidate, TString path, Double_t tolerance){
+  Int_t nDifferentHistograms = 0;
+  TIter nextKey(reference->GetListOfKeys());
+  TKey *key;
+  while((key = (TKey*)nextKey())){
+    TString name = key->GetName();
+    TObject *referenceObject = key->ReadObj();
+    TObject *candidateObject = candidate->Get(name);
+
+    // The card and other non-histogram objects are not compared
+    if(!referenceObject->InheritsFrom("TDirectory") && !referenceObject->InheritsFrom("TH1") && !referenceObject->InheritsFrom("THnBase")) continue;
+
+    if(!candidateObject){
+      cout << "Missing from the candidate: " << path << name << endl;
+      nDifferentHistograms++;
+      continue;
+    }
+
+    if(referenceObject->InheritsFrom("TDirectory")){
+      nDifferentHistograms += CompareDirectories((TDirectory*)referenceObject, (TDirectory*)candidateObject, path + name + "/", tolerance);
+      continue;
+    }
+
+    Long64_t nDifferences = 0;
+    if(referenceObject->InheritsFrom("THnBase")) nDifferences = CompareHistograms((THnBase*)referenceObject, (THnBase*)candidateObject, tolerance);
+    else nDifferences = CompareHistograms((TH1*)referenceObject, (TH1*)candidateObject, tolerance);
+
+    if(nDifferences > 0){
+      cout << "Histogram " << path << name << " differs in " << nDifferences << " bins" << endl;
+      nDifferentHistograms++;
+    }
+  }
+
+  // Histograms only in the candidate
+  TIter nextCandidateKey(candidate->GetListOfKeys());
+  while((key = (TKey*)nextCandidateKey())){
+    TString className = key->GetClassName();
+    if(!className.BeginsWith("TH") && !className.BeginsWith("TDirectory")) continue;
+    if(reference->GetListOfKeys()->FindObject(key->GetName())) continue;
+    cout << "Missing from the reference: " << path << key->GetName() << endl;
+    nDifferentHistograms++;
+  }
+
+  return nDifferentHistograms;
+}
+
+int main(int argc, char **argv){
+
+  if(argc < 3){
+    cout << "Usage: ./tests/compareOutputs <reference.root> <candidate.root> [relative tolerance]" << endl;
+    return 2;
+  }
+
+  const Double_t tolerance = (argc > 3) ? atof(argv[3]) : 0;
+  TFile *referenceFile = TFile::Open(argv[1]);
+  TFile *candidateFile = TFile::Open(argv[2]);
+  if(!referenceFile || referenceFile->IsZombie() || !candidateFile || candidateFile->IsZombie()){
+    cout << "Error! Could not open the compared files" << endl;
+    return 2;
+  }
+
+  const Int_t nDifferentHistograms = CompareDirectories(referenceFile, candidateFile, "", tolerance);
+  if(nDifferentHistograms > 0){
+    cout << nDifferentHistograms << " histograms differ" << endl;
+    return 1;
+  }
+
+  cout << "All histograms agree" << endl;
+  return 0;
+}
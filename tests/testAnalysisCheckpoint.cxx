@@ -0,0 +1,94 @@
+// Tests for AnalysisCheckpoint: counting the completed files for the checkpoint interval, and resuming from the units
+// written to a checkpoint file
+
+// C++ includes
+#include <vector>
+
+// Root includes
+#include <TFile.h>
+#include <TSystem.h>
+
+// Own includes
+#include "AnalysisCheckpoint.h"
+#include "TestTools.h"
+
+using namespace std;
+
+/*
+ * Create a unit of entries in a file
+ */
+AnalysisTask MakeUnit(Int_t fileIndex, Long64_t firstEntry, Long64_t lastEntry){
+  AnalysisTask unit;
+  unit.fFileIndex = fileIndex;
+  unit.fFirstEntry = firstEntry;
+  unit.fLastEntry = lastEntry;
+  return unit;
+}
+
+int main(){
+
+  const std::vector<TString> inputFileNames = {"forest_1.root", "forest_2.root"};
+  const Long64_t nFileEntries = 1000;
+
+  // ======== Checkpoint interval counted in completed files ========
+
+  AnalysisCheckpoint checkpoint("testCheckpoint.root", inputFileNames, 2, 1, 0);
+  Check(!checkpoint.IsDue(), "no checkpoint before any file is completed");
+
+  // Two workers share the clusters of the first file
+  checkpoint.AddCompletedUnit(0, MakeUnit(0, 0, 400), nFileEntries);
+  checkpoint.AddCompletedUnit(1, MakeUnit(0, 400, 800), nFileEntries);
+  Check(!checkpoint.IsDue(), "no checkpoint while the file is partially completed");
+  checkpoint.AddCompletedUnit(1, MakeUnit(0, 800, 1000), nFileEntries);
+  Check(checkpoint.IsDue(), "checkpoint is due when the file is completed");
+
+  // Only one worker gets to write the checkpoint
+  Check(checkpoint.TryBeginWrite(), "first worker begins writing");
+  Check(!checkpoint.TryBeginWrite(), "second worker does not write at the same time");
+  checkpoint.FinishWrite();
+  Check(!checkpoint.IsDue(), "checkpoint is not due right after writing");
+  Check(!checkpoint.TryBeginWrite(), "no write when the checkpoint is not due");
+
+  Check(checkpoint.GetWorkerUnits(0).size() == 1 && checkpoint.GetWorkerUnits(1).size() == 2, "completed units are kept for each worker");
+
+  // ======== Resuming from a checkpoint file ========
+
+  // The units of the first run are written to a checkpoint file and read back
+  std::vector<AnalysisTask> writtenUnits = {MakeUnit(0, 0, 1000), MakeUnit(1, 0, 300)};
+  checkpoint.AddCompletedUnit(0, MakeUnit(1, 0, 300), nFileEntries);
+  TString checkpointFileName = "testAnalysisCheckpoint_checkpoint0.root";
+  TFile *checkpointFile = TFile::Open(checkpointFileName, "RECREATE");
+  checkpoint.WriteUnits(writtenUnits);
+  checkpointFile->Close();
+  delete checkpointFile;
+
+  std::vector<AnalysisTask> previousUnits;
+  std::vector<Long64_t> previousFileEntries(inputFileNames.size(), -1);
+  Check(AnalysisCheckpoint::ReadUnits(checkpointFileName, inputFileNames, previousUnits, previousFileEntries), "checkpoint file is read");
+  gSystem->Unlink(checkpointFileName);
+  Check(previousUnits.size() == writtenUnits.size(), "all the units are read from the checkpoint");
+  Bool_t sameUnits = previousUnits.size() == writtenUnits.size();
+  for(UInt_t iUnit = 0; sameUnits && iUnit < writtenUnits.size(); iUnit++){
+    sameUnits = previousUnits.at(iUnit).fFileIndex == writtenUnits.at(iUnit).fFileIndex && previousUnits.at(iUnit).fFirstEntry == writtenUnits.at(iUnit).fFirstEntry && previousUnits.at(iUnit).fLastEntry == writtenUnits.at(iUnit).fLastEntry;
+  }
+  Check(sameUnits, "units read from the checkpoint are the written ones");
+  Check(previousFileEntries.at(0) == nFileEntries && previousFileEntries.at(1) == nFileEntries, "file sizes are read from the checkpoint");
+
+  // The resumed run completes the rest of the second file. The units of the previous run count for completing it.
+  AnalysisCheckpoint resumedCheckpoint("testCheckpoint1.root", inputFileNames, 1, 1, 0);
+  resumedCheckpoint.SetPreviousUnits(previousUnits, previousFileEntries);
+  resumedCheckpoint.AddCompletedUnit(0, MakeUnit(1, 300, 900), nFileEntries);
+  Check(!resumedCheckpoint.IsDue(), "resumed file is not completed before its last unit");
+  resumedCheckpoint.AddCompletedUnit(0, MakeUnit(1, 900, 1000), nFileEntries);
+  Check(resumedCheckpoint.IsDue(), "resumed file is completed together with the units of the previous run");
+  Check(resumedCheckpoint.GetWorkerUnits(0).size() == 2, "only the new units are written to the new checkpoint");
+
+  // A unit from the previous run reaching past the end of the file covers the rest of the file
+  std::vector<AnalysisTask> openEndedUnits = {MakeUnit(0, 500, 2000)};
+  AnalysisCheckpoint openEndedCheckpoint("testCheckpoint2.root", inputFileNames, 1, 1, 0);
+  openEndedCheckpoint.SetPreviousUnits(openEndedUnits, std::vector<Long64_t>(inputFileNames.size(), -1));
+  openEndedCheckpoint.AddCompletedUnit(0, MakeUnit(0, 0, 500), nFileEntries);
+  Check(openEndedCheckpoint.IsDue(), "previous unit past the end of the file completes the file");
+
+  return TestResult("testAnalysisCheckpoint");
+}
@@ -0,0 +1,116 @@
+// Tests for the RDataFrame engine: the nominal histograms are the same as from the hand-written event loop, also for
+// the Monte Carlo events with negative hiBin
+
+// C++ includes
+#include <vector>
+
+// Root includes
+#include <TSystem.h>
+#include <TH1.h>
+#include <THnSparse.h>
+
+// Own includes
+#include "ConfigurationCard.h"
+#include "TriggerAnalyzer.h"
+#include "DataFrameAnalyzer.h"
+#include "TriggerHistograms.h"
+#include "TestTools.h"
+#include "TestForest.h"
+
+using namespace std;
+
+// Relative tolerance for the bin contents. The weights are computed in the same order in both engines.
+const Double_t kTolerance = 1e-6;
+
+/*
+ * Check that all the bins of two histograms, including underflow and overflow, have the same contents and errors
+ *
+ *  Arguments:
+ *   TH1 *histogram = Tested histogram
+ *   TH1 *reference = Reference histogram
+ *
+ *   return: True if every bin agrees
+ */
+Bool_t SameContents(TH1 *histogram, TH1 *reference){
+  if(histogram->GetNbinsX() != reference->GetNbinsX()) return false;
+  for(Int_t iBin = 0; iBin <= reference->GetNbinsX()+1; iBin++){
+    if(TMath::Abs(histogram->GetBinContent(iBin) - reference->GetBinContent(iBin)) > kTolerance * TMath::Max(1.0, TMath::Abs(reference->GetBinContent(iBin)))) return false;
+    if(TMath::Abs(histogram->GetBinError(iBin) - reference->GetBinError(iBin)) > kTolerance * TMath::Max(1.0, reference->GetBinError(iBin))) return false;
+  }
+  return true;
+}
+
+/*
+ * Check that all the filled bins of two sparse histograms have the same contents and errors
+ *
+ *  Arguments:
+ *   THnBase *histogram = Tested histogram
+ *   THnBase *reference = Reference histogram
+ *
+ *   return: True if every bin agrees in both directions
+ */
+Bool_t SameContents(THnBase *histogram, THnBase *reference){
+  std::vector<Int_t> coordinates(reference->GetNdimensions());
+  Long64_t otherBin;
+  THnBase *pair[2][2] = {{histogram, reference}, {reference, histogram}};
+  for(Int_t iPair = 0; iPair < 2; iPair++){
+    for(Long64_t iBin = 0; iBin < pair[iPair][0]->GetNbins(); iBin++){
+      const Double_t content = pair[iPair][0]->GetBinContent(iBin, coordinates.data());
+      const Double_t error2 = pair[iPair][0]->GetBinError2(iBin);
+      otherBin = pair[iPair][1]->GetBin(coordinates.data(), kFALSE);
+      if(otherBin < 0){
+        if(content != 0 || error2 != 0) return false;
+        continue;
+      }
+      if(TMath::Abs(content - pair[iPair][1]->GetBinContent(otherBin)) > kTolerance * TMath::Max(1.0, TMath::Abs(content))) return false;
+      if(TMath::Abs(error2 - pair[iPair][1]->GetBinError2(otherBin)) > kTolerance * TMath::Max(1.0, error2)) return false;
+    }
+  }
+  return true;
+}
+
+int main(){
+
+  // PbPb Monte Carlo forests, in which every twentieth event has a negative hiBin
+  std::vector<TString> fileNames;
+  for(Int_t iFile = 0; iFile < 2; iFile++){
+    fileNames.push_back(Form("testAnalysisEngines_forest%d.root", iFile));
+    WriteTestForest(fileNames.back(), ForestReader::kPbPbMC, 3, 300, 10, 40, 100, 23 + iFile);
+  }
+  TString cardName = "testAnalysisEngines.input";
+  WriteTestCard(cardName, "cardTriggerPbPb.input", {{"DataType", "3"}, {"LowPtHatCut", "0"}, {"HighPtHatCut", "5020"}, {"ProgressInterval", "0"}, {"DebugLevel", "0"}});
+  ConfigurationCard *card = new ConfigurationCard(cardName);
+
+  // Hand-written event loop
+  TriggerAnalyzer *triggerAnalysis = new TriggerAnalyzer(fileNames, card);
+  triggerAnalysis->RunAnalysis();
+  TriggerHistograms *reference = triggerAnalysis->GetHistograms();
+
+  // RDataFrame engine
+  DataFrameAnalyzer *dataFrameAnalysis = new DataFrameAnalyzer(fileNames, card);
+  dataFrameAnalysis->RunAnalysis();
+  TriggerHistograms *dataFrame = dataFrameAnalysis->GetHistograms();
+
+  // The events with negative hiBin pass the event cuts and are weighted with the centrality weight of hiBin 1
+  Check(reference->fhCentrality->GetBinContent(reference->fhCentrality->FindBin(-0.5)) > 0, "events with negative hiBin are analyzed");
+  Check(reference->fhEvents->GetBinContent(TriggerHistograms::kVzCut+1) > 0, "events pass all the event cuts");
+
+  Check(SameContents(dataFrame->fhEvents, reference->fhEvents), "same event counts");
+  Check(SameContents(dataFrame->fhVertexZ, reference->fhVertexZ), "same vz distribution");
+  Check(SameContents(dataFrame->fhVertexZWeighted, reference->fhVertexZWeighted), "same weighted vz distribution");
+  Check(SameContents(dataFrame->fhCentrality, reference->fhCentrality), "same centrality distribution");
+  Check(SameContents(dataFrame->fhCentralityWeighted, reference->fhCentralityWeighted), "same weighted centrality distribution, also for negative hiBin");
+  Check(SameContents(dataFrame->fhPtHat, reference->fhPtHat), "same pT hat distribution");
+  Check(SameContents(dataFrame->fhPtHatWeighted, reference->fhPtHatWeighted), "same weighted pT hat distribution");
+  Check(reference->fhInclusiveJet->GetNbins() > 0, "jets are filled");
+  Check(SameContents(dataFrame->fhInclusiveJet, reference->fhInclusiveJet), "same inclusive jets");
+  Check(SameContents(dataFrame->fhLeadingJet, reference->fhLeadingJet), "same leading jets");
+
+  delete dataFrameAnalysis;
+  delete triggerAnalysis;
+  delete card;
+  for(const TString &fileName : fileNames) gSystem->Unlink(fileName);
+  gSystem->Unlink(cardName);
+
+  return TestResult("testAnalysisEngines");
+}
@@ -0,0 +1,164 @@
+// Tests for resuming the analysis with several threads: checkpoints written while the other workers are running hold
+// the histograms of the units they list, a run resumed from a manifest and stopped right away lists the remaining
+// units, and the runs over complementary units add up to the full analysis
+
+// C++ includes
+#include <vector>
+
+// Root includes
+#include <TFile.h>
+#include <TSystem.h>
+#include <TH1.h>
+#include <THnSparse.h>
+
+// Own includes
+#include "ConfigurationCard.h"
+#include "TriggerAnalyzer.h"
+#include "TriggerHistograms.h"
+#include "AnalysisCheckpoint.h"
+#include "RuntimeBudget.h"
+#include "TestTools.h"
+#include "TestForest.h"
+
+using namespace std;
+
+// Test forests: several files split into many clusters, so that both workers get clusters of the same file
+const Int_t knFiles = 4;
+const Int_t knEventsPerFile = 400;
+const Int_t knEventsPerCluster = 50;
+
+/*
+ * Create a unit of entries in a file
+ */
+AnalysisTask MakeUnit(Int_t fileIndex, Long64_t firstEntry, Long64_t lastEntry){
+  AnalysisTask unit;
+  unit.fFileIndex = fileIndex;
+  unit.fFirstEntry = firstEntry;
+  unit.fLastEntry = lastEntry;
+  return unit;
+}
+
+/*
+ * Run the analysis over the test forests
+ *
+ *  Arguments:
+ *   ConfigurationCard *card = Card for the analysis
+ *   const std::vector<TString> &fileNames = Test forests
+ *   const std::vector<AnalysisTask> &previousUnits = Units completed in the previous runs. Empty for a new analysis.
+ *   RuntimeBudget *budget = Runtime budget for the analysis. NULL for no budget.
+ *   TString checkpointFileName = File to which the checkpoints are written. Empty for no checkpoints.
+ *
+ *   return: Analyzer after the run. Deleted by the caller.
+ */
+TriggerAnalyzer* RunTestAnalysis(ConfigurationCard *card, const std::vector<TString> &fileNames, const std::vector<AnalysisTask> &previousUnits, RuntimeBudget *budget, TString checkpointFileName){
+  TriggerAnalyzer *analyzer = new TriggerAnalyzer(fileNames, card);
+
+  // The file sizes are not known when resuming from a manifest
+  if(!previousUnits.empty()) analyzer->SetPreviousUnits(previousUnits, std::vector<Long64_t>(fileNames.size(), -1));
+  if(budget) analyzer->SetRuntimeBudget(budget);
+  if(checkpointFileName != "") analyzer->SetCheckpointFile(checkpointFileName);
+  analyzer->RunAnalysis();
+  return analyzer;
+}
+
+/*
+ * Check that two lists of units are the same
+ */
+Bool_t SameUnits(const std::vector<AnalysisTask> &units, const std::vector<AnalysisTask> &expected){
+  if(units.size() != expected.size()) return false;
+  for(UInt_t iUnit = 0; iUnit < units.size(); iUnit++){
+    if(units.at(iUnit).fFileIndex != expected.at(iUnit).fFileIndex) return false;
+    if(units.at(iUnit).fFirstEntry != expected.at(iUnit).fFirstEntry) return false;
+    if(units.at(iUnit).fLastEntry != expected.at(iUnit).fLastEntry) return false;
+  }
+  return true;
+}
+
+/*
+ * Sum of the contents of all the filled bins of a histogram
+ */
+Double_t SumOfContents(THnBase *histogram){
+  Double_t sum = 0;
+  for(Long64_t iBin = 0; iBin < histogram->GetNbins(); iBin++) sum += histogram->GetBinContent(iBin);
+  return sum;
+}
+
+int main(){
+
+  // Write the test forests and a card running the analysis with two threads and a checkpoint after every file
+  std::vector<TString> fileNames;
+  for(Int_t iFile = 0; iFile < knFiles; iFile++){
+    fileNames.push_back(Form("testAnalysisResume_forest%d.root", iFile));
+    WriteTestForest(fileNames.back(), ForestReader::kPbPb, 3, knEventsPerFile, 5, 30, knEventsPerCluster, 11 + iFile);
+  }
+  TString cardName = "testAnalysisResume.input";
+  WriteTestCard(cardName, "cardTriggerPbPb.input", {{"NumberOfThreads", "2"}, {"CheckpointFiles", "1"}, {"ProgressInterval", "0"}, {"DebugLevel", "0"}});
+  ConfigurationCard *card = new ConfigurationCard(cardName);
+  TString checkpointFileName = "testAnalysisResume_checkpoint.root";
+
+  // ======== Full analysis writing checkpoints while the other worker is running ========
+
+  const Bool_t addDirectoryStatus = TH1::AddDirectoryStatus();
+  TriggerAnalyzer *reference = RunTestAnalysis(card, fileNames, std::vector<AnalysisTask>(), NULL, checkpointFileName);
+  Check(TH1::AddDirectoryStatus() == addDirectoryStatus, "the analysis does not change the global AddDirectory flag");
+  Check(reference->GetUnprocessedUnits().empty(), "no unprocessed units without a stop");
+
+  const Double_t referenceEvents = reference->GetHistograms()->fhEvents->GetBinContent(TriggerHistograms::kAll+1);
+  const Double_t referenceJets = SumOfContents(reference->GetHistograms()->fhInclusiveJet);
+  CheckClose(referenceEvents, knFiles*knEventsPerFile, 1e-12, "all events are analyzed");
+  Check(referenceJets > 0, "jets are filled");
+
+  // The checkpoint lists the units of which it has the histograms
+  std::vector<AnalysisTask> checkpointUnits;
+  std::vector<Long64_t> checkpointFileEntries;
+  Check(AnalysisCheckpoint::ReadUnits(checkpointFileName, fileNames, checkpointUnits, checkpointFileEntries), "checkpoint is read");
+  Check(!checkpointUnits.empty(), "checkpoint lists completed units");
+  Long64_t nCheckpointEvents = 0;
+  for(const AnalysisTask &unit : checkpointUnits){
+    nCheckpointEvents += unit.fLastEntry - unit.fFirstEntry;
+    Check(checkpointFileEntries.at(unit.fFileIndex) == knEventsPerFile, "checkpoint knows the size of the files with completed units");
+  }
+  TFile *checkpointFile = TFile::Open(checkpointFileName);
+  TH1 *checkpointEvents = checkpointFile ? (TH1*) checkpointFile->Get("nEvents") : NULL;
+  Check(checkpointEvents != NULL, "checkpoint has the event histogram");
+  if(checkpointEvents) CheckClose(checkpointEvents->GetBinContent(TriggerHistograms::kAll+1), nCheckpointEvents, 1e-12, "checkpoint histograms match the completed units");
+  if(checkpointFile) checkpointFile->Close();
+  delete checkpointFile;
+
+  // ======== Resume from a manifest and stop before any unit is started ========
+
+  // Parts of the first three files are completed in the previous run, the last file is not started
+  const std::vector<AnalysisTask> previousUnits = {MakeUnit(0, 0, 100), MakeUnit(1, 0, 200), MakeUnit(2, 0, 50), MakeUnit(2, 100, 150)};
+  RuntimeBudget *budget = new RuntimeBudget(1e-9);
+  TriggerAnalyzer *stopped = RunTestAnalysis(card, fileNames, previousUnits, budget, "");
+  const std::vector<AnalysisTask> expectedRemainder = {MakeUnit(0, 100, -1), MakeUnit(1, 200, -1), MakeUnit(2, 50, 100), MakeUnit(2, 150, -1), MakeUnit(3, 0, -1)};
+  Check(budget->IsStopped(), "analysis is stopped by the runtime budget");
+  Check(SameUnits(stopped->GetUnprocessedUnits(), expectedRemainder), "all the workers list the gaps between the completed units as unprocessed");
+  CheckClose(stopped->GetHistograms()->fhEvents->GetBinContent(TriggerHistograms::kAll+1), 0, 1e-12, "no events are analyzed after the stop");
+  delete stopped;
+  delete budget;
+
+  // ======== Resumed runs over complementary units add up to the full analysis ========
+
+  // The remainder of the stopped run and the units completed before it are analyzed in separate resumed runs
+  std::vector<AnalysisTask> remainderAsCompleted;
+  for(const AnalysisTask &unit : expectedRemainder) remainderAsCompleted.push_back(MakeUnit(unit.fFileIndex, unit.fFirstEntry, (unit.fLastEntry < 0) ? knEventsPerFile : unit.fLastEntry));
+  TriggerAnalyzer *remainderRun = RunTestAnalysis(card, fileNames, previousUnits, NULL, "");
+  TriggerAnalyzer *previousRun = RunTestAnalysis(card, fileNames, remainderAsCompleted, NULL, "");
+
+  const Double_t remainderEvents = remainderRun->GetHistograms()->fhEvents->GetBinContent(TriggerHistograms::kAll+1);
+  const Double_t previousEvents = previousRun->GetHistograms()->fhEvents->GetBinContent(TriggerHistograms::kAll+1);
+  CheckClose(remainderEvents, knFiles*knEventsPerFile - 350, 1e-12, "resumed run skips the completed units");
+  CheckClose(remainderEvents + previousEvents, referenceEvents, 1e-12, "complementary resumed runs analyze all the events");
+  CheckClose(SumOfContents(remainderRun->GetHistograms()->fhInclusiveJet) + SumOfContents(previousRun->GetHistograms()->fhInclusiveJet), referenceJets, 1e-9, "complementary resumed runs fill all the jets");
+
+  delete remainderRun;
+  delete previousRun;
+  delete reference;
+  delete card;
+  for(const TString &fileName : fileNames) gSystem->Unlink(fileName);
+  gSystem->Unlink(cardName);
+  gSystem->Unlink(checkpointFileName);
+
+  return TestResult("testAnalysisResume");
+}
@@ -0,0 +1,65 @@
+// Tests for the Poisson bootstrap weights of BootstrapHistogram
+
+// C++ includes
+#include <vector>
+
+// Own includes
+#include "BootstrapHistogram.h"
+#include "TestTools.h"
+
+using namespace std;
+
+int main(){
+
+  const Int_t nReplicas = 100;
+  std::vector<UChar_t> weights(nReplicas);
+  std::vector<UChar_t> repeatedWeights(nReplicas);
+
+  // The same event always gets the same weights
+  BootstrapHistogram::GeneratePoissonWeights(326382, 154, 204736612, nReplicas, weights.data());
+  BootstrapHistogram::GeneratePoissonWeights(326382, 154, 204736612, nReplicas, repeatedWeights.data());
+  Check(weights == repeatedWeights, "weights are reproducible for the same event");
+
+  // Swapping the identifiers gives a different event
+  BootstrapHistogram::GeneratePoissonWeights(154, 326382, 204736612, nReplicas, repeatedWeights.data());
+  Check(weights != repeatedWeights, "run and lumi numbers are not interchangeable");
+
+  // Mean, variance and the fraction of zero weights match Poisson(1). Replicas are not correlated with each other.
+  const Int_t nEvents = 20000;
+  Double_t sumWeights = 0;
+  Double_t sumWeightsSquared = 0;
+  Double_t nZeroWeights = 0;
+  Double_t sumFirst = 0, sumSecond = 0, sumProduct = 0, sumFirstSquared = 0, sumSecondSquared = 0;
+  Int_t nIdenticalNeighbours = 0;
+  std::vector<UChar_t> previousWeights(nReplicas);
+  for(Int_t iEvent = 0; iEvent < nEvents; iEvent++){
+    BootstrapHistogram::GeneratePoissonWeights(326382, 154 + iEvent/1000, iEvent, nReplicas, weights.data());
+    for(Int_t iReplica = 0; iReplica < nReplicas; iReplica++){
+      sumWeights += weights.at(iReplica);
+      sumWeightsSquared += weights.at(iReplica) * weights.at(iReplica);
+      if(weights.at(iReplica) == 0) nZeroWeights++;
+    }
+    sumFirst += weights.at(0);
+    sumSecond += weights.at(1);
+    sumProduct += weights.at(0) * weights.at(1);
+    sumFirstSquared += weights.at(0) * weights.at(0);
+    sumSecondSquared += weights.at(1) * weights.at(1);
+    if(iEvent > 0 && weights == previousWeights) nIdenticalNeighbours++;
+    previousWeights = weights;
+  }
+
+  const Double_t nWeights = (Double_t)nEvents * nReplicas;
+  const Double_t mean = sumWeights / nWeights;
+  const Double_t variance = sumWeightsSquared / nWeights - mean * mean;
+  CheckClose(mean, 1, 0.01, "mean of the weights is one");
+  CheckClose(variance, 1, 0.02, "variance of the weights is one");
+  CheckClose(nZeroWeights / nWeights, TMath::Exp(-1), 0.01, "fraction of zero weights is exp(-1)");
+
+  const Double_t covariance = sumProduct / nEvents - (sumFirst / nEvents) * (sumSecond / nEvents);
+  const Double_t firstVariance = sumFirstSquared / nEvents - (sumFirst / nEvents) * (sumFirst / nEvents);
+  const Double_t secondVariance = sumSecondSquared / nEvents - (sumSecond / nEvents) * (sumSecond / nEvents);
+  Check(TMath::Abs(covariance / TMath::Sqrt(firstVariance * secondVariance)) < 0.03, "replicas are not correlated");
+  Check(nIdenticalNeighbours == 0, "consecutive events get different weights");
+
+  return TestResult("testBootstrapHistogram");
+}
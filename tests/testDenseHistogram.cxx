@@ -0,0 +1,138 @@
+// Tests for DenseHistogram: flushing and merging the dense sums gives the same THnSparse as filling it directly
+
+// C++ includes
+#include <vector>
+#include <random>
+
+// Root includes
+#include <THnSparse.h>
+
+// Own includes
+#include "DenseHistogram.h"
+#include "TestTools.h"
+
+using namespace std;
+
+// Binning of the test histograms: [jet pT][centrality][trigger]. Centrality has variable bin widths.
+const Int_t knAxes = 3;
+const Int_t knTriggers = 4;
+const Int_t kTriggerAxis = 2;
+
+/*
+ * Create an empty histogram with the test binning
+ */
+THnSparseF* CreateHistogram(const char *name){
+  Int_t nBins[knAxes] = {50, 4, knTriggers};
+  Double_t lowBinBorder[knAxes] = {0, -0.25, -0.5};
+  Double_t highBinBorder[knAxes] = {500, 89.75, knTriggers-0.5};
+  Double_t centralityBins[5] = {-0.25, 9.75, 29.75, 49.75, 89.75};
+  THnSparseF *histogram = new THnSparseF(name, name, knAxes, nBins, lowBinBorder, highBinBorder);
+  histogram->Sumw2();
+  histogram->SetBinEdges(1, centralityBins);
+  return histogram;
+}
+
+/*
+ * Check that all the filled bins of two histograms have the same contents and errors
+ *
+ *  Arguments:
+ *   THnBase *histogram = Tested histogram
+ *   THnBase *reference = Reference histogram
+ *
+ *   return: True if every bin agrees in both directions
+ */
+Bool_t SameContents(THnBase *histogram, THnBase *reference){
+  std::vector<Int_t> coordinates(knAxes);
+  Long64_t otherBin;
+  THnBase *pair[2][2] = {{histogram, reference}, {reference, histogram}};
+  for(Int_t iPair = 0; iPair < 2; iPair++){
+    for(Long64_t iBin = 0; iBin < pair[iPair][0]->GetNbins(); iBin++){
+      const Double_t content = pair[iPair][0]->GetBinContent(iBin, coordinates.data());
+      const Double_t error2 = pair[iPair][0]->GetBinError2(iBin);
+      otherBin = pair[iPair][1]->GetBin(coordinates.data(), kFALSE);
+      if(otherBin < 0){
+        if(content != 0 || error2 != 0) return false;
+        continue;
+      }
+      if(TMath::Abs(content - pair[iPair][1]->GetBinContent(otherBin)) > 1e-5 * TMath::Max(1.0, TMath::Abs(content))) return false;
+      if(TMath::Abs(error2 - pair[iPair][1]->GetBinError2(otherBin)) > 1e-5 * TMath::Max(1.0, error2)) return false;
+    }
+  }
+  return true;
+}
+
+int main(){
+
+  THnSparseF *reference = CreateHistogram("reference");
+  THnSparseF *flushed = CreateHistogram("flushed");
+  THnSparseF *merged = CreateHistogram("merged");
+  THnSparseF *denseReference = CreateHistogram("denseReference");
+  DenseHistogram dense(flushed);
+  DenseHistogram mergedDense(merged);
+
+  // The memory is reserved before the bins are allocated. Centrality stores underflow and overflow.
+  const Long64_t memorySize = dense.GetMemorySize();
+  Check(memorySize == 2 * 50 * 6 * knTriggers * (Long64_t)sizeof(Double_t), "memory size counts all the stored bins");
+  Check(mergedDense.GetMemorySize() == memorySize, "memory size does not depend on the filling");
+
+  // Fill the same jets directly and through the dense bins. Some jets are above the pT axis and go to the ROOT
+  // histogram, and some are outside of the centrality bins and are stored in the dense underflow and overflow.
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<Double_t> ptDistribution(0, 600);
+  std::uniform_real_distribution<Double_t> centralityDistribution(-5, 95);
+  std::uniform_int_distribution<Int_t> maskDistribution(0, (1 << knTriggers) - 1);
+  const Double_t triggerWeight[knTriggers] = {1, 0.5, 2, 1};
+  Double_t values[knAxes];
+  Int_t nDenseFills = 0;
+  Int_t nSparseFills = 0;
+  for(Int_t iJet = 0; iJet < 2000; iJet++){
+    values[0] = ptDistribution(generator);
+    values[1] = centralityDistribution(generator);
+    const UInt_t triggerMask = maskDistribution(generator);
+    const Double_t jetWeight = (iJet % 3 == 0) ? 0.25 : 1;
+
+    for(Int_t iTrigger = 0; iTrigger < knTriggers; iTrigger++){
+      if(!(triggerMask & (1u << iTrigger))) continue;
+      values[kTriggerAxis] = iTrigger;
+      reference->Fill(values, triggerWeight[iTrigger]*jetWeight);
+    }
+
+    // The jets stored in the dense bins are also filled directly to a reference for the merge
+    const Bool_t isDense = dense.FillTriggers(values, kTriggerAxis, triggerMask, triggerWeight, jetWeight);
+    if(isDense) nDenseFills++; else nSparseFills++;
+    for(Int_t iTrigger = 0; iTrigger < knTriggers; iTrigger++){
+      if(!(triggerMask & (1u << iTrigger))) continue;
+      values[kTriggerAxis] = iTrigger;
+      (isDense ? denseReference : flushed)->Fill(values, triggerWeight[iTrigger]*jetWeight);
+    }
+  }
+  Check(nDenseFills > 0 && nSparseFills > 0, "both dense and sparse fills are tested");
+  Check(dense.GetMemorySize() == memorySize, "memory size does not change with the fills");
+
+  // Merging adds the dense sums straight to another histogram and leaves them in place
+  dense.AddToHistogram(merged);
+  Check(SameContents(merged, denseReference), "merged dense bins agree with the direct fills");
+  CheckClose(merged->GetEntries(), denseReference->GetEntries(), 1e-12, "merged entries agree with the direct fills");
+
+  // The flush adds the dense sums on top of the fills outside of the dense bins
+  dense.FlushToHistogram();
+  Check(SameContents(flushed, reference), "flushed dense bins agree with the direct fills");
+  CheckClose(flushed->GetEntries(), reference->GetEntries(), 1e-12, "flushed entries agree with the direct fills");
+
+  // A second flush after the bins are emptied adds nothing
+  dense.FlushToHistogram();
+  Check(SameContents(flushed, reference), "second flush does not change the contents");
+  CheckClose(flushed->GetEntries(), reference->GetEntries(), 1e-12, "second flush does not change the entries");
+
+  // Flushing a dense histogram that was never filled does not change its ROOT histogram
+  mergedDense.FlushToHistogram();
+  Check(SameContents(merged, denseReference), "flushing unfilled dense bins does not change the contents");
+  CheckClose(merged->GetEntries(), denseReference->GetEntries(), 1e-12, "flushing unfilled dense bins does not change the entries");
+
+  delete reference;
+  delete flushed;
+  delete merged;
+  delete denseReference;
+
+  return TestResult("testDenseHistogram");
+}
@@ -0,0 +1,43 @@
+// Tests for EfficiencyAccumulator: pp jets with centrality below the binning are kept in the underflow bin
+
+// C++ includes
+#include <vector>
+
+// Own includes
+#include "EfficiencyAccumulator.h"
+#include "TestTools.h"
+
+using namespace std;
+
+int main(){
+
+  // Binning from the analysis cards
+  const Int_t nCentralityBins = 4;
+  const Double_t centralityBinEdges[nCentralityBins+1] = {-0.25, 9.75, 29.75, 49.75, 89.75};
+  EfficiencyAccumulator accumulator(100, 0, 500, nCentralityBins, centralityBinEdges);
+
+  // Weight 1 for every trigger bin. The jet fires the first trigger and is counted in total.
+  std::vector<Double_t> triggerWeight(TriggerHistograms::knTriggerTypes+1, 1);
+  const UInt_t triggerMask = (1u << TriggerHistograms::knTriggerTypes) | 1u;
+
+  // A pp jet has centrality -0.5 from hiBin -1
+  accumulator.Fill(EfficiencyAccumulator::kInclusiveJet, 120, -0.5, TriggerHistograms::kReconstructed, triggerMask, triggerWeight.data(), 2);
+  CheckClose(accumulator.GetTotalSumWeights(EfficiencyAccumulator::kInclusiveJet, 120, -0.5, TriggerHistograms::kReconstructed), 2, 1e-12, "pp jet is counted in total");
+  CheckClose(accumulator.GetPassSumWeights(EfficiencyAccumulator::kInclusiveJet, 120, -0.5, TriggerHistograms::kReconstructed, 0), 2, 1e-12, "pp jet is counted in pass");
+  Check(accumulator.GetTotalSumWeights(EfficiencyAccumulator::kInclusiveJet, 120, 5, TriggerHistograms::kReconstructed) == 0, "pp jet is not counted in the most central bin");
+  Check(accumulator.GetPassSumWeights(EfficiencyAccumulator::kInclusiveJet, 120, -0.5, TriggerHistograms::kReconstructed, 1) == 0, "pp jet is not counted for triggers that did not fire");
+
+  // PbPb jets in a regular centrality bin and beyond the last bin edge
+  accumulator.Fill(EfficiencyAccumulator::kLeadingJet, 80, 15, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight.data(), 1);
+  accumulator.Fill(EfficiencyAccumulator::kLeadingJet, 80, 95, TriggerHistograms::kGeneratorLevel, triggerMask, triggerWeight.data(), 3);
+  CheckClose(accumulator.GetTotalSumWeights(EfficiencyAccumulator::kLeadingJet, 80, 20, TriggerHistograms::kGeneratorLevel), 1, 1e-12, "PbPb jet is counted in its centrality bin");
+  CheckClose(accumulator.GetTotalSumWeights(EfficiencyAccumulator::kLeadingJet, 80, 99, TriggerHistograms::kGeneratorLevel), 3, 1e-12, "peripheral jet is counted in the overflow bin");
+  Check(accumulator.GetTotalSumWeights(EfficiencyAccumulator::kLeadingJet, 80, 70, TriggerHistograms::kGeneratorLevel) == 0, "peripheral jet is not counted in the last regular bin");
+
+  // Adding an accumulator sums the bins
+  EfficiencyAccumulator otherAccumulator(accumulator);
+  accumulator.Add(&otherAccumulator);
+  CheckClose(accumulator.GetTotalSumWeights(EfficiencyAccumulator::kInclusiveJet, 120, -0.5, TriggerHistograms::kReconstructed), 4, 1e-12, "added accumulators sum the underflow bin");
+
+  return TestResult("testEfficiencyAccumulator");
+}
@@ -0,0 +1,137 @@
+// Tests for FixedPointHistogram: carries between the limbs, and sums that are the same byte for byte when the fills
+// are split between threads in any order
+
+// C++ includes
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <random>
+
+// Root includes
+#include <TH1.h>
+
+// Own includes
+#include "FixedPointHistogram.h"
+#include "TestTools.h"
+
+using namespace std;
+
+/*
+ * Check if two sums have the same limbs
+ */
+Bool_t AreIdentical(const FixedPointSum &first, const FixedPointSum &second){
+  return memcmp(first.fLimb, second.fLimb, sizeof(first.fLimb)) == 0;
+}
+
+/*
+ * Check if two doubles have the same bytes
+ */
+Bool_t AreIdentical(Double_t first, Double_t second){
+  return memcmp(&first, &second, sizeof(Double_t)) == 0;
+}
+
+int main(){
+
+  // ======== Carries between the limbs ========
+
+  // The lowest limb holds the units from 2^-128 to 2^-65. Filling it completely and adding one unit carries to the next limb.
+  FixedPointSum lowCarry;
+  lowCarry.Add(std::ldexp(1.0 - std::ldexp(1.0, -53), -64));
+  lowCarry.Add(std::ldexp(1.0, -117));
+  Check(lowCarry.fLimb[0] == 0 && lowCarry.fLimb[1] == 1 && lowCarry.fLimb[2] == 0 && lowCarry.fLimb[3] == 0, "carry from the lowest limb");
+  Check(AreIdentical(lowCarry.GetValue(), std::ldexp(1.0, -64)), "value after the carry from the lowest limb");
+
+  // A carry from the second limb to the integer part
+  FixedPointSum unitCarry;
+  unitCarry.Add(1.0 - std::ldexp(1.0, -53));
+  unitCarry.Add(std::ldexp(1.0, -53));
+  Check(unitCarry.fLimb[1] == 0 && unitCarry.fLimb[2] == 1, "carry to the integer part");
+  Check(unitCarry.GetValue() == 1, "value after the carry to the integer part");
+
+  // Adding the negative value borrows through all the limbs and gives exactly zero
+  FixedPointSum cancellation;
+  cancellation.Add(1.5);
+  cancellation.Add(std::ldexp(1.0, -100));
+  cancellation.Add(-1.5);
+  cancellation.Add(-std::ldexp(1.0, -100));
+  Check(AreIdentical(cancellation, FixedPointSum()), "opposite values cancel exactly");
+  cancellation.Add(-0.25);
+  Check(cancellation.GetValue() == -0.25, "negative sum");
+  Check(cancellation.fLimb[FixedPointSum::knLimbs-1] == ~0ull, "negative sum has the sign in the highest limb");
+
+  // Adding partial sums carries the same way as adding the values
+  FixedPointSum partialCarry;
+  partialCarry.Add(lowCarry);
+  partialCarry.Add(unitCarry);
+  CheckClose(partialCarry.GetValue(), 1 + std::ldexp(1.0, -64), 1e-15, "adding partial sums");
+
+  // ======== Sums split between threads ========
+
+  // Weights over many orders of magnitude with both signs, for which the double sums depend on the order
+  const Int_t nValues = 10000;
+  const Int_t nThreads = 4;
+  std::mt19937 generator(1234);
+  std::uniform_real_distribution<Double_t> valueDistribution(-1, 11);
+  std::uniform_real_distribution<Double_t> mantissaDistribution(0.5, 1);
+  std::uniform_int_distribution<Int_t> exponentDistribution(-30, 30);
+  std::vector<Double_t> values(nValues), weights(nValues);
+  for(Int_t iValue = 0; iValue < nValues; iValue++){
+    values[iValue] = valueDistribution(generator);
+    weights[iValue] = std::ldexp(mantissaDistribution(generator), exponentDistribution(generator));
+    if(iValue % 3 == 0) weights[iValue] = -weights[iValue];
+  }
+
+  // One thread filling all the values in order
+  FixedPointSum singleSum;
+  Double_t singleDoubleSum = 0;
+  for(Int_t iValue = 0; iValue < nValues; iValue++){
+    singleSum.Add(weights[iValue]);
+    singleDoubleSum += weights[iValue];
+  }
+
+  // Several threads, each getting a shuffled part of the values, merged in reverse order
+  std::vector<Int_t> fillOrder(nValues);
+  for(Int_t iValue = 0; iValue < nValues; iValue++) fillOrder[iValue] = iValue;
+  std::shuffle(fillOrder.begin(), fillOrder.end(), generator);
+  std::vector<FixedPointSum> threadSums(nThreads);
+  std::vector<Double_t> threadDoubleSums(nThreads, 0);
+  for(Int_t iFill = 0; iFill < nValues; iFill++){
+    threadSums[iFill % nThreads].Add(weights[fillOrder[iFill]]);
+    threadDoubleSums[iFill % nThreads] += weights[fillOrder[iFill]];
+  }
+  FixedPointSum mergedSum;
+  Double_t mergedDoubleSum = 0;
+  for(Int_t iThread = nThreads-1; iThread >= 0; iThread--){
+    mergedSum.Add(threadSums[iThread]);
+    mergedDoubleSum += threadDoubleSums[iThread];
+  }
+  Check(singleDoubleSum != mergedDoubleSum, "double sums depend on the order, so the test is sensitive");
+  Check(AreIdentical(singleSum, mergedSum), "fixed-point sums from one and several threads are identical");
+  Check(AreIdentical(singleSum.GetValue(), mergedSum.GetValue()), "values from one and several threads are identical");
+
+  // The same for histograms, comparing the copied bin contents and errors byte for byte
+  TH1D singleHistogram("singleHistogram", "singleHistogram", 10, 0, 10);
+  TH1D mergedHistogram("mergedHistogram", "mergedHistogram", 10, 0, 10);
+  FixedPointHistogram singleSums(&singleHistogram);
+  for(Int_t iValue = 0; iValue < nValues; iValue++) singleSums.Fill(values[iValue], weights[iValue]);
+
+  std::vector<FixedPointHistogram> threadHistograms(nThreads, FixedPointHistogram(&mergedHistogram));
+  for(Int_t iFill = 0; iFill < nValues; iFill++){
+    threadHistograms[iFill % nThreads].Fill(values[fillOrder[iFill]], weights[fillOrder[iFill]]);
+  }
+  FixedPointHistogram mergedSums(&mergedHistogram);
+  for(Int_t iThread = nThreads-1; iThread >= 0; iThread--) mergedSums.Add(&threadHistograms[iThread]);
+
+  singleSums.CopyToHistogram();
+  mergedSums.CopyToHistogram();
+  Bool_t identicalBins = true;
+  for(Int_t iBin = 0; iBin <= singleHistogram.GetNbinsX()+1; iBin++){
+    identicalBins = identicalBins && AreIdentical(singleHistogram.GetBinContent(iBin), mergedHistogram.GetBinContent(iBin));
+    identicalBins = identicalBins && AreIdentical(singleHistogram.GetBinError(iBin), mergedHistogram.GetBinError(iBin));
+  }
+  Check(identicalBins, "histograms from one and several threads are identical, including underflow and overflow");
+  Check(singleHistogram.GetEntries() == nValues && mergedHistogram.GetEntries() == nValues, "number of entries");
+
+  return TestResult("testFixedPointHistogram");
+}
@@ -0,0 +1,122 @@
+// Tests for spilling the sparse jet histograms: the histograms spilled to files and merged in the end are the same as
+// the histograms filled without spilling
+
+// C++ includes
+#include <vector>
+#include <random>
+
+// Root includes
+#include <TFile.h>
+#include <TFileMerger.h>
+#include <TSystem.h>
+#include <TH1.h>
+#include <THnSparse.h>
+
+// Own includes
+#include "ConfigurationCard.h"
+#include "TriggerHistograms.h"
+#include "TestTools.h"
+
+using namespace std;
+
+/*
+ * Fill jets with random values to the inclusive jet histogram
+ */
+void FillJets(TriggerHistograms *histograms, std::mt19937 &generator, Int_t nJets){
+  std::uniform_real_distribution<Double_t> ptDistribution(20, 500);
+  std::uniform_real_distribution<Double_t> phiDistribution(-3.14, 3.14);
+  std::uniform_real_distribution<Double_t> etaDistribution(-1.6, 1.6);
+  std::uniform_real_distribution<Double_t> centralityDistribution(0, 90);
+  std::uniform_real_distribution<Double_t> weightDistribution(0.5, 2);
+  std::uniform_int_distribution<UInt_t> maskDistribution(0, (1u << TriggerHistograms::knTriggerTypes) - 1);
+  std::vector<Double_t> triggerWeight(TriggerHistograms::knTriggerTypes+1, 1);
+  Double_t filler[6];
+  for(Int_t iJet = 0; iJet < nJets; iJet++){
+    filler[0] = ptDistribution(generator);
+    filler[1] = phiDistribution(generator);
+    filler[2] = etaDistribution(generator);
+    filler[3] = centralityDistribution(generator);
+    filler[4] = TriggerHistograms::kReconstructed;
+    const UInt_t triggerMask = maskDistribution(generator) | (1u << TriggerHistograms::knTriggerTypes);
+    histograms->FillJetTriggers(histograms->fhInclusiveJet, filler, triggerMask, triggerWeight.data(), weightDistribution(generator));
+  }
+}
+
+/*
+ * Write the sparse histograms to a spill file and empty them
+ */
+void Spill(TriggerHistograms *histograms, TString spillFileName){
+  TFile *spillFile = new TFile(spillFileName, "RECREATE");
+  histograms->WriteSparse();
+  spillFile->Close();
+  delete spillFile;
+  histograms->ResetSparse();
+}
+
+int main(){
+
+  TH1::AddDirectory(kFALSE); // The histograms with the same names are created twice
+  ConfigurationCard *card = new ConfigurationCard("cardTriggerPbPb.input");
+
+  // Reference histograms filled without spilling
+  TriggerHistograms *reference = new TriggerHistograms(card);
+  reference->CreateHistograms();
+  std::mt19937 referenceGenerator(2024);
+  FillJets(reference, referenceGenerator, 3000);
+
+  // The same jets filled in three parts, each spilled to a file
+  TriggerHistograms *spilled = new TriggerHistograms(card);
+  spilled->CreateHistograms();
+  std::mt19937 spillGenerator(2024);
+  std::vector<TString> spillFileNames;
+  for(Int_t iSpill = 0; iSpill < 3; iSpill++){
+    FillJets(spilled, spillGenerator, 1000);
+    Check(spilled->GetSparseMemory() > 0, "filled bins use memory");
+    spillFileNames.push_back(Form("testHistogramSpill_%d.root", iSpill));
+    Spill(spilled, spillFileNames.back());
+    Check(spilled->GetSparseMemory() == 0, "memory is released after spilling");
+  }
+
+  // Merge the spill files the same way as the analysis output
+  TString mergedFileName = "testHistogramSpill_merged.root";
+  TFileMerger *merger = new TFileMerger(kFALSE);
+  merger->OutputFile(mergedFileName, "RECREATE");
+  for(const TString &spillFileName : spillFileNames) merger->AddFile(spillFileName, kFALSE);
+  Check(merger->Merge(), "spill files are merged");
+  delete merger;
+
+  // Compare all the filled bins of the reference to the merged histogram
+  TFile *mergedFile = TFile::Open(mergedFileName);
+  THnSparseF *merged = mergedFile ? (THnSparseF*) mergedFile->Get("inclusiveJet") : NULL;
+  Check(merged != NULL, "merged histogram is found");
+  if(merged){
+    THnSparseF *referenceHistogram = reference->fhInclusiveJet;
+    Check(merged->GetNbins() == referenceHistogram->GetNbins(), "same number of filled bins");
+    std::vector<Int_t> coordinates(referenceHistogram->GetNdimensions());
+    Bool_t sameBins = true;
+    Long64_t mergedBin;
+    Double_t content;
+    for(Long64_t iBin = 0; iBin < referenceHistogram->GetNbins(); iBin++){
+      content = referenceHistogram->GetBinContent(iBin, coordinates.data());
+      mergedBin = merged->GetBin(coordinates.data(), kFALSE);
+      if(mergedBin < 0){
+        sameBins = false;
+        continue;
+      }
+      sameBins = sameBins && TMath::Abs(merged->GetBinContent(mergedBin) - content) <= 1e-5 * TMath::Abs(content);
+      sameBins = sameBins && TMath::Abs(merged->GetBinError2(mergedBin) - referenceHistogram->GetBinError2(iBin)) <= 1e-5 * referenceHistogram->GetBinError2(iBin);
+    }
+    Check(sameBins, "merged spills have the same bin contents and errors as the reference");
+    CheckClose(merged->GetEntries(), referenceHistogram->GetEntries(), 1e-12, "merged spills have the same number of entries");
+  }
+  if(mergedFile) mergedFile->Close();
+  delete mergedFile;
+
+  for(const TString &spillFileName : spillFileNames) gSystem->Unlink(spillFileName);
+  gSystem->Unlink(mergedFileName);
+  delete reference;
+  delete spilled;
+  delete card;
+
+  return TestResult("testHistogramSpill");
+}
@@ -0,0 +1,89 @@
+// Tests for JetMatcher: the grid search finds the same match as comparing against every generator level jet
+
+// C++ includes
+#include <vector>
+#include <random>
+
+// Own includes
+#include "JetMatcher.h"
+#include "TestTools.h"
+
+using namespace std;
+
+/*
+ * Closest jet within the matching radius found by comparing against every jet in the mask
+ */
+Int_t BruteForceMatch(Double_t matchingRadius, Double_t eta, Double_t phi, const std::vector<Float_t> &jetEta, const std::vector<Float_t> &jetPhi, const ULong64_t *jetMask){
+  Int_t bestMatch = -1;
+  Double_t bestDistanceSquared = matchingRadius*matchingRadius;
+  Double_t deltaEta, deltaPhi, distanceSquared;
+  for(UInt_t iJet = 0; iJet < jetEta.size(); iJet++){
+    if(!((jetMask[iJet >> 6] >> (iJet & 63)) & 1)) continue;
+    deltaEta = eta - jetEta.at(iJet);
+    deltaPhi = TMath::Abs(phi - jetPhi.at(iJet));
+    if(deltaPhi > TMath::Pi()) deltaPhi = TMath::TwoPi() - deltaPhi;
+    distanceSquared = deltaEta*deltaEta + deltaPhi*deltaPhi;
+    if(distanceSquared < bestDistanceSquared){
+      bestDistanceSquared = distanceSquared;
+      bestMatch = iJet;
+    }
+  }
+  return bestMatch;
+}
+
+int main(){
+
+  std::mt19937 generator(2024);
+  std::uniform_real_distribution<Float_t> phiDistribution(-TMath::Pi(), TMath::Pi());
+  std::uniform_real_distribution<Float_t> etaDistribution(-6, 6);
+  std::uniform_int_distribution<Int_t> multiplicityDistribution(0, 60);
+  std::uniform_int_distribution<Int_t> maskDistribution(0, 3);
+
+  // Small radii use many cells, and the largest ones fewer than three phi cells
+  for(Double_t matchingRadius : {0.2, 0.4, 1.5, 4.0}){
+    JetMatcher matcher(matchingRadius);
+    Int_t nDisagreements = 0;
+    Int_t nMatches = 0;
+    for(Int_t iEvent = 0; iEvent < 2000; iEvent++){
+
+      // Every fourth jet is left out of the grid with the mask
+      const Int_t nJets = multiplicityDistribution(generator);
+      std::vector<Float_t> jetEta(nJets), jetPhi(nJets);
+      ULong64_t jetMask[JetSelectionKernel::knMaskWords] = {0};
+      for(Int_t iJet = 0; iJet < nJets; iJet++){
+        jetEta.at(iJet) = etaDistribution(generator);
+        jetPhi.at(iJet) = phiDistribution(generator);
+        if(maskDistribution(generator) > 0) jetMask[iJet >> 6] |= 1ULL << (iJet & 63);
+      }
+      matcher.BuildGrid(nJets, jetEta.data(), jetPhi.data(), jetMask);
+
+      // Reconstructed jets close to the generator level jets and at random places, also across the phi boundary
+      for(Int_t iJet = 0; iJet < 20; iJet++){
+        Double_t eta = etaDistribution(generator);
+        Double_t phi = phiDistribution(generator);
+        if(iJet < nJets && iJet % 2 == 0){
+          eta = jetEta.at(iJet) + 0.5*matchingRadius*(etaDistribution(generator)/6);
+          phi = jetPhi.at(iJet) + 0.5*matchingRadius*(phiDistribution(generator)/TMath::Pi());
+          if(phi > TMath::Pi()) phi -= TMath::TwoPi();
+          if(phi < -TMath::Pi()) phi += TMath::TwoPi();
+        }
+        const Int_t gridMatch = matcher.FindMatch(eta, phi);
+        if(gridMatch != BruteForceMatch(matchingRadius, eta, phi, jetEta, jetPhi, jetMask)) nDisagreements++;
+        if(gridMatch >= 0) nMatches++;
+      }
+    }
+    Check(nDisagreements == 0, Form("grid matching agrees with brute force for radius %.1f", matchingRadius));
+    Check(nMatches > 0, Form("jets are matched for radius %.1f", matchingRadius));
+  }
+
+  // Jets exactly at the phi boundary are matched across it
+  JetMatcher matcher(0.2);
+  std::vector<Float_t> boundaryEta = {0.5f};
+  std::vector<Float_t> boundaryPhi = {(Float_t)(TMath::Pi() - 0.05)};
+  ULong64_t boundaryMask[JetSelectionKernel::knMaskWords] = {1};
+  matcher.BuildGrid(1, boundaryEta.data(), boundaryPhi.data(), boundaryMask);
+  Check(matcher.FindMatch(0.5, -TMath::Pi() + 0.05) == 0, "jets are matched across the phi boundary");
+  Check(matcher.FindMatch(0.5, 0) == -1, "far away jets are not matched");
+
+  return TestResult("testJetMatcher");
+}
@@ -0,0 +1,147 @@
+// Tests for JetSelectionKernel: the scalar and AVX2 kernels select the same jets as the double precision jet loop
+
+// C++ includes
+#include <vector>
+#include <random>
+#include <limits>
+#include <cmath>
+
+// Own includes
+#include "JetSelectionKernel.h"
+#include "TestTools.h"
+
+using namespace std;
+
+// Cuts used in the tests. The values are not exactly representable in single precision.
+const Double_t kEtaCut = 1.6;
+const Double_t kMinPtCut = 80.3;
+const Double_t kMaxPtCut = 5020.1;
+const Double_t kMinTrackFraction = 0.01;
+const Double_t kMaxTrackFraction = 0.98;
+
+/*
+ * Jet cuts as they were applied in the jet loop before the kernel, with double precision thresholds
+ *
+ *  return: Index of the leading passing jet, or -1 if there is none
+ */
+Int_t ReferenceSelection(Bool_t cutBadPhi, Bool_t cutMaxTrackPt, Int_t nJets, const Float_t *jetPt, const Float_t *jetPhi, const Float_t *jetEta, const Float_t *jetRawPt, const Float_t *jetMaxTrackPt, std::vector<Bool_t> &passes){
+  Int_t leadingJetIndex = -1;
+  Double_t leadingJetPt = 0;
+  passes.assign(nJets, false);
+  for(Int_t iJet = 0; iJet < nJets; iJet++){
+    if(TMath::Abs(jetEta[iJet]) >= kEtaCut) continue;
+    if(cutBadPhi && (jetPhi[iJet] > -0.1 && jetPhi[iJet] < 1.2)) continue;
+    if(cutMaxTrackPt && kMinTrackFraction >= jetMaxTrackPt[iJet]/jetRawPt[iJet]) continue;
+    if(cutMaxTrackPt && kMaxTrackFraction <= jetMaxTrackPt[iJet]/jetRawPt[iJet]) continue;
+    if(jetPt[iJet] < kMinPtCut) continue;
+    if(jetPt[iJet] > kMaxPtCut) continue;
+    passes.at(iJet) = true;
+    if(jetPt[iJet] > leadingJetPt){
+      leadingJetPt = jetPt[iJet];
+      leadingJetIndex = iJet;
+    }
+  }
+  return leadingJetIndex;
+}
+
+/*
+ * Compare one template instantiation of the kernel against the reference for one event
+ */
+template <Bool_t cutBadPhi, Bool_t cutMaxTrackPt> Bool_t CompareEvent(const JetSelectionKernel &kernel, Int_t nJets, const Float_t *jetPt, const Float_t *jetPhi, const Float_t *jetEta, const Float_t *jetRawPt, const Float_t *jetMaxTrackPt){
+  std::vector<Bool_t> passes;
+  ULong64_t passMask[JetSelectionKernel::knMaskWords];
+  const Int_t referenceLeading = ReferenceSelection(cutBadPhi, cutMaxTrackPt, nJets, jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt, passes);
+  const Int_t kernelLeading = kernel.SelectJets<cutBadPhi,cutMaxTrackPt>(nJets, jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt, passMask);
+  if(referenceLeading != kernelLeading) return false;
+  for(Int_t iJet = 0; iJet < nJets; iJet++){
+    if(passes.at(iJet) != (Bool_t)((passMask[iJet >> 6] >> (iJet & 63)) & 1)) return false;
+  }
+  return true;
+}
+
+/*
+ * Compare all the template instantiations for one event
+ */
+Bool_t CompareAllCuts(const JetSelectionKernel &kernel, const std::vector<Float_t> &jetPt, const std::vector<Float_t> &jetPhi, const std::vector<Float_t> &jetEta, const std::vector<Float_t> &jetRawPt, const std::vector<Float_t> &jetMaxTrackPt){
+  const Int_t nJets = jetPt.size();
+  Bool_t agrees = CompareEvent<true,true>(kernel, nJets, jetPt.data(), jetPhi.data(), jetEta.data(), jetRawPt.data(), jetMaxTrackPt.data());
+  agrees = agrees && CompareEvent<true,false>(kernel, nJets, jetPt.data(), jetPhi.data(), jetEta.data(), jetRawPt.data(), jetMaxTrackPt.data());
+  agrees = agrees && CompareEvent<false,true>(kernel, nJets, jetPt.data(), jetPhi.data(), jetEta.data(), jetRawPt.data(), jetMaxTrackPt.data());
+  agrees = agrees && CompareEvent<false,false>(kernel, nJets, jetPt.data(), jetPhi.data(), jetEta.data(), jetRawPt.data(), jetMaxTrackPt.data());
+  return agrees;
+}
+
+int main(){
+
+  JetSelectionKernel vectorKernel(kEtaCut, kMinPtCut, kMaxPtCut, kMinTrackFraction, kMaxTrackFraction);
+  JetSelectionKernel scalarKernel(kEtaCut, kMinPtCut, kMaxPtCut, kMinTrackFraction, kMaxTrackFraction);
+  scalarKernel.SetUseVectorInstructions(false);
+  if(!vectorKernel.GetUseVectorInstructions()) std::cout << "AVX2 is not available. Only the scalar kernel is tested." << std::endl;
+
+  // Values right at and next to every threshold, and values that should pass each cut
+  const Float_t nan = std::numeric_limits<Float_t>::quiet_NaN();
+  std::vector<Float_t> borderValues;
+  for(Double_t threshold : {kEtaCut, -kEtaCut, kMinPtCut, kMaxPtCut, -0.1, 1.2}){
+    const Float_t floatThreshold = (Float_t)threshold;
+    borderValues.push_back(floatThreshold);
+    borderValues.push_back(std::nextafter(floatThreshold, -INFINITY));
+    borderValues.push_back(std::nextafter(floatThreshold, INFINITY));
+  }
+  borderValues.push_back(nan);
+  borderValues.push_back(0);
+
+  // Each border value is tried for each variable while the others pass all the cuts
+  std::vector<Float_t> jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt;
+  for(Int_t iVariable = 0; iVariable < 3; iVariable++){
+    for(Float_t value : borderValues){
+      jetPt.push_back(iVariable == 0 ? value : 100);
+      jetPhi.push_back(iVariable == 1 ? value : 2);
+      jetEta.push_back(iVariable == 2 ? value : 0.5);
+      jetRawPt.push_back(100);
+      jetMaxTrackPt.push_back(50);
+    }
+  }
+
+  // Track pT fractions at the borders
+  for(Double_t fraction : {kMinTrackFraction, kMaxTrackFraction}){
+    for(Float_t rawPt : {100.0f, 137.3f, 1.0f}){
+      const Float_t maxTrackPt = (Float_t)(fraction * rawPt);
+      for(Float_t trackPt : {maxTrackPt, std::nextafter(maxTrackPt, -INFINITY), std::nextafter(maxTrackPt, INFINITY)}){
+        jetPt.push_back(100); jetPhi.push_back(2); jetEta.push_back(0.5);
+        jetRawPt.push_back(rawPt); jetMaxTrackPt.push_back(trackPt);
+      }
+    }
+  }
+  jetPt.push_back(100); jetPhi.push_back(2); jetEta.push_back(0.5); jetRawPt.push_back(0); jetMaxTrackPt.push_back(0);
+  jetPt.push_back(100); jetPhi.push_back(2); jetEta.push_back(0.5); jetRawPt.push_back(0); jetMaxTrackPt.push_back(5);
+
+  Check(CompareAllCuts(vectorKernel, jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt), "vector kernel agrees with the jet loop at the thresholds");
+  Check(CompareAllCuts(scalarKernel, jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt), "scalar kernel agrees with the jet loop at the thresholds");
+
+  // Random events with all jet multiplicities, including the ones not filling a full vector and the ones above the mask size
+  std::mt19937 generator(12345);
+  std::uniform_real_distribution<Float_t> ptDistribution(0, 300);
+  std::uniform_real_distribution<Float_t> phiDistribution(-3.2, 3.2);
+  std::uniform_real_distribution<Float_t> etaDistribution(-2.5, 2.5);
+  std::uniform_real_distribution<Float_t> fractionDistribution(0, 1);
+  Bool_t randomAgrees = true;
+  for(Int_t nJets = 0; nJets <= JetSelectionKernel::kMaxJets; nJets++){
+    jetPt.resize(nJets); jetPhi.resize(nJets); jetEta.resize(nJets); jetRawPt.resize(nJets); jetMaxTrackPt.resize(nJets);
+    for(Int_t iJet = 0; iJet < nJets; iJet++){
+      jetPt.at(iJet) = ptDistribution(generator);
+      jetPhi.at(iJet) = phiDistribution(generator);
+      jetEta.at(iJet) = etaDistribution(generator);
+      jetRawPt.at(iJet) = jetPt.at(iJet) * 0.9f;
+      jetMaxTrackPt.at(iJet) = jetRawPt.at(iJet) * fractionDistribution(generator);
+    }
+
+    // Equal pT values test that the first of the leading jets is returned
+    if(nJets > 10) jetPt.at(nJets-1) = jetPt.at(3);
+
+    randomAgrees = randomAgrees && CompareAllCuts(vectorKernel, jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt);
+    randomAgrees = randomAgrees && CompareAllCuts(scalarKernel, jetPt, jetPhi, jetEta, jetRawPt, jetMaxTrackPt);
+  }
+  Check(randomAgrees, "kernels agree with the jet loop for random events");
+
+  return TestResult("testJetSelectionKernel");
+}
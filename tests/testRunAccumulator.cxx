@@ -0,0 +1,91 @@
+// Tests for RunAccumulator: the runs with the most weight are kept resolved regardless of the order of the fills
+
+// C++ includes
+#include <vector>
+
+// Own includes
+#include "RunAccumulator.h"
+#include "TestTools.h"
+
+using namespace std;
+
+/*
+ * Fill one jet per run with the given weight, counted in the bin without trigger selection
+ */
+void FillRuns(RunAccumulator &accumulator, const std::vector<UInt_t> &runNumbers, const std::vector<Double_t> &runWeights){
+  std::vector<Double_t> triggerWeight(RunAccumulator::knTriggerBins, 1);
+  const UInt_t triggerMask = 1u << (RunAccumulator::knTriggerBins-1);
+  for(UInt_t iRun = 0; iRun < runNumbers.size(); iRun++){
+    accumulator.Fill(runNumbers.at(iRun), 100, triggerMask, triggerWeight.data(), runWeights.at(iRun));
+  }
+}
+
+int main(){
+
+  // Three small runs first, then four large runs and one small run. With a cap of three runs, the spill at six
+  // runs happens during the filling, and the merge spills down to the cap.
+  std::vector<UInt_t> runNumbers = {1, 2, 3, 10, 11, 12, 13, 14};
+  std::vector<Double_t> runWeights = {1, 1, 1, 5, 6, 7, 8, 0.5};
+  const Double_t totalWeight = 29.5;
+
+  RunAccumulator forwardAccumulator("forward", 3, 50, 0, 500);
+  FillRuns(forwardAccumulator, runNumbers, runWeights);
+  Check(forwardAccumulator.GetNRuns() <= 6, "number of runs stays below twice the cap during the filling");
+  Check(forwardAccumulator.GetRunWeight(13) == 8, "run seen after the spill gets its own slot");
+
+  RunAccumulator forwardMerged("forwardMerged", 3, 50, 0, 500);
+  forwardMerged.Add(&forwardAccumulator);
+  Check(forwardMerged.GetNRuns() == 3, "merge spills down to the cap");
+  CheckClose(forwardMerged.GetRunWeight(11), 6, 1e-12, "run 11 is resolved");
+  CheckClose(forwardMerged.GetRunWeight(12), 7, 1e-12, "run 12 is resolved");
+  CheckClose(forwardMerged.GetRunWeight(13), 8, 1e-12, "run 13 is resolved");
+  Check(forwardMerged.GetRunWeight(10) < 0, "run 10 is in the other bucket");
+  CheckClose(forwardMerged.GetRunWeight(11) + forwardMerged.GetRunWeight(12) + forwardMerged.GetRunWeight(13) + forwardMerged.GetOtherWeight(), totalWeight, 1e-12, "total weight is conserved in the spill");
+
+  // The same runs in the reverse order give the same resolved runs
+  std::vector<UInt_t> reversedRunNumbers(runNumbers.rbegin(), runNumbers.rend());
+  std::vector<Double_t> reversedRunWeights(runWeights.rbegin(), runWeights.rend());
+  RunAccumulator reversedAccumulator("reversed", 3, 50, 0, 500);
+  FillRuns(reversedAccumulator, reversedRunNumbers, reversedRunWeights);
+  RunAccumulator reversedMerged("reversedMerged", 3, 50, 0, 500);
+  reversedMerged.Add(&reversedAccumulator);
+  Check(reversedMerged.GetNRuns() == 3, "reversed merge spills down to the cap");
+  Check(reversedMerged.GetRunWeight(11) == 6 && reversedMerged.GetRunWeight(12) == 7 && reversedMerged.GetRunWeight(13) == 8, "resolved runs do not depend on the fill order");
+  CheckClose(reversedMerged.GetOtherWeight(), forwardMerged.GetOtherWeight(), 1e-12, "other bucket does not depend on the fill order");
+
+  // Adding two accumulators sums the runs in both
+  RunAccumulator twiceMerged(forwardMerged);
+  twiceMerged.Add(&reversedMerged);
+  CheckClose(twiceMerged.GetRunWeight(13), 16, 1e-12, "added accumulators sum the runs");
+  CheckClose(twiceMerged.GetOtherWeight(), 2*forwardMerged.GetOtherWeight(), 1e-12, "added accumulators sum the other bucket");
+
+  // A run filled again after it was moved to the "other" bucket is not split into a new slot. With a cap of one
+  // run, the third run spills the smallest of the first two.
+  RunAccumulator splitAccumulator("split", 1, 50, 0, 500);
+  FillRuns(splitAccumulator, {5, 6, 7}, {1, 3, 4});
+  Check(splitAccumulator.IsSpilled(5), "smallest run is spilled at twice the cap");
+  FillRuns(splitAccumulator, {5, 5}, {2, 0.5});
+  Check(splitAccumulator.GetRunWeight(5) < 0, "spilled run does not get a new slot");
+  CheckClose(splitAccumulator.GetOtherWeight(), 3.5, 1e-12, "later fills of a spilled run go to the other bucket");
+  CheckClose(splitAccumulator.GetRunWeight(6) + splitAccumulator.GetRunWeight(7) + splitAccumulator.GetOtherWeight(), 10.5, 1e-12, "total weight is conserved for a run filled before and after the spill");
+
+  // A run resolved in one accumulator but spilled in another is moved to the other bucket when they are merged
+  RunAccumulator resolvedAccumulator("resolved", 1, 50, 0, 500);
+  FillRuns(resolvedAccumulator, {5}, {10});
+  RunAccumulator splitMerged("splitMerged", 1, 50, 0, 500);
+  splitMerged.Add(&resolvedAccumulator);
+  Check(splitMerged.GetRunWeight(5) == 10, "run is resolved before the merge");
+  splitMerged.Add(&splitAccumulator);
+  Check(splitMerged.GetRunWeight(5) < 0 && splitMerged.IsSpilled(5), "run spilled in one of the merged accumulators is spilled in the merge");
+  CheckClose(splitMerged.GetRunWeight(7), 4, 1e-12, "largest run stays resolved in the merge");
+  CheckClose(splitMerged.GetOtherWeight(), 3.5 + 10 + 3, 1e-12, "all the fills of the spilled runs are in the other bucket after the merge");
+
+  // The result is the same when the accumulator with the resolved run is added last
+  RunAccumulator reversedSplitMerged("reversedSplitMerged", 1, 50, 0, 500);
+  reversedSplitMerged.Add(&splitAccumulator);
+  reversedSplitMerged.Add(&resolvedAccumulator);
+  Check(reversedSplitMerged.GetRunWeight(5) < 0, "run spilled earlier is not resolved by a later merge");
+  CheckClose(reversedSplitMerged.GetOtherWeight(), splitMerged.GetOtherWeight(), 1e-12, "other bucket does not depend on the merge order");
+
+  return TestResult("testRunAccumulator");
+}
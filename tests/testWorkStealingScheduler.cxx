@@ -0,0 +1,99 @@
+// Tests for WorkStealingScheduler: every task is processed exactly once and idle workers steal work
+
+// C++ includes
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+// Own includes
+#include "WorkStealingScheduler.h"
+#include "TestTools.h"
+
+using namespace std;
+
+/*
+ * Split files into clusters the same way as the analysis does and count how many times each cluster is processed
+ *
+ *  Arguments:
+ *   Int_t nWorkers = Number of worker threads
+ *   const std::vector<Int_t> &nClusters = Number of clusters in each file
+ *   Bool_t allToFirstWorker = Give all the files to the first worker instead of distributing them
+ *   Int_t sleepMicroseconds = Time spent on each cluster
+ *
+ *   return: Total number of tasks stolen by the workers
+ */
+Int_t RunScheduler(Int_t nWorkers, const std::vector<Int_t> &nClusters, Bool_t allToFirstWorker, Int_t sleepMicroseconds){
+
+  const Long64_t clusterSize = 10;
+  const Int_t nFiles = nClusters.size();
+  std::vector<std::vector<Int_t>> nProcessed(nFiles);
+  for(Int_t iFile = 0; iFile < nFiles; iFile++) nProcessed.at(iFile).assign(nClusters.at(iFile), 0);
+  std::mutex countMutex;
+
+  WorkStealingScheduler scheduler(nWorkers);
+  AnalysisTask fileTask;
+  for(Int_t iFile = 0; iFile < nFiles; iFile++){
+    fileTask.fFileIndex = iFile;
+    fileTask.fFirstEntry = 0;
+    fileTask.fLastEntry = -1;
+    scheduler.PushTask(allToFirstWorker ? 0 : iFile % nWorkers, fileTask);
+  }
+
+  scheduler.Run([&](Int_t iWorker, const AnalysisTask &task){
+    Long64_t firstEntry = task.fFirstEntry;
+    if(task.fLastEntry < 0){
+      std::vector<AnalysisTask> clusterTasks;
+      AnalysisTask clusterTask;
+      clusterTask.fFileIndex = task.fFileIndex;
+      for(Int_t iCluster = 1; iCluster < nClusters.at(task.fFileIndex); iCluster++){
+        clusterTask.fFirstEntry = iCluster * clusterSize;
+        clusterTask.fLastEntry = (iCluster+1) * clusterSize;
+        clusterTasks.push_back(clusterTask);
+      }
+      scheduler.PushSubtasks(iWorker, clusterTasks);
+    }
+    if(sleepMicroseconds > 0) this_thread::sleep_for(chrono::microseconds(sleepMicroseconds));
+    lock_guard<mutex> countLock(countMutex);
+    nProcessed.at(task.fFileIndex).at(firstEntry / clusterSize)++;
+  });
+
+  // Every cluster is processed exactly once, and the statistics include all the tasks
+  Bool_t allOnce = true;
+  Int_t nTotalClusters = 0;
+  for(Int_t iFile = 0; iFile < nFiles; iFile++){
+    for(Int_t count : nProcessed.at(iFile)) allOnce = allOnce && count == 1;
+    nTotalClusters += nClusters.at(iFile);
+  }
+  Check(allOnce, Form("%d workers, %d files: every cluster processed once", nWorkers, nFiles));
+
+  Int_t nProcessedTasks = 0;
+  Int_t nStolenTasks = 0;
+  for(Int_t iWorker = 0; iWorker < nWorkers; iWorker++){
+    nProcessedTasks += scheduler.GetNProcessedTasks(iWorker);
+    nStolenTasks += scheduler.GetNStolenTasks(iWorker);
+  }
+  Check(nProcessedTasks == nTotalClusters, Form("%d workers, %d files: processed task count", nWorkers, nFiles));
+
+  return nStolenTasks;
+}
+
+int main(){
+
+  // One worker runs everything in the calling thread
+  Check(RunScheduler(1, {3, 1, 5}, false, 0) == 0, "single worker does not steal");
+
+  // Files of different sizes distributed over the workers
+  RunScheduler(4, {20, 1, 7, 13, 2, 40, 9}, false, 0);
+
+  // Files without clusters after the first one and more workers than tasks
+  RunScheduler(8, {1, 1}, false, 0);
+
+  // All the work given to one worker has to be stolen by the others
+  Check(RunScheduler(4, {60}, true, 200) > 0, "idle workers steal clusters from a busy worker");
+
+  // Repeat to catch workers sleeping through the last task
+  for(Int_t iRepeat = 0; iRepeat < 50; iRepeat++) RunScheduler(6, {5, 3, 8, 1}, false, 0);
+
+  return TestResult("testWorkStealingScheduler");
+}
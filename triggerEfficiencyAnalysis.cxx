@@ -9,6 +9,11 @@
 #include <iomanip>    // Libraries for checking boolean input
 #include <algorithm>  // Libraries for checking boolean input
 #include <cctype>     // Libraries for checking boolean input
+#include <map>        // Bookkeeping for worker processes
+#include <deque>      // Queue of shards waiting for a worker process
+#include <unistd.h>   // fork for multi-process running
+#include <sys/wait.h> // waitpid for multi-process running
+#include <limits>     // Open-ended entry ranges from the remainder manifest
 
 // Includes from Root
 #include <TString.h>
@@ -17,11 +22,17 @@
 #include <TMath.h>
 #include <TObjArray.h>
 #include <TObjString.h>
+#include <TFileMerger.h>
+#include <TSystem.h>
 
 // Own includes
 #include "src/TriggerAnalyzer.h"
 #include "src/ConfigurationCard.h"
 #include "src/TriggerHistograms.h"
+#include "src/FixedPointHistogram.h"
+#include "src/AnalysisCheckpoint.h"
+#include "src/RuntimeBudget.h"
+#include "src/DataFrameAnalyzer.h"
 
 using namespace std;
 
@@ -34,8 +45,12 @@ using namespace std;
  *    int debug = Level of debug messages shown
  *    int locationIndex = Where to find analysis files: 0 = Purdue EOS, 1 = CERN EOS, 2 = Vanderbilt T2,  3 = Use xrootd to find the data
  *    bool runLocal = True: Local run mode. False: Crab run mode
+ *    std::vector<AnalysisTask> &entryRanges = Ranges of entries to analyze, if given in the file list. Empty if whole files are analyzed.
+ *
+ *  In local run mode, a line can also be "fileName firstEntry lastEntry" as in the remainder manifest written when
+ *  the analysis is stopped. Then only the given ranges of the file are analyzed. Last entry -1 means the end of the file.
  */
-void ReadFileList(std::vector<TString> &fileNameVector, TString fileNameFile, int debug, int locationIndex, bool runLocal)
+void ReadFileList(std::vector<TString> &fileNameVector, TString fileNameFile, int debug, int locationIndex, bool runLocal, std::vector<AnalysisTask> &entryRanges)
 {
   
   // Possible location for the input files
@@ -45,6 +60,7 @@ void ReadFileList(std::vector<TString> &fileNameVector, TString fileNameFile, in
   ifstream file_stream(fileNameFile);
   std::string line;
   fileNameVector.clear();
+  entryRanges.clear();
   if( debug > 0 ) std::cout << "Open file " << fileNameFile.Data() << " to extract files to run over" << std::endl;
   
   // Open the file names file for reading
@@ -63,7 +79,20 @@ void ReadFileList(std::vector<TString> &fileNameVector, TString fileNameFile, in
         
         if(runLocal){
           // For local running, it is assumed that the file name is directly the centents of the line
-          fileNameVector.push_back(lineString);
+          TObjArray *lineTokens = lineString.Tokenize(" ");
+          if(lineTokens->GetEntries() != 3){
+            fileNameVector.push_back(lineString);
+          } else {
+            // Line from the remainder manifest with a range of entries. The ranges of one file share the file index.
+            TString rangeFileName = ((TObjString*)lineTokens->At(0))->String();
+            AnalysisTask entryRange;
+            entryRange.fFileIndex = std::find(fileNameVector.begin(), fileNameVector.end(), rangeFileName) - fileNameVector.begin();
+            if(entryRange.fFileIndex == (int)fileNameVector.size()) fileNameVector.push_back(rangeFileName);
+            entryRange.fFirstEntry = ((TObjString*)lineTokens->At(1))->String().Atoll();
+            entryRange.fLastEntry = ((TObjString*)lineTokens->At(2))->String().Atoll();
+            entryRanges.push_back(entryRange);
+          }
+          delete lineTokens;
           
         } else {
           // For crab running, the line will have format ["file1", "file2", ... , "fileN"]
@@ -100,6 +129,73 @@ void ReadFileList(std::vector<TString> &fileNameVector, TString fileNameFile, in
   }
 }
 
+/*
+ * Find the ranges of entries that are not analyzed when only the given ranges are. These are the gaps between the
+ * given ranges in each file. The gap after the last range reaches past the end of any file.
+ *
+ *  Arguments:
+ *    std::vector<AnalysisTask> entryRanges = Ranges of entries to be analyzed. Last entry -1 means the end of the file.
+ *    int nFiles = Number of files in the file list
+ *
+ *   return: Ranges of entries to be skipped
+ */
+std::vector<AnalysisTask> GetSkippedEntryRanges(std::vector<AnalysisTask> entryRanges, int nFiles)
+{
+  
+  const Long64_t endOfFile = std::numeric_limits<Long64_t>::max();
+  for(AnalysisTask &entryRange : entryRanges){
+    if(entryRange.fLastEntry < 0) entryRange.fLastEntry = endOfFile;
+  }
+  std::sort(entryRanges.begin(), entryRanges.end(), [](const AnalysisTask &first, const AnalysisTask &second){
+    if(first.fFileIndex != second.fFileIndex) return first.fFileIndex < second.fFileIndex;
+    return first.fFirstEntry < second.fFirstEntry;
+  });
+  
+  std::vector<AnalysisTask> skippedRanges;
+  AnalysisTask skippedRange;
+  unsigned int iRange = 0;
+  for(int iFile = 0; iFile < nFiles; iFile++){
+    skippedRange.fFileIndex = iFile;
+    Long64_t firstSkippedEntry = 0;
+    for(; iRange < entryRanges.size() && entryRanges.at(iRange).fFileIndex == iFile; iRange++){
+      if(entryRanges.at(iRange).fFirstEntry > firstSkippedEntry){
+        skippedRange.fFirstEntry = firstSkippedEntry;
+        skippedRange.fLastEntry = entryRanges.at(iRange).fFirstEntry;
+        skippedRanges.push_back(skippedRange);
+      }
+      firstSkippedEntry = std::max(firstSkippedEntry, entryRanges.at(iRange).fLastEntry);
+    }
+    if(firstSkippedEntry < endOfFile){
+      skippedRange.fFirstEntry = firstSkippedEntry;
+      skippedRange.fLastEntry = endOfFile;
+      skippedRanges.push_back(skippedRange);
+    }
+  }
+  
+  return skippedRanges;
+}
+
+/*
+ * Write the units left unprocessed after a stop to a text file that can be given as the file list for a new job
+ *
+ *  Arguments:
+ *    std::vector<AnalysisTask> units = Unprocessed units. Last entry -1 means the end of the file.
+ *    std::vector<TString> fileNameVector = List of analyzed files
+ *    TString manifestFileName = Text file to which the units are written
+ */
+void WriteRemainderManifest(std::vector<AnalysisTask> units, std::vector<TString> fileNameVector, TString manifestFileName)
+{
+  ofstream manifest(manifestFileName.Data());
+  if(!manifest.is_open()){
+    cout << "Error! Could not open " << manifestFileName.Data() << " for writing the remainder manifest" << endl;
+    assert(0);
+  }
+  for(const AnalysisTask &unit : units){
+    manifest << fileNameVector.at(unit.fFileIndex).Data() << " " << unit.fFirstEntry << " " << unit.fLastEntry << endl;
+  }
+  manifest.close();
+}
+
 /*
  *  Convert string to boolean value
  */
@@ -111,6 +207,237 @@ bool checkBool(string str) {
   return b;
 }
 
+/*
+ * Merge the histograms from several files into the output file and write the card there. The checkpoint bookkeeping
+ * is removed from the merged file. With fixed-point sums, the merged histograms are recalculated exactly from the state
+ * trees, so that the result does not depend on how the input was split.
+ *
+ *  Arguments:
+ *    std::vector<TString> inputFileNames = Files with the histograms to be merged
+ *    TString outputFileName = .root file to which the merged histograms are written
+ *    ConfigurationCard *card = Card with the configuration for the analysis. NULL for an intermediate merge, for
+ *                              which the card is not written and the histograms are not recalculated.
+ *
+ *   return: True if the files were merged, false otherwise
+ */
+bool MergeOutputFiles(std::vector<TString> inputFileNames, TString outputFileName, ConfigurationCard *card)
+{
+  
+  // Merge the files in the given order
+  TFileMerger *merger = new TFileMerger(kFALSE);
+  merger->OutputFile(outputFileName, "RECREATE");
+  for(const TString &inputFileName : inputFileNames){
+    merger->AddFile(inputFileName, kFALSE);
+  }
+  bool mergeSuccess = merger->Merge();
+  delete merger;
+  
+  if(!mergeSuccess){
+    cout << "Error! Could not merge the outputs into " << outputFileName.Data() << endl;
+    return false;
+  }
+  
+  TFile *outputFile = new TFile(outputFileName, "UPDATE");
+  outputFile->Delete(Form("%s;*", AnalysisCheckpoint::kUnitTreeName));
+  if(card){
+    if(card->Get("ReproducibleSums") == 1) FixedPointHistogram::FinalizeDirectory(outputFile);
+    card->WriteCard(outputFile);
+  }
+  outputFile->Close();
+  delete outputFile;
+  
+  return true;
+}
+
+/*
+ * Run the analysis in several worker processes
+ *
+ * The file list is split into shards, and each shard is analyzed by a forked worker process writing its histograms
+ * into a temporary file. There are more shards than processes, and a new process is started for the next waiting
+ * shard whenever one finishes, so that the processes with fast shards are not left idle. The workers share nothing with each other, so ROOT global state is never accessed from
+ * more than one thread. If a worker crashes, its shard is given to a new worker. When all the shards are done, the
+ * temporary files are merged into the final output file and the card is written there.
+ *
+ *  Arguments:
+ *    std::vector<TString> fileNameVector = List of files to be analyzed
+ *    ConfigurationCard *card = Card with the configuration for the analysis
+ *    TString outputFileName = .root file to which the merged histograms are written
+ *    int nProcesses = Number of worker processes run at the same time
+ *    int debug = Level of debug messages shown
+ *    std::vector<double> ptHatWeights = Stitching weights for the pT hat bins calculated from all the files. Empty if not used.
+ *
+ *   return: True if all the shards were analyzed and merged, false otherwise
+ */
+bool RunAnalysisInProcesses(std::vector<TString> fileNameVector, ConfigurationCard *card, TString outputFileName, int nProcesses, int debug, std::vector<double> ptHatWeights)
+{
+  
+  // Maximum number of times the analysis of a shard is attempted before giving up
+  const int maxAttempts = 3;
+  
+  // Number of shards for each worker process. Processes finishing early pick up the shards still waiting.
+  const int shardsPerProcess = 4;
+  
+  // Without files there is nothing to shard or merge
+  const int nFiles = fileNameVector.size();
+  if(nFiles == 0){
+    cout << "Error! No files to analyze" << endl;
+    return false;
+  }
+  
+  // Deal the files to the shards in turn, so that the neighbouring files in the list, which often have similar
+  // size and content, go to different shards. The shards are handed out to the processes as they become free.
+  const int nShards = (nFiles < shardsPerProcess*nProcesses) ? nFiles : shardsPerProcess*nProcesses;
+  std::vector<std::vector<TString>> shardFiles(nShards);
+  for(int iFile = 0; iFile < nFiles; iFile++){
+    shardFiles.at(iFile % nShards).push_back(fileNameVector.at(iFile));
+  }
+  
+  // Name the temporary output files after the final output file
+  TString outputBaseName = outputFileName;
+  if(outputBaseName.EndsWith(".root")) outputBaseName.Remove(outputBaseName.Length()-5, 5);
+  std::vector<TString> shardOutputNames;
+  for(int iShard = 0; iShard < nShards; iShard++){
+    shardOutputNames.push_back(Form("%s_shard%d.root", outputBaseName.Data(), iShard));
+  }
+  
+  // Bookkeeping for the shards and worker processes
+  std::deque<int> waitingShards;
+  for(int iShard = 0; iShard < nShards; iShard++) waitingShards.push_back(iShard);
+  std::vector<int> nAttempts(nShards, 0);
+  std::map<pid_t,int> runningShards;
+  
+  // Flush the output, so that the buffered text is not printed again by the workers
+  cout << flush;
+  
+  while(!waitingShards.empty() || !runningShards.empty()){
+    
+    // Start new worker processes as long as there are shards waiting and free slots
+    while(!waitingShards.empty() && (int)runningShards.size() < nProcesses){
+      int iShard = waitingShards.front();
+      waitingShards.pop_front();
+      nAttempts.at(iShard)++;
+      
+      pid_t workerId = fork();
+      
+      if(workerId < 0){
+        cout << "Error! Could not start a worker process for shard " << iShard << endl;
+        return false;
+      }
+      
+      if(workerId == 0){
+        // Worker process: analyze the files in the shard and write the histograms to the temporary file
+        TriggerAnalyzer *shardAnalysis = new TriggerAnalyzer(shardFiles.at(iShard), card);
+        if(!ptHatWeights.empty()) shardAnalysis->SetPtHatStitchingWeights(ptHatWeights);
+        shardAnalysis->SetSpillFileBase(Form("%s_shard%d_spill", outputBaseName.Data(), iShard));
+        shardAnalysis->RunAnalysis();
+        
+        // Histograms spilled because of the memory budget are merged to the shard output
+        std::vector<TString> spillFileNames = shardAnalysis->GetSpillFileNames();
+        TString shardHistogramName = shardOutputNames.at(iShard);
+        if(!spillFileNames.empty()) shardHistogramName = Form("%s_shard%d_unmerged.root", outputBaseName.Data(), iShard);
+        TFile *shardOutputFile = new TFile(shardHistogramName, "RECREATE");
+        shardAnalysis->WriteHistograms();
+        shardOutputFile->Close();
+        if(!spillFileNames.empty()){
+          std::vector<TString> mergedFileNames(1, shardHistogramName);
+          mergedFileNames.insert(mergedFileNames.end(), spillFileNames.begin(), spillFileNames.end());
+          if(!MergeOutputFiles(mergedFileNames, shardOutputNames.at(iShard), NULL)) _exit(1);
+          for(const TString &mergedFileName : mergedFileNames) gSystem->Unlink(mergedFileName);
+        }
+        cout << flush;
+        _exit(0); // Do not run the cleanup inherited from the parent process
+      }
+      
+      if(debug > 0) cout << "Started worker process " << workerId << " for shard " << iShard << " (attempt " << nAttempts.at(iShard) << ")" << endl;
+      runningShards[workerId] = iShard;
+    }
+    
+    // Wait for any of the workers to finish
+    int workerStatus = 0;
+    pid_t finishedId = waitpid(-1, &workerStatus, 0);
+    if(finishedId < 0){
+      cout << "Error! Lost track of the worker processes" << endl;
+      return false;
+    }
+    if(runningShards.find(finishedId) == runningShards.end()) continue;
+    int iShard = runningShards[finishedId];
+    runningShards.erase(finishedId);
+    
+    // A shard is done if the worker exited normally and the output file can be opened
+    bool shardDone = WIFEXITED(workerStatus) && WEXITSTATUS(workerStatus) == 0;
+    if(shardDone){
+      TFile *shardOutputFile = TFile::Open(shardOutputNames.at(iShard));
+      shardDone = shardOutputFile && shardOutputFile->IsOpen() && !shardOutputFile->IsZombie();
+      if(shardOutputFile) shardOutputFile->Close();
+      delete shardOutputFile;
+    }
+    
+    if(shardDone){
+      if(debug > 0) cout << "Worker process " << finishedId << " finished shard " << iShard << endl;
+      continue;
+    }
+    
+    // If the worker crashed, reassign the shard to a new worker
+    if(WIFSIGNALED(workerStatus)){
+      cout << "Warning! Worker process " << finishedId << " for shard " << iShard << " was killed by signal " << WTERMSIG(workerStatus) << endl;
+    } else {
+      cout << "Warning! Worker process " << finishedId << " for shard " << iShard << " failed with exit code " << WEXITSTATUS(workerStatus) << endl;
+    }
+    
+    if(nAttempts.at(iShard) >= maxAttempts){
+      cout << "Error! Shard " << iShard << " failed " << maxAttempts << " times. Giving up." << endl;
+      for(auto &runningShard : runningShards) waitpid(runningShard.first, &workerStatus, 0);
+      return false;
+    }
+    waitingShards.push_back(iShard);
+    
+  } // Loop over shards
+  
+  // Merge the temporary output files in shard order into the final output file
+  if(!MergeOutputFiles(shardOutputNames, outputFileName, card)) return false;
+  
+  // Remove the temporary files
+  for(int iShard = 0; iShard < nShards; iShard++){
+    gSystem->Unlink(shardOutputNames.at(iShard));
+  }
+  
+  return true;
+}
+
+/*
+ * Run the analysis with the RDataFrame engine
+ *
+ *  Arguments:
+ *    std::vector<TString> fileNameVector = List of files to be analyzed
+ *    ConfigurationCard *card = Card with the configuration for the analysis
+ *    TString outputFileName = .root file to which the histograms are written
+ *    std::vector<double> ptHatWeights = Stitching weights for the pT hat bins calculated from all the files. Empty if not used.
+ *
+ *   return: True if the output file was written, false otherwise
+ */
+bool RunDataFrameAnalysis(std::vector<TString> fileNameVector, ConfigurationCard *card, TString outputFileName, std::vector<double> ptHatWeights)
+{
+  
+  DataFrameAnalyzer *dataFrameAnalysis = new DataFrameAnalyzer(fileNameVector, card);
+  if(!ptHatWeights.empty()) dataFrameAnalysis->SetPtHatStitchingWeights(ptHatWeights);
+  dataFrameAnalysis->RunAnalysis();
+  
+  TFile *outputFile = new TFile(outputFileName, "RECREATE");
+  if(!outputFile->IsOpen() || outputFile->IsZombie()){
+    cout << "Error! Could not open the output file " << outputFileName.Data() << endl;
+    delete dataFrameAnalysis;
+    delete outputFile;
+    return false;
+  }
+  dataFrameAnalysis->WriteHistograms();
+  card->WriteCard(outputFile);
+  outputFile->Close();
+  
+  delete dataFrameAnalysis;
+  delete outputFile;
+  return true;
+}
+
 /*
  *  Main program
  *
@@ -120,19 +447,42 @@ bool checkBool(string str) {
  *  argv[3] = .root file to which the histograms are written
  *  argv[4] = Index for the EOS location from where the input files are searched
  *  argv[5] = True: Search input files from local machine. False (default): Search input files from grid with xrootd
+ *  --resume = Continue an interrupted analysis from its checkpoints. Can be given anywhere in the argument list.
+ *  --budget=<minutes> = Wall-clock budget for the job. Overrides RuntimeBudgetMinutes from the card.
  */
 int main(int argc, char **argv) {
   
   //==== Read arguments =====
+  
+  // Take out the options, so that the other arguments keep their positions
+  bool resume = false;
+  double budgetMinutes = -1;
+  int nArguments = 0;
+  for(int iArgument = 0; iArgument < argc; iArgument++){
+    TString argument = argv[iArgument];
+    if(argument == "--resume"){
+      resume = true;
+      continue;
+    }
+    if(argument.BeginsWith("--budget=")){
+      budgetMinutes = TString(argument(9, argument.Length())).Atof();
+      continue;
+    }
+    argv[nArguments++] = argv[iArgument];
+  }
+  argc = nArguments;
+  
   if ( argc<5 ) {
     cout<<"+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++"<<endl;
     cout<<"+ Usage of the macro: " << endl;
-    cout<<"+  "<<argv[0]<<" [fileNameFile] [configurationCard] [outputFileName] [fileLocation] <runLocal>"<<endl;
+    cout<<"+  "<<argv[0]<<" [fileNameFile] [configurationCard] [outputFileName] [fileLocation] <runLocal> <--resume> <--budget=minutes>"<<endl;
     cout<<"+  fileNameFile: Text file containing the list of files used in the analysis. For crab analysis a job id should be given here." <<endl;
     cout<<"+  configurationCard: Card file with binning and cut information for the analysis." <<endl;
     cout<<"+  outputFileName: .root file to which the histograms are written." <<endl;
     cout<<"+  fileLocation: Where to find analysis files: 0 = Purdue EOS, 1 = CERN EOS, 2 = Vanderbilt T2, 3 = Use xrootd to find the data." << endl;
     cout<<"+  runLocal: True: Search input files from local machine. False (default): Search input files from grid with xrootd." << endl;
+    cout<<"+  --resume: Continue an interrupted analysis from the checkpoints written next to the output file." << endl;
+    cout<<"+  --budget=minutes: Stop cleanly before the wall-clock budget runs out and write the unprocessed units to a remainder manifest." << endl;
     cout<<"+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++"<<endl;
     cout << endl << endl;
     exit(1);
@@ -167,29 +517,143 @@ int main(int argc, char **argv) {
     cout << endl;
   }
   
+  // The runtime budget counts from the start of the job. The batch system signals stop the analysis cleanly.
+  // The RDataFrame engine runs its event loop in one go, so it is not stopped by the signals.
+  int nProcesses = configurationCard->Get("NumberOfProcesses");
+  int analysisEngine = configurationCard->Get("AnalysisEngine");
+  if(budgetMinutes < 0) budgetMinutes = configurationCard->Get("RuntimeBudgetMinutes");
+  RuntimeBudget *runtimeBudget = NULL;
+  if(nProcesses <= 1 && analysisEngine != 1){
+    runtimeBudget = new RuntimeBudget(budgetMinutes);
+    RuntimeBudget::InstallSignalHandlers();
+  }
+  
   // Read the file names used for the analysis to a vector
   std::vector<TString> fileNameVector;
+  std::vector<AnalysisTask> entryRanges;
   fileNameVector.clear();
-  ReadFileList(fileNameVector,fileNameFile,debugLevel,fileSearchIndex,runLocal);
+  ReadFileList(fileNameVector,fileNameFile,debugLevel,fileSearchIndex,runLocal,entryRanges);
+  
+  // When stitching MC samples from several pT hat bins, the weights are calculated before the analysis from the event counts in the card or in the file list
+  std::vector<double> ptHatWeights;
+  if(configurationCard->Get("PtHatStitching") == 1) ptHatWeights = TriggerAnalyzer::CalculatePtHatStitchingWeights(fileNameVector, configurationCard);
+  
+  // If requested, run the analysis in several processes instead of a single process
+  bool useCheckpoints = configurationCard->Get("CheckpointFiles") > 0 || configurationCard->Get("CheckpointMinutes") > 0;
+  if(useCheckpoints && configurationCard->Get("HistogramMemoryMB") > 0){
+    cout << "Error! Checkpoints cannot be written when the histograms can be spilled because of the memory budget. Set either CheckpointFiles and CheckpointMinutes or HistogramMemoryMB to 0." << endl;
+    assert(0);
+  }
+  
+  // The RDataFrame engine parallelizes with implicit multithreading and analyzes all the files in one event loop
+  if(analysisEngine == 1){
+    if(useCheckpoints || resume) cout << "Warning! Checkpoints are not supported with the RDataFrame engine. The analysis is run from the beginning without checkpoints." << endl;
+    if(budgetMinutes > 0) cout << "Warning! The runtime budget is not supported with the RDataFrame engine. The analysis is run without a time limit." << endl;
+    if(nProcesses > 1) cout << "Warning! The RDataFrame engine runs in a single process. Use NumberOfThreads for parallel processing." << endl;
+    if(!entryRanges.empty()){
+      cout << "Error! Ranges of entries from a remainder manifest can only be analyzed with the hand-written event loop." << endl;
+      assert(0);
+    }
+    bool success = RunDataFrameAnalysis(fileNameVector, configurationCard, outputFileName, ptHatWeights);
+    delete configurationCard;
+    return success ? 0 : 1;
+  }
   
-  // Variable for histograms in the analysis
-  TriggerHistograms *histograms;
+  if(nProcesses > 1){
+    if(useCheckpoints || resume) cout << "Warning! Checkpoints are not supported with several processes. The analysis is run from the beginning without checkpoints." << endl;
+    if(budgetMinutes > 0) cout << "Warning! The runtime budget is not supported with several processes. The analysis is run without a time limit." << endl;
+    if(!entryRanges.empty()){
+      cout << "Error! Ranges of entries from a remainder manifest can only be analyzed with a single process." << endl;
+      assert(0);
+    }
+    bool success = RunAnalysisInProcesses(fileNameVector, configurationCard, outputFileName, nProcesses, debugLevel, ptHatWeights);
+    delete configurationCard;
+    return success ? 0 : 1;
+  }
+  
+  // Each run of an interrupted analysis writes checkpoints to a file of its own, named after the output file
+  TString outputBaseName = outputFileName;
+  if(outputBaseName.EndsWith(".root")) outputBaseName.Remove(outputBaseName.Length()-5, 5);
+  std::vector<TString> checkpointNames;
+  std::vector<AnalysisTask> previousUnits;
+  std::vector<Long64_t> previousFileEntries(fileNameVector.size(), -1);
+  
+  // If only some ranges of entries are analyzed, the rest are handled as if completed earlier
+  if(!entryRanges.empty()) previousUnits = GetSkippedEntryRanges(entryRanges, fileNameVector.size());
+  if(resume){
+    TString checkpointName = Form("%s_checkpoint%d.root", outputBaseName.Data(), (int)checkpointNames.size());
+    while(AnalysisCheckpoint::ReadUnits(checkpointName, fileNameVector, previousUnits, previousFileEntries)){
+      checkpointNames.push_back(checkpointName);
+      checkpointName = Form("%s_checkpoint%d.root", outputBaseName.Data(), (int)checkpointNames.size());
+    }
+    if(checkpointNames.empty()){
+      cout << "No checkpoints found for " << outputFileName.Data() << ". Starting the analysis from the beginning." << endl;
+    } else {
+      cout << "Resuming the analysis from " << checkpointNames.size() << " checkpoint files with " << previousUnits.size() << " completed units" << endl;
+    }
+  } else if(useCheckpoints){
+    // Checkpoints left over from an earlier analysis with the same output would be mistaken for this one
+    for(int iCheckpoint = 0; gSystem->AccessPathName(Form("%s_checkpoint%d.root", outputBaseName.Data(), iCheckpoint)) == kFALSE; iCheckpoint++){
+      gSystem->Unlink(Form("%s_checkpoint%d.root", outputBaseName.Data(), iCheckpoint));
+    }
+  }
   
   // Run the analysis over the list of files
   TriggerAnalyzer *triggerAnalysis = new TriggerAnalyzer(fileNameVector, configurationCard);
+  if(!ptHatWeights.empty()) triggerAnalysis->SetPtHatStitchingWeights(ptHatWeights);
+  if(!previousUnits.empty()) triggerAnalysis->SetPreviousUnits(previousUnits, previousFileEntries);
+  triggerAnalysis->SetRuntimeBudget(runtimeBudget);
+  if(useCheckpoints) triggerAnalysis->SetCheckpointFile(Form("%s_checkpoint%d.root", outputBaseName.Data(), (int)checkpointNames.size()));
+  triggerAnalysis->SetSpillFileBase(outputBaseName + "_spill");
   triggerAnalysis->RunAnalysis();
-  histograms = triggerAnalysis->GetHistograms();
   
-  // Write the histograms and card to file
-  TFile *outputFile = new TFile(outputFileName, "RECREATE");
-  histograms->Write();
-  configurationCard->WriteCard(outputFile);
+  // If the analysis was stopped, the units left over are listed for a new job. Stale lists are removed.
+  TString manifestFileName = outputBaseName + "_remainder.txt";
+  if(runtimeBudget->IsStopped()){
+    std::vector<AnalysisTask> unprocessedUnits = triggerAnalysis->GetUnprocessedUnits();
+    WriteRemainderManifest(unprocessedUnits, fileNameVector, manifestFileName);
+    cout << "The analysis was stopped with " << unprocessedUnits.size() << " units unprocessed. Give " << manifestFileName.Data() << " as the file list to analyze them." << endl;
+  } else {
+    gSystem->Unlink(manifestFileName);
+  }
+  
+  // Without previous checkpoints or spilled histograms, write the histograms and card directly to the output file.
+  // Otherwise the card is written when the histograms are merged with the checkpoints and spills.
+  std::vector<TString> spillFileNames = triggerAnalysis->GetSpillFileNames();
+  bool mergeOutput = !checkpointNames.empty() || !spillFileNames.empty();
+  TString histogramFileName = outputFileName;
+  if(mergeOutput) histogramFileName = outputBaseName + "_unmerged.root";
+  TFile *outputFile = new TFile(histogramFileName, "RECREATE");
+  triggerAnalysis->WriteHistograms();
+  if(!mergeOutput) configurationCard->WriteCard(outputFile);
   outputFile->Close();
   
   // After writing to the file, delete all created objects
-  delete configurationCard;
   delete triggerAnalysis;
   delete outputFile;
   
+  // The histograms from the previous runs and the spilled histograms are merged with the histograms written last
+  bool success = true;
+  if(mergeOutput){
+    std::vector<TString> mergedFileNames = checkpointNames;
+    mergedFileNames.push_back(histogramFileName);
+    mergedFileNames.insert(mergedFileNames.end(), spillFileNames.begin(), spillFileNames.end());
+    success = MergeOutputFiles(mergedFileNames, outputFileName, configurationCard);
+    if(success){
+      gSystem->Unlink(histogramFileName);
+      for(const TString &spillFileName : spillFileNames) gSystem->Unlink(spillFileName);
+    }
+  }
+  
+  // The checkpoints are not needed after the output is complete
+  if(success){
+    for(const TString &checkpointName : checkpointNames) gSystem->Unlink(checkpointName);
+    if(useCheckpoints) gSystem->Unlink(Form("%s_checkpoint%d.root", outputBaseName.Data(), (int)checkpointNames.size()));
+  }
+  
+  delete configurationCard;
+  delete runtimeBudget;
+  return success ? 0 : 1;
+  
 }
 